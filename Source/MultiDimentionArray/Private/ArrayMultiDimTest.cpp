@@ -1,6 +1,24 @@
 ﻿#pragma once
 #include "Misc/AutomationTest.h"
 #include "ArrayMultiDim.h"
+#include "ArrayMultiDimSummedAreaTable.h"
+#include "ArrayMultiDimSoA.h"
+#include "ArrayMultiDimQuantized.h"
+#include "ArrayMultiDimChunked.h"
+#include "ArrayMultiDimSparse.h"
+#include "ArrayMultiDimView.h"
+#include "ArrayMultiDimTensor.h"
+#include "ArrayMultiDimStencil.h"
+#include "ArrayMultiDimSnapshot.h"
+#include "ArrayMultiDimAsync.h"
+
+// Element type of the structure-of-arrays test.
+struct FSoATestCell
+{
+	float Density;
+	int32 Material;
+	double Temperature;
+};
 
 
 template<typename ArrayMultiType>
@@ -450,5 +468,1557 @@ bool ArrayMultiDimTest::RunTest(const FString& Parameters)
 		PopContext();
 #endif
 	}
+
+	// This block tests the shared storage (copy-on-write) mode
+	{
+		PushContext("Shared storage (copy-on-write) mode");
+		using SharedTestType = ArrayMultiDim::TArrayMultiDim<int, 4, 4>;
+		SharedTestType OriginArray {};
+		OriginArray.SetData([](const SharedTestType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			return InLinearIdx;
+		});
+
+		// Without the shared storage mode, the copy owns its own buffer.
+		SharedTestType DeepCopy = OriginArray;
+		TestFalse("Deep copy doesn't share the buffer: ", OriginArray.IsStorageShared() || DeepCopy.IsStorageShared());
+
+		OriginArray.SetSharedStorageMode(true);
+		SharedTestType SharedCopy = OriginArray;
+		TestTrue("Copy inherits the shared storage mode: ", SharedCopy.IsSharedStorageMode());
+		TestTrue("Copy shares the buffer: ", OriginArray.IsStorageShared() && SharedCopy.IsStorageShared());
+
+		// Const reads never detach the buffer.
+		const SharedTestType& ConstCopy = SharedCopy;
+		TestEqual("Const read of the shared buffer: ", ConstCopy(1, 2), 6);
+		TestTrue("Const read keeps the buffer shared: ", SharedCopy.IsStorageShared());
+
+		// The first write detaches the buffer, the origin array keeps its data.
+		SharedCopy(1, 2) = 100;
+		TestFalse("Write detaches the buffer: ", SharedCopy.IsStorageShared() || OriginArray.IsStorageShared());
+		TestEqual("Copy gets the new value: ", SharedCopy(1, 2), 100);
+		TestEqual("Origin keeps the old value: ", OriginArray(1, 2), 6);
+
+		// Loops and SetData are writes as well.
+		SharedTestType LoopCopy = OriginArray;
+		LoopCopy.LoopByIndex([](const SharedTestType::CoordinateType& InCoordinate, int InLinearIdx, int InLoopCount, int& InData)
+		{
+			InData = -InData;
+		});
+		TestEqual("Loop writes the copy: ", LoopCopy[5], -5);
+		TestEqual("Loop doesn't touch the origin: ", OriginArray[5], 5);
+
+		SharedTestType SetDataCopy;
+		SetDataCopy = OriginArray;
+		TestTrue("Assigned copy shares the buffer: ", SetDataCopy.IsStorageShared());
+		SetDataCopy.SetData([](const SharedTestType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			return InOldData + 1;
+		});
+		TestEqual("SetData writes the copy: ", SetDataCopy[15], 16);
+		TestEqual("SetData doesn't touch the origin: ", OriginArray[15], 15);
+
+		// A move takes the buffer over, even without the shared storage mode.
+		SetDataCopy.SetSharedStorageMode(false);
+		const int* MovedBuffer = static_cast<const SharedTestType&>(SetDataCopy).GetData();
+		SharedTestType Moved = MoveTemp(SetDataCopy);
+		TestTrue("Move doesn't copy the buffer: ", static_cast<const SharedTestType&>(Moved).GetData() == MovedBuffer && Moved[15] == 16);
+		TestTrue("Moved-from array is empty: ", static_cast<const SharedTestType&>(SetDataCopy).GetData() == nullptr);
+		TestEqual("Moved-from fixed array keeps its shape: ", SetDataCopy.GetRuntimeEachDimSize(), SharedTestType::ArrayDimType{4, 4});
+		SharedTestType MoveAssigned;
+		MoveAssigned = MoveTemp(Moved);
+		TestTrue("Move assignment doesn't copy the buffer: ", static_cast<const SharedTestType&>(MoveAssigned).GetData() == MovedBuffer);
+		SharedTestType SharedMoved = MoveTemp(SharedCopy);
+		TestTrue("Move keeps the shared storage mode: ", SharedMoved.IsSharedStorageMode() && !SharedCopy.IsSharedStorageMode() && SharedMoved(1, 2) == 100);
+		ArrayMultiDim::TArrayMultiDim<int, -1, -1> DynamicSource;
+		DynamicSource.SetDimSize({3, 2});
+		ArrayMultiDim::TArrayMultiDim<int, -1, -1> DynamicMoved = MoveTemp(DynamicSource);
+		TestTrue("Moved-from dynamic array is 0-sized: ", DynamicSource.GetTotalSize() == 0 && DynamicMoved.GetTotalSize() == 6);
+		PopContext();
+	}
+
+	// This block tests the prefix scans and the summed-area table
+	{
+		PushContext("Prefix scans and summed-area table");
+		using ScanTestType = ArrayMultiDim::TArrayMultiDim<int, -1, -1, -1>;
+		ScanTestType ScanArray;
+		ScanArray.SetDimSize({3, 4, 5}, {1, 0, 2});
+		auto ResetDataFunc = [](const ScanTestType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			return InCoord[0] * 100 + InCoord[1] * 10 + InCoord[2];
+		};
+		ScanArray.SetData(ResetDataFunc);
+		ScanTestType InclusiveArray = ScanArray;
+		InclusiveArray.InclusiveScan(1);
+		ScanTestType ExclusiveArray = ScanArray;
+		ExclusiveArray.ExclusiveScan(1);
+		ScanArray.ConstLoopByCoord([&](const ScanTestType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const int& InData)
+		{
+			int ExpectedSum = 0;
+			for (int j = 0; j < InCoord[1]; ++j)
+			{
+				ExpectedSum += ScanArray(InCoord[0], j, InCoord[2]);
+			}
+			TestEqual("Exclusive scan along axis 1: ", ExclusiveArray(InCoord[0], InCoord[1], InCoord[2]), ExpectedSum);
+			TestEqual("Inclusive scan along axis 1: ", InclusiveArray(InCoord[0], InCoord[1], InCoord[2]), ExpectedSum + InData);
+		});
+
+		// A few long lines use the blocked parallel scan.
+		ArrayMultiDim::TArrayMultiDim<int64, -1, -1> LongLines;
+		LongLines.SetDimSize({2, 100000}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		LongLines.SetData([](const std::array<int, 2>& InCoord, int InLinearIdx, int64& InOldData) -> int64
+		{
+			return InCoord[1] + InCoord[0];
+		});
+		LongLines.InclusiveScan(1);
+		TestEqual("Blocked scan, line 0 end: ", LongLines(0, 99999), int64(99999) * 100000 / 2);
+		TestEqual("Blocked scan, line 1 end: ", LongLines(1, 99999), int64(99999) * 100000 / 2 + 100000);
+		TestEqual("Blocked scan, block border: ", LongLines(1, 8192), int64(8192) * 8193 / 2 + 8193);
+
+		// Summed-area table box sums against the brute force sums.
+		using SatSourceType = ArrayMultiDim::TArrayMultiDim<int, 6, 7, 5>;
+		SatSourceType SatSource {ArrayMultiDim::Odr<0, 2, 1>()};
+		SatSource.SetData([](const SatSourceType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			return (InCoord[0] * 7 + InCoord[1] * 3 + InCoord[2] * 11) % 13 - 4;
+		});
+		auto BruteForceSum = [&SatSource](const SatSourceType::CoordinateType& InMin, const SatSourceType::CoordinateType& InMax) -> int64
+		{
+			int64 Sum = 0;
+			SatSource.ConstLoopByCoord([&](const SatSourceType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const int& InData)
+			{
+				bool bInside = true;
+				for (int Dim = 0; Dim < 3; ++Dim)
+				{
+					bInside &= InCoord[Dim] >= InMin[Dim] && InCoord[Dim] < InMax[Dim];
+				}
+				Sum += bInside ? InData : 0;
+			});
+			return Sum;
+		};
+		ArrayMultiDim::TSummedAreaTable<int64, 6, 7, 5> Table(SatSource);
+		TestEqual("SAT total sum: ", Table.GetTotalSum(), BruteForceSum({0, 0, 0}, {6, 7, 5}));
+		TestEqual("SAT box sum: ", Table.BoxSum({1, 2, 0}, {4, 7, 3}), BruteForceSum({1, 2, 0}, {4, 7, 3}));
+		TestEqual("SAT box sum at origin: ", Table.BoxSum({0, 0, 0}, {2, 1, 5}), BruteForceSum({0, 0, 0}, {2, 1, 5}));
+		TestEqual("SAT single element: ", Table.BoxSum({5, 6, 4}, {6, 7, 5}), int64(SatSource(5, 6, 4)));
+		TestEqual("SAT empty box: ", Table.BoxSum({3, 3, 3}, {3, 5, 5}), int64(0));
+
+		// Update a plane and a row, then compare with the brute force sums again.
+		for (int j = 0; j < 7; ++j)
+		{
+			for (int k = 0; k < 5; ++k)
+			{
+				SatSource(2, j, k) = j * k;
+			}
+		}
+		Table.UpdateRegion(SatSource, {2, 0, 0}, {3, 7, 5});
+		for (int k = 0; k < 5; ++k)
+		{
+			SatSource(4, 3, k) = -k;
+		}
+		Table.UpdateRegion(SatSource, {4, 3, 0}, {5, 4, 5});
+		TestEqual("SAT total sum after update: ", Table.GetTotalSum(), BruteForceSum({0, 0, 0}, {6, 7, 5}));
+		TestEqual("SAT box sum after update: ", Table.BoxSum({1, 2, 1}, {5, 6, 4}), BruteForceSum({1, 2, 1}, {5, 6, 4}));
+		ArrayMultiDim::TSummedAreaTable<int64, 6, 7, 5> RebuiltTable(SatSource);
+		for (int i = 0; i < RebuiltTable.GetTable().GetTotalSize(); ++i)
+		{
+			TestEqual("SAT matches a rebuilt table: ", Table.GetTable()[i], RebuiltTable.GetTable()[i]);
+		}
+		PopContext();
+	}
+
+	// This block tests the mip pyramid
+	{
+		PushContext("Mip pyramid");
+		using PyramidTestType = ArrayMultiDim::TArrayMultiDim<float, -1, -1>;
+		PyramidTestType Source;
+		Source.SetDimSize({5, 8}, {1, 0}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Source.SetData([](const PyramidTestType::CoordinateType& InCoord, int InLinearIdx, float& InOldData) -> float
+		{
+			return static_cast<float>((InCoord[0] * 5 + InCoord[1] * 3) % 7);
+		});
+
+		TArray<PyramidTestType> MeanLevels = Source.BuildPyramid();
+		TestEqual("Level count: ", MeanLevels.Num(), 3);
+		TestEqual("Level 0 size: ", MeanLevels[0].GetRuntimeEachDimSize(), PyramidTestType::ArrayDimType{3, 4});
+		TestEqual("Level 2 size: ", MeanLevels[2].GetRuntimeEachDimSize(), PyramidTestType::ArrayDimType{1, 1});
+		TestEqual("Levels keep the storage order: ", MeanLevels[1].GetRuntimeStorageOrder(), PyramidTestType::CoordinateType{1, 0});
+		TestEqual("Mean of 4 children: ", MeanLevels[0](1, 2), (Source(2, 4) + Source(2, 5) + Source(3, 4) + Source(3, 5)) / 4.0f);
+		TestEqual("Mean of 2 children at the odd border: ", MeanLevels[0](2, 1), (Source(4, 2) + Source(4, 3)) / 2.0f);
+
+		TArray<PyramidTestType> MaxLevels = Source.BuildPyramid(ArrayMultiDim::EPyramidReducer::MaxReduce);
+		TArray<PyramidTestType> MinLevels = Source.BuildPyramid(ArrayMultiDim::EPyramidReducer::MinReduce, 1);
+		TestEqual("Max level limitation: ", MinLevels.Num(), 1);
+		float SourceMax = Source[0];
+		for (int i = 0; i < Source.GetTotalSize(); ++i)
+		{
+			SourceMax = FMath::Max(SourceMax, Source[i]);
+		}
+		TestEqual("Top of max pyramid: ", MaxLevels.Last()[0], SourceMax);
+		TestEqual("Min of 4 children: ", MinLevels[0](0, 0), FMath::Min(FMath::Min(Source(0, 0), Source(0, 1)), FMath::Min(Source(1, 0), Source(1, 1))));
+
+		TArray<PyramidTestType> CountLevels = Source.BuildPyramid([](const TArray<float>& InChildren) -> float
+		{
+			return static_cast<float>(InChildren.Num());
+		});
+		TestEqual("Custom reducer, corner child count: ", CountLevels[0](2, 3), 2.0f);
+
+		// Change a box of the source, the incremental update must match a full rebuild.
+		for (int i = 1; i < 4; ++i)
+		{
+			for (int j = 5; j < 7; ++j)
+			{
+				Source(i, j) = 10.0f + i * j;
+			}
+		}
+		Source.UpdatePyramid(MaxLevels, {1, 5}, {4, 7}, ArrayMultiDim::EPyramidReducer::MaxReduce);
+		TArray<PyramidTestType> RebuiltLevels = Source.BuildPyramid(ArrayMultiDim::EPyramidReducer::MaxReduce);
+		for (int LevelIndex = 0; LevelIndex < RebuiltLevels.Num(); ++LevelIndex)
+		{
+			for (int i = 0; i < RebuiltLevels[LevelIndex].GetTotalSize(); ++i)
+			{
+				TestEqual("Updated pyramid matches a rebuilt one: ", MaxLevels[LevelIndex][i], RebuiltLevels[LevelIndex][i]);
+			}
+		}
+		PopContext();
+	}
+
+	// This block tests the dirty tracking
+	{
+		PushContext("Dirty tracking");
+		using DirtyTestType = ArrayMultiDim::TArrayMultiDim<int, -1, -1>;
+		DirtyTestType Field;
+		Field.SetDimSize({40, 20}, {1, 0}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		TestFalse("Disabled by default: ", Field.IsDirtyTracking());
+		Field(3, 3) = 1;
+		TestFalse("No dirty block when disabled: ", Field.HasDirtyBlocks());
+
+		Field.SetDirtyTracking(true, 3);  // 8x8 blocks, the grid is 5x3.
+		TestFalse("Starts clean: ", Field.HasDirtyBlocks());
+		const DirtyTestType& ConstField = Field;
+		int ReadValue = ConstField(5, 5) + ConstField[7];
+		TestEqual("Const reads: ", ReadValue, 0);
+		TestFalse("Const reads don't mark: ", Field.HasDirtyBlocks());
+
+		Field(9, 2) = 5;
+		Field[Field.GetLinearIndex({39, 19})] = 6;
+		Field(10, 3) = 7;  // Same block as (9, 2).
+		TArray<TPair<DirtyTestType::CoordinateType, DirtyTestType::CoordinateType>> DirtyBlocks;
+		Field.ForEachDirtyBlock([&](const DirtyTestType::CoordinateType& InBlockMin, const DirtyTestType::CoordinateType& InBlockMax)
+		{
+			DirtyBlocks.Add({InBlockMin, InBlockMax});
+		});
+		TestEqual("Dirty block count: ", DirtyBlocks.Num(), 2);
+		TestEqual("Block of operator(): ", DirtyBlocks[0].Key, DirtyTestType::CoordinateType{8, 0});
+		TestEqual("Block of operator(), end: ", DirtyBlocks[0].Value, DirtyTestType::CoordinateType{16, 8});
+		TestEqual("Block of operator[], clamped: ", DirtyBlocks[1].Value, DirtyTestType::CoordinateType{40, 20});
+
+		Field.ClearDirty();
+		TestFalse("Cleared: ", Field.HasDirtyBlocks());
+		Field.MarkDirtyRegion({7, 7}, {9, 9});
+		int NumRegionBlocks = 0;
+		Field.ForEachDirtyBlock([&](const DirtyTestType::CoordinateType& InBlockMin, const DirtyTestType::CoordinateType& InBlockMax)
+		{
+			++NumRegionBlocks;
+		});
+		TestEqual("A region over a block corner: ", NumRegionBlocks, 4);
+		Field.ClearDirty();
+		Field.MarkDirtyRegion({50, 0}, {60, 5});
+		TestFalse("A region outside the array: ", Field.HasDirtyBlocks());
+		Field.MarkDirtyRegion({-5, 15}, {100, 30});
+		NumRegionBlocks = 0;
+		Field.ForEachDirtyBlock([&](const DirtyTestType::CoordinateType& InBlockMin, const DirtyTestType::CoordinateType& InBlockMax)
+		{
+			++NumRegionBlocks;
+		});
+		TestEqual("A region clamped to the array: ", NumRegionBlocks, 5 * 2);
+
+		Field.ClearDirty();
+		Field.LoopByIndex([](const DirtyTestType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, int& InData)
+		{
+			InData += 1;
+		});
+		int NumLoopBlocks = 0;
+		Field.ForEachDirtyBlock([&](const DirtyTestType::CoordinateType& InBlockMin, const DirtyTestType::CoordinateType& InBlockMax)
+		{
+			++NumLoopBlocks;
+		});
+		TestEqual("Loops mark all blocks: ", NumLoopBlocks, 15);
+
+		// Writes from several threads to the same words of the bitset.
+		Field.ClearDirty();
+		ParallelFor(40, [&](int32 Row)
+		{
+			Field(Row, Row % 20) = Row;
+		});
+		int NumParallelBlocks = 0;
+		Field.ForEachDirtyBlock([&](const DirtyTestType::CoordinateType& InBlockMin, const DirtyTestType::CoordinateType& InBlockMax)
+		{
+			++NumParallelBlocks;
+		});
+		TestEqual("Parallel writes: ", NumParallelBlocks, 8);
+
+		DirtyTestType FieldCopy = Field;
+		TestTrue("Copies keep the dirty state: ", FieldCopy.IsDirtyTracking() && FieldCopy.HasDirtyBlocks());
+		PopContext();
+	}
+
+	// This block tests the ring-buffer (rolling origin) mode
+	{
+		PushContext("Ring-buffer mode");
+		using RingTestType = ArrayMultiDim::TArrayMultiDim<int, -1, -1>;
+		RingTestType Grid;
+		Grid.SetDimSize({5, 4}, {1, 0}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		// The value encodes the world coordinate, the grid starts at world (0, 0).
+		auto WorldValue = [](int InX, int InY) -> int
+		{
+			return InX * 100 + InY;
+		};
+		Grid.SetData([&](const RingTestType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			return WorldValue(InCoord[0], InCoord[1]);
+		});
+
+		// Scroll +2 along axis 0 then -1 along axis 1, the grid starts at world (2, -1).
+		int NumRefilled = 0;
+		Grid.ScrollRingBuffer(0, 2, [&](const RingTestType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			++NumRefilled;
+			return WorldValue(InCoord[0] + 2, InCoord[1]);
+		});
+		TestEqual("Only the exposed slab is refilled: ", NumRefilled, 8);
+		Grid.ScrollRingBuffer(1, -1, [&](const RingTestType::CoordinateType& InCoord, int InLinearIdx, int& InOldData) -> int
+		{
+			return WorldValue(InCoord[0] + 2, InCoord[1] - 1);
+		});
+		TestTrue("Has origin: ", Grid.HasRingOrigin());
+		TestEqual("Origin: ", Grid.GetRingOrigin(), RingTestType::CoordinateType{2, 3});
+
+		bool bAllMatch = true;
+		Grid.ConstLoopByCoord([&](const RingTestType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const int& InData)
+		{
+			bAllMatch &= InData == WorldValue(InCoord[0] + 2, InCoord[1] - 1);
+			bAllMatch &= Grid.GetLinearIndex(InCoord) == InLinearIdx && InLoopCount == InCoord[0] * 4 + InCoord[1];
+		});
+		TestTrue("Loop by coordinate after scrolling: ", bAllMatch);
+		Grid.ConstLoopByIndex([&](const RingTestType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const int& InData)
+		{
+			bAllMatch &= InData == WorldValue(InCoord[0] + 2, InCoord[1] - 1);
+		}, true);
+		TestTrue("Loop by index after scrolling: ", bAllMatch);
+		TestEqual("operator() after scrolling: ", Grid(4, 0), WorldValue(6, -1));
+
+		RingTestType Sliced = Grid.Slice({{2, 5}, {0, 2}});
+		TestEqual("Slice across the wrap: ", Sliced(0, 0), WorldValue(4, -1));
+		TestEqual("Slice across the wrap, end: ", Sliced(2, 1), WorldValue(6, 0));
+		// The rows of the last dimension wrap between 0 and 1.
+		RingTestType Rows = Grid.Slice({{1, 4}, {}});
+		bool bRowsMatch = Rows.GetRuntimeEachDimSize() == RingTestType::ArrayDimType{3, 4};
+		Rows.ConstLoopByCoord([&](const RingTestType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const int& InData)
+		{
+			bRowsMatch &= InData == WorldValue(InCoord[0] + 3, InCoord[1] - 1);
+		});
+		TestTrue("Slice of whole wrapped rows: ", bRowsMatch && Grid.Slice({{0, 5}, 2})(4, 0) == WorldValue(6, 1));
+
+		// The copies, the resize and the normalization keep the coordinates.
+		RingTestType GridCopy = Grid;
+		TestEqual("Copy keeps the origin: ", GridCopy(3, 2), WorldValue(5, 1));
+		GridCopy.NormalizeRingOrigin();
+		TestFalse("Normalized: ", GridCopy.HasRingOrigin());
+		TestEqual("Normalized keeps the values: ", GridCopy(3, 2), WorldValue(5, 1));
+		TestEqual("Normalized plain layout: ", GridCopy[0], WorldValue(2, -1));
+		RingTestType Resized = Grid;
+		Resized.SetDimSize({6, 4});
+		TestEqual("Resize keeps the values: ", Resized(4, 3), WorldValue(6, 2));
+
+		// Scrolling further than the size refills everything.
+		RingTestType Refilled = Grid;
+		Refilled.ScrollRingBuffer(1, 9);
+		TestEqual("Whole array exposed: ", Refilled(1, 1), 0);
+
+		// The summed-area table reads the source through the coordinates.
+		ArrayMultiDim::TSummedAreaTable<int64, -1, -1> Table(Grid);
+		ArrayMultiDim::TSummedAreaTable<int64, -1, -1> PlainTable(GridCopy);
+		TestEqual("SAT of a scrolled array: ", Table.BoxSum({1, 1}, {4, 3}), PlainTable.BoxSum({1, 1}, {4, 3}));
+		PopContext();
+	}
+
+	// This block tests the 64-bit index policy and the shape validation
+	{
+		PushContext("64-bit indexing");
+		// A default-constructed fixed size array has its shape but no storage until SetDimSize() allocates it, so the
+		// huge shape costs nothing here: only the index arithmetic is tested, nothing is written.
+		using HugeVolumeType = ArrayMultiDim::TArrayMultiDim64<uint8, 2048, 2048, 2048>;
+		HugeVolumeType HugeVolume;
+		TestEqual("Total size beyond 2^31: ", HugeVolume.GetTotalSize(), int64(1) << 33);
+		TestEqual("Last linear index: ", HugeVolume.GetLinearIndex({2047, 2047, 2047}), (int64(1) << 33) - 1);
+		TestEqual("64-bit stride: ", HugeVolume.GetRuntimeStride()[0], int64(2048) * 2048);
+
+		// The 32-bit arrays reject the overflowing shapes and keep the old one.
+		ArrayMultiDim::TArrayMultiDim<uint8, -1, -1, -1> SmallVolume;
+		SmallVolume.SetDimSize({4, 5, 6});
+		SmallVolume.SetDimSize({2048, 2048, 2048});
+		TestEqual("Overflowing shape is rejected: ", SmallVolume.GetTotalSize(), 120);
+		SmallVolume.SetDimSize({4, -3, 6});
+		TestEqual("Negative size is rejected: ", SmallVolume.GetRuntimeEachDimSize()[1], 5);
+
+		// The 64-bit arrays provide the same APIs.
+		using Array64Type = ArrayMultiDim::TArrayMultiDim64<int, -1, -1>;
+		Array64Type Array64;
+		Array64.SetDimSize({6, 5}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Array64.SetData([](const Array64Type::CoordinateType& InCoord, int64 InLinearIdx, int& InOldData) -> int
+		{
+			return static_cast<int>(InCoord[0] * 10 + InCoord[1]);
+		});
+		TestEqual("64-bit operator(): ", Array64(4, 3), 43);
+		Array64Type Sliced64 = Array64.Slice({{1, 3}, 2});
+		TestEqual("64-bit slice: ", Sliced64(1, 0), 22);
+		ArrayMultiDim::TArrayMultiDim<std::variant<bool, int>, -1, -1> Mask {{true, true}};
+		TArray<int> Masked = Array64.GetElementsByMask(Mask, {2, 2});
+		TestEqual("64-bit mask: ", Masked.Num(), 2);
+		TestEqual("64-bit mask value: ", Masked[1], 23);
+		const TArray<int64, FDefaultAllocator64> Found64 = Array64.Where([](int InValue) { return InValue % 10 == 4; });
+		TestTrue("64-bit where: ", Found64.Num() == 6 && Array64[Found64[5]] == 54);
+		Array64.ScrollRingBuffer(0, 1);
+		TestEqual("64-bit ring buffer: ", Array64(0, 1), 11);
+		Array64.InclusiveScan(1);
+		TestEqual("64-bit scan: ", Array64(0, 4), 10 + 11 + 12 + 13 + 14);
+		TArray<Array64Type> Levels64 = Array64.BuildPyramid(ArrayMultiDim::EPyramidReducer::MaxReduce);
+		TestEqual("64-bit pyramid: ", Levels64.Last()[0], Array64(4, 4));
+		PopContext();
+	}
+
+	// This block tests the structure-of-arrays storage
+	{
+		PushContext("Structure-of-arrays storage");
+		using FCellFields = ArrayMultiDim::TSoAFields<&FSoATestCell::Density, &FSoATestCell::Material, &FSoATestCell::Temperature>;
+		using SoATestType = ArrayMultiDim::TArrayMultiDimSoA<FSoATestCell, FCellFields, -1, -1>;
+		SoATestType Cells {ArrayMultiDim::Odr<0, 1>()};
+		Cells.SetDimSize({4, 3}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		TestEqual("Planes keep the storage order: ", Cells.GetField<&FSoATestCell::Temperature>().GetRuntimeStorageOrder(), SoATestType::CoordinateType{0, 1});
+		Cells.SetData([](const SoATestType::CoordinateType& InCoord, int InLinearIdx, FSoATestCell& InOldData) -> FSoATestCell
+		{
+			return {InCoord[0] * 1.5f, InCoord[0] * 10 + InCoord[1], 300.0 + InLinearIdx};
+		});
+
+		// The proxy gathers on read and scatters on write.
+		FSoATestCell Cell = Cells(2, 1);
+		TestEqual("Gathered member: ", Cell.Material, 21);
+		Cells(2, 1) = FSoATestCell{-1.f, 99, 0.0};
+		TestEqual("Scattered member: ", Cells.GetField<&FSoATestCell::Material>()(2, 1), 99);
+		TestEqual("Scattered member in its plane: ", Cells.GetField<&FSoATestCell::Density>()(2, 1), -1.f);
+
+		// Single member kernel on the contiguous plane.
+		TArrayView<float> DensityView = Cells.GetFieldView<&FSoATestCell::Density>();
+		TestEqual("Field view size: ", DensityView.Num(), 12);
+		for (float& Density : DensityView)
+		{
+			Density *= 2.f;
+		}
+		TestEqual("Field view writes the plane: ", static_cast<FSoATestCell>(Cells(3, 0)).Density, 9.f);
+		TestEqual("Field view in the storage order: ", DensityView[Cells.GetLinearIndex({1, 2})], 3.f);
+
+		// Slicing, the conversions and the resize keep the members together.
+		SoATestType::SelfDynamicSizeType Sliced = Cells.Slice({{1, 3}, 2});
+		TestEqual("Sliced shape: ", Sliced.GetRuntimeEachDimSize(), SoATestType::ArrayDimType{2, 1});
+		TestEqual("Sliced member: ", static_cast<FSoATestCell>(Sliced(1, 0)).Material, 22);
+		ArrayMultiDim::TArrayMultiDim<FSoATestCell, -1, -1> AoS = Cells.ToAoS();
+		TestEqual("To AoS: ", AoS(1, 2).Temperature, Cells.GetField<&FSoATestCell::Temperature>()(1, 2));
+		SoATestType FromAoS(AoS);
+		TestEqual("From AoS: ", static_cast<FSoATestCell>(FromAoS(3, 2)).Material, 32);
+		// A scrolled source is read by coordinate, not in its raw storage order.
+		AoS.ScrollRingBuffer(0, 1, [](const SoATestType::CoordinateType& InCoord, int InLinearIdx, FSoATestCell& InOldData) -> FSoATestCell
+		{
+			return {0.f, 40 + InCoord[1], 0.0};
+		});
+		SoATestType FromScrolled(AoS);
+		TestEqual("From scrolled AoS: ", static_cast<FSoATestCell>(FromScrolled(0, 1)).Material, 11);
+		TestEqual("From scrolled AoS, refilled: ", static_cast<FSoATestCell>(FromScrolled(3, 2)).Material, 42);
+		Cells.SetDimSize({5, 3});
+		TestEqual("Resize keeps the data: ", static_cast<FSoATestCell>(Cells(3, 2)).Material, 32);
+		PopContext();
+	}
+
+	// This block tests the quantized storage
+	{
+		PushContext("Quantized storage");
+		using FloatFieldType = ArrayMultiDim::TArrayMultiDim<float, -1, -1>;
+		FloatFieldType Field;
+		Field.SetDimSize({40, 30}, {1, 0}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Field.SetData([](const FloatFieldType::CoordinateType& InCoord, int InLinearIdx, float& InOldData) -> float
+		{
+			return FMath::Sin(InCoord[0] * 0.3f) * FMath::Cos(InCoord[1] * 0.2f);
+		});
+		double ExpectedSum = 0.0;
+		float ExpectedMin = Field[0];
+		float ExpectedMax = Field[0];
+		for (int i = 0; i < Field.GetTotalSize(); ++i)
+		{
+			ExpectedSum += Field[i];
+			ExpectedMin = FMath::Min(ExpectedMin, Field[i]);
+			ExpectedMax = FMath::Max(ExpectedMax, Field[i]);
+		}
+
+		// Scaled int8: [-1, 1] mapped to [-128, 127].
+		using Int8FieldType = ArrayMultiDim::TArrayMultiDimQuantized<ArrayMultiDim::FInt8Codec, -1, -1>;
+		const ArrayMultiDim::FInt8Codec Int8Codec = ArrayMultiDim::FInt8Codec::FromRange(-1.f, 1.f);
+		Int8FieldType Int8Field(Field, Int8Codec);
+		TestEqual("Int8 keeps the storage order: ", Int8Field.GetRuntimeStorageOrder(), FloatFieldType::CoordinateType{1, 0});
+		TestTrue("Int8 element decode: ", FMath::Abs(Int8Field(7, 11) - Field(7, 11)) <= Int8Codec.GetMaxError() + 1e-6f);
+		FloatFieldType Int8Decoded = Int8Field.Decode();
+		float MaxError = 0.f;
+		for (int i = 0; i < Field.GetTotalSize(); ++i)
+		{
+			MaxError = FMath::Max(MaxError, FMath::Abs(Int8Decoded[i] - Field[i]));
+		}
+		TestTrue("Int8 bulk decode error: ", MaxError <= Int8Codec.GetMaxError() + 1e-6f);
+		TestTrue("Int8 sum: ", FMath::Abs(Int8Field.Sum() - ExpectedSum) <= Int8Codec.GetMaxError() * Field.GetTotalSize());
+		TestTrue("Int8 min: ", FMath::Abs(Int8Field.Min() - ExpectedMin) <= Int8Codec.GetMaxError() + 1e-6f);
+		TestTrue("Int8 max: ", FMath::Abs(Int8Field.Max() - ExpectedMax) <= Int8Codec.GetMaxError() + 1e-6f);
+		Int8Field(2, 3) = 5.f;
+		TestTrue("Int8 clamps: ", FMath::Abs(Int8Field(2, 3) - 1.f) < 1e-5f);
+		TestEqual("Int8 clamps a huge value: ", Int8Codec.Encode(1e30f), TNumericLimits<int8>::Max());
+		TestEqual("Int8 clamps a huge negative value: ", Int8Codec.Encode(-1e30f), TNumericLimits<int8>::Min());
+		TestEqual("Int32 clamps a huge value: ", ArrayMultiDim::TScaledIntCodec<int32>(1.f, 0.f).Encode(1e30f), TNumericLimits<int32>::Max());
+		Int8Field(2, 3) = 0.5f;
+		Int8Field(2, 3) += 0.25f;
+		TestTrue("Int8 encode: ", FMath::Abs(Int8Field(2, 3) - 0.75f) <= 2.f * Int8Codec.GetMaxError());
+
+		// Half-float.
+		using HalfFieldType = ArrayMultiDim::TArrayMultiDimQuantized<ArrayMultiDim::FHalfFloatCodec, -1, -1>;
+		HalfFieldType HalfField(Field, ArrayMultiDim::FHalfFloatCodec());
+		TestTrue("Half element decode: ", FMath::Abs(HalfField(13, 29) - Field(13, 29)) < 1e-3f);
+		TestTrue("Half sum: ", FMath::Abs(HalfField.Sum() - ExpectedSum) < 1e-3 * Field.GetTotalSize());
+		TestEqual("Half max: ", HalfField.Max(), ArrayMultiDim::FHalfFloatCodec().Decode(ArrayMultiDim::FHalfFloatCodec().Encode(ExpectedMax)));
+		int64 NumDecoded = 0;
+		HalfField.ForEachDecodedChunk([&](int InStartIndex, const float* InValues, int32 InCount)
+		{
+			NumDecoded += InCount;
+		});
+		TestEqual("Decoded chunks cover the array: ", NumDecoded, int64(1200));
+
+		// Slicing and the masks decode the same values.
+		HalfFieldType::SelfDynamicSizeType HalfSliced = HalfField.Slice({{10, 20}, 5});
+		TestEqual("Sliced value: ", HalfSliced(3, 0), HalfField(13, 5));
+		ArrayMultiDim::TArrayMultiDim<std::variant<bool, int>, -1, -1> Mask {{true, false, true}};
+		TArray<float> Masked = Int8Field.GetElementsByMask(Mask, {4, 4}, {0, 1});
+		TestEqual("Masked count: ", Masked.Num(), 2);
+		TestEqual("Masked value: ", Masked[1], static_cast<float>(Int8Field(4, 5)));
+
+		// uint8 with a new range.
+		ArrayMultiDim::TArrayMultiDimQuantized<ArrayMultiDim::FUInt8Codec, -1, -1> UInt8Field(Field, ArrayMultiDim::FUInt8Codec::FromRange(-1.f, 1.f));
+		UInt8Field.Recode(ArrayMultiDim::FUInt8Codec::FromRange(-2.f, 2.f));
+		TestTrue("Recoded value: ", FMath::Abs(UInt8Field(7, 11) - Field(7, 11)) <= 3.f * UInt8Field.GetCodec().GetMaxError());
+		TestEqual("4x smaller storage: ", sizeof(ArrayMultiDim::FUInt8Codec::StoredType) * 4, sizeof(float));
+		PopContext();
+	}
+
+	// This block tests the compressed chunk storage
+	{
+		PushContext("Compressed chunk storage");
+		ArrayMultiDim::FChunkedStorageSettings Settings;
+		Settings.ChunkSizeLog2 = 3;
+		Settings.MaxHotChunks = 4;
+		using ChunkedType = ArrayMultiDim::TArrayMultiDimChunked<int32, -1, -1, -1>;
+		ChunkedType Chunked(Settings);
+		Chunked.SetDimSize({20, 30, 12});
+		TestEqual("Chunk count: ", Chunked.GetChunkCount(), 3 * 4 * 2);
+		TestEqual("Initial value: ", Chunked.Get(19, 29, 11), 0);
+		ArrayMultiDim::FChunkedStorageStats Stats = Chunked.GetStats();
+		TestEqual("All chunks start uniform: ", Stats.NumUniformChunks, 3 * 4 * 2 - 1);
+
+		// Write every element, the working set is much smaller than the array.
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1, -1> Dense;
+		Dense.SetDimSize({20, 30, 12}, ArrayMultiDim::EResizeDataCopyPolicy::SetToUninitializedValue);
+		Dense.LoopByCoord([](const auto& InCoord, int32 InLinearIdx, int32 InLoopCount, int32& OutValue)
+		{
+			OutValue = InCoord[0] < 10 ? 7 : (InCoord[1] < 15 ? InCoord[2] / 4 : InCoord[0] * 1000 + InCoord[1] * 10 + InCoord[2]);
+		});
+		for (int x = 0; x < 20; ++x)
+		{
+			for (int y = 0; y < 30; ++y)
+			{
+				for (int z = 0; z < 12; ++z)
+				{
+					Chunked(x, y, z) = Dense(x, y, z);
+				}
+			}
+		}
+		Chunked.Flush(true);
+		Stats = Chunked.GetStats();
+		TestEqual("Everything is cold after a flush: ", Stats.NumColdChunks, Chunked.GetChunkCount());
+		// x < 8 and z < 8 without the border padding: 3 chunks of 7.
+		TestEqual("Uniform chunks: ", Stats.NumUniformChunks, 3);
+		TestTrue("Compressed: ", Stats.GetCompressionRatio() > 1.0);
+
+		// Read back in another order, every value survives the compression round trip.
+		bool bAllEqual = true;
+		for (int z = 0; z < 12; ++z)
+		{
+			for (int y = 0; y < 30; ++y)
+			{
+				for (int x = 0; x < 20; ++x)
+				{
+					bAllEqual &= Chunked.Get(x, y, z) == Dense(x, y, z);
+				}
+			}
+		}
+		TestTrue("Round trip: ", bAllEqual);
+		Stats = Chunked.GetStats();
+		TestTrue("Working set respected: ", Stats.NumHotChunks <= Settings.MaxHotChunks);
+		TestTrue("Hits and misses counted: ", Stats.NumHits > 0 && Stats.NumMisses > 0);
+
+		// Dense conversions and slicing.
+		ChunkedType::DenseArrayType Restored = Chunked.ToDense();
+		TestTrue("ToDense: ", Restored.GetRuntimeEachDimSize() == Dense.GetRuntimeEachDimSize() && Restored(19, 3, 7) == Dense(19, 3, 7));
+		ChunkedType::SelfDynamicSizeType Sliced = Chunked.Slice({{8, 12}, 20, {}});
+		TestEqual("Sliced shape: ", Sliced.GetRuntimeEachDimSize(), ChunkedType::ArrayDimType{4, 1, 12});
+		TestEqual("Sliced value: ", Sliced(3, 0, 5), Dense(11, 20, 5));
+		ChunkedType Copy(Settings);
+		Copy.FromDense(Dense);
+		int64 Sum = 0;
+		Copy.ConstLoopByCoord([&](const ChunkedType::CoordinateType& InCoord, const int32& InValue)
+		{
+			Sum += InValue - Dense(InCoord[0], InCoord[1], InCoord[2]);
+		});
+		TestEqual("FromDense: ", Sum, int64(0));
+
+		// Synchronous compression, and Fill() makes every chunk uniform again.
+		Settings.bBackgroundCompression = false;
+		ArrayMultiDim::TArrayMultiDimChunked<float, 64, 64> Fixed(Settings);
+		Fixed(1, 2) = 3.f;
+		Fixed(63, 63) = 4.f;
+		for (int i = 0; i < 64; ++i)
+		{
+			Fixed(i, i) += 1.f;
+		}
+		TestEqual("Evicted and read back: ", Fixed.Get(1, 2), 3.f);
+		TestEqual("Accumulated: ", Fixed.Get(63, 63), 5.f);
+		Fixed.Fill(2.f);
+		Stats = Fixed.GetStats();
+		TestEqual("Fill: ", Stats.NumUniformChunks, Fixed.GetChunkCount());
+		TestEqual("Filled value: ", Fixed.Get(5, 6), 2.f);
+		PopContext();
+	}
+
+	// This block tests the sparse storage
+	{
+		PushContext("Sparse storage");
+		using SparseType = ArrayMultiDim::TArrayMultiDimSparse<float, -1, -1, -1>;
+		SparseType Sparse(-1.f);
+		Sparse.SetDimSize({1000, 1000, 100});
+		TestEqual("Background: ", Sparse.Get(999, 999, 99), -1.f);
+		TestEqual("Nothing allocated: ", Sparse.GetBrickCount(), 0);
+
+		Sparse(10, 20, 30) = 5.f;
+		Sparse(11, 20, 30) = 6.f;
+		Sparse(500, 500, 50) = 7.f;
+		Sparse(500, 500, 50) += 1.f;
+		TestEqual("Active count: ", Sparse.GetActiveCount(), int64(3));
+		TestEqual("Brick count: ", Sparse.GetBrickCount(), 2);
+		TestEqual("Value: ", Sparse.Get(500, 500, 50), 8.f);
+		TestEqual("Inactive neighbour: ", Sparse.Get(12, 20, 30), -1.f);
+		TestTrue("Active: ", Sparse.IsActive({11, 20, 30}) && !Sparse.IsActive({12, 20, 30}));
+		TestTrue("Memory proportional to the active content: ", Sparse.GetAllocatedSize() < 16 * 1024);
+
+		float ActiveSum = 0.f;
+		int32 ActiveVisited = 0;
+		Sparse.ConstForEachActive([&](const SparseType::CoordinateType& InCoord, const float& InValue)
+		{
+			ActiveSum += InValue;
+			++ActiveVisited;
+		});
+		TestEqual("Active iteration: ", ActiveVisited, 3);
+		TestEqual("Active sum: ", ActiveSum, 19.f);
+
+		// Masks return the background for the inactive cells and the constant border.
+		ArrayMultiDim::TArrayMultiDim<std::variant<bool, int>, -1, -1, -1> Mask {{{true, true, true}}};
+		TArray<float> Masked = Sparse.GetElementsByMask(Mask, {10, 20, 30}, {0, 0, 1});
+		TestEqual("Masked count: ", Masked.Num(), 3);
+		TestEqual("Masked values: ", Masked, TArray<float>{-1.f, 5.f, -1.f});
+		Masked = Sparse.GetElementsByMask(Mask, {0, 0, 99}, {0, 0, 1}, ArrayMultiDim::EBorderMode::ConstantBorder);
+		TestEqual("Constant border is the background: ", Masked.Num(), 3);
+
+		Sparse.Deactivate({10, 20, 30});
+		Sparse(11, 20, 30) = -1.f;
+		TestEqual("Deactivated: ", Sparse.Get(10, 20, 30), -1.f);
+		TestEqual("Pruned bricks: ", Sparse.Prune(), 1);
+		TestEqual("Active after prune: ", Sparse.GetActiveCount(), int64(1));
+		TestEqual("Value after prune: ", Sparse.Get(500, 500, 50), 8.f);
+
+		// Dense <-> sparse.
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Dense;
+		Dense.SetDimSize({37, 45}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Dense(3, 4) = 2;
+		Dense(36, 44) = 3;
+		Dense(20, 0) = 4;
+		ArrayMultiDim::TArrayMultiDimSparse<int32, -1, -1> Sparse2D;
+		Sparse2D.FromDense(Dense);
+		TestEqual("FromDense active count: ", Sparse2D.GetActiveCount(), int64(3));
+		TestEqual("FromDense value: ", Sparse2D.Get(36, 44), 3);
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Restored = Sparse2D.ToDense();
+		bool bAllEqual = Restored.GetRuntimeEachDimSize() == Dense.GetRuntimeEachDimSize();
+		for (int i = 0; i < Dense.GetTotalSize(); ++i)
+		{
+			bAllEqual &= Restored[i] == Dense[i];
+		}
+		TestTrue("ToDense: ", bAllEqual);
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Sliced = Sparse2D.Slice({{2, 5}, 4});
+		TestEqual("Slice: ", Sliced(1, 0), 2);
+		PopContext();
+	}
+
+	// This block tests the external buffers
+	{
+		PushContext("External buffers");
+		// Adopt a TArray without copying.
+		TArray<int32> Buffer;
+		for (int i = 0; i < 12; ++i)
+		{
+			Buffer.Add(i);
+		}
+		const int32* BufferData = Buffer.GetData();
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Adopted;
+		TestTrue("Adopt: ", Adopted.AdoptData(MoveTemp(Buffer), {3, 4}));
+		TestTrue("No copy: ", Adopted.GetData() == BufferData);
+		TestEqual("Adopted value: ", Adopted(2, 1), 9);
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> AdoptedColumnMajor;
+		TArray<int32> ColumnMajor = {0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11};
+		TestTrue("Adopt with order: ", AdoptedColumnMajor.AdoptData(MoveTemp(ColumnMajor), {3, 4}, ArrayMultiDim::Odr<0, 1>()));
+		TestEqual("Adopted order value: ", AdoptedColumnMajor(2, 1), 9);
+		TArray<int32> WrongSize = {1, 2, 3};
+		TestFalse("Adopt rejects a wrong size: ", AdoptedColumnMajor.AdoptData(MoveTemp(WrongSize), {3, 4}));
+		TArray<int32> NegativeShape = {1, 2, 3};
+		TestFalse("Adopt rejects a negative shape: ", AdoptedColumnMajor.AdoptData(MoveTemp(NegativeShape), {-1, -3}));
+		TArray<int32> Released = Adopted.ReleaseData();
+		TestTrue("Release without copy: ", Released.GetData() == BufferData && Released.Num() == 12);
+
+		// Borrow foreign memory with a row pitch.
+		float Texels[4 * 6];
+		for (int i = 0; i < 4 * 6; ++i)
+		{
+			Texels[i] = static_cast<float>(i);
+		}
+		using ConstViewType = ArrayMultiDim::TArrayMultiDimView<const float, -1, -1>;
+		ConstViewType Pitched = ConstViewType::BorrowStrided(Texels, {4, 5}, {6, 1});
+		TestEqual("Pitched value: ", Pitched(2, 3), 15.f);
+		TestFalse("Pitched is not contiguous: ", Pitched.IsContiguous());
+		TestFalse("Borrowed: ", Pitched.IsOwning());
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1> PitchedCopy = Pitched.ToArray();
+		TestEqual("Copied value: ", PitchedCopy(3, 4), 22.f);
+		ConstViewType SubView = Pitched.Slice({{1, 3}, 2});
+		TestEqual("Sub-view shape: ", SubView.GetRuntimeEachDimSize(), ConstViewType::ArrayDimType{2, 1});
+		TestEqual("Sub-view value: ", SubView(1, 0), 14.f);
+
+		// Write through a borrowed TArrayView, and view a TArrayMultiDim.
+		TArray<float> Storage;
+		Storage.SetNumZeroed(6);
+		using ViewType = ArrayMultiDim::TArrayMultiDimView<float, 2, 3>;
+		ViewType Writable = ViewType::Borrow(TArrayView<float>(Storage), {2, 3});
+		Writable(1, 2) = 5.f;
+		TestEqual("Written through the view: ", Storage[5], 5.f);
+		ArrayMultiDim::TArrayMultiDim<float, 2, 3> Fixed {{1.f, 2.f, 3.f}, {4.f, 5.f, 6.f}};
+		ViewType ArrayView(Fixed);
+		ArrayView(0, 1) = 7.f;
+		TestEqual("Written into the array: ", Fixed(0, 1), 7.f);
+		TestTrue("Array view is contiguous: ", ArrayView.IsContiguous());
+		ViewType::SelfDynamicSizeViewType Row = ArrayView.Slice({1, {1, 3}});
+		TestEqual("Fixed view slice shape: ", Row.GetRuntimeEachDimSize(), ViewType::ArrayDimType{1, 2});
+		TestEqual("Fixed view slice value: ", Row(0, 1), 6.f);
+
+		// Adopt: the release function runs once, after the last copy.
+		int32 NumReleased = 0;
+		float* Owned = new float[8]{};
+		{
+			using OwningViewType = ArrayMultiDim::TArrayMultiDimView<float, -1, -1, -1>;
+			OwningViewType Owning = OwningViewType::Adopt(Owned, {2, 2, 2}, [&](float* InData)
+			{
+				delete[] InData;
+				++NumReleased;
+			});
+			OwningViewType Slice = Owning.Slice({1, {}, {}});
+			Owning = OwningViewType();
+			Slice(0, 1, 1) = 1.f;
+			TestTrue("Owning: ", Slice.IsOwning());
+			TestEqual("Not released while referenced: ", NumReleased, 0);
+		}
+		TestEqual("Released once: ", NumReleased, 1);
+		PopContext();
+	}
+
+	// This block tests the batched gather / scatter
+	{
+		PushContext("Gather and scatter");
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Field;
+		Field.SetDimSize({300, 200}, ArrayMultiDim::Odr<0, 1>(), ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Field.SetData([](const auto& InCoord, int InLinearIdx, float& InOldData)
+		{
+			return static_cast<float>(InCoord[0] * 1000 + InCoord[1]);
+		});
+
+		TArray<ArrayMultiDim::TArrayMultiDim<float, -1, -1>::CoordinateType> Coords;
+		for (int i = 0; i < 10000; ++i)
+		{
+			Coords.Add({(i * 7919) % 300, (i * 104729) % 200});
+		}
+		TArray<float> Gathered;
+		Field.Gather(Coords, Gathered);
+		TArray<float> GatheredSorted;
+		Field.Gather(Coords, GatheredSorted, true);
+		bool bGatherEqual = Gathered.Num() == Coords.Num();
+		for (int i = 0; i < Coords.Num(); ++i)
+		{
+			bGatherEqual &= Gathered[i] == Field(Coords[i][0], Coords[i][1]) && GatheredSorted[i] == Gathered[i];
+		}
+		TestTrue("Gather: ", bGatherEqual);
+
+		// Deposits with duplicated coordinates, all the modes give the same sums.
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Serial;
+		Serial.SetDimSize({64, 64}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Atomic = Serial;
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Partitioned = Serial;
+		TArray<ArrayMultiDim::TArrayMultiDim<int32, -1, -1>::CoordinateType> Deposits;
+		TArray<int32> Masses;
+		for (int i = 0; i < 20000; ++i)
+		{
+			Deposits.Add({(i * 31) % 64, (i * 17) % 13});
+			Masses.Add(i % 5 + 1);
+		}
+		Serial.Scatter(Deposits, Masses, ArrayMultiDim::FScatterAdd());
+		Atomic.Scatter(Deposits, Masses, ArrayMultiDim::FScatterAdd(), ArrayMultiDim::EScatterMode::AtomicScatter);
+		Partitioned.Scatter(Deposits, Masses, ArrayMultiDim::FScatterAdd(), ArrayMultiDim::EScatterMode::PartitionedScatter);
+		int64 Total = 0;
+		bool bModesEqual = true;
+		for (int i = 0; i < Serial.GetTotalSize(); ++i)
+		{
+			Total += Serial[i];
+			bModesEqual &= Serial[i] == Atomic[i] && Serial[i] == Partitioned[i];
+		}
+		TestEqual("Scatter total: ", Total, int64(20000 / 5 * 15));
+		TestTrue("Scatter modes agree: ", bModesEqual);
+
+		// Max, and the last write wins for the partitioned assign.
+		Partitioned.Scatter(Deposits, Masses, ArrayMultiDim::FScatterMax(), ArrayMultiDim::EScatterMode::AtomicScatter);
+		TestEqual("Scatter max: ", Partitioned(Deposits[0][0], Deposits[0][1]), Serial(Deposits[0][0], Deposits[0][1]));
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Assigned = Serial;
+		Assigned.Scatter(Deposits, Masses, ArrayMultiDim::FScatterAssign(), ArrayMultiDim::EScatterMode::PartitionedScatter);
+		TestEqual("Partitioned assign keeps the input order: ", Assigned(Deposits.Last()[0], Deposits.Last()[1]), Masses.Last());
+
+		// Non-arithmetic types fall back to the partitioned mode, and the dirty blocks are marked.
+		ArrayMultiDim::TArrayMultiDim<FVector2f, -1, -1> Velocity;
+		Velocity.SetDimSize({32, 32}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Velocity.SetDirtyTracking(true);
+		Velocity.ClearDirty();
+		TArray<ArrayMultiDim::TArrayMultiDim<FVector2f, -1, -1>::CoordinateType> VelocityCoords = {{1, 2}, {1, 2}, {30, 30}};
+		TArray<FVector2f> Impulses = {FVector2f(1.f, 0.f), FVector2f(0.f, 2.f), FVector2f(3.f, 3.f)};
+		Velocity.Scatter(VelocityCoords, Impulses, ArrayMultiDim::FScatterAdd(), ArrayMultiDim::EScatterMode::AtomicScatter);
+		TestTrue("Struct scatter: ", Velocity(1, 2) == FVector2f(1.f, 2.f));
+		int32 NumDirtyBlocks = 0;
+		Velocity.ForEachDirtyBlock([&](const auto& InMin, const auto& InMax) { ++NumDirtyBlocks; });
+		TestEqual("Scatter marks dirty: ", NumDirtyBlocks, 2);
+		PopContext();
+	}
+
+	// This block tests the N-linear sampling
+	{
+		PushContext("N-linear sampling");
+		// f(x, y, z) = 2x + 3y - z + 1 is reproduced exactly by the trilinear interpolation.
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1, -1> Field;
+		Field.SetDimSize({10, 12, 8}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Field.SetData([](const auto& InCoord, int InLinearIdx, float& InOldData)
+		{
+			return 2.f * InCoord[0] + 3.f * InCoord[1] - InCoord[2] + 1.f;
+		});
+		using FloatCoordType = ArrayMultiDim::TArrayMultiDim<float, -1, -1, -1>::FloatCoordinateType;
+		TestEqual("Sample at an element: ", Field.Sample(FloatCoordType{2.f, 3.f, 4.f}), Field(2, 3, 4));
+		TestEqual("Sample inside: ", Field.Sample(FloatCoordType{2.25f, 3.5f, 4.75f}), 2.f * 2.25f + 3.f * 3.5f - 4.75f + 1.f, 1e-4f);
+		TestEqual("Clamped to the edge: ", Field.Sample(FloatCoordType{-3.f, 11.5f, 7.f}), Field(0, 11, 7), 1e-4f);
+		TestEqual("Repeat border: ", Field.Sample(FloatCoordType{9.5f, 0.f, 0.f}, ArrayMultiDim::EBorderMode::RepeatBorder),
+				  0.5f * (Field(9, 0, 0) + Field(0, 0, 0)), 1e-4f);
+		TestEqual("NoPadding renormalizes: ", Field.Sample(FloatCoordType{9.5f, 0.f, 0.f}, ArrayMultiDim::EBorderMode::NoPadding), Field(9, 0, 0), 1e-4f);
+
+		// The batch matches the single samples, inside and on the border.
+		TArray<FloatCoordType> Positions;
+		for (int i = 0; i < 1000; ++i)
+		{
+			Positions.Add({(i % 97) * 0.1f - 0.5f, (i % 89) * 0.13f, (i % 83) * 0.09f});
+		}
+		TArray<float> Sampled;
+		Field.SampleMany(Positions, Sampled);
+		bool bBatchEqual = Sampled.Num() == Positions.Num();
+		for (int i = 0; i < Positions.Num(); ++i)
+		{
+			bBatchEqual &= FMath::Abs(Sampled[i] - Field.Sample(Positions[i])) < 1e-4f;
+		}
+		TestTrue("SampleMany: ", bBatchEqual);
+
+		// Integer arrays interpolate in float, the ring origin goes through the general path.
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Grid {{0, 10}, {20, 30}};
+		TestEqual("Integer bilinear: ", Grid.Sample({0.5f, 0.5f}), 15.f);
+		Grid.ScrollRingBuffer(0, 1);
+		TestEqual("Ring origin: ", Grid.Sample({0.5f, 0.25f}), 0.5f * (Grid(0, 0) * 0.75f + Grid(0, 1) * 0.25f) + 0.5f * (Grid(1, 0) * 0.75f + Grid(1, 1) * 0.25f), 1e-4f);
+		PopContext();
+	}
+
+	// This block tests the connected component labeling
+	{
+		PushContext("Connected components");
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Map {
+			{1, 1, 0, 0, 1},
+			{0, 1, 0, 1, 0},
+			{0, 0, 0, 0, 0},
+			{1, 0, 1, 1, 1}};
+		auto Face = Map.LabelConnectedComponents([](const int32 InCell) { return InCell != 0; });
+		TestEqual("Face components: ", Face.Components.Num(), 5);
+		TestEqual("Labels in the memory order: ", Face.Labels(0, 4), 2);
+		TestEqual("Background: ", Face.Labels(2, 2), 0);
+		TestEqual("Component size: ", Face.Components[Face.Labels(0, 0) - 1].Size, 3);
+		TestTrue("Bounding box: ", Face.Components[Face.Labels(3, 3) - 1].Min[1] == 2 && Face.Components[Face.Labels(3, 3) - 1].Max[1] == 4);
+		auto Full = Map.LabelConnectedComponents([](const int32 InCell) { return InCell != 0; }, ArrayMultiDim::EConnectivity::FullConnectivity);
+		TestEqual("Diagonal components: ", Full.Components.Num(), 4);
+		TestEqual("Diagonal neighbors: ", Full.Labels(0, 4), Full.Labels(1, 3));
+
+		// A noise volume over several slabs, checked against a serial flood fill.
+		ArrayMultiDim::TArrayMultiDim<uint8, -1, -1, -1> Volume;
+		Volume.SetDimSize({40, 64, 64}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Volume.SetData([](const auto& InCoord, int InLinearIdx, uint8& InOldData)
+		{
+			// A hash noise with about 30% of the cells set.
+			return static_cast<uint8>((static_cast<uint32>(InCoord[0] * 73856093 ^ InCoord[1] * 19349663 ^ InCoord[2] * 83492791) >> 4) % 10 < 3);
+		});
+		auto Result = Volume.LabelConnectedComponents([](const uint8 InCell) { return InCell != 0; });
+		TArray<int32> Visited;
+		Visited.SetNumZeroed(Volume.GetTotalSize());
+		int32 NumFloodFills = 0;
+		bool bSameComponents = true;
+		for (int32 Seed = 0; Seed < Volume.GetTotalSize(); ++Seed)
+		{
+			if (Volume[Seed] == 0 || Visited[Seed])
+			{
+				continue;
+			}
+			++NumFloodFills;
+			const int32 Label = Result.Labels[Seed];
+			int32 Size = 0;
+			TArray<int32> Stack = {Seed};
+			Visited[Seed] = 1;
+			while (Stack.Num() > 0)
+			{
+				const int32 Index = Stack.Pop();
+				bSameComponents &= Result.Labels[Index] == Label;
+				++Size;
+				const auto Coord = Volume.GetCoordinate(Index);
+				for (int Dim = 0; Dim < 3; ++Dim)
+				{
+					for (const int Step : {-1, 1})
+					{
+						auto Neighbor = Coord;
+						Neighbor[Dim] += Step;
+						if (Neighbor[Dim] >= 0 && Neighbor[Dim] < Volume.GetRuntimeEachDimSize()[Dim])
+						{
+							const int32 NeighborIndex = Volume.GetLinearIndex(Neighbor);
+							if (Volume[NeighborIndex] != 0 && !Visited[NeighborIndex])
+							{
+								Visited[NeighborIndex] = 1;
+								Stack.Add(NeighborIndex);
+							}
+						}
+					}
+				}
+			}
+			bSameComponents &= Label > 0 && Result.Components[Label - 1].Size == Size;
+		}
+		TestEqual("Same count as the flood fill: ", Result.Components.Num(), NumFloodFills);
+		TestTrue("Same components as the flood fill: ", bSameComponents);
+		PopContext();
+	}
+
+	// This block tests the morphology and median filters
+	{
+		PushContext("Morphology filters");
+		using FilterTestType = ArrayMultiDim::TArrayMultiDim<uint8, -1, -1>;
+		FilterTestType Image;
+		Image.SetDimSize({23, 37}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Image.SetData([](const auto& InCoord, int InLinearIdx, uint8& InOldData)
+		{
+			return static_cast<uint8>((static_cast<uint32>(InCoord[0] * 73856093 ^ InCoord[1] * 19349663) >> 4) % 251);
+		});
+		FilterTestType::MaskType Box {{
+			{1, 1, 1, 1, 1},
+			{1, 1, 1, 1, 1},
+			{1, 1, 1, 1, 1}
+		}};
+		FilterTestType::MaskType Cross {{
+			{0, 1, 0},
+			{1, 1, 1},
+			{0, 1, 0}
+		}};
+
+		// The reference: min / max / median of GetElementsByMask() at every element.
+		auto MatchesReference = [&Image](const FilterTestType::SelfDynamicSizeType& InFiltered, const FilterTestType::MaskType& InMask,
+										 ArrayMultiDim::EBorderMode InBorderMode, int InRank)
+		{
+			bool bEqual = true;
+			const FilterTestType::CoordinateType MaskCenter = {InMask.GetRuntimeEachDimSize()[0] / 2, InMask.GetRuntimeEachDimSize()[1] / 2};
+			Image.ConstLoopByCoord([&](const auto& InCoord, int InLinearIdx, int InLoopCount, const uint8& InData)
+			{
+				TArray<uint8> Window = Image.GetElementsByMask(InMask, InCoord, MaskCenter, InBorderMode);
+				Window.Sort();
+				const int32 Rank = InRank < 0 ? Window.Num() / 2 : (InRank == 0 ? 0 : Window.Num() - 1);
+				bEqual &= InFiltered(InCoord[0], InCoord[1]) == Window[Rank];
+			});
+			return bEqual;
+		};
+		TestTrue("Erode box: ", MatchesReference(Image.Erode({3, 5}), Box, ArrayMultiDim::EBorderMode::NoPadding, 0));
+		TestTrue("Dilate box, reflect: ", MatchesReference(Image.Dilate({3, 5}, ArrayMultiDim::EBorderMode::ReflectBorder), Box, ArrayMultiDim::EBorderMode::ReflectBorder, 1));
+		TestTrue("Erode mask: ", MatchesReference(Image.Erode(Cross), Cross, ArrayMultiDim::EBorderMode::NoPadding, 0));
+		TestTrue("Dilate mask, repeat: ", MatchesReference(Image.Dilate(Cross, ArrayMultiDim::EBorderMode::RepeatBorder), Cross, ArrayMultiDim::EBorderMode::RepeatBorder, 1));
+		TestTrue("Median box: ", MatchesReference(Image.MedianFilter({3, 5}), Box, ArrayMultiDim::EBorderMode::NoPadding, -1));
+		TestTrue("Median mask, reflect101: ", MatchesReference(Image.MedianFilter(Cross, ArrayMultiDim::EBorderMode::Reflect101Border), Cross, ArrayMultiDim::EBorderMode::Reflect101Border, -1));
+
+		// The opening never raises a value and is idempotent, the closing never lowers one.
+		const auto Opened = Image.Open({3, 3});
+		const auto Closed = Image.Close(Cross);
+		bool bOrdered = true;
+		Image.ConstLoopByCoord([&](const auto& InCoord, int InLinearIdx, int InLoopCount, const uint8& InData)
+		{
+			bOrdered &= Opened(InCoord[0], InCoord[1]) <= InData && InData <= Closed(InCoord[0], InCoord[1]);
+		});
+		TestTrue("Open <= source <= close: ", bOrdered);
+		const auto OpenedTwice = Opened.Open({3, 3});
+		bool bIdempotent = true;
+		Opened.ConstLoopByCoord([&](const auto& InCoord, int InLinearIdx, int InLoopCount, const uint8& InData)
+		{
+			bIdempotent &= OpenedTwice(InCoord[0], InCoord[1]) == InData;
+		});
+		TestTrue("Opening is idempotent: ", bIdempotent);
+
+		// The other types take the selection path, the ring origin is applied.
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Heights {{5.f, 1.f, 4.f}, {2.f, 9.f, 3.f}, {8.f, 7.f, 6.f}};
+		TestEqual("Float median: ", Heights.MedianFilter({3, 3})(1, 1), 5.f);
+		Heights.ScrollRingBuffer(0, 1);
+		TestEqual("Ring origin: ", Heights.Erode({1, 3})(0, 1), FMath::Min3(Heights(0, 0), Heights(0, 1), Heights(0, 2)));
+		PopContext();
+	}
+
+	// This block tests the tensor contraction and the matrix product
+	{
+		PushContext("Tensor contraction");
+		using MatrixType = ArrayMultiDim::TArrayMultiDim<float, -1, -1>;
+		// Sizes not multiple of the kernel tiles, and a column-major B.
+		MatrixType A, B;
+		A.SetDimSize({37, 300}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		B.SetDimSize({300, 29}, {1, 0}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		A.SetData([](const auto& InCoord, int InLinearIdx, float& InOldData) { return static_cast<float>((InCoord[0] * 7 + InCoord[1] * 3) % 11) - 5.f; });
+		B.SetData([](const auto& InCoord, int InLinearIdx, float& InOldData) { return static_cast<float>((InCoord[0] * 5 + InCoord[1]) % 13) - 6.f; });
+		auto C = ArrayMultiDim::MatMul(A, B);
+		bool bProductEqual = C.GetRuntimeEachDimSize()[0] == 37 && C.GetRuntimeEachDimSize()[1] == 29;
+		for (int i = 0; i < 37; ++i)
+		{
+			for (int j = 0; j < 29; ++j)
+			{
+				float Expected = 0.f;
+				for (int k = 0; k < 300; ++k)
+				{
+					Expected += A(i, k) * B(k, j);
+				}
+				bProductEqual &= C(i, j) == Expected;
+			}
+		}
+		TestTrue("MatMul: ", bProductEqual);
+
+		// Contract the last axis of a 3D tensor with a ring origin, like numpy.tensordot(T, W, axes=([2], [0])).
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1, -1> Tensor;
+		Tensor.SetDimSize({3, 4, 5}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Tensor.SetData([](const auto& InCoord, int InLinearIdx, int32& InOldData) { return InCoord[0] * 100 + InCoord[1] * 10 + InCoord[2]; });
+		Tensor.ScrollRingBuffer(1, 1);
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Weights {{1, 0}, {0, 1}, {1, 1}, {2, 0}, {0, 2}};
+		auto Contracted = ArrayMultiDim::Contract(Tensor, {2}, Weights, {0});
+		const int32 Expected = Tensor(2, 1, 0) * 0 + Tensor(2, 1, 1) + Tensor(2, 1, 2) + Tensor(2, 1, 4) * 2;
+		TestEqual("Contract: ", Contracted(2, 1, 1), Expected);
+		auto Full = ArrayMultiDim::Contract(Tensor, {1, 2}, Tensor, {1, 2});
+		int32 Gram = 0;
+		Tensor.ConstLoopByCoord([&](const auto& InCoord, int InLinearIdx, int InLoopCount, const int32& InData)
+		{
+			Gram += InCoord[0] == 1 ? InData * Tensor(2, InCoord[1], InCoord[2]) : 0;
+		});
+		TestEqual("Contract 2 axes: ", Full(1, 2), Gram);
+
+		// The batched product matches the product of each batch.
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1, -1> BatchA, BatchB;
+		BatchA.SetDimSize({4, 5, 6}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		BatchB.SetDimSize({4, 6, 3}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		BatchA.SetData([](const auto& InCoord, int InLinearIdx, float& InOldData) { return static_cast<float>(InLinearIdx % 7); });
+		BatchB.SetData([](const auto& InCoord, int InLinearIdx, float& InOldData) { return static_cast<float>(InLinearIdx % 5) - 2.f; });
+		auto Batched = ArrayMultiDim::MatMul(BatchA, BatchB);
+		auto Third = ArrayMultiDim::MatMul(BatchA.Slice({2, {}, {}}), BatchB.Slice({2, {}, {}}));
+		TestEqual("Batched MatMul: ", Batched(2, 4, 1), Third(0, 4, 1));
+		PopContext();
+	}
+
+	// This block tests the sorting, the argsort and the top-k
+	{
+		PushContext("Sorting");
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Scores {
+			{5, 3, 9, 1},
+			{2, 8, 8, 4},
+			{7, 0, 6, 3}};
+		auto RowOrder = Scores.ArgSort(1);
+		TestTrue("ArgSort along rows: ", RowOrder(0, 0) == 3 && RowOrder(0, 3) == 2 && RowOrder(1, 2) == 1 && RowOrder(1, 3) == 2);
+		auto Top2 = Scores.TopKAlongAxis(0, 2);
+		TestTrue("TopK along columns: ", Top2.GetRuntimeEachDimSize()[0] == 2 && Top2(0, 0) == 2 && Top2(1, 0) == 0 && Top2(0, 1) == 1);
+		const auto Best = Scores.TopK(3);
+		TestTrue("Whole-array TopK, ties by index: ", Best.Num() == 3 && Best[0] == Scores.GetCoordinate(2) && Best[1] == Scores.GetCoordinate(5) && Best[2] == Scores.GetCoordinate(6));
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Sorted = Scores;
+		Sorted.Sort(0, TGreater<int32>());
+		TestTrue("Sort along columns: ", Sorted(0, 0) == 7 && Sorted(2, 0) == 2 && Sorted(0, 1) == 8 && Scores(0, 0) == 5);
+
+		// A large array over several chunks and a ring origin: the parallel argsort is a stable sort.
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Big;
+		Big.SetDimSize({700, 300}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Big.SetData([](const auto& InCoord, int InLinearIdx, int32& InOldData) { return static_cast<int32>((static_cast<uint32>(InLinearIdx) * 2654435761u) >> 20); });
+		Big.ScrollRingBuffer(0, 3);
+		const auto Order = Big.ArgSortIndices();
+		bool bStable = Order.Num() == Big.GetTotalSize();
+		for (int32 i = 1; i < Order.Num(); ++i)
+		{
+			bStable &= Big[Order[i - 1]] < Big[Order[i]] || (Big[Order[i - 1]] == Big[Order[i]] && Order[i - 1] < Order[i]);
+		}
+		TestTrue("Parallel ArgSort: ", bStable);
+		const auto Top = Big.TopKIndices(100);
+		bool bTopMatches = Top.Num() == 100;
+		for (int32 i = 0; i < Top.Num(); ++i)
+		{
+			bTopMatches &= Top[i] == Order[Order.Num() - 1 - i] || Big[Top[i]] == Big[Order[Order.Num() - 1 - i]];
+		}
+		TestTrue("Parallel TopK: ", bTopMatches);
+		const auto Columns = Big.ArgSort(0);
+		bool bColumnsSorted = true;
+		for (int32 i = 1; i < 700; ++i)
+		{
+			bColumnsSorted &= Big(Columns(i - 1, 7), 7) <= Big(Columns(i, 7), 7);
+		}
+		TestTrue("ArgSort with ring origin: ", bColumnsSorted);
+		PopContext();
+	}
+
+	// This block tests the histograms and the unique counts, on arrays, slices and views.
+	{
+		PushContext("Histogram");
+		ArrayMultiDim::TArrayMultiDim<uint8, -1, -1> Classes {
+			{0, 2, 2, 1},
+			{3, 2, 0, 1},
+			{2, 2, 3, 0}};
+		const auto Unique = Classes.CountUnique();
+		TestTrue("CountUnique: ", Unique.Num() == 4 && Unique[0].Key == 0 && Unique[0].Value == 3 && Unique[2].Key == 2 && Unique[2].Value == 5);
+		const auto ClassBins = Classes.Histogram(4, 0, 4);
+		TestTrue("Integer histogram: ", ClassBins.Num() == 4 && ClassBins[0] == 3 && ClassBins[1] == 2 && ClassBins[2] == 5 && ClassBins[3] == 2);
+		const auto ColumnBins = Classes.Histogram(4, 0, 4, {{}, 2});
+		TestTrue("Histogram of a slice: ", ColumnBins[0] == 1 && ColumnBins[2] == 1 && ColumnBins[3] == 1);
+		const auto MaxBins = Classes.Histogram(3, 0, 3);
+		TestTrue("Integer histogram, Max in the last bin: ", MaxBins[0] == 3 && MaxBins[1] == 2 && MaxBins[2] == 7);
+		const auto AboveMaxBins = Classes.Histogram(2, 0, 2);
+		TestTrue("Integer histogram, above Max skipped: ", AboveMaxBins[0] == 3 && AboveMaxBins[1] == 7);
+
+		ArrayMultiDim::TArrayMultiDim<float, -1> Samples {-1.f, 0.f, 0.2f, 0.5f, 0.99f, 1.f, 2.f};
+		const auto FloatBins = Samples.Histogram(2, 0.f, 1.f);
+		TestTrue("Range histogram, Max in the last bin: ", FloatBins[0] == 2 && FloatBins[1] == 3);
+		const TArray<float> Edges = {0.f, 0.5f, 2.f};
+		const auto EdgeBins = Samples.Histogram(Edges);
+		TestTrue("Histogram by edges: ", EdgeBins[0] == 2 && EdgeBins[1] == 4);
+		const auto FloatUnique = Samples.CountUnique({{1, 4}});
+		TestTrue("CountUnique of a slice: ", FloatUnique.Num() == 3 && FloatUnique[0].Key == 0.f && FloatUnique[2].Key == 0.5f);
+
+		// A large array with a ring origin, the column view of it is strided.
+		ArrayMultiDim::TArrayMultiDim<int16, -1, -1> Big;
+		Big.SetDimSize({600, 500}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Big.SetData([](const auto& InCoord, int InLinearIdx, int16& InOldData) { return static_cast<int16>(static_cast<int32>((static_cast<uint32>(InLinearIdx) * 2654435761u) >> 24) - 100); });
+		Big.ScrollRingBuffer(1, 7);
+		TArray<int64> Expected;
+		Expected.SetNumZeroed(256);
+		int32 NumExpected = 0;
+		for (int32 i = 0; i < Big.GetTotalSize(); ++i)
+		{
+			NumExpected += Expected[Big[i] + 100]++ == 0;
+		}
+		const auto BigBins = Big.Histogram(256, -100, 156);
+		const auto BigUnique = Big.CountUnique();
+		bool bMatches = BigBins == Expected && BigUnique.Num() == NumExpected;
+		for (const auto& Count : BigUnique)
+		{
+			bMatches &= Expected[Count.Key + 100] == Count.Value;
+		}
+		TestTrue("Parallel histogram with ring origin: ", bMatches);
+		Big.NormalizeRingOrigin();
+		const auto Column = ArrayMultiDim::TArrayMultiDimView<const int16, -1, -1>(Big).Slice({{}, 9});
+		const auto ColumnUnique = Column.CountUnique();
+		int64 ColumnTotal = 0;
+		for (const auto& Count : ColumnUnique)
+		{
+			ColumnTotal += Count.Value;
+		}
+		TestTrue("CountUnique of a strided view: ", ColumnTotal == 600 && Column.Histogram(256, -100, 156)[Column(0, 0) + 100] > 0);
+		PopContext();
+	}
+
+	// This block tests Where / Select / SetWhere.
+	{
+		PushContext("Where and Select");
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Depth {
+			{1.f, -1.f, 3.f},
+			{-2.f, 5.f, 0.f}};
+		const auto Valid = Depth.Where([](float InValue) { return InValue > 0.f; });
+		TestTrue("Where: ", Valid.Num() == 3 && Depth[Valid[0]] == 1.f && Depth[Valid[1]] == 3.f && Depth[Valid[2]] == 5.f);
+		const auto Negative = Depth.WhereCoordinates([](float InValue) { return InValue < 0.f; });
+		TestTrue("WhereCoordinates: ", Negative.Num() == 2 && Negative[0][0] == 0 && Negative[0][1] == 1 && Negative[1][0] == 1 && Negative[1][1] == 0);
+		const auto Positive = Depth.MakeCondition([](float InValue) { return InValue > 0.f; });
+		const auto Clamped = decltype(Depth)::Select(Positive, Depth, 0.f);
+		TestTrue("Select with a constant: ", Clamped(0, 1) == 0.f && Clamped(1, 1) == 5.f && Clamped(1, 0) == 0.f);
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Fallback;
+		Fallback.SetDimSize({2, 3}, ArrayMultiDim::Odr<0, 1>(), ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Fallback(0, 1) = 10.f;
+		const auto Merged = decltype(Depth)::Select(Positive, Depth, Fallback);
+		TestTrue("Select across storage orders: ", Merged(0, 1) == 10.f && Merged(0, 2) == 3.f && Merged(1, 0) == 0.f);
+		Depth.SetWhere([](float InValue) { return InValue < 0.f; }, 0.f);
+		TestTrue("SetWhere by predicate: ", Depth(0, 1) == 0.f && Depth(1, 0) == 0.f && Depth(1, 1) == 5.f);
+
+		// Several chunks, a ring origin and the dirty tracking.
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Big;
+		Big.SetDimSize({500, 400}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Big.SetData([](const auto& InCoord, int InLinearIdx, int32& InOldData) { return static_cast<int32>((static_cast<uint32>(InLinearIdx) * 2654435761u) >> 24); });
+		Big.ScrollRingBuffer(0, 11);
+		const auto Odd = Big.Where([](int32 InValue) { return (InValue & 1) != 0; });
+		bool bCompacted = true;
+		int32 NumOdd = 0;
+		for (int32 i = 0; i < Big.GetTotalSize(); ++i)
+		{
+			if ((Big[i] & 1) != 0)
+			{
+				bCompacted &= NumOdd < Odd.Num() && Odd[NumOdd] == i;
+				++NumOdd;
+			}
+		}
+		TestTrue("Parallel Where: ", bCompacted && NumOdd == Odd.Num());
+		const auto OddCondition = Big.MakeCondition([](int32 InValue) { return (InValue & 1) != 0; });
+		Big.SetDirtyTracking(true);
+		Big.SetWhere(OddCondition, -1);
+		bool bAllSet = true;
+		for (const int32 Index : Odd)
+		{
+			bAllSet &= Big[Index] == -1;
+		}
+		TestTrue("SetWhere by condition with ring origin: ", bAllSet && Big.Where([](int32 InValue) { return InValue == -1; }).Num() == Odd.Num() && Big.HasDirtyBlocks());
+		PopContext();
+	}
+
+	// This block tests the stencil runner against the steps run one by one.
+	{
+		PushContext("Stencil runner");
+		using GridType = ArrayMultiDim::TArrayMultiDim<int32, -1, -1>;
+		GridType Grid;
+		Grid.SetDimSize({37, 23}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Grid.SetData([](const auto& InCoord, int InLinearIdx, int32& InOldData) { return static_cast<int32>((static_cast<uint32>(InLinearIdx) * 2654435761u) >> 28); });
+		const GridType::MaskType Weights {
+			{0, 1, 0},
+			{1, 2, 1},
+			{0, 1, 0}};
+		// The plain steps: a weighted sum of the neighbors, the elements out of the array follow the border mode.
+		auto RunReference = [&](GridType InGrid, int32 InNumSteps, ArrayMultiDim::EBorderMode InBorderMode, int32 InBorderValue)
+		{
+			for (int32 Step = 0; Step < InNumSteps; ++Step)
+			{
+				GridType Next = InGrid;
+				for (int32 X = 0; X < 37; ++X)
+				{
+					for (int32 Y = 0; Y < 23; ++Y)
+					{
+						int32 Sum = 0;
+						for (int32 DX = -1; DX <= 1; ++DX)
+						{
+							for (int32 DY = -1; DY <= 1; ++DY)
+							{
+								const int32 Weight = std::get<int>(Weights(DX + 1, DY + 1));
+								GridType::CoordinateType Neighbor{X + DX, Y + DY};
+								Sum += Weight * (GridType::ResolveBorderCoordinate(Neighbor, {37, 23}, InBorderMode) ? InGrid(Neighbor[0], Neighbor[1]) : InBorderValue);
+							}
+						}
+						Next(X, Y) = Sum % 1000;
+					}
+				}
+				InGrid = Next;
+			}
+			return InGrid;
+		};
+		auto Modulo = [](const auto& InCells)
+		{
+			return (InCells(-1, 0) + InCells(1, 0) + InCells(0, -1) + InCells(0, 1) + 2 * InCells.GetCenter()) % 1000;
+		};
+
+		bool bAllMatch = true;
+		for (const ArrayMultiDim::EBorderMode BorderMode : {ArrayMultiDim::EBorderMode::NoPadding, ArrayMultiDim::EBorderMode::ConstantBorder,
+			ArrayMultiDim::EBorderMode::ReflectBorder, ArrayMultiDim::EBorderMode::Reflect101Border, ArrayMultiDim::EBorderMode::RepeatBorder})
+		{
+			const GridType Expected = RunReference(Grid, 7, BorderMode, BorderMode == ArrayMultiDim::EBorderMode::ConstantBorder ? 5 : 0);
+			ArrayMultiDim::TStencilRunner<int32, -1, -1> Runner(Grid, BorderMode, 5);
+			Runner.SetTileSize({8, 6});
+			Runner.SetStepsPerTile(3);
+			Runner.Run(4, {1, 1}, Modulo);
+			Runner.Run(3, {1, 1}, Modulo);
+			bAllMatch &= Runner.GetStepCount() == 7;
+			Expected.ConstLoopByCoord([&](const GridType::CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const int32& InValue)
+			{
+				bAllMatch &= Runner.GetCurrent()(InCoord[0], InCoord[1]) == InValue;
+			});
+		}
+		TestTrue("Temporal blocking matches the plain steps: ", bAllMatch);
+
+		// The weighted form, the whole array in one tile.
+		ArrayMultiDim::TArrayMultiDim<float, -1> Rod {0.f, 0.f, 8.f, 0.f, 0.f};
+		ArrayMultiDim::TStencilRunner<float, -1> Heat(Rod, ArrayMultiDim::EBorderMode::ReflectBorder);
+		Heat.Run(2, ArrayMultiDim::TArrayMultiDim<float, -1>::MaskType{1, 2, 1}, 0.25);
+		const auto& Diffused = Heat.GetCurrent();
+		TestTrue("Weighted stencil: ", Diffused(2) == 3.f && Diffused(1) == 2.f && Diffused(0) == 0.5f && Diffused(4) == 0.5f);
+
+		// A uint8 sum of 4 * 200 would wrap, it's summed in double.
+		ArrayMultiDim::TArrayMultiDim<uint8, -1> Bytes {200, 200, 200, 200, 200};
+		ArrayMultiDim::TStencilRunner<uint8, -1> Blur(Bytes, ArrayMultiDim::EBorderMode::ReflectBorder);
+		Blur.Run(1, ArrayMultiDim::TArrayMultiDim<uint8, -1>::MaskType{1, 2, 1}, 0.25);
+		TestTrue("Weighted uint8 stencil: ", Blur.GetCurrent()(0) == 200 && Blur.GetCurrent()(2) == 200);
+		PopContext();
+	}
+
+	// This block tests the snapshot publishing.
+	{
+		PushContext("Snapshot publisher");
+		using GridType = ArrayMultiDim::TArrayMultiDim<int32, -1, -1>;
+		GridType Initial;
+		Initial.SetDimSize({100, 70}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		ArrayMultiDim::TSnapshotPublisher<int32, -1, -1> Publisher(Initial, 2);
+		TestTrue("No snapshot before the first publication: ", !Publisher.Acquire().IsValid());
+		Publisher.GetWriteArray()(3, 4) = 1;
+		TestTrue("First publication: ", Publisher.Publish());
+		auto First = Publisher.Acquire();
+		Publisher.GetWriteArray()(90, 60) = 2;
+		TestTrue("Second publication: ", Publisher.Publish());
+		auto Second = Publisher.Acquire();
+		TestTrue("Old snapshot unchanged: ", First.GetVersion() == 1 && (*First)(3, 4) == 1 && (*First)(90, 60) == 0);
+		TestTrue("New snapshot: ", Second.GetVersion() == 2 && (*Second)(3, 4) == 1 && (*Second)(90, 60) == 2);
+		Publisher.GetWriteArray()(50, 10) = 3;
+		TestTrue("Double buffering waits for the readers: ", !Publisher.Publish());
+		First.Release();
+		TestTrue("Publication after the release: ", Publisher.Publish());
+		// The buffer of the first snapshot missed (90, 60), the block is copied forward.
+		auto Third = Publisher.Acquire();
+		TestTrue("Changed blocks copied forward: ", Third.GetVersion() == 3 && (*Third)(3, 4) == 1 && (*Third)(90, 60) == 2 && (*Third)(50, 10) == 3);
+
+		// A writer fills the whole array with the publication number, the readers never see a mixed snapshot.
+		Second.Release();
+		Third.Release();
+		std::atomic<int32> NumTornReads{0};
+		ParallelFor(3, [&](int32 Task)
+		{
+			for (int32 Iteration = 0; Iteration < 200; ++Iteration)
+			{
+				if (Task == 0)
+				{
+					GridType& Writable = Publisher.GetWriteArray();
+					const int32 Value = static_cast<int32>(Publisher.GetPublishedVersion()) + 1;
+					for (int32 i = 0; i < Writable.GetTotalSize(); ++i)
+					{
+						Writable[i] = Value;
+					}
+					Publisher.Publish();
+				}
+				else if (auto Snapshot = Publisher.Acquire(); Snapshot && Snapshot.GetVersion() > 3)
+				{
+					const int32 Value = (*Snapshot)[0];
+					for (int32 i = 0; i < Snapshot->GetTotalSize(); ++i)
+					{
+						NumTornReads += (*Snapshot)[i] != Value;
+					}
+				}
+			}
+		});
+		TestTrue("Consistent concurrent snapshots: ", NumTornReads == 0);
+		PopContext();
+	}
+
+	// This block tests the concurrent writes: disjoint write regions and atomic element operations.
+	{
+		PushContext("Concurrent writes");
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Grid;
+		Grid.SetDimSize({37, 21}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Grid.SetDirtyTracking(true, 3);
+		Grid.ClearDirty();
+		{
+			auto Regions = Grid.PartitionWriteRegions({10, 8});
+			TestTrue("Number of regions: ", Regions.Num() == 4 * 3);
+			TestTrue("Border region clamped: ", Regions.Last().GetMin() == ArrayMultiDim::TArrayMultiDim<int32, -1, -1>::CoordinateType{30, 16}
+				&& Regions.Last().GetMax() == ArrayMultiDim::TArrayMultiDim<int32, -1, -1>::CoordinateType{37, 21});
+			ParallelFor(Regions.Num(), [&](int32 i)
+			{
+				Regions[i].ForEach([i](const auto& InCoord, int32& OutValue) { OutValue = i * 1000 + InCoord[0] + InCoord[1]; });
+			});
+		}
+		bool bRegionsWritten = true;
+		for (int32 x = 0; x < 37; ++x)
+		{
+			for (int32 y = 0; y < 21; ++y)
+			{
+				bRegionsWritten &= Grid(x, y) == (x / 10 + y / 8 * 4) * 1000 + x + y;
+			}
+		}
+		TestTrue("Regions written: ", bRegionsWritten);
+		int32 NumDirtyBlocks = 0;
+		Grid.ForEachDirtyBlock([&](const auto&, const auto&) { ++NumDirtyBlocks; });
+		TestTrue("Region writes marked dirty: ", NumDirtyBlocks == 5 * 3);
+		// The regions were released, the same boxes can be acquired again.
+		auto Again = Grid.AcquireWriteRegion({0, 0}, {37, 21});
+		Again(36, 20) = -1;
+		Again.Release();
+		TestTrue("Region reacquired: ", Grid(36, 20) == -1 && !Again.IsValid());
+
+		// Overlapping deposition: every task splats onto the same cells.
+		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Density;
+		Density.SetDimSize({8, 8}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		ArrayMultiDim::TArrayMultiDim<int32, -1> Extremes;
+		Extremes.SetDimSize({2}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		ParallelFor(64, [&](int32 Task)
+		{
+			for (int32 i = 0; i < 1000; ++i)
+			{
+				Density.AtomicAdd({i % 8, (i / 8) % 8}, 0.25f);
+				Extremes.AtomicMin({0}, Task * 1000 + i - 5000);
+				Extremes.AtomicMax({1}, Task * 1000 + i);
+			}
+		});
+		bool bSums = true;
+		float Total = 0.f;
+		for (int32 i = 0; i < Density.GetTotalSize(); ++i)
+		{
+			Total += Density[i];
+		}
+		bSums &= Total == 64 * 1000 * 0.25f && Density(0, 0) == 64 * 16 * 0.25f;
+		TestTrue("Atomic additions: ", bSums);
+		TestTrue("Atomic min / max: ", Extremes(0) == -5000 && Extremes(1) == 63999);
+		int32 Expected = 0;
+		TestTrue("Compare exchange fails: ", !Extremes.AtomicCompareExchange({0}, Expected, 7) && Expected == -5000);
+		TestTrue("Compare exchange succeeds: ", Extremes.AtomicCompareExchange({0}, Expected, 7) && Extremes.AtomicLoad({0}) == 7);
+		PopContext();
+	}
+
+	// This block tests the async operations and the pipeline chaining.
+	{
+		PushContext("Async operations");
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Initial;
+		Initial.SetDimSize({40, 30}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		ArrayMultiDim::TAsyncArray<int32, -1, -1> Async(Initial);
+		Async.SetDataAsync([](const auto& InCoord, int32, int32&) { return InCoord[0] * 100 + InCoord[1]; });
+		auto Sum = Async.ReduceAsync(0, [](int32 A, int32 B) { return A + B; });
+		// The resize waits for the reduction, which still sees the 40 x 30 array.
+		Async.SetDimSizeAsync({50, 20});
+		auto Slice = Async.SliceAsync({{10, 45}, 3});
+		auto Large = ArrayMultiDim::Then(Slice, [](const auto& InSlice) { return InSlice.Where([](int32 InValue) { return InValue >= 2000; }); });
+		auto NumLarge = ArrayMultiDim::Then(Large, [](const TArray<int32>& InIndexes) { return InIndexes.Num(); });
+		TestTrue("Reduction before the resize: ", Sum.GetResult() == 40 * 30 * 29 / 2 + 30 * 100 * 40 * 39 / 2);
+		TestTrue("Sliced after the resize: ", Slice.GetResult().GetRuntimeEachDimSize()[0] == 35 && Slice.GetResult()(29, 0) == 3903 && Slice.GetResult()(30, 0) == 0);
+		TestTrue("Pipeline result: ", NumLarge.GetResult() == 20);
+		Async.Wait();
+		TestTrue("Idle after Wait(): ", Async.IsIdle() && Async.Get()(39, 19) == 3919 && Async.Get()(49, 0) == 0);
+		// A write scheduled while another thread is in Wait() still waits for the pending reads. The task events order
+		// the steps: the read is running, the waiter has started, then the write is scheduled before the read ends.
+		UE::Tasks::FTaskEvent ReadStarted(UE_SOURCE_LOCATION);
+		UE::Tasks::FTaskEvent ReleaseRead(UE_SOURCE_LOCATION);
+		UE::Tasks::FTaskEvent WaiterStarted(UE_SOURCE_LOCATION);
+		std::atomic<bool> bReadDone {false};
+		Async.ReadAsync([&](const auto&)
+		{
+			ReadStarted.Trigger();
+			ReleaseRead.Wait();
+			bReadDone = true;
+			return 0;
+		});
+		ReadStarted.Wait();
+		UE::Tasks::FTask Waiter = UE::Tasks::Launch(UE_SOURCE_LOCATION, [&]()
+		{
+			WaiterStarted.Trigger();
+			Async.Wait();
+		});
+		WaiterStarted.Wait();
+		bool bWriteAfterRead = false;
+		Async.WriteAsync([&](auto&) { bWriteAfterRead = bReadDone; });
+		ReleaseRead.Trigger();
+		Waiter.Wait();
+		Async.Wait();
+		TestTrue("Write waits for the reads of a concurrent Wait(): ", bWriteAfterRead);
+		PopContext();
+	}
+
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+	// This block tests the access profiler and the re-layout it recommends.
+	{
+		PushContext("Access profiler");
+		using GridType = ArrayMultiDim::TArrayMultiDim<float, -1, -1>;
+		GridType Grid;
+		Grid.SetDimSize({64, 48}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Grid.SetData([](const auto& InCoord, int32, float&) { return InCoord[0] * 100.f + InCoord[1]; });
+		const int SlowAxis = Grid.GetRuntimeStride()[0] == 1 ? 1 : 0;
+		Grid.SetAccessProfiling(true);
+		const GridType& ConstGrid = Grid;
+		float Sum = 0.f;
+		// The inner loop walks the slow axis.
+		for (int32 Outer = 0; Outer < Grid.GetRuntimeEachDimSize()[1 - SlowAxis]; ++Outer)
+		{
+			for (int32 Inner = 0; Inner < Grid.GetRuntimeEachDimSize()[SlowAxis]; ++Inner)
+			{
+				Sum += SlowAxis == 0 ? ConstGrid(Inner, Outer) : ConstGrid(Outer, Inner);
+			}
+		}
+		auto Profile = Grid.GetAccessProfile();
+		TestTrue("Accesses recorded: ", Profile.NumAccesses == 64 * 48 && Sum > 0.f);
+		TestTrue("Dominant axis: ", Profile.DominantAxis == SlowAxis && Profile.DominantStride == Grid.GetRuntimeStride()[SlowAxis]);
+		TestTrue("Miss-prone axis: ", Profile.MissProneAxes[SlowAxis] && !Profile.MissProneAxes[1 - SlowAxis] && Profile.NumCacheLineJumps > 0);
+		TestTrue("Recommended order: ", Profile.RecommendedOrder[0] == SlowAxis && !Profile.bRecommendBricked);
+		TestTrue("Re-layout: ", Grid.ApplyRecommendedLayout() && Grid.GetRuntimeStride()[SlowAxis] == 1);
+		TestTrue("Data kept by coordinate: ", ConstGrid(63, 47) == 6347.f && ConstGrid(5, 7) == 507.f);
+		TestTrue("Statistics cleared: ", Grid.GetAccessProfile().NumAccesses == 2 && !Grid.ApplyRecommendedLayout());
+		// The loops by coordinate walk the last axis innermost.
+		Grid.ConstLoopByCoord([](const auto&, int32, int32, const float&) {});
+		TestTrue("Loops recorded: ", Grid.GetAccessProfile().AxisSteps[1] == 64 * 48);
+		Grid.SetAccessProfiling(false);
+		TestTrue("Profiling disabled: ", Grid.GetAccessProfile().NumAccesses == 0);
+		PopContext();
+	}
+#endif
+
+#if ARRAYMULTIDIM_WITH_STATS
+	// This block tests the operation counters.
+	{
+		PushContext("Operation stats");
+		using ArrayMultiDim::EArrayOperation;
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Grid;
+		const ArrayMultiDim::FArrayMultiDimStatsSnapshot Before = ArrayMultiDim::FArrayMultiDimStats::GetSnapshot();
+		Grid.SetDimSize({16, 8}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+		Grid.SetDimSize({8, 8});
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Copy = Grid;
+		auto Sliced = Grid.Slice({{0, 4}, {}});
+		Grid.GetElementsByMask(ArrayMultiDim::TArrayMultiDim<int32, -1, -1>::MaskType({{1, 1}, {0, 1}}), {2, 2});
+		Grid.SetSharedStorageMode(true);
+		ArrayMultiDim::TArrayMultiDim<int32, -1, -1> Shared = Grid;
+		Shared(0, 0) = 1;
+		Copy.LoopByIndex([](const auto&, int32, int32, int32& OutData) { OutData = 2; });
+		Copy.ConstLoopByCoord([](const auto&, int32, int32, const int32&) {});
+		const auto Delta = ArrayMultiDim::FArrayMultiDimStats::GetSnapshot() - Before;
+		TestTrue("Resizes: ", Delta[EArrayOperation::Resize].NumCalls >= 2 && Delta[EArrayOperation::Resize].BytesCopied == 8 * 8 * sizeof(int32));
+		TestTrue("Deep copies: ", Delta[EArrayOperation::DeepCopy].NumCalls == 1 && Delta[EArrayOperation::DeepCopy].BytesCopied == 8 * 8 * sizeof(int32));
+		TestTrue("Slices: ", Delta[EArrayOperation::Slice].NumCalls == 1 && Delta[EArrayOperation::Slice].BytesAllocated == 4 * 8 * sizeof(int32));
+		TestTrue("Mask gathers: ", Delta[EArrayOperation::MaskGather].NumCalls == 1 && Delta[EArrayOperation::MaskGather].BytesCopied == 3 * sizeof(int32));
+		TestTrue("Copy-on-write detaches: ", Delta[EArrayOperation::Detach].NumCalls == 1);
+		// The mask gather traverses its mask too.
+		TestTrue("Traversals: ", Delta[EArrayOperation::Traversal].NumCalls == 3 && Delta[EArrayOperation::Traversal].BytesCopied == 0);
+		TestTrue("Totals: ", Delta.GetTotal().NumCalls >= 6 && Delta.GetTotal().Seconds >= 0.0);
+		PopContext();
+	}
+#endif
 	return true;
 }
@@ -1,6 +1,7 @@
 ﻿// Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MultiDimentionArray.h"
+#include "ArrayMultiDimStats.h"
 
 #define LOCTEXT_NAMESPACE "FMultiDimentionArrayModule"
 
@@ -16,5 +17,8 @@ void FMultiDimentionArrayModule::ShutdownModule()
 }
 
 #undef LOCTEXT_NAMESPACE
+
+// Defined here rather than in the header, so that all the modules share one set of counters.
+ArrayMultiDim::FArrayMultiDimStats::FCounters ArrayMultiDim::FArrayMultiDimStats::Counters[static_cast<int>(ArrayMultiDim::EArrayOperation::Num)];
 	
 IMPLEMENT_MODULE(FMultiDimentionArrayModule, MultiDimentionArray)
\ No newline at end of file
@@ -1,11 +1,19 @@
 ﻿#pragma once
 #include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "ArrayMultiDimStats.h"
 #include <array>
 #include <ranges>
 #include <algorithm>
 #include <type_traits>
 #include <initializer_list>
 #include <variant>
+#include <atomic>
+
+// Compiles the opt-in access profiler (see SetAccessProfiling()) into the element accessors, off in shipping builds.
+#ifndef ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+#define ARRAYMULTIDIM_WITH_ACCESS_PROFILER !UE_BUILD_SHIPPING
+#endif
 
 namespace ArrayMultiDim
 {
@@ -141,25 +149,173 @@ namespace ArrayMultiDim
 		ConstantBorder  // Fill with a constant border value. result is [1 2 3 4 5] 5 5 5 5 5 
 	};
 
+	// How the (up to 2^N) children of a cell are combined when building a pyramid level. See TArrayMultiDim::BuildPyramid().
+	enum EPyramidReducer
+	{
+		MeanReduce,  // Average of the children.
+		MinReduce,  // Minimum of the children.
+		MaxReduce  // Maximum of the children.
+	};
+
+	// How TArrayMultiDim::Scatter() resolves the concurrent writes to the same element.
+	enum EScatterMode
+	{
+		SerialScatter,  // One thread, in the input order.
+		AtomicScatter,  // Parallel, each combine is a compare-and-swap loop. Arithmetic element types only.
+		PartitionedScatter  // Parallel, the writes are sorted by index and each thread owns a disjoint index range.
+	};
+
+	// Which neighbors are connected in TArrayMultiDim::LabelConnectedComponents().
+	enum EConnectivity
+	{
+		FaceConnectivity,  // The 2N neighbors sharing a face: 4-connected in 2D, 6-connected in 3D.
+		FullConnectivity  // All the 3^N - 1 neighbors, diagonals included: 8-connected in 2D, 26-connected in 3D.
+	};
+
+	// The combine operations of TArrayMultiDim::Scatter(): Combine(InOutTarget, InValue).
+	struct FScatterAssign
+	{
+		template <typename T>
+		FORCEINLINE void operator()(T& InOutTarget, const T& InValue) const { InOutTarget = InValue; }
+	};
+
+	struct FScatterAdd
+	{
+		template <typename T>
+		FORCEINLINE void operator()(T& InOutTarget, const T& InValue) const { InOutTarget += InValue; }
+	};
+
+	struct FScatterMin
+	{
+		template <typename T>
+		FORCEINLINE void operator()(T& InOutTarget, const T& InValue) const { InOutTarget = InValue < InOutTarget ? InValue : InOutTarget; }
+	};
+
+	struct FScatterMax
+	{
+		template <typename T>
+		FORCEINLINE void operator()(T& InOutTarget, const T& InValue) const { InOutTarget = InOutTarget < InValue ? InValue : InOutTarget; }
+	};
+
 	
 
+	/**
+	 * Index policies of the multi-dimension array. The policy decides the type of the coordinates, the dimension sizes,
+	 * the strides and the linear indexes, and the allocator of the backend storage.
+	 */
+	// 32-bit indexes, the default. Up to 2^31 - 1 elements.
+	struct FArrayMultiDimIndex32
+	{
+		using IndexType = int32;
+		using AllocatorType = FDefaultAllocator;
+	};
+
+	// 64-bit indexes and a 64-bit allocator (like TArray64), for the huge arrays, e.g. a 2048^3 volume.
+	struct FArrayMultiDimIndex64
+	{
+		using IndexType = int64;
+		using AllocatorType = FDefaultAllocator64;
+	};
+
+	// Multiplies 2 non-negative sizes, saturates at the max of [SizeType] instead of overflowing.
+	template <typename SizeType>
+	constexpr SizeType SaturatingMultiplySize(SizeType InA, SizeType InB)
+	{
+		return (InA != 0 && InB > TNumericLimits<SizeType>::Max() / InA) ? TNumericLimits<SizeType>::Max() : InA * InB;
+	}
+
+	// Whether the element count of the compile-time sizes fits in [SizeType], the dynamic sizes are checked at runtime.
+	template <typename SizeType, int... Dims>
+	constexpr bool IsCompileTimeShapeValid()
+	{
+		SizeType Total = 1;
+		for (const int SingleDimSize : {Dims...})
+		{
+			if (SingleDimSize == -1)
+			{
+				return true;
+			}
+			if (SingleDimSize < 0)
+			{
+				return false;
+			}
+			Total = SaturatingMultiplySize<SizeType>(Total, SingleDimSize);
+		}
+		return Total < TNumericLimits<SizeType>::Max();
+	}
+
+	// The result type of the interpolated sampling: DataType * float, or DataType itself for the types without it.
+	template <typename DataType, typename = void>
+	struct TSampleResult
+	{
+		using Type = DataType;
+	};
+
+	template <typename DataType>
+	struct TSampleResult<DataType, std::void_t<decltype(std::declval<DataType>() * std::declval<float>())>>
+	{
+		using Type = std::decay_t<decltype(std::declval<DataType>() * std::declval<float>())>;
+	};
+
+	// ParallelFor() over [0, InNum) for any index type. ParallelFor() only takes an int32 count, so a larger count
+	// (an int64 array) is split into at most MAX_int32 batches of consecutive indices.
+	template <typename CountType, typename FuncType>
+	void ParallelForIndex(CountType InNum, const FuncType& InFunc, bool bInForceSingleThread = false)
+	{
+		if (InNum <= 0)
+		{
+			return;
+		}
+		if (static_cast<int64>(InNum) <= MAX_int32)
+		{
+			ParallelFor(static_cast<int32>(InNum), [&](int32 Index) { InFunc(static_cast<CountType>(Index)); }, bInForceSingleThread);
+			return;
+		}
+		const int64 Num = static_cast<int64>(InNum);
+		const int64 BatchSize = (Num + MAX_int32 - 1) / MAX_int32;
+		const int32 NumBatches = static_cast<int32>((Num + BatchSize - 1) / BatchSize);
+		ParallelFor(NumBatches, [&](int32 Batch)
+		{
+			const int64 End = FMath::Min<int64>((Batch + 1) * BatchSize, Num);
+			for (int64 Index = Batch * BatchSize; Index < End; ++Index)
+			{
+				InFunc(static_cast<CountType>(Index));
+			}
+		}, bInForceSingleThread);
+	}
+
+	template <typename DataType, typename IndexPolicy, int... Dims>
+	class TBasicArrayMultiDim;
+
+	// The multi-dimension array with 32-bit indexes.
+	template <typename DataType, int... Dims>
+	using TArrayMultiDim = TBasicArrayMultiDim<DataType, FArrayMultiDimIndex32, Dims...>;
+
+	// The multi-dimension array with 64-bit indexes, for more than 2^31 - 1 elements.
 	template <typename DataType, int... Dims>
-	class TArrayMultiDim
+	using TArrayMultiDim64 = TBasicArrayMultiDim<DataType, FArrayMultiDimIndex64, Dims...>;
+
+	template <typename DataType, typename IndexPolicy, int... Dims>
+	class TBasicArrayMultiDim
 	{
-		using DimSizeType = int;
-		using IndexType = int;
-		using SelfType = TArrayMultiDim<DataType, Dims...>;
+		using SelfType = TBasicArrayMultiDim<DataType, IndexPolicy, Dims...>;
 		static constexpr int DYNAMIC_SIZE = -1;
 		static constexpr int INVALID_INDEX = -1;
 
 	public:
+		using IndexPolicyType = IndexPolicy;
+		using IndexType = typename IndexPolicy::IndexType;
+		using DimSizeType = IndexType;
 		using StorageDataType = DataType;
 		using NestedListType = NestList<sizeof...(Dims), DataType>;
 		using ArrayDimType = std::array<DimSizeType, sizeof...(Dims)>;
 		using CoordinateType = std::array<IndexType, sizeof...(Dims)>;
+		// The masks are small, they always use 32-bit indexes.
 		using MaskType = TArrayMultiDim<std::variant<bool, int>, (Dims > 0 ? DYNAMIC_SIZE : DYNAMIC_SIZE)...>;
-		using SelfDynamicSizeType = TArrayMultiDim<DataType, (Dims > 0 ? DYNAMIC_SIZE : DYNAMIC_SIZE)...>;
-		static constexpr DimSizeType DIM_SIZE = sizeof...(Dims);
+		using SelfDynamicSizeType = TBasicArrayMultiDim<DataType, IndexPolicy, (Dims > 0 ? DYNAMIC_SIZE : DYNAMIC_SIZE)...>;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static_assert(IsCompileTimeShapeValid<IndexType, Dims...>(),
+					  "The element count overflows the index type, use TArrayMultiDim64 for the huge arrays.");
 
 	private:
 
@@ -201,7 +357,7 @@ namespace ArrayMultiDim
 					return GenCompileTimeArray(INVALID_INDEX);
 				}
 				CoordinateType Strides;
-				int CurrentStride = 1;
+				IndexType CurrentStride = 1;
 				for (size_t i = 0; i < RuntimeStorageOrder.size(); ++i)
 				{
 					Strides[RuntimeStorageOrder[i]] = CurrentStride;
@@ -210,14 +366,38 @@ namespace ArrayMultiDim
 				return Strides;
 			}()
 		};
-		int TotalSize{
+		IndexType TotalSize{
 			[]
 			{
-				return HasCompileTimeDynamicSize() ? -1 : (Dims * ...);
+				return HasCompileTimeDynamicSize() ? -1 : (static_cast<IndexType>(Dims) * ...);
 			}()
 		};
 
-		TArray<DataType> DataList;
+		// Backend storage, held inline. In the shared storage mode the buffer lives in [SharedDataList] instead, a
+		// thread-safe reference-counted block that several copies can reference. See SetSharedStorageMode().
+		using StorageListType = TArray<DataType, typename IndexPolicy::AllocatorType>;
+		using StoragePtrType = TSharedPtr<StorageListType, ESPMode::ThreadSafe>;
+		StorageListType DataList;
+
+		// Only set in the shared storage mode, [DataList] is empty then. The copies of this array share it instead of
+		// deep-copying the buffer.
+		StoragePtrType SharedDataList;
+
+		// Dirty tracking state, see SetDirtyTracking(). One bit per block of (2^DirtyBlockSizeLog2)^N elements, the
+		// blocks are numbered in the storage order of the array.
+		bool bDirtyTracking = false;
+		int DirtyBlockSizeLog2 = 4;
+		ArrayDimType DirtyBlockGridSize{};
+		CoordinateType DirtyBlockGridStride{};
+		TArray<int64> DirtyBits;
+		// The last marked block, so that the consecutive writes to a block skip the bitset. Relaxed atomic, since the
+		// writers of several threads share it; a stale value only costs a redundant check of the bitset.
+		std::atomic<IndexType> LastDirtyBlockIndex{INVALID_INDEX};
+
+		// Ring-buffer origin, see ScrollRingBuffer(). The element of the coordinate C is stored at
+		// (C + RingOrigin) % Size in each dimension. [bHasRingOrigin] keeps the all-zero case on the fast path.
+		CoordinateType RingOrigin{};
+		bool bHasRingOrigin = false;
 
 
 #pragma region 构造函数
@@ -246,8 +426,8 @@ namespace ArrayMultiDim
 
 		static bool HasDynamicSize(const ArrayDimType& InRuntimeEachDimSize,
 								   std::vector<int>& OutDynamicSizeDimIndex,
-								   int& OutTotalSize = []() -> int& {
-									   static int defaultValue = 0; // 使用静态局部变量作为默认值
+								   IndexType& OutTotalSize = []() -> IndexType& {
+									   static IndexType defaultValue = 0; // 使用静态局部变量作为默认值
 									   return defaultValue;
 								   }())
 		{
@@ -262,7 +442,7 @@ namespace ArrayMultiDim
 					OutTotalSize = DYNAMIC_SIZE;
 					return true;
 				}
-				OutTotalSize *= SingleDimSize;
+				OutTotalSize = SaturatingMultiplySize<IndexType>(OutTotalSize, SingleDimSize);
 				i++;
 			}
 			return false;
@@ -273,8 +453,8 @@ namespace ArrayMultiDim
 		/// @param OutTotalSize Optional, A int reference to output the total size, get -1 when [InRuntimeEachDimSize] has ANY -1 sized dimension.
 		/// @return [InRuntimeEachDimSize] has ANY -1 sized dimension.
 		static bool HasDynamicSize(const ArrayDimType& InRuntimeEachDimSize,
-								   int& OutTotalSize = []() -> int& {
-									   static int defaultValue = 0; // 使用静态局部变量作为默认值
+								   IndexType& OutTotalSize = []() -> IndexType& {
+									   static IndexType defaultValue = 0; // 使用静态局部变量作为默认值
 									   return defaultValue;
 								   }())
 		{
@@ -286,12 +466,31 @@ namespace ArrayMultiDim
 					OutTotalSize = DYNAMIC_SIZE;
 					return true;
 				}
-				OutTotalSize *= SingleDimSize;
+				OutTotalSize = SaturatingMultiplySize<IndexType>(OutTotalSize, SingleDimSize);
 			}
 			return false;
 		}
 
-		template <typename ElementType, int ArraySize, typename InvalidValType>
+		/**
+		 * @brief Validates a determined shape: no negative size, and the element count fits in [IndexType].
+		 *
+		 * The strides and the linear indexes are computed in [IndexType], so a too large shape would silently overflow.
+		 */
+		static bool IsValidShape(const ArrayDimType& InEachDimSize)
+		{
+			IndexType Total = 1;
+			for (const DimSizeType SingleDimSize : InEachDimSize)
+			{
+				if (SingleDimSize < 0)
+				{
+					return false;
+				}
+				Total = SaturatingMultiplySize<IndexType>(Total, SingleDimSize);
+			}
+			return Total < TNumericLimits<IndexType>::Max();
+		}
+
+		template <typename ElementType, size_t ArraySize, typename InvalidValType>
 		static bool HasInvalidValue(const std::array<ElementType, ArraySize>& InArray,
 									const InvalidValType& InInvalidVal)
 		{
@@ -317,7 +516,7 @@ namespace ArrayMultiDim
 		 */
 		void UpdateStrides()
 		{
-			int CurrentStride = 1;
+			IndexType CurrentStride = 1;
 			for (size_t i = 0; i < RuntimeStorageOrder.size(); ++i)
 			{
 				checkf(RuntimeEachDimSize[i] != DYNAMIC_SIZE,
@@ -405,7 +604,7 @@ namespace ArrayMultiDim
 						UE_LOG(LogTemp, Display, TEXT("%s%s%d"), *ElementIndexStr, *FString::ChrN(Level, '\t'), Elem);
 					}
 
-					DataList[InElementIndex] = Elem;
+					GetMutableStorage()[InElementIndex] = Elem;
 				}
 				++i;
 			}
@@ -414,34 +613,122 @@ namespace ArrayMultiDim
 				UpdateStrides();
 			}
 		}
+		void CopyFrom(const TBasicArrayMultiDim& InOther)
+		{
+			RuntimeEachDimSize = InOther.RuntimeEachDimSize;
+			RuntimeStorageOrder = InOther.RuntimeStorageOrder;
+			RuntimeStride = InOther.RuntimeStride;
+			TotalSize = InOther.TotalSize;
+			bDirtyTracking = InOther.bDirtyTracking;
+			DirtyBlockSizeLog2 = InOther.DirtyBlockSizeLog2;
+			DirtyBlockGridSize = InOther.DirtyBlockGridSize;
+			DirtyBlockGridStride = InOther.DirtyBlockGridStride;
+			DirtyBits = InOther.DirtyBits;
+			LastDirtyBlockIndex.store(INVALID_INDEX, std::memory_order_relaxed);
+			RingOrigin = InOther.RingOrigin;
+			bHasRingOrigin = InOther.bHasRingOrigin;
+			if (InOther.SharedDataList)
+			{
+				InOther.CheckNoLiveWriteRegion_Internal();
+				DataList.Empty();
+				SharedDataList = InOther.SharedDataList;
+			}
+			else
+			{
+				ARRAYMULTIDIM_OPERATION_SCOPE(DeepCopy, CopyScope);
+				ARRAYMULTIDIM_OPERATION_BYTES(CopyScope, InOther.DataList.Num() * sizeof(DataType), InOther.DataList.Num() * sizeof(DataType));
+				SharedDataList.Reset();
+				DataList = InOther.DataList;
+			}
+		}
+		// Steals the buffer (or the shared block), the dirty bits and the ring origin, without allocating. The source is
+		// left with an empty storage outside of the shared storage mode: its dynamic dimensions are 0 (ready for
+		// SetDimSize()), its fixed ones keep their compile-time size, like a default-constructed array.
+		void MoveFrom(TBasicArrayMultiDim& InOther)
+		{
+			RuntimeEachDimSize = InOther.RuntimeEachDimSize;
+			RuntimeStorageOrder = InOther.RuntimeStorageOrder;
+			RuntimeStride = InOther.RuntimeStride;
+			TotalSize = InOther.TotalSize;
+			bDirtyTracking = InOther.bDirtyTracking;
+			DirtyBlockSizeLog2 = InOther.DirtyBlockSizeLog2;
+			DirtyBlockGridSize = InOther.DirtyBlockGridSize;
+			DirtyBlockGridStride = InOther.DirtyBlockGridStride;
+			DirtyBits = MoveTemp(InOther.DirtyBits);
+			LastDirtyBlockIndex.store(INVALID_INDEX, std::memory_order_relaxed);
+			RingOrigin = InOther.RingOrigin;
+			bHasRingOrigin = InOther.bHasRingOrigin;
+			DataList = MoveTemp(InOther.DataList);
+			SharedDataList = MoveTemp(InOther.SharedDataList);
+
+			InOther.DataList.Empty();
+			InOther.SharedDataList.Reset();
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				InOther.RuntimeEachDimSize[i] = CompileTimeDynamicDimFlagList[i] ? 0 : CompileTimeEachDimSize[i];
+			}
+			InOther.UpdateTotalSize();
+			InOther.UpdateStrides();
+			InOther.bDirtyTracking = false;
+			InOther.DirtyBits.Reset();
+			InOther.LastDirtyBlockIndex.store(INVALID_INDEX, std::memory_order_relaxed);
+			InOther.RingOrigin = GenCompileTimeArray(0);
+			InOther.bHasRingOrigin = false;
+		}
 #pragma endregion HelperFuncs for Constructor
 
 	public:
 #pragma region 无数据初始化构造
-		TArrayMultiDim()
+		TBasicArrayMultiDim()
 		{
 		}
 
 		template <int... IndexTypes>
-		TArrayMultiDim(Odr<IndexTypes...>)
+		TBasicArrayMultiDim(Odr<IndexTypes...>)
 		{
 			RuntimeStorageOrder = {IndexTypes...};
-			UpdateStrides();
+			// The strides of the dynamic sized arrays are computed by SetDimSize().
+			if (!HasDynamicSize())
+			{
+				UpdateStrides();
+			}
 		}
 
 		// Copy Constructor
-		TArrayMultiDim(const TArrayMultiDim& InOther)
+		// In the shared storage mode the copy only references the source buffer (O(1)), otherwise the data is deep-copied.
+		TBasicArrayMultiDim(const TBasicArrayMultiDim& InOther)
 		{
-			RuntimeEachDimSize = InOther.RuntimeEachDimSize;
-			RuntimeStorageOrder = InOther.RuntimeStorageOrder;
-			RuntimeStride = InOther.RuntimeStride;
-			TotalSize = InOther.TotalSize;
-			DataList = InOther.DataList;
+			CopyFrom(InOther);
+		}
+
+		TBasicArrayMultiDim& operator=(const TBasicArrayMultiDim& InOther)
+		{
+			if (this != &InOther)
+			{
+				CopyFrom(InOther);
+			}
+			return *this;
+		}
+
+		// Move Constructor
+		// The buffer is taken over without copying it, whatever the storage mode. The source is left empty.
+		TBasicArrayMultiDim(TBasicArrayMultiDim&& InOther) noexcept
+		{
+			MoveFrom(InOther);
+		}
+
+		TBasicArrayMultiDim& operator=(TBasicArrayMultiDim&& InOther) noexcept
+		{
+			if (this != &InOther)
+			{
+				MoveFrom(InOther);
+			}
+			return *this;
 		}
 #pragma endregion 无数据初始化构造
 
 #pragma region MultiDim Data Constructors
-		explicit TArrayMultiDim(const NestedListType& InList)
+		explicit TBasicArrayMultiDim(const NestedListType& InList)
 		{
 			ArrayDimType InitListDimSize;
 			GetNestedListDimSize<DIM_SIZE>(InList, InitListDimSize);
@@ -466,7 +753,7 @@ namespace ArrayMultiDim
 		}
 
 		template <int... IndexTypes>
-		explicit TArrayMultiDim(const NestedListType& InList, Odr<IndexTypes...>)
+		explicit TBasicArrayMultiDim(const NestedListType& InList, Odr<IndexTypes...>)
 		{
 			ArrayDimType InitListDimSize;
 			GetNestedListDimSize<DIM_SIZE>(InList, InitListDimSize);
@@ -521,7 +808,7 @@ namespace ArrayMultiDim
 		}
 
 		// 将线性序号转换为多维坐标
-		static CoordinateType IndexToCoordinate(int InIndex,
+		static CoordinateType IndexToCoordinate(IndexType InIndex,
 																 const CoordinateType& InStride,
 																 const CoordinateType& InStorageOrder)
 		{
@@ -535,6 +822,39 @@ namespace ArrayMultiDim
 			return Coordinates;
 		}
 
+		// Converts a coordinate of this array to the linear storage index, the ring-buffer origin is applied.
+		FORCEINLINE IndexType CoordinateToLinearIndex(const CoordinateType& InCoordinate) const
+		{
+			if (!bHasRingOrigin)
+			{
+				return CoordinateToLinearIndex(InCoordinate, RuntimeStride);
+			}
+			IndexType RetLinearIndex = 0;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				// The origin is smaller than the size, so a single conditional subtraction wraps the coordinate.
+				IndexType StoredCoord = InCoordinate[i] + RingOrigin[i];
+				StoredCoord -= StoredCoord >= RuntimeEachDimSize[i] ? RuntimeEachDimSize[i] : 0;
+				RetLinearIndex += RuntimeStride[i] * StoredCoord;
+			}
+			return RetLinearIndex;
+		}
+
+		// Converts a linear storage index of this array to the coordinate, the ring-buffer origin is applied.
+		CoordinateType IndexToCoordinate(IndexType InIndex) const
+		{
+			CoordinateType Coordinates = IndexToCoordinate(InIndex, RuntimeStride, RuntimeStorageOrder);
+			if (bHasRingOrigin)
+			{
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					Coordinates[i] -= RingOrigin[i];
+					Coordinates[i] += Coordinates[i] < 0 ? RuntimeEachDimSize[i] : 0;
+				}
+			}
+			return Coordinates;
+		}
+
 		static bool IsCoordinateOversize(const CoordinateType& InCoordinate,
 										 const ArrayDimType& InEachDimSize)
 		{
@@ -546,7 +866,7 @@ namespace ArrayMultiDim
 			return false;
 		}
 
-		void CoordinationCopyData_Internal(const TArray<DataType>& InOldDataList, TArray<DataType>& InNewDataList,
+		void CoordinationCopyData_Internal(const StorageListType& InOldDataList, StorageListType& InNewDataList,
 										   const ArrayDimType& OldRuntimeEachDimSize,
 										   const CoordinateType& OldRuntimeStride,
 										   const CoordinateType& InOldStorageOrder,
@@ -563,7 +883,7 @@ namespace ArrayMultiDim
 				InNewDataList.SetNumUninitialized(NewDataSize);
 			}
 
-			for (int i = 0; i < InOldDataList.Num(); ++i)
+			for (IndexType i = 0; i < InOldDataList.Num(); ++i)
 			{
 				auto Coord = IndexToCoordinate(i, OldRuntimeStride, InOldStorageOrder);
 				if (IsCoordinateOversize(Coord, NewRuntimeEachDimSize))
@@ -591,10 +911,24 @@ namespace ArrayMultiDim
 						const CoordinateType& InNewOrder,
 						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
 		{
+			ARRAYMULTIDIM_OPERATION_SCOPE(Resize, ResizeScope);
+			if (bHasRingOrigin)
+			{
+				// The copy policies work on the plain layout, the discarding ones just drop the origin.
+				if (InCopyPolicy == EResizeDataCopyPolicy::PreserveOldData || InCopyPolicy == EResizeDataCopyPolicy::CoordinationCopy)
+				{
+					NormalizeRingOrigin();
+				}
+				else
+				{
+					RingOrigin = GenCompileTimeArray(0);
+					bHasRingOrigin = false;
+				}
+			}
 			const ArrayDimType& NewRuntimeEachDimSize = InSize;
 			const CoordinateType OldStorageOrder = RuntimeStorageOrder;
 			RuntimeStorageOrder = InNewOrder;
-			int NewTotalSize = DYNAMIC_SIZE;
+			IndexType NewTotalSize = DYNAMIC_SIZE;
 
 			// 检查是否有未知大小的维度
 			std::vector<int> DynamicDimIndexList;
@@ -616,6 +950,14 @@ namespace ArrayMultiDim
 					   ), __FUNCTION__, *DynamicDimIndexStr);
 				return;
 			}
+			if (!IsValidShape(NewRuntimeEachDimSize))
+			{
+				UE_LOG(LogTemp, Error,
+					   TEXT("Function:[%hs] Invalid size: a negative size, or the element count overflows the %d-bit index type. "
+						   "Use TArrayMultiDim64 for the huge arrays."), __FUNCTION__, static_cast<int>(sizeof(IndexType) * 8));
+				RuntimeStorageOrder = OldStorageOrder;
+				return;
+			}
 
 			// Store the old [EachDimSize] and [Stride] values
 			ArrayDimType OldRuntimeEachDimSize = RuntimeEachDimSize;
@@ -625,29 +967,50 @@ namespace ArrayMultiDim
 			RuntimeEachDimSize = NewRuntimeEachDimSize;
 			UpdateTotalSize();
 			UpdateStrides();
+			if (bDirtyTracking)
+			{
+				// The block grid follows the new size, and all the elements may have been moved.
+				ResetDirtyBlockGrid();
+				MarkAllDirty_Internal();
+			}
 
 			// Resize the data list based on the new total size and the copy policy
+			ARRAYMULTIDIM_OPERATION_BYTES(ResizeScope,
+										  InCopyPolicy == EResizeDataCopyPolicy::CoordinationCopy ? NewTotalSize * sizeof(DataType)
+										  : FMath::Max<int64>(NewTotalSize - GetStorage().Num(), 0) * sizeof(DataType), 0);
 			if (InCopyPolicy == EResizeDataCopyPolicy::PreserveOldData)
 			{
-				DataList.SetNum(NewTotalSize);
+				GetMutableStorage().SetNum(NewTotalSize);
 			}
 			else if (InCopyPolicy == EResizeDataCopyPolicy::SetToInitialValue)
 			{
-				DataList.SetNumZeroed(NewTotalSize);
+				// The old data is dropped, so a shared buffer is released instead of being copied.
+				ReleaseSharedStorage();
+				GetMutableStorage().SetNumZeroed(NewTotalSize);
 			}
 			else if (InCopyPolicy == EResizeDataCopyPolicy::SetToUninitializedValue)
 			{
-				DataList.SetNumUninitialized(NewTotalSize);
+				ReleaseSharedStorage();
+				GetMutableStorage().SetNumUninitialized(NewTotalSize);
 			}
 			else if (InCopyPolicy == EResizeDataCopyPolicy::CoordinationCopy)
 			{
-				bool bHasNoneOldData = HasInvalidValue(OldRuntimeEachDimSize, DYNAMIC_SIZE) || HasInvalidValue(OldRuntimeStride, DYNAMIC_SIZE) || DataList.IsEmpty();
+				bool bHasNoneOldData = HasInvalidValue(OldRuntimeEachDimSize, DYNAMIC_SIZE) || HasInvalidValue(OldRuntimeStride, DYNAMIC_SIZE) || GetStorage().IsEmpty();
 				if (!bHasNoneOldData)
 				{
-					TArray<DataType> NewData;
-					CoordinationCopyData_Internal(DataList, NewData, OldRuntimeEachDimSize, OldRuntimeStride,
+					// The old buffer is only read here, so it doesn't need to be detached even if it's shared.
+					StorageListType NewData;
+#if ARRAYMULTIDIM_WITH_STATS
+					int64 NumCopied = 1;
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						NumCopied *= FMath::Min(OldRuntimeEachDimSize[Dim], NewRuntimeEachDimSize[Dim]);
+					}
+					ARRAYMULTIDIM_OPERATION_BYTES(ResizeScope, 0, NumCopied * sizeof(DataType));
+#endif
+					CoordinationCopyData_Internal(GetStorage(), NewData, OldRuntimeEachDimSize, OldRuntimeStride,
 												  OldStorageOrder, NewRuntimeEachDimSize, RuntimeStride);
-					DataList = MoveTemp(NewData);
+					ReplaceStorage_Internal(MoveTemp(NewData));
 				}
 			}
 		}
@@ -667,6 +1030,10 @@ namespace ArrayMultiDim
 
 		void SetData(const NestedListType& InDataList)
 		{
+			DetachSharedStorage();
+			MarkAllDirty_Internal();
+			RingOrigin = GenCompileTimeArray(0);
+			bHasRingOrigin = false;
 			InitializeFromInputData<DIM_SIZE>(InDataList, TempIndexList);
 		}
 
@@ -699,28 +1066,112 @@ namespace ArrayMultiDim
 		 */
 		void SetData(DataInitializerFuncType InFunc)
 		{
-			if (DataList.Num() != TotalSize)
+			ARRAYMULTIDIM_OPERATION_SCOPE(SetData, SetDataScope);
+			StorageListType& Storage = GetMutableStorage();
+			MarkAllDirty_Internal();
+			if (Storage.Num() != TotalSize)
 			{
-				DataList.SetNum(TotalSize);
+				Storage.SetNum(TotalSize);
 			}
-			for (int i = 0; i < TotalSize; ++i)
+			for (IndexType i = 0; i < TotalSize; ++i)
 			{
-				auto Coord = IndexToCoordinate(i, RuntimeStride, RuntimeStorageOrder);
-				DataList[i] = InFunc(Coord, i, DataList[i]);
+				auto Coord = IndexToCoordinate(i);
+				Storage[i] = InFunc(Coord, i, Storage[i]);
 			}
 		}
 
 #pragma endregion SetDimSize
 
+#pragma region AdoptData
+
+	public:
+		/**
+		 * @brief Takes over an existing buffer as the storage, without copying the elements.
+		 *
+		 * The buffer is moved in (the source array is left empty), its elements must already be laid out in the given
+		 * storage order. Use TArrayMultiDimView (ArrayMultiDimView.h) to work on foreign memory that can't be moved.
+		 * \return False if the shape doesn't match the buffer size or the compile-time sizes, the array is unchanged.
+		 */
+		bool AdoptData(StorageListType&& InData, const ArrayDimType& InSize, const CoordinateType& InStorageOrder)
+		{
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				if (!CompileTimeDynamicDimFlagList[i] && InSize[i] != CompileTimeEachDimSize[i])
+				{
+					UE_LOG(LogTemp, Error, TEXT("Function:[%hs] Dimension %d is fixed to %d, cannot adopt a buffer of size %d."),
+						   __FUNCTION__, i, CompileTimeEachDimSize[i], static_cast<int32>(InSize[i]));
+					return false;
+				}
+			}
+			// Validated first, a negative or overflowing size must not reach the product below.
+			if (!IsValidShape(InSize))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Function:[%hs] Invalid shape, a size is negative or the element count overflows."), __FUNCTION__);
+				return false;
+			}
+			int64 NumElements = 1;
+			for (const DimSizeType SingleDimSize : InSize)
+			{
+				NumElements *= SingleDimSize;
+			}
+			if (NumElements != InData.Num())
+			{
+				UE_LOG(LogTemp, Error, TEXT("Function:[%hs] The shape doesn't match the %lld elements of the buffer."),
+					   __FUNCTION__, static_cast<int64>(InData.Num()));
+				return false;
+			}
+
+			ReplaceStorage_Internal(MoveTemp(InData));
+			RuntimeEachDimSize = InSize;
+			RuntimeStorageOrder = InStorageOrder;
+			UpdateTotalSize();
+			UpdateStrides();
+			RingOrigin = GenCompileTimeArray(0);
+			bHasRingOrigin = false;
+			if (bDirtyTracking)
+			{
+				ResetDirtyBlockGrid();
+				MarkAllDirty_Internal();
+			}
+			return true;
+		}
+
+		bool AdoptData(StorageListType&& InData, const ArrayDimType& InSize)
+		{
+			return AdoptData(MoveTemp(InData), InSize, GenCompileTimeArray(DIM_SIZE - 1, -1));
+		}
+
+		template <int... OrderList>
+		bool AdoptData(StorageListType&& InData, const ArrayDimType& InSize, Odr<OrderList...>)
+		{
+			return AdoptData(MoveTemp(InData), InSize, CoordinateType{OrderList...});
+		}
+
+		/**
+		 * Moves the storage out without copying (a shared buffer is copied first), e.g. to hand it to another system.
+		 * The elements are in the storage order with the ring origin applied. The array keeps its shape with an
+		 * empty storage, call SetDimSize() or AdoptData() before using it again.
+		 */
+		StorageListType ReleaseData()
+		{
+			if (bHasRingOrigin)
+			{
+				NormalizeRingOrigin();
+			}
+			return MoveTemp(GetMutableStorage());
+		}
+
+#pragma endregion AdoptData
+
 #pragma region GetElements
 
 #pragma region HelperFunctions
-		using NestedLoopCallbackType = std::function<void(const CoordinateType& /* InLoopIndex */, const int& /* InLoopCounter */)>;
+		using NestedLoopCallbackType = std::function<void(const CoordinateType& /* InLoopIndex */, const IndexType& /* InLoopCounter */)>;
 
 		static void DoNestedLoops(const CoordinateType& Limits, const NestedLoopCallbackType& InFunc)
 		{
 			CoordinateType Indices{};  // Zero-initialize all elements
-			int Counter = 0;
+			IndexType Counter = 0;
 
 			while (true)
 			{
@@ -741,26 +1192,144 @@ namespace ArrayMultiDim
 				}
 			}
 		}
+
+		/**
+		 * Maps an out of range coordinate back into the array according to the border mode.
+		 * \return False if the element has no source (NoPadding, ConstantBorder), true otherwise.
+		 */
+		static bool ResolveBorderCoordinate(CoordinateType& InOutCoordinate,
+											const ArrayDimType& InEachDimSize,
+											EBorderMode InBorderMode)
+		{
+			if (!IsCoordinateOversize(InOutCoordinate, InEachDimSize))
+			{
+				return true;
+			}
+
+			switch (InBorderMode)
+			{
+			case EBorderMode::NoPadding:  // No padding, skip the element.
+				return false;
+			case EBorderMode::RepeatBorder:
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					InOutCoordinate[i] = (InOutCoordinate[i] % InEachDimSize[i] + InEachDimSize[i]) % InEachDimSize[i];
+				}
+				break;
+			case EBorderMode::ReflectBorder:
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					if (InOutCoordinate[i] < 0)
+					{
+						InOutCoordinate[i] = -InOutCoordinate[i] - 1;  //  -(-11) - 1 = 10
+					}
+					if (InOutCoordinate[i] >= InEachDimSize[i])
+					{
+						int period = 2 * InEachDimSize[i];
+						InOutCoordinate[i] = InOutCoordinate[i] % period;  // 10 % 20 = 10
+						if (InOutCoordinate[i] >= InEachDimSize[i]) // 10 >= 10
+						{
+							InOutCoordinate[i] = period - InOutCoordinate[i] - 1;  // 20 - 11 - 1 = 8
+						}
+					}
+				}
+				break;
+			case EBorderMode::Reflect101Border:
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					if (InOutCoordinate[i] < 0)
+					{
+						InOutCoordinate[i] = -InOutCoordinate[i];
+					}
+					if (InOutCoordinate[i] >= InEachDimSize[i])  // 16 >= 10
+					{
+						int period = 2 * InEachDimSize[i] - 2;  // 20 - 2 = 18
+						InOutCoordinate[i] = InOutCoordinate[i] % period;  // 16 % 18 = 16
+						if (InOutCoordinate[i] >= InEachDimSize[i])  // 16 >= 10
+						{
+							InOutCoordinate[i] = period - InOutCoordinate[i];  // 18 - 16 = 2
+						}
+					}
+				}
+				break;
+			case EBorderMode::ConstantBorder:  // The caller decides the constant value.
+				return false;
+			}
+			return true;
+		}
+
 #pragma endregion HelperFunctions 
 
 	public:
+		// The non-const accessors are treated as writes: a shared buffer is detached before the reference is returned,
+		// and the block of the element is marked dirty if the dirty tracking is enabled.
 		DataType& operator[](const IndexType& InElementLinearIndex)
 		{
-			return DataList[InElementLinearIndex];
+			if (bDirtyTracking)
+			{
+				MarkDirtyCoordinate_Internal(IndexToCoordinate(InElementLinearIndex));
+			}
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordAccess_Internal(IndexToCoordinate(InElementLinearIndex), InElementLinearIndex);
+			}
+#endif
+			return GetMutableStorage()[InElementLinearIndex];
+		}
+
+		const DataType& operator[](const IndexType& InElementLinearIndex) const
+		{
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordAccess_Internal(IndexToCoordinate(InElementLinearIndex), InElementLinearIndex);
+			}
+#endif
+			return GetStorage()[InElementLinearIndex];
 		}
 
 		template <typename... T>
 		DataType& operator()(T... InElementCoordinate)
 		{
-			const IndexType ElementIndex = CoordinateToLinearIndex({InElementCoordinate...}, RuntimeStride);
-			return DataList[ElementIndex];
+			const CoordinateType ElementCoordinate{InElementCoordinate...};
+			const IndexType ElementIndex = CoordinateToLinearIndex(ElementCoordinate);
+			if (bDirtyTracking)
+			{
+				MarkDirtyCoordinate_Internal(ElementCoordinate);
+			}
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordAccess_Internal(ElementCoordinate, ElementIndex);
+			}
+#endif
+			return GetMutableStorage()[ElementIndex];
+		}
+
+		template <typename... T>
+		const DataType& operator()(T... InElementCoordinate) const
+		{
+			const CoordinateType ElementCoordinate{InElementCoordinate...};
+			const IndexType ElementIndex = CoordinateToLinearIndex(ElementCoordinate);
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordAccess_Internal(ElementCoordinate, ElementIndex);
+			}
+#endif
+			return GetStorage()[ElementIndex];
 		}
 
 		// Begin and end methods for non-const iterators
-		typename TArray<DataType>::TIterator CreateIterator() { return DataList.CreateIterator(); }
+		typename StorageListType::TIterator CreateIterator()
+		{
+			MarkAllDirty_Internal();
+			return GetMutableStorage().CreateIterator();
+		}
 
 		// Begin and end methods for const iterators
-		typename TArray<DataType>::TConstIterator CreateConstIterator() const { return DataList.CreateConstIterator(); }
+		typename StorageListType::TConstIterator CreateConstIterator() const { return GetStorage().CreateConstIterator(); }
 
 		/**
 		 * \brief Loop all elements by the linear storage index.
@@ -788,74 +1357,598 @@ namespace ArrayMultiDim
 			const DataType& /* InData */)>;
 		void LoopByIndex(LoopCallbackType InFunc, const bool& InCalcCoord = false)
 		{
+			ARRAYMULTIDIM_OPERATION_SCOPE(Traversal, TraversalScope);
 			static CoordinateType NoneCoord;
+			StorageListType& Storage = GetMutableStorage();
+			MarkAllDirty_Internal();
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordTraversal_Internal(RuntimeStorageOrder[0]);
+			}
+#endif
 			if (InCalcCoord)
 			{
-				for (int i = 0; i < TotalSize; ++i)
+				for (IndexType i = 0; i < TotalSize; ++i)
 				{
-					auto Coord = IndexToCoordinate(i, RuntimeStride, RuntimeStorageOrder);
-					InFunc(Coord, i, i, DataList[i]);
+					auto Coord = IndexToCoordinate(i);
+					InFunc(Coord, i, i, Storage[i]);
 				}
 			}
 			else
 			{
-				for (int i = 0; i < TotalSize; ++i)
+				for (IndexType i = 0; i < TotalSize; ++i)
 				{
-					InFunc(NoneCoord, i, i, DataList[i]);
+					InFunc(NoneCoord, i, i, Storage[i]);
 				}
 			}
 		}
 		void ConstLoopByIndex(ConstLoopCallbackType InFunc, const bool& InCalcCoord = false) const
 		{
+			ARRAYMULTIDIM_OPERATION_SCOPE(Traversal, TraversalScope);
 			static CoordinateType NoneCoord;
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordTraversal_Internal(RuntimeStorageOrder[0]);
+			}
+#endif
+			const StorageListType& Storage = GetStorage();
 			if (InCalcCoord)
 			{
-				for (int i = 0; i < TotalSize; ++i)
+				for (IndexType i = 0; i < TotalSize; ++i)
 				{
-					auto Coord = IndexToCoordinate(i, RuntimeStride, RuntimeStorageOrder);
-					InFunc(Coord, i, i, DataList[i]);
+					auto Coord = IndexToCoordinate(i);
+					InFunc(Coord, i, i, Storage[i]);
 				}
 			}
 			else
 			{
-				for (int i = 0; i < TotalSize; ++i)
+				for (IndexType i = 0; i < TotalSize; ++i)
 				{
-					InFunc(NoneCoord, i, i, DataList[i]);
+					InFunc(NoneCoord, i, i, Storage[i]);
 				}
 			}
 		}
 		void LoopByCoord(const LoopCallbackType& InFunc)
 		{
-			DoNestedLoops(RuntimeEachDimSize, [&](const CoordinateType& InLoopIndex, const int& InLoopCounter)
+			ARRAYMULTIDIM_OPERATION_SCOPE(Traversal, TraversalScope);
+			StorageListType& Storage = GetMutableStorage();
+			MarkAllDirty_Internal();
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
+			{
+				RecordTraversal_Internal(DIM_SIZE - 1);
+			}
+#endif
+			ForEachElementByCoord_Internal([&](const CoordinateType& InCoordinate, IndexType InLinearIndex, IndexType InLoopCounter)
 			{
-				IndexType LinearIndex = CoordinateToLinearIndex(InLoopIndex, RuntimeStride);
-				InFunc(InLoopIndex, LinearIndex, InLoopCounter, DataList[LinearIndex]);
+				InFunc(InCoordinate, InLinearIndex, InLoopCounter, Storage[InLinearIndex]);
 			});
 		}
 		void ConstLoopByCoord(const ConstLoopCallbackType& InFunc) const
 		{
-			DoNestedLoops(RuntimeEachDimSize, [&](const CoordinateType& InLoopIndex, const int& InLoopCounter)
+			ARRAYMULTIDIM_OPERATION_SCOPE(Traversal, TraversalScope);
+			const StorageListType& Storage = GetStorage();
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+			if (AccessRecorder)
 			{
-				IndexType LinearIndex = CoordinateToLinearIndex(InLoopIndex, RuntimeStride);
-				InFunc(InLoopIndex, LinearIndex, InLoopCounter, DataList[LinearIndex]);
+				RecordTraversal_Internal(DIM_SIZE - 1);
+			}
+#endif
+			ForEachElementByCoord_Internal([&](const CoordinateType& InCoordinate, IndexType InLinearIndex, IndexType InLoopCounter)
+			{
+				InFunc(InCoordinate, InLinearIndex, InLoopCounter, Storage[InLinearIndex]);
 			});
 		}
 
-#pragma endregion GetElements
-
-	public:
-		// Getter for the total size.
-		int GetTotalSize() const { return TotalSize; }
-
-		// Getter for the [RuntimeStride] values.
-		const CoordinateType& GetRuntimeStride() const { return RuntimeStride; }
-
-#pragma region SlicingOperator
-
+	private:
+		/**
+		 * Calls InFunc(Coordinate, LinearIndex, LoopCounter) for each element, the last dimension fastest. A row along the
+		 * last dimension wraps at most once with a ring origin, so it's run as two runs of constant stride split at the
+		 * wrap point, instead of wrapping each element in CoordinateToLinearIndex().
+		 */
+		template <typename FuncType>
+		void ForEachElementByCoord_Internal(const FuncType& InFunc) const
+		{
+			if (TotalSize <= 0)
+			{
+				return;
+			}
+			constexpr int LastDim = DIM_SIZE - 1;
+			const IndexType RowLength = RuntimeEachDimSize[LastDim];
+			const IndexType RowStride = RuntimeStride[LastDim];
+			// The first coordinate of the row stored at the start of the storage row.
+			const IndexType WrapCoord = RowLength - RingOrigin[LastDim];
+			CoordinateType Coord{};
+			IndexType Counter = 0;
+			while (true)
+			{
+				// Coord[LastDim] is 0 here, the start of the row includes the ring origin of the last dimension.
+				const IndexType RowStart = CoordinateToLinearIndex(Coord);
+				IndexType i = 0;
+				for (IndexType LinearIndex = RowStart; i < WrapCoord; ++i, LinearIndex += RowStride)
+				{
+					Coord[LastDim] = i;
+					InFunc(Coord, LinearIndex, Counter++);
+				}
+				for (IndexType LinearIndex = RowStart + (WrapCoord - RowLength) * RowStride; i < RowLength; ++i, LinearIndex += RowStride)
+				{
+					Coord[LastDim] = i;
+					InFunc(Coord, LinearIndex, Counter++);
+				}
+				Coord[LastDim] = 0;
+
+				int Level = LastDim - 1;
+				while (Level >= 0 && ++Coord[Level] == RuntimeEachDimSize[Level])
+				{
+					Coord[Level--] = 0;
+				}
+				if (Level < 0)
+				{
+					return;
+				}
+			}
+		}
+
+#pragma endregion GetElements
+
+	public:
+		// Getter for the total size.
+		IndexType GetTotalSize() const { return TotalSize; }
+
+		// Getter for the [RuntimeStride] values.
+		const CoordinateType& GetRuntimeStride() const { return RuntimeStride; }
+
+		// Getter for the runtime size of each dimension.
+		const ArrayDimType& GetRuntimeEachDimSize() const { return RuntimeEachDimSize; }
+
+		// Converts a coordinate of this array to the linear storage index.
+		IndexType GetLinearIndex(const CoordinateType& InCoordinate) const { return CoordinateToLinearIndex(InCoordinate); }
+
+		// Converts a linear storage index of this array to the coordinate.
+		CoordinateType GetCoordinate(IndexType InLinearIndex) const { return IndexToCoordinate(InLinearIndex); }
+
+		// Raw pointer to the backend storage, for the vectorized kernels. The elements are in the linear storage order.
+		// The mutable version is treated as a bulk write: a shared buffer is detached and all the dirty blocks are marked.
+		DataType* GetData()
+		{
+			MarkAllDirty_Internal();
+			return GetMutableStorage().GetData();
+		}
+
+		const DataType* GetData() const { return GetStorage().GetData(); }
+
+#pragma region SharedStorage
+
+	public:
+		/**
+		 * @brief Enables or disables the shared storage (copy-on-write) mode.
+		 *
+		 * In the shared storage mode, copying the array (copy constructor or copy assignment) only adds a reference to
+		 * the backend buffer, so the copy is O(1). The buffer is deep-copied the first time one of its owners mutates it
+		 * through operator[], operator(), CreateIterator(), LoopByIndex(), LoopByCoord(), SetData() or SetDimSize().
+		 * Const access (const operator[] / operator(), ConstLoopByIndex(), Slice(), ...) never copies the buffer.
+		 * The copies inherit the mode.
+		 *
+		 * Outside of the mode the buffer is held inline, enabling it moves the buffer into a reference-counted block
+		 * (one allocation, no element copy). Disabling the mode detaches the buffer of this array and moves it back
+		 * inline, the later copies deep-copy again.
+		 *
+		 * @param InEnable Whether the copies of this array share the backend buffer.
+		 */
+		void SetSharedStorageMode(bool InEnable)
+		{
+			if (InEnable != SharedDataList.IsValid())
+			{
+				CheckNoLiveWriteRegion_Internal();
+			}
+			if (InEnable && !SharedDataList)
+			{
+				// The reference-counted block is only allocated now, the buffer is moved into it.
+				SharedDataList = MakeShared<StorageListType, ESPMode::ThreadSafe>(MoveTemp(DataList));
+				DataList.Empty();
+			}
+			else if (!InEnable && SharedDataList)
+			{
+				DetachSharedStorage();
+				DataList = MoveTemp(*SharedDataList);
+				SharedDataList.Reset();
+			}
+		}
+
+		// Whether the copies of this array share the backend buffer.
+		bool IsSharedStorageMode() const { return SharedDataList.IsValid(); }
+
+		// Whether the backend buffer is currently referenced by more than one array, i.e. the next write will copy it.
+		bool IsStorageShared() const { return SharedDataList && !SharedDataList.IsUnique(); }
+
+		// Makes sure this array exclusively owns its backend buffer, copies the buffer if it's shared.
+		void DetachSharedStorage()
+		{
+			if (SharedDataList && !SharedDataList.IsUnique())
+			{
+				ARRAYMULTIDIM_OPERATION_SCOPE(Detach, DetachScope);
+				ARRAYMULTIDIM_OPERATION_BYTES(DetachScope, SharedDataList->Num() * sizeof(DataType), SharedDataList->Num() * sizeof(DataType));
+				SharedDataList = MakeShared<StorageListType, ESPMode::ThreadSafe>(*SharedDataList);
+			}
+		}
+
+	protected:
+		// The backend buffer for reading, inline or shared.
+		FORCEINLINE const StorageListType& GetStorage() const
+		{
+			return UNLIKELY(SharedDataList.IsValid()) ? *SharedDataList : DataList;
+		}
+
+		// The backend buffer without detaching it, for the callers that checked it's not shared.
+		FORCEINLINE StorageListType& GetStorage_Internal()
+		{
+			return UNLIKELY(SharedDataList.IsValid()) ? *SharedDataList : DataList;
+		}
+
+		// Access to the backend buffer for writing. A shared buffer is detached first (copy-on-write). Outside of the
+		// shared storage mode it's the inline buffer, behind a single predictable branch.
+		FORCEINLINE StorageListType& GetMutableStorage()
+		{
+			if (UNLIKELY(SharedDataList.IsValid()))
+			{
+				DetachSharedStorage();
+				return *SharedDataList;
+			}
+			return DataList;
+		}
+
+		// Drops the reference to a shared buffer without copying it, used when the old data is discarded anyway.
+		void ReleaseSharedStorage()
+		{
+			if (SharedDataList && !SharedDataList.IsUnique())
+			{
+				SharedDataList = MakeShared<StorageListType, ESPMode::ThreadSafe>();
+			}
+		}
+
+		// Replaces the whole buffer, e.g. by a re-laid-out one. In the shared storage mode the other owners keep the old one.
+		void ReplaceStorage_Internal(StorageListType&& InNewData)
+		{
+			if (SharedDataList)
+			{
+				SharedDataList = MakeShared<StorageListType, ESPMode::ThreadSafe>(MoveTemp(InNewData));
+			}
+			else
+			{
+				DataList = MoveTemp(InNewData);
+			}
+		}
+
+#pragma endregion SharedStorage
+
+#pragma region DirtyTracking
+
+	public:
+		/**
+		 * @brief Enables or disables the dirty tracking.
+		 *
+		 * The array is divided into blocks of (2^InBlockSizeLog2)^N elements. When the tracking is enabled, the writes
+		 * through the non-const operator[] / operator() mark the block of the element dirty, and the bulk writes
+		 * (LoopByIndex(), LoopByCoord(), CreateIterator(), SetData(), SetDimSize(), InclusiveScan(), ...) mark all the
+		 * blocks dirty, because the written elements are unknown. The downstream systems call ForEachDirtyBlock() to
+		 * recompute only the changed regions, then ClearDirty().
+		 *
+		 * When disabled, the cost of a write is a single bool check. When enabled, a write computes the block index (a
+		 * shift and a multiply-add per dimension) and compares it with the last marked block, the bitset is only touched
+		 * when the block changes. operator[] also converts the linear index to a coordinate, so prefer operator() in the
+		 * hot loops, or write a known box without the tracking and call MarkDirtyRegion() once.
+		 * The bits and the last marked block are updated atomically, so the elements can be written from several
+		 * threads (in the shared storage mode, detach the buffer first, see FWriteRegion for the lock-free pattern).
+		 * Note that every non-const access is treated as a write: reading through a non-const array marks the block
+		 * dirty as well, read through a const reference to avoid it.
+		 *
+		 * Enabling the tracking starts with all the blocks clean.
+		 *
+		 * @param InEnable Whether the writes are tracked.
+		 * @param InBlockSizeLog2 Log2 of the block edge length, e.g. 4 means 16x16 blocks for a 2D array.
+		 */
+		void SetDirtyTracking(bool InEnable, int InBlockSizeLog2 = 4)
+		{
+			check(InBlockSizeLog2 >= 0 && InBlockSizeLog2 < 31);
+			bDirtyTracking = InEnable;
+			DirtyBlockSizeLog2 = InBlockSizeLog2;
+			if (bDirtyTracking)
+			{
+				ResetDirtyBlockGrid();
+			}
+			else
+			{
+				DirtyBits.Empty();
+			}
+		}
+
+		// Whether the writes are tracked.
+		bool IsDirtyTracking() const { return bDirtyTracking; }
+
+		// The edge length of a dirty block.
+		int GetDirtyBlockSize() const { return 1 << DirtyBlockSizeLog2; }
+
+		// Whether any block has been written since the last ClearDirty().
+		bool HasDirtyBlocks() const
+		{
+			for (const int64 Word : DirtyBits)
+			{
+				if (Word != 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * \brief Type definition for the callback of ForEachDirtyBlock().
+		 *
+		 * \param InBlockMin The first coordinate of the dirty block (inclusive).
+		 * \param InBlockMax The last coordinate of the dirty block (exclusive), clamped to the array size.
+		 */
+		using DirtyBlockCallbackType = std::function<void(const CoordinateType& /* InBlockMin */, const CoordinateType& /* InBlockMax */)>;
+
+		// Calls [InFunc] for each dirty block, in the storage order of the blocks. The dirty bits are not cleared.
+		void ForEachDirtyBlock(const DirtyBlockCallbackType& InFunc) const
+		{
+			for (int WordIndex = 0; WordIndex < DirtyBits.Num(); ++WordIndex)
+			{
+				uint64 Word = static_cast<uint64>(DirtyBits[WordIndex]);
+				while (Word != 0)
+				{
+					const int BitIndex = static_cast<int>(FMath::CountTrailingZeros64(Word));
+					Word &= Word - 1;
+
+					// Block index -> block coordinate -> element box.
+					IndexType BlockIndex = WordIndex * 64 + BitIndex;
+					CoordinateType BlockMin;
+					CoordinateType BlockMax;
+					for (int i = DIM_SIZE - 1; i >= 0; --i)
+					{
+						const int Dim = RuntimeStorageOrder[i];
+						const IndexType BlockCoord = BlockIndex / DirtyBlockGridStride[Dim];
+						BlockIndex %= DirtyBlockGridStride[Dim];
+						BlockMin[Dim] = BlockCoord << DirtyBlockSizeLog2;
+						BlockMax[Dim] = FMath::Min<IndexType>(BlockMin[Dim] + (1 << DirtyBlockSizeLog2), RuntimeEachDimSize[Dim]);
+					}
+					InFunc(BlockMin, BlockMax);
+				}
+			}
+		}
+
+		// Marks all the blocks clean.
+		void ClearDirty()
+		{
+			LastDirtyBlockIndex.store(INVALID_INDEX, std::memory_order_relaxed);
+			FMemory::Memzero(DirtyBits.GetData(), DirtyBits.Num() * sizeof(int64));
+		}
+
+		// Marks the blocks overlapping the box [InMin, InMax) dirty, e.g. after writing through a raw pointer. The box is
+		// clamped to the array, the part outside of it is ignored.
+		void MarkDirtyRegion(const CoordinateType& InMin, const CoordinateType& InMax)
+		{
+			if (!bDirtyTracking)
+			{
+				return;
+			}
+			CoordinateType BoxMin;
+			CoordinateType BlockLimits;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				BoxMin[Dim] = FMath::Max<IndexType>(InMin[Dim], 0);
+				const IndexType BoxMax = FMath::Min<IndexType>(InMax[Dim], RuntimeEachDimSize[Dim]);
+				if (BoxMax <= BoxMin[Dim])
+				{
+					return;
+				}
+				BlockLimits[Dim] = ((BoxMax - 1) >> DirtyBlockSizeLog2) - (BoxMin[Dim] >> DirtyBlockSizeLog2) + 1;
+			}
+			DoNestedLoops(BlockLimits, [&](const CoordinateType& InBlockOffset, const IndexType& InLoopCounter)
+			{
+				CoordinateType Coord;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Coord[Dim] = BoxMin[Dim] + (InBlockOffset[Dim] << DirtyBlockSizeLog2);
+				}
+				MarkDirtyCoordinate_Internal(Coord);
+			});
+		}
+
+		// Marks all the blocks dirty.
+		void MarkAllDirty()
+		{
+			MarkAllDirty_Internal();
+		}
+
+	protected:
+		// Recomputes the block grid from the current size, all the blocks become clean.
+		void ResetDirtyBlockGrid()
+		{
+			IndexType NumBlocks = 1;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				const int Dim = RuntimeStorageOrder[i];
+				const DimSizeType DimSize = FMath::Max<DimSizeType>(RuntimeEachDimSize[Dim], 0);
+				DirtyBlockGridSize[Dim] = (DimSize + (1 << DirtyBlockSizeLog2) - 1) >> DirtyBlockSizeLog2;
+				DirtyBlockGridStride[Dim] = NumBlocks;
+				NumBlocks *= DirtyBlockGridSize[Dim];
+			}
+			DirtyBits.Reset();
+			DirtyBits.SetNumZeroed((NumBlocks + 63) / 64);
+			LastDirtyBlockIndex.store(INVALID_INDEX, std::memory_order_relaxed);
+		}
+
+		FORCEINLINE void MarkDirtyCoordinate_Internal(const CoordinateType& InCoordinate)
+		{
+			const IndexType BlockIndex = GetDirtyBlockIndex_Internal(InCoordinate);
+			// Consecutive writes usually hit the same block, they only compare the block index.
+			if (BlockIndex == LastDirtyBlockIndex.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+			LastDirtyBlockIndex.store(BlockIndex, std::memory_order_relaxed);
+			MarkDirtyBlock_Internal(BlockIndex);
+		}
+
+		FORCEINLINE IndexType GetDirtyBlockIndex_Internal(const CoordinateType& InCoordinate) const
+		{
+			IndexType BlockIndex = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				BlockIndex += (InCoordinate[Dim] >> DirtyBlockSizeLog2) * DirtyBlockGridStride[Dim];
+			}
+			return BlockIndex;
+		}
+
+		// Sets the bit of a block, thread-safe (the parallel writers keep their own last block instead of LastDirtyBlockIndex).
+		FORCEINLINE void MarkDirtyBlock_Internal(IndexType InBlockIndex)
+		{
+			int64* Word = DirtyBits.GetData() + (InBlockIndex >> 6);
+			const int64 Bit = int64(1) << (InBlockIndex & 63);
+			// Only the first write of a block pays for the atomic operation.
+			if ((std::atomic_ref<int64>(*Word).load(std::memory_order_relaxed) & Bit) == 0)
+			{
+				FPlatformAtomics::InterlockedOr(Word, Bit);
+			}
+		}
+
+		FORCEINLINE void MarkAllDirty_Internal()
+		{
+			if (!bDirtyTracking)
+			{
+				return;
+			}
+			IndexType NumBlocks = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				NumBlocks *= DirtyBlockGridSize[Dim];
+			}
+			for (int WordIndex = 0; WordIndex < DirtyBits.Num(); ++WordIndex)
+			{
+				const IndexType NumBitsInWord = FMath::Min<IndexType>(NumBlocks - WordIndex * 64, 64);
+				DirtyBits[WordIndex] = NumBitsInWord == 64 ? int64(-1) : static_cast<int64>((uint64(1) << NumBitsInWord) - 1);
+			}
+		}
+
+#pragma endregion DirtyTracking
+
+#pragma region RingBuffer
+
+	public:
+		/**
+		 * @brief Scrolls the array along an axis in O(1) by moving the ring-buffer (toroidal) origin, then refills only
+		 * the newly exposed slab.
+		 *
+		 * After scrolling by K, the coordinate C of the axis refers to the element that was at C + K, no element is
+		 * moved in the memory. For K > 0 the slab [Size - K, Size) is exposed (like dropping the oldest slices of a
+		 * time series), for K < 0 it's [0, -K).
+		 *
+		 * The origin is applied wherever a coordinate is converted: operator(), the loops, Slice(), the masks, ...
+		 * Each wrapped coordinate costs an add and a conditional subtract per dimension. operator[] and the iterators
+		 * still use the raw linear storage index; the scan and the resize first move the data back to the plain layout, see NormalizeRingOrigin().
+		 * With the dirty tracking enabled, all the blocks become dirty because every coordinate refers to new content.
+		 *
+		 * Usage:
+		 * \code
+		 *		// The player moved 3 cells along +X: keep the 61 overlapping columns, stream in the 3 new ones.
+		 *		Grid.ScrollRingBuffer(0, 3, [&](const auto& InCoord, int InLinearIdx, float& InOldData)
+		 *		{
+		 *			return LoadCell(GridStart + InCoord);
+		 *		});
+		 * \endcode
+		 *
+		 * @param InAxis The axis to scroll.
+		 * @param InShift The number of cells to scroll, can be negative.
+		 * @param InRefillFunc Initializer of the exposed elements (receives the new coordinates), nullptr sets them to DataType().
+		 */
+		void ScrollRingBuffer(int InAxis, IndexType InShift, const DataInitializerFuncType& InRefillFunc = nullptr)
+		{
+			check(InAxis >= 0 && InAxis < DIM_SIZE);
+			const DimSizeType AxisSize = RuntimeEachDimSize[InAxis];
+			if (TotalSize <= 0 || AxisSize <= 0 || InShift == 0)
+			{
+				return;
+			}
+
+			RingOrigin[InAxis] = ((RingOrigin[InAxis] + InShift) % AxisSize + AxisSize) % AxisSize;
+			UpdateHasRingOrigin();
+			MarkAllDirty_Internal();
+
+			const IndexType NumExposed = FMath::Min<IndexType>(FMath::Abs(InShift), AxisSize);
+			CoordinateType SlabMin = GenCompileTimeArray(0);
+			CoordinateType SlabSize = RuntimeEachDimSize;
+			SlabMin[InAxis] = InShift > 0 ? AxisSize - NumExposed : 0;
+			SlabSize[InAxis] = NumExposed;
+			StorageListType& Storage = GetMutableStorage();
+			DoNestedLoops(SlabSize, [&](const CoordinateType& InLocalCoord, const IndexType& InLoopCounter)
+			{
+				CoordinateType Coord;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Coord[Dim] = SlabMin[Dim] + InLocalCoord[Dim];
+				}
+				const IndexType LinearIndex = CoordinateToLinearIndex(Coord);
+				Storage[LinearIndex] = InRefillFunc ? InRefillFunc(Coord, LinearIndex, Storage[LinearIndex]) : DataType();
+			});
+		}
+
+		// The ring-buffer origin of each dimension, all zeros means the plain layout.
+		const CoordinateType& GetRingOrigin() const { return RingOrigin; }
+
+		// Whether any dimension has a non-zero ring-buffer origin.
+		bool HasRingOrigin() const { return bHasRingOrigin; }
+
+		/**
+		 * @brief Moves the elements so that the ring-buffer origin becomes zero (O(n)), the coordinates keep their values.
+		 *
+		 * Call it before handing the raw storage (linear indexes, iterators) to a code that expects the plain layout.
+		 */
+		void NormalizeRingOrigin()
+		{
+			if (!bHasRingOrigin)
+			{
+				return;
+			}
+			StorageListType NewData;
+			NewData.Reserve(TotalSize);
+			const StorageListType& OldData = GetStorage();
+			for (IndexType i = 0; i < TotalSize; ++i)
+			{
+				NewData.Add(OldData[CoordinateToLinearIndex(IndexToCoordinate(i, RuntimeStride, RuntimeStorageOrder))]);
+			}
+			ReplaceStorage_Internal(MoveTemp(NewData));
+			RingOrigin = GenCompileTimeArray(0);
+			bHasRingOrigin = false;
+		}
+
+	protected:
+		void UpdateHasRingOrigin()
+		{
+			bHasRingOrigin = false;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				bHasRingOrigin |= RingOrigin[Dim] != 0;
+			}
+		}
+
+#pragma endregion RingBuffer
+
+#pragma region SlicingOperator
+
 	public:
 		// 切片操作函数
 		SelfDynamicSizeType Slice(std::initializer_list<FSlice> InSlices) const
 		{
+			return Slice(TConstArrayView<FSlice>(InSlices.begin(), static_cast<int32>(InSlices.size())));
+		}
+
+		// Same as above, for the slices built at runtime or kept beyond the call (e.g. by SliceAsync()).
+		SelfDynamicSizeType Slice(TConstArrayView<FSlice> InSlices) const
+		{
+			check(InSlices.Num() == DIM_SIZE);
 			// 1. 计算新维度大小
 			ArrayDimType NewDimensions;
 			int i = 0;
@@ -881,31 +1974,42 @@ namespace ArrayMultiDim
 			}
 
 			// 2. 创建新数组
+			ARRAYMULTIDIM_OPERATION_SCOPE(Slice, SliceScope);
 			SelfDynamicSizeType Result;
 			Result.SetDimSize(NewDimensions, EResizeDataCopyPolicy::SetToUninitializedValue);
 
 			// 3. 填充数据
 			CoordinateType CurrentCoord;
-			FillSlicedData(Result, InSlices, CurrentCoord, 0);
+			FillSlicedData(Result, Result.GetData(), InSlices, CurrentCoord, 0);
+			ARRAYMULTIDIM_OPERATION_BYTES(SliceScope, Result.GetTotalSize() * sizeof(DataType), Result.GetTotalSize() * sizeof(DataType));
 
 			return Result;
 		}
 
 	private:
 		// 递归填充切片数据
+		// The last dimension is copied row by row: a row wraps at most once with a ring origin, so it's copied as two
+		// runs of constant stride split at the wrap point.
 		void FillSlicedData(SelfDynamicSizeType& OutResult,
-							const std::initializer_list<FSlice>& InSlices,
+							DataType* OutData,
+							TConstArrayView<FSlice> InSlices,
 							CoordinateType& InOutCoord,
 							int InDimIndex) const
 		{
-			if (InDimIndex == DIM_SIZE)
+			const FSlice& Slice = InSlices[InDimIndex];
+			if (InDimIndex == DIM_SIZE - 1)
 			{
 				// Enter the last dimension, start to fill the data.
-				IndexType SrcIndex = CoordinateToLinearIndex(InOutCoord, RuntimeStride);
+				const IndexType Begin = Slice.IsSingle() ? Slice.GetSingle() : Slice.IsRanged() ? Slice.GetRangeStart() : 0;
+				const IndexType End = Slice.IsSingle() ? Begin + 1 : Slice.IsRanged() ? Slice.GetRangeEnd() : RuntimeEachDimSize[InDimIndex];
+				if (Begin >= End)
+				{
+					return;
+				}
 
 				// Adjust the InOutCoord by subtracting the slice start coordinate.
+				InOutCoord[InDimIndex] = Begin;
 				CoordinateType AdjustedCoord = InOutCoord;
-				// for (int j = 0; j < DIM_SIZE; ++j)
 				int j = 0;
 				for (auto SliceObj : InSlices)
 				{
@@ -920,19 +2024,31 @@ namespace ArrayMultiDim
 					}
 					j++;
 				}
-				IndexType DstIndex = CoordinateToLinearIndex(AdjustedCoord, OutResult.GetRuntimeStride());
-				OutResult[DstIndex] = DataList[SrcIndex];  // OutResult[DstIndex] use the public operator[] function.
+				DataType* Dst = OutData + CoordinateToLinearIndex(AdjustedCoord, OutResult.GetRuntimeStride());
+				const IndexType DstStride = OutResult.GetRuntimeStride()[InDimIndex];
+
+				const IndexType RowLength = RuntimeEachDimSize[InDimIndex];
+				const IndexType SrcStride = RuntimeStride[InDimIndex];
+				const IndexType WrapCoord = RowLength - RingOrigin[InDimIndex];
+				InOutCoord[InDimIndex] = 0;
+				const DataType* SrcRow = GetStorage().GetData() + CoordinateToLinearIndex(InOutCoord);
+				IndexType i = Begin;
+				for (const DataType* Src = SrcRow + i * SrcStride; i < FMath::Min(End, WrapCoord); ++i, Src += SrcStride, Dst += DstStride)
+				{
+					*Dst = *Src;
+				}
+				for (const DataType* Src = SrcRow + (i - RowLength) * SrcStride; i < End; ++i, Src += SrcStride, Dst += DstStride)
+				{
+					*Dst = *Src;
+				}
 				return;
 			}
 
-			// auto SlicesArray = InSlices.begin();
-			const FSlice& Slice = *(InSlices.begin() + InDimIndex);
-			// const auto& Slice = InSlices[InDimIndex];
 			if (Slice.IsSingle())
 			{
 				// Single index
 				InOutCoord[InDimIndex] = Slice.GetSingle();
-				FillSlicedData(OutResult, InSlices, InOutCoord, InDimIndex + 1);
+				FillSlicedData(OutResult, OutData, InSlices, InOutCoord, InDimIndex + 1);
 			}
 			else if (Slice.IsRanged())
 			{
@@ -940,7 +2056,7 @@ namespace ArrayMultiDim
 				for (int i = Slice.GetRangeStart(); i < Slice.GetRangeEnd(); ++i)
 				{
 					InOutCoord[InDimIndex] = i;
-					FillSlicedData(OutResult, InSlices, InOutCoord, InDimIndex + 1);
+					FillSlicedData(OutResult, OutData, InSlices, InOutCoord, InDimIndex + 1);
 				}
 			}
 			else if (Slice.IsAllDim())
@@ -949,7 +2065,7 @@ namespace ArrayMultiDim
 				for (int i = 0; i < RuntimeEachDimSize[InDimIndex]; ++i)
 				{
 					InOutCoord[InDimIndex] = i;
-					FillSlicedData(OutResult, InSlices, InOutCoord, InDimIndex + 1);
+					FillSlicedData(OutResult, OutData, InSlices, InOutCoord, InDimIndex + 1);
 				}
 			}
 		}
@@ -964,11 +2080,15 @@ namespace ArrayMultiDim
 										   const CoordinateType& InMaskCenter = GenCompileTimeArray(0),
 										   EBorderMode InBorderMode = EBorderMode::NoPadding) const
 		{
+			ARRAYMULTIDIM_OPERATION_SCOPE(MaskGather, GatherScope);
 			TArray<DataType> Result;
 			Result.Reserve(InMask.GetTotalSize());  // Pre-allocate the result array.
 
 			// Iterate over the mask
-			InMask.ConstLoopByCoord([&](const CoordinateType& MaskCoord, IndexType MaskLinearIdx, IndexType MaskLoopCount, const std::variant<bool, int>& MaskValue)
+			InMask.ConstLoopByCoord([&](const typename MaskType::CoordinateType& MaskCoord,
+										typename MaskType::IndexType MaskLinearIdx,
+										typename MaskType::IndexType MaskLoopCount,
+										const std::variant<bool, int>& MaskValue)
 			{
 				// Access the mask value whatever the type is bool or int. The int value will be converted to bool
 				//		with the following rules: 0 -> false, None-Zeroed values -> true.
@@ -998,74 +2118,3170 @@ namespace ArrayMultiDim
 					OriginalCoord[i] = InApplyCoord[i] + MaskCoord[i] - InMaskCenter[i];
 				}
 			
-				if (!IsCoordinateOversize(OriginalCoord, RuntimeEachDimSize))
+				// Skip the out of range elements, or map them back into the array by the border mode.
+				if (!ResolveBorderCoordinate(OriginalCoord, RuntimeEachDimSize, InBorderMode))
 				{
-					// Add the element to the result
-					IndexType OriginalLinearIdx = CoordinateToLinearIndex(OriginalCoord, RuntimeStride);
-					Result.Add(DataList[OriginalLinearIdx]);
 					return;
 				}
-
-				// Handle [out of range] conditions
-				switch (InBorderMode)
+			
+				// Add the element to the result
+				IndexType OriginalLinearIdx = CoordinateToLinearIndex(OriginalCoord);
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+				if (AccessRecorder)
 				{
-				case EBorderMode::NoPadding:  // No padding, skip the element.
-					return;
-				case EBorderMode::RepeatBorder:
-					for (int i = 0; i < DIM_SIZE; ++i)
-					{
-						OriginalCoord[i] = (OriginalCoord[i] % RuntimeEachDimSize[i] + RuntimeEachDimSize[i]) % RuntimeEachDimSize[i];
-					}
-					break;
-				case EBorderMode::ReflectBorder:
-					for (int i = 0; i < DIM_SIZE; ++i)
-					{
-						if (OriginalCoord[i] < 0)
-						{
-							OriginalCoord[i] = -OriginalCoord[i] - 1;  //  -(-11) - 1 = 10
-						}
-						if (OriginalCoord[i] >= RuntimeEachDimSize[i])
-						{
-							int period = 2 * RuntimeEachDimSize[i];
-							OriginalCoord[i] = OriginalCoord[i] % period;  // 10 % 20 = 10
-							if (OriginalCoord[i] >= RuntimeEachDimSize[i]) // 10 >= 10
-							{
-								OriginalCoord[i] = period - OriginalCoord[i] - 1;  // 20 - 11 - 1 = 8
-							}
-						}
-					}
-					break;
-				case EBorderMode::Reflect101Border:
-					for (int i = 0; i < DIM_SIZE; ++i)
-					{
-						if (OriginalCoord[i] < 0)
-						{
-							OriginalCoord[i] = -OriginalCoord[i];
-						}
-						if (OriginalCoord[i] >= RuntimeEachDimSize[i])  // 16 >= 10
-						{
-							int period = 2 * RuntimeEachDimSize[i] - 2;  // 20 - 2 = 18
-							OriginalCoord[i] = OriginalCoord[i] % period;  // 16 % 18 = 16
-							if (OriginalCoord[i] >= RuntimeEachDimSize[i])  // 16 >= 10
+					RecordAccess_Internal(OriginalCoord, OriginalLinearIdx);
+				}
+#endif
+				Result.Add(GetStorage()[OriginalLinearIdx]);
+			});
+			ARRAYMULTIDIM_OPERATION_BYTES(GatherScope, InMask.GetTotalSize() * sizeof(DataType), Result.Num() * sizeof(DataType));
+
+			return Result;
+		}
+#pragma endregion MaskDataGetter
+
+#pragma region PrefixScan
+	public:
+		/**
+		 * @brief Replaces each element with the sum of itself and all the elements before it along the given axis (in place).
+		 *
+		 * Like NumPy cumsum(axis). For example, a 1-dim array [1 2 3 4] becomes [1 3 6 10].
+		 * The lines along the axis are independent, so they are scanned in parallel. When there are only a few long lines,
+		 * each line is split into blocks and scanned by a parallel two-pass (reduce-then-scan) algorithm instead.
+		 *
+		 * @param InAxis The dimension index to scan along.
+		 */
+		void InclusiveScan(int InAxis)
+		{
+			ScanAlongAxis_Internal(InAxis, true);
+		}
+
+		/**
+		 * @brief Replaces each element with the sum of all the elements before it along the given axis (in place).
+		 *
+		 * For example, a 1-dim array [1 2 3 4] becomes [0 1 3 6]. The first element of each line is set to DataType().
+		 * See InclusiveScan() for the parallelization.
+		 *
+		 * @param InAxis The dimension index to scan along.
+		 */
+		void ExclusiveScan(int InAxis)
+		{
+			ScanAlongAxis_Internal(InAxis, false);
+		}
+
+	protected:
+		// The arrays smaller than this (element count) are scanned in the calling thread.
+		static constexpr IndexType SCAN_PARALLEL_MIN_SIZE = 16 * 1024;
+		// Use the per-line parallelization when there are at least this many lines, otherwise scan blocks of each line in parallel.
+		static constexpr IndexType SCAN_PARALLEL_MIN_LINES = 64;
+		// The element count of a block in the blocked scan of a single long line.
+		static constexpr IndexType SCAN_BLOCK_SIZE = 8 * 1024;
+
+		// Scans [InCount] elements start from [InData] with the step [InStride], [InCarry] is the sum before the first element.
+		static void ScanLine_Internal(DataType* InData, IndexType InCount, IndexType InStride, DataType InCarry, bool bInclusive)
+		{
+			DataType Running = InCarry;
+			for (IndexType i = 0; i < InCount; ++i)
+			{
+				DataType& Element = InData[i * InStride];
+				if (bInclusive)
+				{
+					Running += Element;
+					Element = Running;
+				}
+				else
+				{
+					const DataType Value = Element;
+					Element = Running;
+					Running += Value;
+				}
+			}
+		}
+
+		// Linear index of the first element of the [InLineIndex]-th line along [InAxis].
+		// The lines are counted by the coordinates of the other dimensions, inner dimension first.
+		IndexType GetLineStartIndex(int InAxis, IndexType InLineIndex) const
+		{
+			IndexType LineStart = 0;
+			for (int Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+			{
+				if (Dim == InAxis)
+				{
+					continue;
+				}
+				LineStart += (InLineIndex % RuntimeEachDimSize[Dim]) * RuntimeStride[Dim];
+				InLineIndex /= RuntimeEachDimSize[Dim];
+			}
+			return LineStart;
+		}
+
+		void ScanAlongAxis_Internal(int InAxis, bool bInclusive)
+		{
+			check(InAxis >= 0 && InAxis < DIM_SIZE);
+			const IndexType LineLength = RuntimeEachDimSize[InAxis];
+			if (TotalSize <= 0 || LineLength <= 0)
+			{
+				return;
+			}
+			// The lines are scanned in the plain layout.
+			NormalizeRingOrigin();
+			DataType* Data = GetMutableStorage().GetData();
+			MarkAllDirty_Internal();
+			const IndexType LineStride = RuntimeStride[InAxis];
+			const IndexType NumLines = TotalSize / LineLength;
+			const bool bSingleThread = TotalSize < SCAN_PARALLEL_MIN_SIZE;
+
+			if (bSingleThread || NumLines >= SCAN_PARALLEL_MIN_LINES)
+			{
+				ParallelForIndex(NumLines, [&](IndexType LineIndex)
+				{
+					ScanLine_Internal(Data + GetLineStartIndex(InAxis, LineIndex), LineLength, LineStride, DataType(), bInclusive);
+				}, bSingleThread);
+				return;
+			}
+
+			// Few long lines: reduce-then-scan. Each element is read twice and written once (work-efficient).
+			const IndexType NumBlocks = (LineLength + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+			TArray<DataType> BlockOffsets;
+			BlockOffsets.SetNum(NumBlocks);
+			for (IndexType LineIndex = 0; LineIndex < NumLines; ++LineIndex)
+			{
+				DataType* LineData = Data + GetLineStartIndex(InAxis, LineIndex);
+
+				// 1. Sum of each block.
+				ParallelForIndex(NumBlocks, [&](IndexType BlockIndex)
+				{
+					const IndexType BlockStart = BlockIndex * SCAN_BLOCK_SIZE;
+					const IndexType BlockEnd = FMath::Min(BlockStart + SCAN_BLOCK_SIZE, LineLength);
+					DataType BlockSum = DataType();
+					for (IndexType i = BlockStart; i < BlockEnd; ++i)
+					{
+						BlockSum += LineData[i * LineStride];
+					}
+					BlockOffsets[BlockIndex] = BlockSum;
+				});
+
+				// 2. Exclusive scan of the block sums, gets the carry of each block.
+				DataType Running = DataType();
+				for (IndexType BlockIndex = 0; BlockIndex < NumBlocks; ++BlockIndex)
+				{
+					const DataType BlockSum = BlockOffsets[BlockIndex];
+					BlockOffsets[BlockIndex] = Running;
+					Running += BlockSum;
+				}
+
+				// 3. Scan each block from its carry.
+				ParallelForIndex(NumBlocks, [&](IndexType BlockIndex)
+				{
+					const IndexType BlockStart = BlockIndex * SCAN_BLOCK_SIZE;
+					const IndexType BlockCount = FMath::Min(SCAN_BLOCK_SIZE, LineLength - BlockStart);
+					ScanLine_Internal(LineData + BlockStart * LineStride, BlockCount, LineStride, BlockOffsets[BlockIndex], bInclusive);
+				});
+			}
+		}
+#pragma endregion PrefixScan
+
+#pragma region Pyramid
+	public:
+		/**
+		 * \brief Type definition for a custom pyramid reducer.
+		 *
+		 * \param InChildren The children of the coarse cell, up to 2^N elements (fewer at the border of an odd-sized dimension).
+		 * \return The value of the coarse cell.
+		 */
+		using PyramidReducerFuncType = std::function<DataType(const TArray<DataType>& /* InChildren */)>;
+
+		/**
+		 * @brief Builds a mip pyramid: a chain of levels, each one halves (rounding up) the size of every dimension of
+		 * the previous one, until all the dimensions are 1 or [InMaxLevels] levels are built.
+		 *
+		 * The returned array doesn't include the source array itself, [0] is the first halved level.
+		 * Each level keeps the storage order of the source, its cells are computed in the storage order of the level
+		 * (so the children are read in nearly sequential rows), and the cells of one level are computed in parallel.
+		 *
+		 * @param InReducer How the children are combined.
+		 * @param InMaxLevels The maximum count of the levels, -1 means no limitation.
+		 * @return The levels from fine to coarse.
+		 */
+		TArray<SelfDynamicSizeType> BuildPyramid(EPyramidReducer InReducer = EPyramidReducer::MeanReduce, int InMaxLevels = -1) const
+		{
+			return BuildPyramid(GetPyramidReducerFunc(InReducer), InMaxLevels);
+		}
+
+		// Same as above, with a custom reducer.
+		TArray<SelfDynamicSizeType> BuildPyramid(const PyramidReducerFuncType& InReducer, int InMaxLevels = -1) const
+		{
+			// Count the levels first, so that the level array is never reallocated (which copies the levels).
+			TArray<ArrayDimType> LevelSizeList;
+			ArrayDimType LevelSize = RuntimeEachDimSize;
+			while (InMaxLevels < 0 || LevelSizeList.Num() < InMaxLevels)
+			{
+				bool bCanHalve = false;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					bCanHalve |= LevelSize[Dim] > 1;
+					LevelSize[Dim] = (LevelSize[Dim] + 1) / 2;
+				}
+				if (!bCanHalve)
+				{
+					break;
+				}
+				LevelSizeList.Add(LevelSize);
+			}
+
+			TArray<SelfDynamicSizeType> Levels;
+			Levels.Reserve(LevelSizeList.Num());
+			for (int LevelIndex = 0; LevelIndex < LevelSizeList.Num(); ++LevelIndex)
+			{
+				SelfDynamicSizeType& Level = Levels.AddDefaulted_GetRef();
+				Level.SetDimSize(LevelSizeList[LevelIndex], RuntimeStorageOrder, EResizeDataCopyPolicy::SetToUninitializedValue);
+				const CoordinateType ParentMin = GenCompileTimeArray(0);
+				if (LevelIndex == 0)
+				{
+					ReducePyramidLevel_Internal(*this, Level, ParentMin, LevelSizeList[LevelIndex], InReducer);
+				}
+				else
+				{
+					ReducePyramidLevel_Internal(Levels[LevelIndex - 1], Level, ParentMin, LevelSizeList[LevelIndex], InReducer);
+				}
+			}
+			return Levels;
+		}
+
+		/**
+		 * @brief Recomputes only the pyramid cells above the changed box [InMin, InMax) of this (source) array.
+		 *
+		 * @param InOutLevels The levels built by BuildPyramid() from this array, the size of this array must not be changed.
+		 * @param InMin The first coordinate of the changed box (inclusive).
+		 * @param InMax The last coordinate of the changed box (exclusive).
+		 * @param InReducer Must be the same reducer as the one used to build the pyramid.
+		 */
+		void UpdatePyramid(TArray<SelfDynamicSizeType>& InOutLevels,
+						   const CoordinateType& InMin,
+						   const CoordinateType& InMax,
+						   EPyramidReducer InReducer = EPyramidReducer::MeanReduce) const
+		{
+			UpdatePyramid(InOutLevels, InMin, InMax, GetPyramidReducerFunc(InReducer));
+		}
+
+		// Same as above, with a custom reducer.
+		void UpdatePyramid(TArray<SelfDynamicSizeType>& InOutLevels,
+						   const CoordinateType& InMin,
+						   const CoordinateType& InMax,
+						   const PyramidReducerFuncType& InReducer) const
+		{
+			CoordinateType RegionMin = InMin;
+			CoordinateType RegionMax = InMax;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (RegionMax[Dim] <= RegionMin[Dim])
+				{
+					return;
+				}
+			}
+			for (int LevelIndex = 0; LevelIndex < InOutLevels.Num(); ++LevelIndex)
+			{
+				// The parents of the box [Min, Max) are [Min / 2, (Max - 1) / 2 + 1).
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					RegionMin[Dim] = RegionMin[Dim] / 2;
+					RegionMax[Dim] = (RegionMax[Dim] - 1) / 2 + 1;
+				}
+				if (LevelIndex == 0)
+				{
+					ReducePyramidLevel_Internal(*this, InOutLevels[LevelIndex], RegionMin, RegionMax, InReducer);
+				}
+				else
+				{
+					ReducePyramidLevel_Internal(InOutLevels[LevelIndex - 1], InOutLevels[LevelIndex], RegionMin, RegionMax, InReducer);
+				}
+			}
+		}
+
+	protected:
+		// The coarse cells are computed by chunks of this size (element count), the chunks run in parallel.
+		static constexpr IndexType PYRAMID_CHUNK_SIZE = 4 * 1024;
+
+		static PyramidReducerFuncType GetPyramidReducerFunc(EPyramidReducer InReducer)
+		{
+			switch (InReducer)
+			{
+			case EPyramidReducer::MinReduce:
+				return [](const TArray<DataType>& InChildren) -> DataType
+				{
+					DataType Result = InChildren[0];
+					for (int i = 1; i < InChildren.Num(); ++i)
+					{
+						Result = InChildren[i] < Result ? InChildren[i] : Result;
+					}
+					return Result;
+				};
+			case EPyramidReducer::MaxReduce:
+				return [](const TArray<DataType>& InChildren) -> DataType
+				{
+					DataType Result = InChildren[0];
+					for (int i = 1; i < InChildren.Num(); ++i)
+					{
+						Result = Result < InChildren[i] ? InChildren[i] : Result;
+					}
+					return Result;
+				};
+			case EPyramidReducer::MeanReduce:
+			default:
+				return [](const TArray<DataType>& InChildren) -> DataType
+				{
+					DataType Result = InChildren[0];
+					for (int i = 1; i < InChildren.Num(); ++i)
+					{
+						Result += InChildren[i];
+					}
+					return Result / InChildren.Num();
+				};
+			}
+		}
+
+		/**
+		 * @brief Converts the counter of a box (counted in [InStorageOrder], the highest priority dimension first) to a coordinate.
+		 */
+		static CoordinateType BoxCounterToCoordinate(IndexType InCounter,
+													 const CoordinateType& InBoxMin,
+													 const CoordinateType& InBoxMax,
+													 const CoordinateType& InStorageOrder)
+		{
+			CoordinateType Coord;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				const int Dim = InStorageOrder[i];
+				const IndexType Extent = InBoxMax[Dim] - InBoxMin[Dim];
+				Coord[Dim] = InBoxMin[Dim] + InCounter % Extent;
+				InCounter /= Extent;
+			}
+			return Coord;
+		}
+
+		// Moves the coordinate to the next one of the box [InBoxMin, InBoxMax) in [InStorageOrder].
+		static void AdvanceCoordinateInBox(CoordinateType& InOutCoord,
+										   const CoordinateType& InBoxMin,
+										   const CoordinateType& InBoxMax,
+										   const CoordinateType& InStorageOrder)
+		{
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				const int Dim = InStorageOrder[i];
+				if (++InOutCoord[Dim] < InBoxMax[Dim])
+				{
+					return;
+				}
+				InOutCoord[Dim] = InBoxMin[Dim];
+			}
+		}
+
+		// Computes the cells [InParentMin, InParentMax) of [OutLevel] from its finer level [InSource].
+		template <typename SourceArrayType>
+		static void ReducePyramidLevel_Internal(const SourceArrayType& InSource,
+												SelfDynamicSizeType& OutLevel,
+												const CoordinateType& InParentMin,
+												const CoordinateType& InParentMax,
+												const PyramidReducerFuncType& InReducer)
+		{
+			const ArrayDimType& SourceSize = InSource.GetRuntimeEachDimSize();
+			const CoordinateType LevelOrder = OutLevel.GetRuntimeStorageOrder();
+			IndexType NumParents = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				check(InParentMin[Dim] >= 0 && InParentMax[Dim] <= OutLevel.GetRuntimeEachDimSize()[Dim]);
+				NumParents *= InParentMax[Dim] - InParentMin[Dim];
+			}
+			if (NumParents <= 0)
+			{
+				return;
+			}
+
+			const IndexType NumChunks = (NumParents + PYRAMID_CHUNK_SIZE - 1) / PYRAMID_CHUNK_SIZE;
+			ParallelForIndex(NumChunks, [&](IndexType ChunkIndex)
+			{
+				const IndexType ChunkBegin = ChunkIndex * PYRAMID_CHUNK_SIZE;
+				const IndexType ChunkEnd = FMath::Min(ChunkBegin + PYRAMID_CHUNK_SIZE, NumParents);
+				CoordinateType ParentCoord = BoxCounterToCoordinate(ChunkBegin, InParentMin, InParentMax, LevelOrder);
+				TArray<DataType> Children;
+				Children.Reserve(1 << DIM_SIZE);
+				for (IndexType Counter = ChunkBegin; Counter < ChunkEnd; ++Counter)
+				{
+					// Gather the children 2 * Parent + {0, 1} in each dimension, skip the ones out of an odd-sized dimension.
+					Children.Reset();
+					for (uint32 Corner = 0; Corner < (1u << DIM_SIZE); ++Corner)
+					{
+						CoordinateType ChildCoord;
+						bool bInside = true;
+						for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+						{
+							ChildCoord[Dim] = ParentCoord[Dim] * 2 + ((Corner >> Dim) & 1);
+							bInside &= ChildCoord[Dim] < SourceSize[Dim];
+						}
+						if (bInside)
+						{
+							Children.Add(InSource[InSource.GetLinearIndex(ChildCoord)]);
+						}
+					}
+					OutLevel[OutLevel.GetLinearIndex(ParentCoord)] = InReducer(Children);
+					AdvanceCoordinateInBox(ParentCoord, InParentMin, InParentMax, LevelOrder);
+				}
+			});
+		}
+#pragma endregion Pyramid
+
+#pragma region GatherScatter
+
+	public:
+		// The bulk paths split the work into chunks of this many elements.
+		static constexpr int32 GATHER_CHUNK_SIZE = 4096;
+		// How many elements ahead the bulk loops prefetch.
+		static constexpr int32 GATHER_PREFETCH_DISTANCE = 16;
+
+		// Converts a coordinate list to linear indexes in bulk (the ring origin is applied), in parallel.
+		void GetLinearIndices(TConstArrayView<CoordinateType> InCoordinates, TArray<IndexType>& OutIndices) const
+		{
+			OutIndices.SetNumUninitialized(InCoordinates.Num());
+			ParallelForRange_Internal(InCoordinates.Num(), [&](int32 InStart, int32 InEnd)
+			{
+				for (int32 i = InStart; i < InEnd; ++i)
+				{
+					OutIndices[i] = CoordinateToLinearIndex(InCoordinates[i]);
+				}
+			});
+		}
+
+		/**
+		 * @brief Reads the elements at a list of coordinates, OutValues[i] = (*this)(InCoordinates[i]).
+		 *
+		 * The coordinates are converted to linear indexes in bulk, and the reads prefetch a few elements ahead.
+		 * With bInSortByIndex the reads are done in the memory order (the results still follow the input order),
+		 * which pays off when the list is large and scattered over an array much bigger than the cache.
+		 */
+		void Gather(TConstArrayView<CoordinateType> InCoordinates, TArray<DataType>& OutValues, bool bInSortByIndex = false) const
+		{
+			TArray<IndexType> Indices;
+			GetLinearIndices(InCoordinates, Indices);
+			GatherByIndex(Indices, OutValues, bInSortByIndex);
+		}
+
+		// Same as Gather(), with the linear indexes already computed (e.g. reused over frames).
+		void GatherByIndex(TConstArrayView<IndexType> InIndices, TArray<DataType>& OutValues, bool bInSortByIndex = false) const
+		{
+			OutValues.SetNumUninitialized(InIndices.Num());
+			const DataType* Data = GetStorage().GetData();
+			DataType* Out = OutValues.GetData();
+			if (!bInSortByIndex)
+			{
+				ParallelForRange_Internal(InIndices.Num(), [&](int32 InStart, int32 InEnd)
+				{
+					for (int32 i = InStart; i < InEnd; ++i)
+					{
+						if (i + GATHER_PREFETCH_DISTANCE < InEnd)
+						{
+							FPlatformMisc::Prefetch(Data + InIndices[i + GATHER_PREFETCH_DISTANCE]);
+						}
+						Out[i] = Data[InIndices[i]];
+					}
+				});
+				return;
+			}
+
+			const TArray<TPair<IndexType, int32>> Order = SortByIndex_Internal(InIndices);
+			ParallelForRange_Internal(Order.Num(), [&](int32 InStart, int32 InEnd)
+			{
+				for (int32 i = InStart; i < InEnd; ++i)
+				{
+					Out[Order[i].Value] = Data[Order[i].Key];
+				}
+			});
+		}
+
+		/**
+		 * @brief Combines a list of values into the elements at a list of coordinates:
+		 * InCombineFunc((*this)(InCoordinates[i]), InValues[i]).
+		 *
+		 * The duplicated coordinates are all combined, e.g. particle deposits with FScatterAdd. See EScatterMode for
+		 * the parallel modes; PartitionedScatter combines the values of one element in the input order, so its
+		 * result is deterministic. The dirty blocks of the written elements are marked.
+		 *
+		 * \code
+		 *		Density.Scatter(ParticleCells, ParticleMasses, ArrayMultiDim::FScatterAdd(), ArrayMultiDim::EScatterMode::AtomicScatter);
+		 * \endcode
+		 */
+		template <typename CombineFuncType>
+		void Scatter(TConstArrayView<CoordinateType> InCoordinates, TConstArrayView<DataType> InValues,
+					 const CombineFuncType& InCombineFunc, EScatterMode InMode = EScatterMode::SerialScatter)
+		{
+			TArray<IndexType> Indices;
+			GetLinearIndices(InCoordinates, Indices);
+			ScatterByIndex(Indices, InValues, InCombineFunc, InMode);
+		}
+
+		template <typename CombineFuncType>
+		void ScatterByIndex(TConstArrayView<IndexType> InIndices, TConstArrayView<DataType> InValues,
+							const CombineFuncType& InCombineFunc, EScatterMode InMode = EScatterMode::SerialScatter)
+		{
+			checkf(InIndices.Num() == InValues.Num(), TEXT("%d indexes for %d values."), InIndices.Num(), InValues.Num());
+			DataType* Data = GetMutableStorage().GetData();
+			if (bDirtyTracking)
+			{
+				for (const IndexType Index : InIndices)
+				{
+					MarkDirtyCoordinate_Internal(IndexToCoordinate(Index));
+				}
+			}
+
+			if (InMode == EScatterMode::SerialScatter)
+			{
+				const int32 Num = InIndices.Num();
+				for (int32 i = 0; i < Num; ++i)
+				{
+					if (i + GATHER_PREFETCH_DISTANCE < Num)
+					{
+						FPlatformMisc::Prefetch(Data + InIndices[i + GATHER_PREFETCH_DISTANCE]);
+					}
+					InCombineFunc(Data[InIndices[i]], InValues[i]);
+				}
+				return;
+			}
+
+			if constexpr (std::is_arithmetic_v<DataType>)
+			{
+				if (InMode == EScatterMode::AtomicScatter)
+				{
+					ParallelForRange_Internal(InIndices.Num(), [&](int32 InStart, int32 InEnd)
+					{
+						for (int32 i = InStart; i < InEnd; ++i)
+						{
+							std::atomic_ref<DataType> Target(Data[InIndices[i]]);
+							DataType Expected = Target.load(std::memory_order_relaxed);
+							DataType Desired;
+							do
+							{
+								Desired = Expected;
+								InCombineFunc(Desired, InValues[i]);
+							}
+							while (!Target.compare_exchange_weak(Expected, Desired, std::memory_order_relaxed));
+						}
+					});
+					return;
+				}
+			}
+
+			// Partitioned (also the fallback of the atomic mode for the non-arithmetic types): after a stable sort by
+			// index, the chunk boundaries are moved past the runs of equal indexes, so no element spans two chunks.
+			const TArray<TPair<IndexType, int32>> Order = SortByIndex_Internal(InIndices);
+			const int32 Num = Order.Num();
+			const int32 NumChunks = FMath::DivideAndRoundUp(Num, GATHER_CHUNK_SIZE);
+			TArray<int32> ChunkStarts;
+			ChunkStarts.SetNumUninitialized(NumChunks + 1);
+			for (int32 Chunk = 0; Chunk < NumChunks; ++Chunk)
+			{
+				int32 Start = Chunk * GATHER_CHUNK_SIZE;
+				while (Start > 0 && Start < Num && Order[Start].Key == Order[Start - 1].Key)
+				{
+					++Start;
+				}
+				ChunkStarts[Chunk] = Start;
+			}
+			ChunkStarts[NumChunks] = Num;
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				const int32 End = FMath::Max(ChunkStarts[Chunk + 1], ChunkStarts[Chunk]);
+				for (int32 i = ChunkStarts[Chunk]; i < End; ++i)
+				{
+					InCombineFunc(Data[Order[i].Key], InValues[Order[i].Value]);
+				}
+			});
+		}
+
+	protected:
+		// Calls InFunc(Start, End) on the worker threads for the chunks of [0, InNum).
+		template <typename FuncType>
+		static void ParallelForRange_Internal(int32 InNum, const FuncType& InFunc)
+		{
+			const int32 NumChunks = FMath::DivideAndRoundUp(InNum, GATHER_CHUNK_SIZE);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				InFunc(Chunk * GATHER_CHUNK_SIZE, FMath::Min(InNum, (Chunk + 1) * GATHER_CHUNK_SIZE));
+			}, NumChunks <= 1);
+		}
+
+		// (LinearIndex, InputPosition) pairs in the memory order, the input order is kept for the equal indexes.
+		static TArray<TPair<IndexType, int32>> SortByIndex_Internal(TConstArrayView<IndexType> InIndices)
+		{
+			TArray<TPair<IndexType, int32>> Order;
+			Order.SetNumUninitialized(InIndices.Num());
+			for (int32 i = 0; i < InIndices.Num(); ++i)
+			{
+				Order[i] = TPair<IndexType, int32>(InIndices[i], i);
+			}
+			Order.StableSort([](const TPair<IndexType, int32>& A, const TPair<IndexType, int32>& B) { return A.Key < B.Key; });
+			return Order;
+		}
+#pragma endregion GatherScatter
+
+#pragma region Sampling
+
+	public:
+		using FloatCoordinateType = std::array<float, DIM_SIZE>;
+		// The interpolated type, e.g. float for the integer arrays, FVector for the FVector arrays.
+		using SampleResultType = typename TSampleResult<DataType>::Type;
+		using SampleCornerOffsetsType = std::array<IndexType, (1 << DIM_SIZE)>;
+
+		// SampleMany() processes the positions in blocks of this size, one pass per step so the compiler can vectorize.
+		static constexpr int32 SAMPLE_BLOCK_SIZE = 16;
+
+		/**
+		 * @brief N-linear interpolation at a fractional coordinate (bilinear in 2D, trilinear in 3D).
+		 *
+		 * The integer coordinates are the element positions: Sample({2.f, 3.f}) == (*this)(2, 3).
+		 * Near the border the 2^N corners follow the border mode: ConstantBorder clamps to the edge element (the
+		 * default), Repeat / Reflect / Reflect101 wrap like GetElementsByMask(), and NoPadding drops the corners
+		 * outside the array and renormalizes the weights of the others.
+		 */
+		FORCEINLINE SampleResultType Sample(const FloatCoordinateType& InPosition, EBorderMode InBorderMode = EBorderMode::ConstantBorder) const
+		{
+			return Sample_Internal(InPosition, InBorderMode, GetSampleCornerOffsets());
+		}
+
+		/**
+		 * Samples many positions, in parallel. The positions are processed in blocks: the floor / fraction, the corner
+		 * loads and the interpolation steps each run over the whole block. The corner offsets are computed once.
+		 */
+		void SampleMany(TConstArrayView<FloatCoordinateType> InPositions, TArray<SampleResultType>& OutValues,
+						EBorderMode InBorderMode = EBorderMode::ConstantBorder) const
+		{
+			OutValues.SetNumUninitialized(InPositions.Num());
+			const SampleCornerOffsetsType CornerOffsets = GetSampleCornerOffsets();
+			ParallelForRange_Internal(InPositions.Num(), [&](int32 InStart, int32 InEnd)
+			{
+				for (int32 BlockStart = InStart; BlockStart < InEnd; BlockStart += SAMPLE_BLOCK_SIZE)
+				{
+					const int32 BlockSize = FMath::Min(SAMPLE_BLOCK_SIZE, InEnd - BlockStart);
+					SampleBlock_Internal(&InPositions[BlockStart], &OutValues[BlockStart], BlockSize, InBorderMode, CornerOffsets);
+				}
+			});
+		}
+
+		// The offsets of the 2^N corners from the lower corner, bit Dim of the corner index is the step along Dim.
+		SampleCornerOffsetsType GetSampleCornerOffsets() const
+		{
+			SampleCornerOffsetsType Offsets;
+			for (int32 Corner = 0; Corner < (1 << DIM_SIZE); ++Corner)
+			{
+				IndexType Offset = 0;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Offset += ((Corner >> Dim) & 1) ? RuntimeStride[Dim] : 0;
+				}
+				Offsets[Corner] = Offset;
+			}
+			return Offsets;
+		}
+
+	protected:
+		FORCEINLINE SampleResultType Sample_Internal(const FloatCoordinateType& InPosition, EBorderMode InBorderMode,
+													const SampleCornerOffsetsType& InCornerOffsets) const
+		{
+			CoordinateType Base;
+			FloatCoordinateType Fraction;
+			IndexType BaseIndex = 0;
+			bool bInside = !bHasRingOrigin;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				const float Floor = FMath::FloorToFloat(InPosition[Dim]);
+				Base[Dim] = static_cast<IndexType>(Floor);
+				Fraction[Dim] = InPosition[Dim] - Floor;
+				bInside &= Base[Dim] >= 0 && Base[Dim] + 1 < RuntimeEachDimSize[Dim];
+				BaseIndex += Base[Dim] * RuntimeStride[Dim];
+			}
+			if (!bInside)
+			{
+				return SampleBorder_Internal(Base, Fraction, InBorderMode);
+			}
+
+			// Fast path: all the corners are inside, they are the lower corner plus the precomputed offsets.
+			const DataType* LowerCorner = GetStorage().GetData() + BaseIndex;
+			SampleResultType Values[1 << DIM_SIZE];
+			for (int32 Corner = 0; Corner < (1 << DIM_SIZE); ++Corner)
+			{
+				Values[Corner] = static_cast<SampleResultType>(LowerCorner[InCornerOffsets[Corner]]);
+			}
+			// Interpolate the pairs along dimension 0, then along dimension 1, ... 2^N - 1 lerps in total.
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				const int32 NumPairs = 1 << (DIM_SIZE - 1 - Dim);
+				for (int32 Pair = 0; Pair < NumPairs; ++Pair)
+				{
+					Values[Pair] = Values[2 * Pair] * (1.f - Fraction[Dim]) + Values[2 * Pair + 1] * Fraction[Dim];
+				}
+			}
+			return Values[0];
+		}
+
+		// The general path: each corner is resolved by the border mode, also handles the ring origin.
+		SampleResultType SampleBorder_Internal(const CoordinateType& InBase, const FloatCoordinateType& InFraction, EBorderMode InBorderMode) const
+		{
+			SampleResultType Result{};
+			float TotalWeight = 0.f;
+			for (int32 Corner = 0; Corner < (1 << DIM_SIZE); ++Corner)
+			{
+				CoordinateType CornerCoord;
+				float Weight = 1.f;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					const bool bUpper = (Corner >> Dim) & 1;
+					CornerCoord[Dim] = InBase[Dim] + (bUpper ? 1 : 0);
+					Weight *= bUpper ? InFraction[Dim] : 1.f - InFraction[Dim];
+				}
+				if (Weight == 0.f)
+				{
+					continue;
+				}
+				if (InBorderMode == EBorderMode::ConstantBorder)
+				{
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						CornerCoord[Dim] = FMath::Clamp<IndexType>(CornerCoord[Dim], 0, RuntimeEachDimSize[Dim] - 1);
+					}
+				}
+				else if (!ResolveBorderCoordinate(CornerCoord, RuntimeEachDimSize, InBorderMode))
+				{
+					continue;
+				}
+				const SampleResultType Value = static_cast<SampleResultType>(GetStorage()[CoordinateToLinearIndex(CornerCoord)]);
+				Result = TotalWeight == 0.f ? Value * Weight : Result + Value * Weight;
+				TotalWeight += Weight;
+			}
+			// Only NoPadding drops corners, the weights of the others are renormalized.
+			return TotalWeight > 0.f && TotalWeight != 1.f ? Result * (1.f / TotalWeight) : Result;
+		}
+
+		void SampleBlock_Internal(const FloatCoordinateType* InPositions, SampleResultType* OutValues, int32 InBlockSize,
+								  EBorderMode InBorderMode, const SampleCornerOffsetsType& InCornerOffsets) const
+		{
+			constexpr int32 NumCorners = 1 << DIM_SIZE;
+			float Fraction[DIM_SIZE][SAMPLE_BLOCK_SIZE];
+			IndexType BaseIndex[SAMPLE_BLOCK_SIZE];
+			bool bInside[SAMPLE_BLOCK_SIZE];
+			bool bAllInside = !bHasRingOrigin;
+
+			// 1. Lower corners and fractions.
+			for (int32 Lane = 0; Lane < InBlockSize; ++Lane)
+			{
+				BaseIndex[Lane] = 0;
+				bInside[Lane] = true;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					const float Floor = FMath::FloorToFloat(InPositions[Lane][Dim]);
+					const IndexType Base = static_cast<IndexType>(Floor);
+					Fraction[Dim][Lane] = InPositions[Lane][Dim] - Floor;
+					bInside[Lane] &= Base >= 0 && Base + 1 < RuntimeEachDimSize[Dim];
+					BaseIndex[Lane] += Base * RuntimeStride[Dim];
+				}
+				bAllInside &= bInside[Lane];
+			}
+			if (!bAllInside)
+			{
+				for (int32 Lane = 0; Lane < InBlockSize; ++Lane)
+				{
+					OutValues[Lane] = Sample_Internal(InPositions[Lane], InBorderMode, InCornerOffsets);
+				}
+				return;
+			}
+
+			// 2. Corner loads.
+			const DataType* Data = GetStorage().GetData();
+			SampleResultType Values[NumCorners][SAMPLE_BLOCK_SIZE];
+			for (int32 Corner = 0; Corner < NumCorners; ++Corner)
+			{
+				const IndexType CornerOffset = InCornerOffsets[Corner];
+				for (int32 Lane = 0; Lane < InBlockSize; ++Lane)
+				{
+					Values[Corner][Lane] = static_cast<SampleResultType>(Data[BaseIndex[Lane] + CornerOffset]);
+				}
+			}
+
+			// 3. Lerps, one dimension at a time over all the lanes.
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				const int32 NumPairs = 1 << (DIM_SIZE - 1 - Dim);
+				for (int32 Pair = 0; Pair < NumPairs; ++Pair)
+				{
+					for (int32 Lane = 0; Lane < InBlockSize; ++Lane)
+					{
+						Values[Pair][Lane] = Values[2 * Pair][Lane] * (1.f - Fraction[Dim][Lane]) + Values[2 * Pair + 1][Lane] * Fraction[Dim][Lane];
+					}
+				}
+			}
+			for (int32 Lane = 0; Lane < InBlockSize; ++Lane)
+			{
+				OutValues[Lane] = Values[0][Lane];
+			}
+		}
+#pragma endregion Sampling
+
+#pragma region ConnectedComponents
+
+	public:
+		// The labels of LabelConnectedComponents(): 0 is the background, the components are 1, 2, ... N.
+		using LabelArrayType = TBasicArrayMultiDim<IndexType, IndexPolicy, Dims...>;
+
+		// The statistics of one connected component.
+		struct FComponentStats
+		{
+			IndexType Size = 0;  // The element count.
+			CoordinateType Min;  // The bounding box, both ends inclusive.
+			CoordinateType Max;
+		};
+
+		struct FComponentLabeling
+		{
+			LabelArrayType Labels;
+			// Components[Label - 1] is the component labeled [Label].
+			TArray<FComponentStats, typename IndexPolicy::AllocatorType> Components;
+		};
+
+		// The labeling cuts the array into slabs along the slowest storage dimension, each one at least this many elements.
+		static constexpr int32 LABEL_BLOCK_SIZE = 65536;
+
+		/**
+		 * @brief Labels the connected components of the elements that InPredicate(Element) is true for, like scipy.ndimage.label().
+		 *
+		 * The label array has the same size and storage order as this array. The components are numbered in the memory
+		 * order of their first element, so the result doesn't depend on the thread count.
+		 *
+		 * The slabs are scanned in parallel, each one with a local union-find which unites every element with its
+		 * neighbors visited before it. Then the slab boundaries are merged in parallel with lock-free unions (a root is
+		 * always linked to a smaller root by a compare-and-swap), and a last parallel pass writes the compact labels and
+		 * the statistics. Besides the label array, one index per element is allocated.
+		 *
+		 * Usage:
+		 * \code
+		 *		auto Rooms = Grid.LabelConnectedComponents([](const uint8 InCell) { return InCell == Walkable; });
+		 *		const int32 Room = Rooms.Labels(X, Y);  // 0 for a wall.
+		 *		const int32 RoomArea = Rooms.Components[Room - 1].Size;
+		 * \endcode
+		 */
+		template <typename PredicateType>
+		FComponentLabeling LabelConnectedComponents(const PredicateType& InPredicate,
+													EConnectivity InConnectivity = EConnectivity::FaceConnectivity) const
+		{
+			FComponentLabeling Result;
+			Result.Labels.SetDimSize(RuntimeEachDimSize, RuntimeStorageOrder, EResizeDataCopyPolicy::SetToUninitializedValue);
+			if (TotalSize == 0)
+			{
+				return Result;
+			}
+
+			const int SlowDim = RuntimeStorageOrder[DIM_SIZE - 1];
+			const IndexType SlabStride = RuntimeStride[SlowDim];
+			const IndexType SlabThickness = FMath::Max<IndexType>(1, (LABEL_BLOCK_SIZE + SlabStride - 1) / SlabStride);
+			const int32 NumSlabs = static_cast<int32>((RuntimeEachDimSize[SlowDim] + SlabThickness - 1) / SlabThickness);
+			const CoordinateType BoxMin = GenCompileTimeArray(0);
+
+			// The neighbors visited before an element: its slowest (in the storage order) non-zero offset is negative.
+			int32 NumCodes = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				NumCodes *= 3;
+			}
+			TArray<CoordinateType> Offsets;
+			for (int32 Code = 0; Code < NumCodes; ++Code)
+			{
+				CoordinateType Offset;
+				int32 NumNonZero = 0;
+				for (int Dim = 0, Rest = Code; Dim < DIM_SIZE; ++Dim, Rest /= 3)
+				{
+					Offset[Dim] = Rest % 3 - 1;
+					NumNonZero += Offset[Dim] != 0;
+				}
+				int32 SlowestNonZero = DIM_SIZE - 1;
+				while (SlowestNonZero >= 0 && Offset[RuntimeStorageOrder[SlowestNonZero]] == 0)
+				{
+					--SlowestNonZero;
+				}
+				if (SlowestNonZero >= 0 && Offset[RuntimeStorageOrder[SlowestNonZero]] < 0 &&
+					(InConnectivity == EConnectivity::FullConnectivity || NumNonZero == 1))
+				{
+					Offsets.Add(Offset);
+				}
+			}
+			TArray<IndexType> OffsetDeltas;
+			for (const CoordinateType& Offset : Offsets)
+			{
+				OffsetDeltas.Add(CoordinateToLinearIndex(Offset, RuntimeStride));
+			}
+			auto IsNeighborInside = [this, SlowDim](const CoordinateType& InCoord, const CoordinateType& InOffset, IndexType InSlowMin)
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					const IndexType Neighbor = InCoord[Dim] + InOffset[Dim];
+					if (Neighbor < (Dim == SlowDim ? InSlowMin : 0) || Neighbor >= RuntimeEachDimSize[Dim])
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+
+			// The union-find forest in the memory order of the labels, INDEX_NONE for the background.
+			TArray<IndexType, typename IndexPolicy::AllocatorType> ParentList;
+			ParentList.SetNumUninitialized(TotalSize);
+			IndexType* Parents = ParentList.GetData();
+			const DataType* Data = GetStorage().GetData();
+
+			// 1. The local union-find of each slab, then the slab is flattened: every element points to its root.
+			ParallelFor(NumSlabs, [&](int32 Slab)
+			{
+				const IndexType SlabBegin = Slab * SlabThickness;
+				const IndexType SlabEnd = FMath::Min<IndexType>(SlabBegin + SlabThickness, RuntimeEachDimSize[SlowDim]);
+				CoordinateType Coord = BoxMin;
+				Coord[SlowDim] = SlabBegin;
+				for (IndexType i = SlabBegin * SlabStride; i < SlabEnd * SlabStride; ++i)
+				{
+					if (!InPredicate(Data[bHasRingOrigin ? CoordinateToLinearIndex(Coord) : i]))
+					{
+						Parents[i] = INDEX_NONE;
+					}
+					else
+					{
+						Parents[i] = i;
+						for (int32 k = 0; k < Offsets.Num(); ++k)
+						{
+							if (IsNeighborInside(Coord, Offsets[k], SlabBegin) && Parents[i + OffsetDeltas[k]] != INDEX_NONE)
+							{
+								UniteLocal_Internal(Parents, i, i + OffsetDeltas[k]);
+							}
+						}
+					}
+					AdvanceCoordinateInBox(Coord, BoxMin, RuntimeEachDimSize, RuntimeStorageOrder);
+				}
+				// A parent is never after its child, so one forward pass flattens the slab.
+				for (IndexType i = SlabBegin * SlabStride; i < SlabEnd * SlabStride; ++i)
+				{
+					if (Parents[i] != INDEX_NONE)
+					{
+						Parents[i] = Parents[Parents[i]];
+					}
+				}
+			}, NumSlabs <= 1);
+
+			// 2. Merges the first plane of each slab with the last plane of the previous slab.
+			ParallelFor(NumSlabs - 1, [&](int32 Boundary)
+			{
+				const IndexType Plane = (Boundary + 1) * SlabThickness;
+				CoordinateType Coord = BoxMin;
+				Coord[SlowDim] = Plane;
+				for (IndexType i = Plane * SlabStride; i < (Plane + 1) * SlabStride; ++i)
+				{
+					if (std::atomic_ref<IndexType>(Parents[i]).load(std::memory_order_relaxed) != INDEX_NONE)
+					{
+						for (int32 k = 0; k < Offsets.Num(); ++k)
+						{
+							if (Offsets[k][SlowDim] < 0 && IsNeighborInside(Coord, Offsets[k], 0) &&
+								std::atomic_ref<IndexType>(Parents[i + OffsetDeltas[k]]).load(std::memory_order_relaxed) != INDEX_NONE)
+							{
+								UniteAtomic_Internal(Parents, i, i + OffsetDeltas[k]);
+							}
+						}
+					}
+					AdvanceCoordinateInBox(Coord, BoxMin, RuntimeEachDimSize, RuntimeStorageOrder);
+				}
+			}, NumSlabs <= 2);
+
+			// 3. Numbers the roots: counts them per slab, then each slab labels its roots from its prefix sum.
+			TArray<IndexType> SlabFirstLabels;
+			SlabFirstLabels.SetNumZeroed(NumSlabs + 1);
+			ParallelFor(NumSlabs, [&](int32 Slab)
+			{
+				const IndexType SlabEnd = FMath::Min<IndexType>((Slab + 1) * SlabThickness, RuntimeEachDimSize[SlowDim]);
+				IndexType NumRoots = 0;
+				for (IndexType i = Slab * SlabThickness * SlabStride; i < SlabEnd * SlabStride; ++i)
+				{
+					NumRoots += Parents[i] == i;
+				}
+				SlabFirstLabels[Slab + 1] = NumRoots;
+			}, NumSlabs <= 1);
+			for (int32 Slab = 0; Slab < NumSlabs; ++Slab)
+			{
+				SlabFirstLabels[Slab + 1] += SlabFirstLabels[Slab];
+			}
+
+			IndexType* Labels = Result.Labels.GetData();
+			Result.Components.SetNumUninitialized(SlabFirstLabels[NumSlabs]);
+			FComponentStats* Components = Result.Components.GetData();
+			ParallelFor(NumSlabs, [&](int32 Slab)
+			{
+				const IndexType SlabEnd = FMath::Min<IndexType>((Slab + 1) * SlabThickness, RuntimeEachDimSize[SlowDim]);
+				IndexType Label = SlabFirstLabels[Slab];
+				for (IndexType i = Slab * SlabThickness * SlabStride; i < SlabEnd * SlabStride; ++i)
+				{
+					if (Parents[i] == i)
+					{
+						Labels[i] = ++Label;
+						FComponentStats& Stats = Components[Label - 1];
+						Stats.Size = 0;
+						Stats.Min.fill(TNumericLimits<IndexType>::Max());
+						Stats.Max.fill(-1);
+					}
+				}
+			}, NumSlabs <= 1);
+
+			// 4. Labels every element by its root and gathers the statistics. The statistics are accumulated over a run
+			// of equal labels, and the run is merged into the shared statistics with atomics when the label changes.
+			ParallelFor(NumSlabs, [&](int32 Slab)
+			{
+				const IndexType SlabBegin = Slab * SlabThickness;
+				const IndexType SlabEnd = FMath::Min<IndexType>(SlabBegin + SlabThickness, RuntimeEachDimSize[SlowDim]);
+				FComponentStats Run;
+				IndexType RunLabel = 0;
+				auto FlushRun = [&]()
+				{
+					if (RunLabel == 0)
+					{
+						return;
+					}
+					FComponentStats& Stats = Components[RunLabel - 1];
+					std::atomic_ref<IndexType>(Stats.Size).fetch_add(Run.Size, std::memory_order_relaxed);
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						std::atomic_ref<IndexType> Min(Stats.Min[Dim]);
+						IndexType OldMin = Min.load(std::memory_order_relaxed);
+						while (Run.Min[Dim] < OldMin && !Min.compare_exchange_weak(OldMin, Run.Min[Dim], std::memory_order_relaxed))
+						{
+						}
+						std::atomic_ref<IndexType> Max(Stats.Max[Dim]);
+						IndexType OldMax = Max.load(std::memory_order_relaxed);
+						while (Run.Max[Dim] > OldMax && !Max.compare_exchange_weak(OldMax, Run.Max[Dim], std::memory_order_relaxed))
+						{
+						}
+					}
+				};
+
+				CoordinateType Coord = BoxMin;
+				Coord[SlowDim] = SlabBegin;
+				for (IndexType i = SlabBegin * SlabStride; i < SlabEnd * SlabStride; ++i)
+				{
+					IndexType Label = 0;
+					if (Parents[i] == INDEX_NONE)
+					{
+						Labels[i] = 0;
+					}
+					else if (Parents[i] == i)
+					{
+						Label = Labels[i];
+					}
+					else
+					{
+						// The label of the root is written by the previous pass, the roots themselves are only read here.
+						IndexType Root = Parents[i];
+						while (Parents[Root] != Root)
+						{
+							Root = Parents[Root];
+						}
+						Label = Labels[Root];
+						Labels[i] = Label;
+					}
+					if (Label != RunLabel)
+					{
+						FlushRun();
+						RunLabel = Label;
+						Run.Size = 0;
+						Run.Min = Coord;
+						Run.Max = Coord;
+					}
+					if (Label != 0)
+					{
+						++Run.Size;
+						for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+						{
+							Run.Min[Dim] = FMath::Min(Run.Min[Dim], Coord[Dim]);
+							Run.Max[Dim] = FMath::Max(Run.Max[Dim], Coord[Dim]);
+						}
+					}
+					AdvanceCoordinateInBox(Coord, BoxMin, RuntimeEachDimSize, RuntimeStorageOrder);
+				}
+				FlushRun();
+			}, NumSlabs <= 1);
+
+			return Result;
+		}
+
+	protected:
+		// Unites the trees of 2 elements of the same slab, the bigger root is linked to the smaller one. Not thread-safe.
+		static void UniteLocal_Internal(IndexType* InOutParents, IndexType InA, IndexType InB)
+		{
+			auto FindRoot = [InOutParents](IndexType InElement)
+			{
+				while (InOutParents[InElement] != InElement)
+				{
+					// Path halving.
+					InOutParents[InElement] = InOutParents[InOutParents[InElement]];
+					InElement = InOutParents[InElement];
+				}
+				return InElement;
+			};
+			const IndexType RootA = FindRoot(InA);
+			const IndexType RootB = FindRoot(InB);
+			if (RootA != RootB)
+			{
+				InOutParents[FMath::Max(RootA, RootB)] = FMath::Min(RootA, RootB);
+			}
+		}
+
+		// Same as above, thread-safe: the link is a compare-and-swap on the bigger root, retried if the root has changed.
+		static void UniteAtomic_Internal(IndexType* InOutParents, IndexType InA, IndexType InB)
+		{
+			auto FindRoot = [InOutParents](IndexType InElement)
+			{
+				IndexType Parent;
+				while ((Parent = std::atomic_ref<IndexType>(InOutParents[InElement]).load(std::memory_order_relaxed)) != InElement)
+				{
+					InElement = Parent;
+				}
+				return InElement;
+			};
+			while (true)
+			{
+				InA = FindRoot(InA);
+				InB = FindRoot(InB);
+				if (InA == InB)
+				{
+					return;
+				}
+				if (InA < InB)
+				{
+					Swap(InA, InB);
+				}
+				IndexType Expected = InA;
+				if (std::atomic_ref<IndexType>(InOutParents[InA]).compare_exchange_strong(Expected, InB))
+				{
+					return;
+				}
+			}
+		}
+#pragma endregion ConnectedComponents
+
+#pragma region MorphologyFilters
+
+	public:
+		// The filters split the work into chunks of at least this many elements.
+		static constexpr int32 FILTER_CHUNK_SIZE = 65536;
+
+		/**
+		 * @brief Erosion: each element becomes the minimum of the window around it, like scipy.ndimage.minimum_filter().
+		 *
+		 * The window is a box of [InWindowSize] elements, with the filtered element at InWindowSize / 2 of the box. A box is
+		 * separable, so it runs as one 1D pass per dimension, and each pass uses the van Herk / Gil-Werman algorithm:
+		 * 3 comparisons per element whatever the window length.
+		 * The elements out of range follow the border mode like GetElementsByMask(), NoPadding and ConstantBorder skip them.
+		 */
+		SelfDynamicSizeType Erode(const ArrayDimType& InWindowSize, EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			return MinMaxFilter_Internal<true>(MakeFilterSource_Internal(), MakeBoxFootprint_Internal(InWindowSize), InBorderMode);
+		}
+
+		/**
+		 * Same as above, with any footprint: the elements where the mask is true (or non-zero), [InMaskCenter] of the mask
+		 * over the filtered element (the middle of the mask by default). An all-true mask runs as a box, the others read
+		 * the footprint of each element directly, in parallel.
+		 */
+		SelfDynamicSizeType Erode(const MaskType& InMask, EBorderMode InBorderMode = EBorderMode::NoPadding,
+								  const CoordinateType& InMaskCenter = GenCompileTimeArray(INVALID_INDEX)) const
+		{
+			return MinMaxFilter_Internal<true>(MakeFilterSource_Internal(), MakeMaskFootprint_Internal(InMask, InMaskCenter), InBorderMode);
+		}
+
+		// Dilation: each element becomes the maximum of the window around it. See Erode().
+		SelfDynamicSizeType Dilate(const ArrayDimType& InWindowSize, EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			return MinMaxFilter_Internal<false>(MakeFilterSource_Internal(), MakeBoxFootprint_Internal(InWindowSize), InBorderMode);
+		}
+
+		SelfDynamicSizeType Dilate(const MaskType& InMask, EBorderMode InBorderMode = EBorderMode::NoPadding,
+								   const CoordinateType& InMaskCenter = GenCompileTimeArray(INVALID_INDEX)) const
+		{
+			return MinMaxFilter_Internal<false>(MakeFilterSource_Internal(), MakeMaskFootprint_Internal(InMask, InMaskCenter), InBorderMode);
+		}
+
+		// Opening: erosion, then dilation by the reflected footprint. Removes the peaks narrower than the footprint.
+		SelfDynamicSizeType Open(const ArrayDimType& InWindowSize, EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			return Open_Internal(MakeBoxFootprint_Internal(InWindowSize), InBorderMode);
+		}
+
+		SelfDynamicSizeType Open(const MaskType& InMask, EBorderMode InBorderMode = EBorderMode::NoPadding,
+								 const CoordinateType& InMaskCenter = GenCompileTimeArray(INVALID_INDEX)) const
+		{
+			return Open_Internal(MakeMaskFootprint_Internal(InMask, InMaskCenter), InBorderMode);
+		}
+
+		// Closing: dilation, then erosion by the reflected footprint. Fills the holes narrower than the footprint.
+		SelfDynamicSizeType Close(const ArrayDimType& InWindowSize, EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			return Close_Internal(MakeBoxFootprint_Internal(InWindowSize), InBorderMode);
+		}
+
+		SelfDynamicSizeType Close(const MaskType& InMask, EBorderMode InBorderMode = EBorderMode::NoPadding,
+								  const CoordinateType& InMaskCenter = GenCompileTimeArray(INVALID_INDEX)) const
+		{
+			return Close_Internal(MakeMaskFootprint_Internal(InMask, InMaskCenter), InBorderMode);
+		}
+
+		/**
+		 * @brief Median filter: each element becomes the median of the window around it, like scipy.ndimage.median_filter().
+		 *
+		 * For a window of n elements the result is the element of rank n / 2 (the upper median when n is even).
+		 * The 8 and 16 bit integer types use a sliding histogram (Huang's algorithm) along the fastest storage dimension:
+		 * moving the window by one element only removes its trailing face and adds its leading face, and the median is
+		 * found by a two-level (coarse / fine) bin count. The other types select the median of each window with
+		 * std::nth_element(). The elements out of range follow the border mode like Erode().
+		 */
+		SelfDynamicSizeType MedianFilter(const ArrayDimType& InWindowSize, EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			return MedianFilter_Internal(MakeBoxFootprint_Internal(InWindowSize), InBorderMode);
+		}
+
+		SelfDynamicSizeType MedianFilter(const MaskType& InMask, EBorderMode InBorderMode = EBorderMode::NoPadding,
+										 const CoordinateType& InMaskCenter = GenCompileTimeArray(INVALID_INDEX)) const
+		{
+			return MedianFilter_Internal(MakeMaskFootprint_Internal(InMask, InMaskCenter), InBorderMode);
+		}
+
+	protected:
+		// The window of a filter, relative to the filtered element.
+		struct FFilterFootprint
+		{
+			bool bIsBox = true;
+			ArrayDimType BoxSize;
+			CoordinateType BoxAnchor;  // The position of the filtered element in the box.
+			TArray<CoordinateType> Offsets;  // All the enabled offsets, for both the boxes and the masks.
+		};
+
+		FFilterFootprint MakeBoxFootprint_Internal(const ArrayDimType& InWindowSize) const
+		{
+			FFilterFootprint Footprint;
+			Footprint.BoxSize = InWindowSize;
+			IndexType NumOffsets = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				checkf(InWindowSize[Dim] > 0, TEXT("The window size of dimension %d is %d."), Dim, static_cast<int32>(InWindowSize[Dim]));
+				Footprint.BoxAnchor[Dim] = InWindowSize[Dim] / 2;
+				NumOffsets *= InWindowSize[Dim];
+			}
+			const CoordinateType BoxMin = GenCompileTimeArray(0);
+			CoordinateType BoxCoord = BoxMin;
+			Footprint.Offsets.Reserve(NumOffsets);
+			for (IndexType i = 0; i < NumOffsets; ++i)
+			{
+				CoordinateType& Offset = Footprint.Offsets.AddDefaulted_GetRef();
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Offset[Dim] = BoxCoord[Dim] - Footprint.BoxAnchor[Dim];
+				}
+				AdvanceCoordinateInBox(BoxCoord, BoxMin, InWindowSize, RuntimeStorageOrder);
+			}
+			return Footprint;
+		}
+
+		FFilterFootprint MakeMaskFootprint_Internal(const MaskType& InMask, const CoordinateType& InMaskCenter) const
+		{
+			FFilterFootprint Footprint;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Footprint.BoxSize[Dim] = InMask.GetRuntimeEachDimSize()[Dim];
+				Footprint.BoxAnchor[Dim] = InMaskCenter[Dim] == INVALID_INDEX ? Footprint.BoxSize[Dim] / 2 : InMaskCenter[Dim];
+			}
+			InMask.ConstLoopByCoord([&](const typename MaskType::CoordinateType& InMaskCoord,
+										typename MaskType::IndexType InMaskLinearIdx,
+										typename MaskType::IndexType InMaskLoopCount,
+										const std::variant<bool, int>& InMaskValue)
+			{
+				if (!std::visit([](const auto InValue) { return static_cast<bool>(InValue); }, InMaskValue))
+				{
+					Footprint.bIsBox = false;
+					return;
+				}
+				CoordinateType& Offset = Footprint.Offsets.AddDefaulted_GetRef();
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Offset[Dim] = InMaskCoord[Dim] - Footprint.BoxAnchor[Dim];
+				}
+			});
+			// A box anchored outside itself doesn't hold the filtered element, the van Herk pass relies on that.
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Footprint.bIsBox &= Footprint.BoxAnchor[Dim] >= 0 && Footprint.BoxAnchor[Dim] < Footprint.BoxSize[Dim];
+			}
+			Footprint.bIsBox &= Footprint.Offsets.Num() > 0;
+			return Footprint;
+		}
+
+		static FFilterFootprint ReflectFootprint_Internal(const FFilterFootprint& InFootprint)
+		{
+			FFilterFootprint Reflected = InFootprint;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Reflected.BoxAnchor[Dim] = InFootprint.BoxSize[Dim] - 1 - InFootprint.BoxAnchor[Dim];
+			}
+			for (CoordinateType& Offset : Reflected.Offsets)
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Offset[Dim] = -Offset[Dim];
+				}
+			}
+			return Reflected;
+		}
+
+		SelfDynamicSizeType Open_Internal(const FFilterFootprint& InFootprint, EBorderMode InBorderMode) const
+		{
+			return MinMaxFilter_Internal<false>(MinMaxFilter_Internal<true>(MakeFilterSource_Internal(), InFootprint, InBorderMode),
+												ReflectFootprint_Internal(InFootprint), InBorderMode);
+		}
+
+		SelfDynamicSizeType Close_Internal(const FFilterFootprint& InFootprint, EBorderMode InBorderMode) const
+		{
+			return MinMaxFilter_Internal<true>(MinMaxFilter_Internal<false>(MakeFilterSource_Internal(), InFootprint, InBorderMode),
+											   ReflectFootprint_Internal(InFootprint), InBorderMode);
+		}
+
+		// A copy of this array without the ring origin, so that the filters can address it by the strides.
+		SelfDynamicSizeType MakeFilterSource_Internal() const
+		{
+			SelfDynamicSizeType Source;
+			Source.SetDimSize(RuntimeEachDimSize, RuntimeStorageOrder, EResizeDataCopyPolicy::SetToUninitializedValue);
+			DataType* Out = Source.GetData();
+			const DataType* Data = GetStorage().GetData();
+			const int32 NumChunks = static_cast<int32>((TotalSize + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				const IndexType Begin = static_cast<IndexType>(Chunk) * FILTER_CHUNK_SIZE;
+				const IndexType End = FMath::Min<IndexType>(Begin + FILTER_CHUNK_SIZE, TotalSize);
+				for (IndexType i = Begin; i < End; ++i)
+				{
+					Out[i] = Data[bHasRingOrigin ? CoordinateToLinearIndex(IndexToCoordinate(i, RuntimeStride, RuntimeStorageOrder)) : i];
+				}
+			}, NumChunks <= 1);
+			return Source;
+		}
+
+		template <bool bMin>
+		FORCEINLINE static const DataType& PickExtremum_Internal(const DataType& InA, const DataType& InB)
+		{
+			if constexpr (bMin)
+			{
+				return InB < InA ? InB : InA;
+			}
+			else
+			{
+				return InA < InB ? InB : InA;
+			}
+		}
+
+		// Erosion (bMin) or dilation of a source without ring origin.
+		template <bool bMin>
+		static SelfDynamicSizeType MinMaxFilter_Internal(SelfDynamicSizeType InSource, const FFilterFootprint& InFootprint, EBorderMode InBorderMode)
+		{
+			SelfDynamicSizeType Result = MoveTemp(InSource);
+			if (Result.GetTotalSize() == 0 || InFootprint.Offsets.Num() == 0)
+			{
+				return Result;
+			}
+			if (InFootprint.bIsBox)
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					if (InFootprint.BoxSize[Dim] > 1)
+					{
+						MinMaxFilterAxis_Internal<bMin>(Result, Dim, InFootprint.BoxSize[Dim], InFootprint.BoxAnchor[Dim], InBorderMode);
+					}
+				}
+				return Result;
+			}
+
+			// The windows read the source while the result is written. The source takes the buffer, the result gets an
+			// uninitialized one of the same shape (every element is written), so the elements aren't copied.
+			const SelfDynamicSizeType Source = MoveTemp(Result);
+			Result.SetDimSize(Source.GetRuntimeEachDimSize(), Source.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToUninitializedValue);
+			ReduceWindows_Internal(Source, Result, InFootprint.Offsets, InBorderMode, [](TArray<DataType>& InWindow)
+			{
+				DataType Extremum = InWindow[0];
+				for (int32 i = 1; i < InWindow.Num(); ++i)
+				{
+					Extremum = PickExtremum_Internal<bMin>(Extremum, InWindow[i]);
+				}
+				return Extremum;
+			});
+			return Result;
+		}
+
+		// One van Herk / Gil-Werman pass of a 1D window along [InAxis], in place.
+		template <bool bMin>
+		static void MinMaxFilterAxis_Internal(SelfDynamicSizeType& InOutArray, int InAxis, IndexType InWindowSize, IndexType InAnchor, EBorderMode InBorderMode)
+		{
+			const ArrayDimType& Size = InOutArray.GetRuntimeEachDimSize();
+			const CoordinateType& Stride = InOutArray.GetRuntimeStride();
+			const CoordinateType Order = InOutArray.GetRuntimeStorageOrder();
+			const IndexType Length = Size[InAxis];
+			const IndexType AxisStride = Stride[InAxis];
+			const IndexType PaddedLength = Length + InWindowSize - 1;
+
+			// The source offset of each padded position. NoPadding and ConstantBorder clamp to the edge, which gives the
+			// same extremum as skipping (the window of an element always holds the element, so also the edge it crosses).
+			TArray<IndexType> PaddedSource;
+			PaddedSource.SetNumUninitialized(PaddedLength);
+			for (IndexType j = 0; j < PaddedLength; ++j)
+			{
+				CoordinateType Coord = GenCompileTimeArray(0);
+				Coord[InAxis] = j - InAnchor;
+				if (!ResolveBorderCoordinate(Coord, Size, InBorderMode))
+				{
+					Coord[InAxis] = FMath::Clamp<IndexType>(Coord[InAxis], 0, Length - 1);
+				}
+				PaddedSource[j] = Coord[InAxis] * AxisStride;
+			}
+
+			const CoordinateType BoxMin = GenCompileTimeArray(0);
+			CoordinateType LineMax = Size;
+			LineMax[InAxis] = 1;
+			const IndexType NumLines = InOutArray.GetTotalSize() / Length;
+			const IndexType LinesPerChunk = FMath::Max<IndexType>(1, FILTER_CHUNK_SIZE / Length);
+			const int32 NumChunks = static_cast<int32>((NumLines + LinesPerChunk - 1) / LinesPerChunk);
+			DataType* Data = InOutArray.GetData();
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				TArray<DataType> Padded, Forward, Backward;
+				Padded.SetNumUninitialized(PaddedLength);
+				Forward.SetNumUninitialized(PaddedLength);
+				Backward.SetNumUninitialized(PaddedLength);
+				const IndexType LineBegin = Chunk * LinesPerChunk;
+				const IndexType LineEnd = FMath::Min<IndexType>(LineBegin + LinesPerChunk, NumLines);
+				CoordinateType LineCoord = BoxCounterToCoordinate(LineBegin, BoxMin, LineMax, Order);
+				for (IndexType Line = LineBegin; Line < LineEnd; ++Line)
+				{
+					DataType* LineData = Data + CoordinateToLinearIndex(LineCoord, Stride);
+					for (IndexType j = 0; j < PaddedLength; ++j)
+					{
+						Padded[j] = LineData[PaddedSource[j]];
+					}
+					// The extremum of each block of [InWindowSize] from the block start (Forward) and to the block end
+					// (Backward). Any window is the end of one block and the start of the next one.
+					for (IndexType BlockBegin = 0; BlockBegin < PaddedLength; BlockBegin += InWindowSize)
+					{
+						const IndexType BlockEnd = FMath::Min<IndexType>(BlockBegin + InWindowSize, PaddedLength);
+						Forward[BlockBegin] = Padded[BlockBegin];
+						for (IndexType j = BlockBegin + 1; j < BlockEnd; ++j)
+						{
+							Forward[j] = PickExtremum_Internal<bMin>(Forward[j - 1], Padded[j]);
+						}
+						Backward[BlockEnd - 1] = Padded[BlockEnd - 1];
+						for (IndexType j = BlockEnd - 2; j >= BlockBegin; --j)
+						{
+							Backward[j] = PickExtremum_Internal<bMin>(Backward[j + 1], Padded[j]);
+						}
+					}
+					for (IndexType i = 0; i < Length; ++i)
+					{
+						LineData[i * AxisStride] = PickExtremum_Internal<bMin>(Backward[i], Forward[i + InWindowSize - 1]);
+					}
+					AdvanceCoordinateInBox(LineCoord, BoxMin, LineMax, Order);
+				}
+			}, NumChunks <= 1);
+		}
+
+		/**
+		 * Gathers the window of each element of [InSource] into a reused buffer, and writes InReduce(Window) to [OutResult].
+		 * The elements whose whole window is inside read it by precomputed linear offsets. An element with an empty window
+		 * (every offset skipped by the border mode) keeps its value.
+		 */
+		template <typename ReduceFuncType>
+		static void ReduceWindows_Internal(const SelfDynamicSizeType& InSource, SelfDynamicSizeType& OutResult,
+										   const TArray<CoordinateType>& InOffsets, EBorderMode InBorderMode,
+										   const ReduceFuncType& InReduce)
+		{
+			const ArrayDimType& Size = InSource.GetRuntimeEachDimSize();
+			const CoordinateType& Stride = InSource.GetRuntimeStride();
+			const CoordinateType Order = InSource.GetRuntimeStorageOrder();
+			const IndexType Total = InSource.GetTotalSize();
+			CoordinateType OffsetMin = GenCompileTimeArray(0);
+			CoordinateType OffsetMax = GenCompileTimeArray(0);
+			TArray<IndexType> Deltas;
+			for (const CoordinateType& Offset : InOffsets)
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					OffsetMin[Dim] = FMath::Min(OffsetMin[Dim], Offset[Dim]);
+					OffsetMax[Dim] = FMath::Max(OffsetMax[Dim], Offset[Dim]);
+				}
+				Deltas.Add(CoordinateToLinearIndex(Offset, Stride));
+			}
+
+			const DataType* Source = InSource.GetData();
+			DataType* Out = OutResult.GetData();
+			const CoordinateType BoxMin = GenCompileTimeArray(0);
+			const int32 NumChunks = static_cast<int32>((Total + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				const IndexType Begin = static_cast<IndexType>(Chunk) * FILTER_CHUNK_SIZE;
+				const IndexType End = FMath::Min<IndexType>(Begin + FILTER_CHUNK_SIZE, Total);
+				CoordinateType Coord = BoxCounterToCoordinate(Begin, BoxMin, Size, Order);
+				TArray<DataType> Window;
+				Window.Reserve(InOffsets.Num());
+				for (IndexType i = Begin; i < End; ++i)
+				{
+					Window.Reset();
+					bool bInside = true;
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						bInside &= Coord[Dim] + OffsetMin[Dim] >= 0 && Coord[Dim] + OffsetMax[Dim] < Size[Dim];
+					}
+					if (bInside)
+					{
+						for (const IndexType Delta : Deltas)
+						{
+							Window.Add(Source[i + Delta]);
+						}
+					}
+					else
+					{
+						for (const CoordinateType& Offset : InOffsets)
+						{
+							CoordinateType NeighborCoord;
+							for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+							{
+								NeighborCoord[Dim] = Coord[Dim] + Offset[Dim];
+							}
+							if (ResolveBorderCoordinate(NeighborCoord, Size, InBorderMode))
+							{
+								Window.Add(Source[CoordinateToLinearIndex(NeighborCoord, Stride)]);
+							}
+						}
+					}
+					Out[i] = Window.Num() > 0 ? InReduce(Window) : Source[i];
+					AdvanceCoordinateInBox(Coord, BoxMin, Size, Order);
+				}
+			}, NumChunks <= 1);
+		}
+
+		SelfDynamicSizeType MedianFilter_Internal(const FFilterFootprint& InFootprint, EBorderMode InBorderMode) const
+		{
+			SelfDynamicSizeType Source = MakeFilterSource_Internal();
+			if (TotalSize == 0 || InFootprint.Offsets.Num() == 0)
+			{
+				return Source;
+			}
+			// Every element of the result is written, it doesn't need a copy of the source.
+			SelfDynamicSizeType Result;
+			Result.SetDimSize(Source.GetRuntimeEachDimSize(), Source.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToUninitializedValue);
+
+			if constexpr (std::is_integral_v<DataType> && !std::is_same_v<DataType, bool> && sizeof(DataType) <= 2)
+			{
+				MedianHistogram_Internal(Source, Result, InFootprint.Offsets, InBorderMode);
+			}
+			else
+			{
+				ReduceWindows_Internal(Source, Result, InFootprint.Offsets, InBorderMode, [](TArray<DataType>& InWindow)
+				{
+					DataType* Middle = InWindow.GetData() + InWindow.Num() / 2;
+					std::nth_element(InWindow.GetData(), Middle, InWindow.GetData() + InWindow.Num());
+					return *Middle;
+				});
+			}
+			return Result;
+		}
+
+		// The sliding histogram median of the 8 / 16 bit integer types, along the fastest storage dimension.
+		static void MedianHistogram_Internal(const SelfDynamicSizeType& InSource, SelfDynamicSizeType& OutResult,
+											 const TArray<CoordinateType>& InOffsets, EBorderMode InBorderMode)
+		{
+			using UnsignedType = std::make_unsigned_t<DataType>;
+			// The signed values are biased, so that the bin order is the value order.
+			constexpr uint32 SignBias = std::is_signed_v<DataType> ? (1u << (sizeof(DataType) * 8 - 1)) : 0u;
+			constexpr uint32 NumBins = 1u << (sizeof(DataType) * 8);
+			constexpr uint32 CoarseShift = sizeof(DataType) == 1 ? 4 : 8;
+
+			const ArrayDimType& Size = InSource.GetRuntimeEachDimSize();
+			const CoordinateType& Stride = InSource.GetRuntimeStride();
+			const CoordinateType Order = InSource.GetRuntimeStorageOrder();
+			const int SlideDim = Order[0];
+			const IndexType Length = Size[SlideDim];
+
+			// Moving the window from X to X + 1 removes the offsets whose predecessor along the slide isn't in the footprint,
+			// and adds (at X + 1) the offsets whose successor isn't in the footprint.
+			CoordinateType OffsetMin = InOffsets[0];
+			CoordinateType OffsetMax = InOffsets[0];
+			for (const CoordinateType& Offset : InOffsets)
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					OffsetMin[Dim] = FMath::Min(OffsetMin[Dim], Offset[Dim]);
+					OffsetMax[Dim] = FMath::Max(OffsetMax[Dim], Offset[Dim]);
+				}
+			}
+			auto OffsetKey = [&](const CoordinateType& InOffset)
+			{
+				int64 Key = 0;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Key = Key * (OffsetMax[Dim] - OffsetMin[Dim] + 3) + (InOffset[Dim] - OffsetMin[Dim] + 1);
+				}
+				return Key;
+			};
+			TSet<int64> OffsetKeys;
+			for (const CoordinateType& Offset : InOffsets)
+			{
+				OffsetKeys.Add(OffsetKey(Offset));
+			}
+			TArray<CoordinateType> LeavingOffsets, EnteringOffsets;
+			for (const CoordinateType& Offset : InOffsets)
+			{
+				CoordinateType Neighbor = Offset;
+				Neighbor[SlideDim] = Offset[SlideDim] - 1;
+				if (!OffsetKeys.Contains(OffsetKey(Neighbor)))
+				{
+					LeavingOffsets.Add(Offset);
+				}
+				Neighbor[SlideDim] = Offset[SlideDim] + 1;
+				if (!OffsetKeys.Contains(OffsetKey(Neighbor)))
+				{
+					EnteringOffsets.Add(Offset);
+				}
+			}
+
+			const DataType* Source = InSource.GetData();
+			DataType* Out = OutResult.GetData();
+			const CoordinateType BoxMin = GenCompileTimeArray(0);
+			CoordinateType LineMax = Size;
+			LineMax[SlideDim] = 1;
+			const IndexType NumLines = InSource.GetTotalSize() / Length;
+			const IndexType LinesPerChunk = FMath::Max<IndexType>(1, FILTER_CHUNK_SIZE / Length);
+			const int32 NumChunks = static_cast<int32>((NumLines + LinesPerChunk - 1) / LinesPerChunk);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				TArray<uint32> FineBins, CoarseBins;
+				FineBins.SetNumZeroed(NumBins);
+				CoarseBins.SetNumZeroed(NumBins >> CoarseShift);
+				IndexType Count = 0;
+				CoordinateType Coord;
+				auto Update = [&](const TArray<CoordinateType>& InUpdateOffsets, int32 InDelta)
+				{
+					for (const CoordinateType& Offset : InUpdateOffsets)
+					{
+						CoordinateType NeighborCoord;
+						for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+						{
+							NeighborCoord[Dim] = Coord[Dim] + Offset[Dim];
+						}
+						if (ResolveBorderCoordinate(NeighborCoord, Size, InBorderMode))
+						{
+							const uint32 Bin = static_cast<UnsignedType>(Source[CoordinateToLinearIndex(NeighborCoord, Stride)]) ^ SignBias;
+							FineBins[Bin] += InDelta;
+							CoarseBins[Bin >> CoarseShift] += InDelta;
+							Count += InDelta;
+						}
+					}
+				};
+
+				const IndexType LineBegin = Chunk * LinesPerChunk;
+				const IndexType LineEnd = FMath::Min<IndexType>(LineBegin + LinesPerChunk, NumLines);
+				CoordinateType LineCoord = BoxCounterToCoordinate(LineBegin, BoxMin, LineMax, Order);
+				for (IndexType Line = LineBegin; Line < LineEnd; ++Line)
+				{
+					Coord = LineCoord;
+					Update(InOffsets, 1);
+					for (IndexType X = 0; X < Length; ++X)
+					{
+						const IndexType Index = CoordinateToLinearIndex(Coord, Stride);
+						if (Count == 0)
+						{
+							Out[Index] = Source[Index];
+						}
+						else
+						{
+							// Walks the coarse bins to the one holding the rank, then its fine bins.
+							IndexType Rank = Count / 2;
+							uint32 Coarse = 0;
+							while (Rank >= CoarseBins[Coarse])
+							{
+								Rank -= CoarseBins[Coarse++];
+							}
+							uint32 Bin = Coarse << CoarseShift;
+							while (Rank >= FineBins[Bin])
+							{
+								Rank -= FineBins[Bin++];
+							}
+							Out[Index] = static_cast<DataType>(static_cast<UnsignedType>(Bin ^ SignBias));
+						}
+						if (X + 1 < Length)
+						{
+							Update(LeavingOffsets, -1);
+							++Coord[SlideDim];
+							Update(EnteringOffsets, 1);
+						}
+					}
+					// Empties the histogram for the next line.
+					Update(InOffsets, -1);
+					AdvanceCoordinateInBox(LineCoord, BoxMin, LineMax, Order);
+				}
+			}, NumChunks <= 1);
+		}
+#pragma endregion MorphologyFilters
+
+#pragma region Sorting
+
+	public:
+		// The positions along an axis (ArgSort(), TopKAlongAxis()), same layout as this array.
+		using IndexArrayType = TBasicArrayMultiDim<IndexType, IndexPolicy, (static_cast<void>(Dims), DYNAMIC_SIZE)...>;
+
+		// The sorts split the work into chunks of at least this many elements.
+		static constexpr int32 SORT_CHUNK_SIZE = 65536;
+
+		/**
+		 * @brief Sorts each line along the axis in place, like NumPy sort(axis).
+		 *
+		 * The lines are independent, so they are sorted in parallel. A line is gathered into a buffer, sorted, and
+		 * written back, which keeps the sort itself on contiguous memory whatever the stride of the axis is.
+		 */
+		template <typename PredicateType = TLess<DataType>>
+		void Sort(int InAxis, const PredicateType& InPredicate = PredicateType())
+		{
+			check(InAxis >= 0 && InAxis < DIM_SIZE);
+			if (TotalSize <= 0)
+			{
+				return;
+			}
+			NormalizeRingOrigin();
+			DataType* Data = GetMutableStorage().GetData();
+			MarkAllDirty_Internal();
+			const IndexType LineStride = RuntimeStride[InAxis];
+			ForEachAxisLine_Internal(InAxis, [&](IndexType InLineStart, TArray<DataType>& InOutLineBuffer, TArray<IndexType>& InOutPositionBuffer)
+			{
+				const IndexType LineLength = RuntimeEachDimSize[InAxis];
+				InOutLineBuffer.SetNumUninitialized(LineLength);
+				for (IndexType i = 0; i < LineLength; ++i)
+				{
+					InOutLineBuffer[i] = Data[InLineStart + i * LineStride];
+				}
+				std::sort(InOutLineBuffer.GetData(), InOutLineBuffer.GetData() + LineLength, InPredicate);
+				for (IndexType i = 0; i < LineLength; ++i)
+				{
+					Data[InLineStart + i * LineStride] = InOutLineBuffer[i];
+				}
+			});
+		}
+
+		/**
+		 * @brief The positions along the axis that sort each line, like NumPy argsort(axis, kind='stable').
+		 *
+		 * Result(..., i, ...) is the position (along the axis) of the i-th element of the sorted line, the equal
+		 * elements keep their order. The lines are sorted in parallel.
+		 */
+		template <typename PredicateType = TLess<DataType>>
+		IndexArrayType ArgSort(int InAxis, const PredicateType& InPredicate = PredicateType()) const
+		{
+			return ArgSortAlongAxis_Internal(InAxis, RuntimeEachDimSize[InAxis], InPredicate);
+		}
+
+		/**
+		 * @brief Sorts the whole array, returns the coordinates of the elements in the sorted order (stable).
+		 *
+		 * The storage order is cut into chunks that are sorted in parallel, then merged pairwise in parallel rounds.
+		 */
+		template <typename PredicateType = TLess<DataType>>
+		TArray<CoordinateType> ArgSortCoordinates(const PredicateType& InPredicate = PredicateType()) const
+		{
+			return IndicesToCoordinates_Internal(ArgSortIndices(InPredicate));
+		}
+
+		// Same as above, returns the linear indexes (for operator[] and GatherByIndex()).
+		template <typename PredicateType = TLess<DataType>>
+		TArray<IndexType, typename IndexPolicy::AllocatorType> ArgSortIndices(const PredicateType& InPredicate = PredicateType()) const
+		{
+			TArray<IndexType, typename IndexPolicy::AllocatorType> Indices;
+			Indices.SetNumUninitialized(TotalSize);
+			for (IndexType i = 0; i < TotalSize; ++i)
+			{
+				Indices[i] = i;
+			}
+			const DataType* Data = GetStorage().GetData();
+			ParallelStableSort_Internal(Indices, [Data, &InPredicate](IndexType InA, IndexType InB) { return InPredicate(Data[InA], Data[InB]); });
+			return Indices;
+		}
+
+		/**
+		 * @brief The coordinates of the K greatest elements (by default) of the whole array, the greatest first.
+		 *
+		 * Each chunk of the array keeps its K best elements in a heap on its own thread, then the heaps are merged, so
+		 * the cost is about N log K and nothing is allocated per element. The equal elements are ordered by linear index.
+		 */
+		template <typename PredicateType = TGreater<DataType>>
+		TArray<CoordinateType> TopK(int32 InK, const PredicateType& InPredicate = PredicateType()) const
+		{
+			return IndicesToCoordinates_Internal(TopKIndices(InK, InPredicate));
+		}
+
+		// Same as above, returns the linear indexes.
+		template <typename PredicateType = TGreater<DataType>>
+		TArray<IndexType, typename IndexPolicy::AllocatorType> TopKIndices(int32 InK, const PredicateType& InPredicate = PredicateType()) const
+		{
+			TArray<IndexType, typename IndexPolicy::AllocatorType> Result;
+			const IndexType K = FMath::Min<IndexType>(InK, TotalSize);
+			if (K <= 0)
+			{
+				return Result;
+			}
+			const DataType* Data = GetStorage().GetData();
+			// A strict order: by the predicate, then by linear index.
+			auto IsBetter = [Data, &InPredicate](IndexType InA, IndexType InB)
+			{
+				return InPredicate(Data[InA], Data[InB]) || (!InPredicate(Data[InB], Data[InA]) && InA < InB);
+			};
+
+			const IndexType ChunkSize = FMath::Max<IndexType>(SORT_CHUNK_SIZE, K * 16);
+			const int32 NumChunks = static_cast<int32>((TotalSize + ChunkSize - 1) / ChunkSize);
+			TArray<TArray<IndexType>> Heaps;
+			Heaps.SetNum(NumChunks);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				// A heap of the best K so far, the worst of them on top.
+				TArray<IndexType>& Heap = Heaps[Chunk];
+				Heap.Reserve(static_cast<int32>(K));
+				const IndexType End = FMath::Min<IndexType>((Chunk + 1) * ChunkSize, TotalSize);
+				for (IndexType i = Chunk * ChunkSize; i < End; ++i)
+				{
+					if (Heap.Num() < K)
+					{
+						Heap.Add(i);
+						std::push_heap(Heap.GetData(), Heap.GetData() + Heap.Num(), IsBetter);
+					}
+					else if (IsBetter(i, Heap[0]))
+					{
+						std::pop_heap(Heap.GetData(), Heap.GetData() + Heap.Num(), IsBetter);
+						Heap.Last() = i;
+						std::push_heap(Heap.GetData(), Heap.GetData() + Heap.Num(), IsBetter);
+					}
+				}
+			}, NumChunks <= 1);
+
+			for (const TArray<IndexType>& Heap : Heaps)
+			{
+				Result.Append(Heap);
+			}
+			std::partial_sort(Result.GetData(), Result.GetData() + K, Result.GetData() + Result.Num(), IsBetter);
+			Result.SetNum(K);
+			return Result;
+		}
+
+		/**
+		 * @brief The positions of the K greatest elements (by default) of each line along the axis, the greatest first.
+		 *
+		 * The result has the size of this array, except K along the axis (or the line length if it's shorter), like
+		 * the indices of torch.topk(K, axis). The lines are selected in parallel with a partial sort.
+		 */
+		template <typename PredicateType = TGreater<DataType>>
+		IndexArrayType TopKAlongAxis(int InAxis, int32 InK, const PredicateType& InPredicate = PredicateType()) const
+		{
+			return ArgSortAlongAxis_Internal(InAxis, FMath::Clamp<IndexType>(InK, 0, RuntimeEachDimSize[InAxis]), InPredicate);
+		}
+
+	protected:
+		/**
+		 * Calls InFunc(LineStart, LineBuffer, PositionBuffer) for each line along the axis, in parallel. LineStart is
+		 * the storage index of the first element without the ring origin; the buffers are reused by the lines of a chunk.
+		 */
+		template <typename FuncType>
+		void ForEachAxisLine_Internal(int InAxis, const FuncType& InFunc) const
+		{
+			const IndexType LineLength = RuntimeEachDimSize[InAxis];
+			if (LineLength <= 0)
+			{
+				return;
+			}
+			const IndexType NumLines = TotalSize / LineLength;
+			const IndexType LinesPerChunk = FMath::Max<IndexType>(1, SORT_CHUNK_SIZE / LineLength);
+			const int32 NumChunks = static_cast<int32>((NumLines + LinesPerChunk - 1) / LinesPerChunk);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				TArray<DataType> LineBuffer;
+				TArray<IndexType> PositionBuffer;
+				const IndexType LineEnd = FMath::Min<IndexType>((Chunk + 1) * LinesPerChunk, NumLines);
+				for (IndexType LineIndex = Chunk * LinesPerChunk; LineIndex < LineEnd; ++LineIndex)
+				{
+					InFunc(GetLineStartIndex(InAxis, LineIndex), LineBuffer, PositionBuffer);
+				}
+			}, NumChunks <= 1);
+		}
+
+		// The first [InNumKept] positions of the stably sorted lines along the axis.
+		template <typename PredicateType>
+		IndexArrayType ArgSortAlongAxis_Internal(int InAxis, IndexType InNumKept, const PredicateType& InPredicate) const
+		{
+			check(InAxis >= 0 && InAxis < DIM_SIZE);
+			ArrayDimType ResultSize = RuntimeEachDimSize;
+			ResultSize[InAxis] = InNumKept;
+			IndexArrayType Result;
+			Result.SetDimSize(ResultSize, RuntimeStorageOrder, EResizeDataCopyPolicy::SetToUninitializedValue);
+			if (TotalSize <= 0 || InNumKept <= 0)
+			{
+				return Result;
+			}
+
+			// The lines are read in the plain layout, from a normalized copy if there is a ring origin.
+			SelfType Plain;
+			const SelfType* Source = this;
+			if (bHasRingOrigin)
+			{
+				Plain = *this;
+				Plain.NormalizeRingOrigin();
+				Source = &Plain;
+			}
+			const DataType* Data = Source->GetData();
+			IndexType* Out = Result.GetData();
+			const IndexType LineLength = RuntimeEachDimSize[InAxis];
+			const IndexType LineStride = RuntimeStride[InAxis];
+			const IndexType ResultStride = Result.GetRuntimeStride()[InAxis];
+			ForEachAxisLine_Internal(InAxis, [&](IndexType InLineStart, TArray<DataType>& InOutLineBuffer, TArray<IndexType>& InOutPositionBuffer)
+			{
+				InOutLineBuffer.SetNumUninitialized(LineLength);
+				InOutPositionBuffer.SetNumUninitialized(LineLength);
+				for (IndexType i = 0; i < LineLength; ++i)
+				{
+					InOutLineBuffer[i] = Data[InLineStart + i * LineStride];
+					InOutPositionBuffer[i] = i;
+				}
+				const DataType* Line = InOutLineBuffer.GetData();
+				IndexType* Positions = InOutPositionBuffer.GetData();
+				auto IsBetter = [Line, &InPredicate](IndexType InA, IndexType InB)
+				{
+					return InPredicate(Line[InA], Line[InB]) || (!InPredicate(Line[InB], Line[InA]) && InA < InB);
+				};
+				if (InNumKept < LineLength)
+				{
+					std::partial_sort(Positions, Positions + InNumKept, Positions + LineLength, IsBetter);
+				}
+				else
+				{
+					std::sort(Positions, Positions + LineLength, IsBetter);
+				}
+
+				// The line start in the result: the same coordinate, with the strides of the result.
+				const CoordinateType LineCoord = IndexToCoordinate(InLineStart, RuntimeStride, RuntimeStorageOrder);
+				IndexType* OutLine = Out + CoordinateToLinearIndex(LineCoord, Result.GetRuntimeStride());
+				for (IndexType i = 0; i < InNumKept; ++i)
+				{
+					OutLine[i * ResultStride] = Positions[i];
+				}
+			});
+			return Result;
+		}
+
+		/**
+		 * A stable sort of the items on the worker threads: the chunks are sorted in parallel, then the sorted runs are
+		 * merged pairwise, each round merging all its pairs in parallel into the other buffer.
+		 */
+		template <typename ItemType, typename AllocatorType, typename LessType>
+		static void ParallelStableSort_Internal(TArray<ItemType, AllocatorType>& InOutItems, const LessType& InLess)
+		{
+			const IndexType Num = InOutItems.Num();
+			const int32 NumChunks = static_cast<int32>(FMath::Clamp<IndexType>(Num / SORT_CHUNK_SIZE, 1, 64));
+			if (NumChunks <= 1)
+			{
+				std::stable_sort(InOutItems.GetData(), InOutItems.GetData() + Num, InLess);
+				return;
+			}
+
+			TArray<IndexType> RunStarts;
+			for (int32 Chunk = 0; Chunk <= NumChunks; ++Chunk)
+			{
+				RunStarts.Add(Num * Chunk / NumChunks);
+			}
+			ItemType* Items = InOutItems.GetData();
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				std::stable_sort(Items + RunStarts[Chunk], Items + RunStarts[Chunk + 1], InLess);
+			});
+
+			TArray<ItemType, AllocatorType> Buffer;
+			Buffer.SetNumUninitialized(Num);
+			ItemType* From = Items;
+			ItemType* To = Buffer.GetData();
+			while (RunStarts.Num() > 2)
+			{
+				const int32 NumRuns = RunStarts.Num() - 1;
+				ParallelFor((NumRuns + 1) / 2, [&](int32 Pair)
+				{
+					const IndexType Begin = RunStarts[Pair * 2];
+					const IndexType Middle = RunStarts[FMath::Min(Pair * 2 + 1, NumRuns)];
+					const IndexType End = RunStarts[FMath::Min(Pair * 2 + 2, NumRuns)];
+					std::merge(From + Begin, From + Middle, From + Middle, From + End, To + Begin, InLess);
+				});
+				TArray<IndexType> MergedStarts;
+				for (int32 Run = 0; Run < NumRuns; Run += 2)
+				{
+					MergedStarts.Add(RunStarts[Run]);
+				}
+				MergedStarts.Add(Num);
+				RunStarts = MoveTemp(MergedStarts);
+				Swap(From, To);
+			}
+			if (From != Items)
+			{
+				for (IndexType i = 0; i < Num; ++i)
+				{
+					Items[i] = MoveTemp(From[i]);
+				}
+			}
+		}
+
+		TArray<CoordinateType> IndicesToCoordinates_Internal(const TArray<IndexType, typename IndexPolicy::AllocatorType>& InIndices) const
+		{
+			TArray<CoordinateType> Coordinates;
+			Coordinates.SetNumUninitialized(static_cast<int32>(InIndices.Num()));
+			for (int32 i = 0; i < Coordinates.Num(); ++i)
+			{
+				Coordinates[i] = IndexToCoordinate(InIndices[i]);
+			}
+			return Coordinates;
+		}
+#pragma endregion Sorting
+
+#pragma region Histogram
+
+	public:
+		/**
+		 * A box of elements addressed without copying: the element at a (region) coordinate is
+		 * Data[AxisOffsets[0][Coord[0]] + ... + AxisOffsets[N - 1][Coord[N - 1]]]. The per-axis tables describe a whole
+		 * array, a slice of it (the ring origin included) or a strided view alike.
+		 */
+		struct FStridedRegion
+		{
+			const DataType* Data = nullptr;
+			std::array<TArray<int64>, DIM_SIZE> AxisOffsets;
+		};
+
+		// The histograms split the work into at most this many chunks, each one counts into its own bins.
+		static constexpr int32 HISTOGRAM_MAX_CHUNKS = 64;
+		// The budget of the private bin counters of all the chunks (8 MB), the chunks and the bin sets are cut to fit.
+		static constexpr int64 HISTOGRAM_MAX_BIN_COUNTERS = 1 << 20;
+
+		/**
+		 * @brief Counts the elements in [InNumBins] equal-width bins over [InMin, InMax], like numpy.histogram(bins, range).
+		 *
+		 * The last bin includes InMax, the elements outside the range aren't counted. The chunks of the array are
+		 * counted in parallel into private bins, which are summed at the end. For the integer types with one value per
+		 * bin (InMax - InMin == InNumBins, e.g. class IDs) the bin is the value itself minus InMin (InMax falls in the last
+		 * bin), counted into 4 interleaved bin sets so that the repeated values don't serialize on one counter.
+		 */
+		TArray<int64> Histogram(int32 InNumBins, DataType InMin, DataType InMax) const
+		{
+			return HistogramRegion(MakeStridedRegion(), InNumBins, InMin, InMax);
+		}
+
+		// Same as above, over a slice (same as Slice()), without materializing it.
+		TArray<int64> Histogram(int32 InNumBins, DataType InMin, DataType InMax, std::initializer_list<FSlice> InSlices) const
+		{
+			return HistogramRegion(MakeStridedRegion(InSlices), InNumBins, InMin, InMax);
+		}
+
+		/**
+		 * @brief Counts the elements in the bins [InBinEdges[i], InBinEdges[i + 1]), like numpy.histogram(bins=edges).
+		 * The edges are sorted, the last bin includes its right edge.
+		 */
+		TArray<int64> Histogram(TConstArrayView<DataType> InBinEdges) const
+		{
+			return HistogramRegion(MakeStridedRegion(), InBinEdges);
+		}
+
+		TArray<int64> Histogram(TConstArrayView<DataType> InBinEdges, std::initializer_list<FSlice> InSlices) const
+		{
+			return HistogramRegion(MakeStridedRegion(InSlices), InBinEdges);
+		}
+
+		/**
+		 * @brief The distinct values and their counts, sorted by value, like numpy.unique(return_counts=True).
+		 *
+		 * The 8 / 16 bit integer types count into the bins of their whole domain, the other types into a map per chunk.
+		 */
+		TArray<TPair<DataType, int64>> CountUnique() const
+		{
+			return CountUniqueRegion(MakeStridedRegion());
+		}
+
+		TArray<TPair<DataType, int64>> CountUnique(std::initializer_list<FSlice> InSlices) const
+		{
+			return CountUniqueRegion(MakeStridedRegion(InSlices));
+		}
+
+		// The whole array, or a slice of it, as a region.
+		FStridedRegion MakeStridedRegion(std::initializer_list<FSlice> InSlices = {}) const
+		{
+			check(InSlices.size() == 0 || static_cast<int>(InSlices.size()) == DIM_SIZE);
+			FStridedRegion Region;
+			const IndexType OriginIndex = CoordinateToLinearIndex(GenCompileTimeArray(0));
+			Region.Data = GetStorage().GetData() + OriginIndex;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				IndexType Start = 0;
+				IndexType End = RuntimeEachDimSize[Dim];
+				if (InSlices.size() > 0)
+				{
+					const FSlice& SliceObj = *(InSlices.begin() + Dim);
+					if (SliceObj.IsSingle())
+					{
+						Start = SliceObj.GetSingle();
+						End = Start + 1;
+					}
+					else if (SliceObj.IsRanged())
+					{
+						Start = SliceObj.GetRangeStart();
+						End = SliceObj.GetRangeEnd();
+					}
+				}
+				check(Start >= 0 && Start <= End && End <= RuntimeEachDimSize[Dim]);
+				// The ring origin wraps each axis on its own, so the offset of an axis doesn't depend on the others.
+				CoordinateType Coord = GenCompileTimeArray(0);
+				for (IndexType i = Start; i < End; ++i)
+				{
+					Coord[Dim] = i;
+					Region.AxisOffsets[Dim].Add(static_cast<int64>(CoordinateToLinearIndex(Coord)) - OriginIndex);
+				}
+			}
+			return Region;
+		}
+
+		static TArray<int64> HistogramRegion(const FStridedRegion& InRegion, int32 InNumBins, DataType InMin, DataType InMax)
+		{
+			check(InNumBins > 0 && !(InMax < InMin));
+			if constexpr (std::is_integral_v<DataType>)
+			{
+				if (static_cast<int64>(InMax) - static_cast<int64>(InMin) == InNumBins)
+				{
+					const int64 Min = InMin;
+					return CountBins_Internal(InRegion, InNumBins, [Min, InNumBins](const DataType& InValue)
+					{
+						// The last bin includes InMax, the other values out of the range stay out of [0, InNumBins).
+						const int64 Bin = static_cast<int64>(InValue) - Min;
+						return Bin == InNumBins ? Bin - 1 : Bin;
+					});
+				}
+			}
+			const double Min = static_cast<double>(InMin);
+			const double Scale = InMax > InMin ? InNumBins / (static_cast<double>(InMax) - Min) : 0.;
+			return CountBins_Internal(InRegion, InNumBins, [Min, Scale, InMin, InMax, InNumBins](const DataType& InValue) -> int64
+			{
+				if (InValue < InMin || InMax < InValue)
+				{
+					return INDEX_NONE;
+				}
+				return FMath::Min<int64>(static_cast<int64>((static_cast<double>(InValue) - Min) * Scale), InNumBins - 1);
+			});
+		}
+
+		static TArray<int64> HistogramRegion(const FStridedRegion& InRegion, TConstArrayView<DataType> InBinEdges)
+		{
+			check(InBinEdges.Num() >= 2);
+			const int32 NumBins = InBinEdges.Num() - 1;
+			return CountBins_Internal(InRegion, NumBins, [InBinEdges, NumBins](const DataType& InValue) -> int64
+			{
+				if (InValue < InBinEdges[0] || InBinEdges[NumBins] < InValue)
+				{
+					return INDEX_NONE;
+				}
+				const int64 Bin = std::upper_bound(InBinEdges.GetData(), InBinEdges.GetData() + NumBins + 1, InValue) - InBinEdges.GetData() - 1;
+				return FMath::Min<int64>(Bin, NumBins - 1);
+			});
+		}
+
+		static TArray<TPair<DataType, int64>> CountUniqueRegion(const FStridedRegion& InRegion)
+		{
+			TArray<TPair<DataType, int64>> Result;
+			if constexpr (std::is_integral_v<DataType> && !std::is_same_v<DataType, bool> && sizeof(DataType) <= 2)
+			{
+				using UnsignedType = std::make_unsigned_t<DataType>;
+				// The signed values are biased, so that the bin order is the value order.
+				constexpr uint32 SignBias = std::is_signed_v<DataType> ? (1u << (sizeof(DataType) * 8 - 1)) : 0u;
+				constexpr int32 NumBins = 1 << (sizeof(DataType) * 8);
+				const TArray<int64> Counts = CountBins_Internal(InRegion, NumBins, [](const DataType& InValue)
+				{
+					return static_cast<int64>(static_cast<UnsignedType>(InValue) ^ SignBias);
+				});
+				for (int32 Bin = 0; Bin < NumBins; ++Bin)
+				{
+					if (Counts[Bin] > 0)
+					{
+						Result.Add(TPair<DataType, int64>(static_cast<DataType>(static_cast<UnsignedType>(Bin ^ SignBias)), Counts[Bin]));
+					}
+				}
+			}
+			else
+			{
+				const int32 NumChunks = GetRegionNumChunks_Internal(InRegion);
+				TArray<TMap<DataType, int64>> ChunkCounts;
+				ChunkCounts.SetNum(NumChunks);
+				ForEachRegionRow_Internal(InRegion, NumChunks, [&](int32 InChunk, const DataType* InRow, const int64* InInnerOffsets, int64 InInnerLength)
+				{
+					TMap<DataType, int64>& Counts = ChunkCounts[InChunk];
+					for (int64 i = 0; i < InInnerLength; ++i)
+					{
+						++Counts.FindOrAdd(InInnerOffsets ? InRow[InInnerOffsets[i]] : InRow[i]);
+					}
+				});
+				TArray<DataType> Keys;
+				for (int32 Chunk = 1; Chunk < NumChunks; ++Chunk)
+				{
+					Keys.Reset();
+					ChunkCounts[Chunk].GenerateKeyArray(Keys);
+					for (const DataType& Key : Keys)
+					{
+						ChunkCounts[0].FindOrAdd(Key) += ChunkCounts[Chunk][Key];
+					}
+				}
+				Keys.Reset();
+				ChunkCounts[0].GenerateKeyArray(Keys);
+				Result.Reserve(Keys.Num());
+				for (const DataType& Key : Keys)
+				{
+					Result.Add(TPair<DataType, int64>(Key, ChunkCounts[0][Key]));
+				}
+				Result.Sort([](const TPair<DataType, int64>& A, const TPair<DataType, int64>& B) { return A.Key < B.Key; });
+			}
+			return Result;
+		}
+
+	protected:
+		// Counts the elements into [InNumBins] bins by InGetBin(Value), which is out of [0, InNumBins) for the skipped ones.
+		template <typename GetBinFuncType>
+		static TArray<int64> CountBins_Internal(const FStridedRegion& InRegion, int32 InNumBins, const GetBinFuncType& InGetBin)
+		{
+			// Each chunk owns 4 interleaved bin sets: the consecutive elements count into different sets, so a run of
+			// equal values isn't a chain of increments on one counter. With many bins (e.g. CountUnique() of int16) the
+			// counters are rarely adjacent anyway, a single set is used and the chunks are cut to the counter budget.
+			constexpr int32 NUM_LANES = 4;
+			const int32 NumLanes = static_cast<int64>(InNumBins) * NUM_LANES <= HISTOGRAM_MAX_BIN_COUNTERS / HISTOGRAM_MAX_CHUNKS ? NUM_LANES : 1;
+			const int32 LaneMask = NumLanes - 1;
+			const int32 NumChunks = static_cast<int32>(FMath::Clamp<int64>(HISTOGRAM_MAX_BIN_COUNTERS / (static_cast<int64>(InNumBins) * NumLanes),
+																		   1, GetRegionNumChunks_Internal(InRegion)));
+			TArray<TArray<int64>> ChunkBins;
+			ChunkBins.SetNum(NumChunks);
+			ForEachRegionRow_Internal(InRegion, NumChunks, [&](int32 InChunk, const DataType* InRow, const int64* InInnerOffsets, int64 InInnerLength)
+			{
+				TArray<int64>& Bins = ChunkBins[InChunk];
+				if (Bins.Num() == 0)
+				{
+					Bins.SetNumZeroed(InNumBins * NumLanes);
+				}
+				int64* LaneBins = Bins.GetData();
+				auto CountValue = [&](const DataType& InValue, int32 InLane)
+				{
+					const int64 Bin = InGetBin(InValue);
+					if (static_cast<uint64>(Bin) < static_cast<uint64>(InNumBins))
+					{
+						++LaneBins[Bin * NumLanes + (InLane & LaneMask)];
+					}
+				};
+				int64 i = 0;
+				if (!InInnerOffsets)
+				{
+					for (; i + NUM_LANES <= InInnerLength; i += NUM_LANES)
+					{
+						CountValue(InRow[i], 0);
+						CountValue(InRow[i + 1], 1);
+						CountValue(InRow[i + 2], 2);
+						CountValue(InRow[i + 3], 3);
+					}
+				}
+				for (; i < InInnerLength; ++i)
+				{
+					CountValue(InInnerOffsets ? InRow[InInnerOffsets[i]] : InRow[i], static_cast<int32>(i % NUM_LANES));
+				}
+			});
+
+			TArray<int64> Result;
+			Result.SetNumZeroed(InNumBins);
+			ParallelFor(InNumBins, [&](int32 Bin)
+			{
+				for (const TArray<int64>& Bins : ChunkBins)
+				{
+					for (int32 Lane = 0; Lane < NumLanes && Bins.Num() > 0; ++Lane)
+					{
+						Result[Bin] += Bins[Bin * NumLanes + Lane];
+					}
+				}
+			}, InNumBins * NumChunks < SORT_CHUNK_SIZE);
+			return Result;
+		}
+
+		// The chunk count of a region: about SORT_CHUNK_SIZE elements per chunk, up to HISTOGRAM_MAX_CHUNKS.
+		static int32 GetRegionNumChunks_Internal(const FStridedRegion& InRegion)
+		{
+			int64 NumElements = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				NumElements *= InRegion.AxisOffsets[Dim].Num();
+			}
+			return static_cast<int32>(FMath::Clamp<int64>(NumElements / SORT_CHUNK_SIZE, 1, HISTOGRAM_MAX_CHUNKS));
+		}
+
+		/**
+		 * Calls InFunc(Chunk, Row, InnerOffsets, InnerLength) for each row of the region, the rows split into [InNumChunks]
+		 * parallel chunks. A row runs along the contiguous axis if there is one (then InnerOffsets is null and the row
+		 * is InRow[0, InnerLength)), else along the last axis (then the elements are InRow[InnerOffsets[i]]).
+		 */
+		template <typename FuncType>
+		static void ForEachRegionRow_Internal(const FStridedRegion& InRegion, int32 InNumChunks, const FuncType& InFunc)
+		{
+			int InnerAxis = DIM_SIZE - 1;
+			bool bContiguous = false;
+			for (int Dim = 0; Dim < DIM_SIZE && !bContiguous; ++Dim)
+			{
+				const TArray<int64>& Offsets = InRegion.AxisOffsets[Dim];
+				bool bUnitStride = Offsets.Num() > 1;
+				for (int32 i = 1; i < Offsets.Num() && bUnitStride; ++i)
+				{
+					bUnitStride = Offsets[i] == Offsets[i - 1] + 1;
+				}
+				if (bUnitStride)
+				{
+					InnerAxis = Dim;
+					bContiguous = true;
+				}
+			}
+			const TArray<int64>& InnerOffsets = InRegion.AxisOffsets[InnerAxis];
+			const int64 InnerLength = InnerOffsets.Num();
+			int64 NumRows = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				NumRows *= Dim == InnerAxis ? 1 : InRegion.AxisOffsets[Dim].Num();
+			}
+			if (NumRows * InnerLength == 0)
+			{
+				return;
+			}
+
+			ParallelFor(InNumChunks, [&](int32 Chunk)
+			{
+				const int64 RowBegin = NumRows * Chunk / InNumChunks;
+				const int64 RowEnd = NumRows * (Chunk + 1) / InNumChunks;
+				// The coordinate of the row over the outer axes, the last outer axis fastest.
+				std::array<int64, DIM_SIZE> RowCoord{};
+				for (int64 Rest = RowBegin, Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+				{
+					if (Dim != InnerAxis)
+					{
+						RowCoord[Dim] = Rest % InRegion.AxisOffsets[Dim].Num();
+						Rest /= InRegion.AxisOffsets[Dim].Num();
+					}
+				}
+				for (int64 Row = RowBegin; Row < RowEnd; ++Row)
+				{
+					int64 RowOffset = InnerOffsets[0];
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						RowOffset += Dim == InnerAxis ? 0 : InRegion.AxisOffsets[Dim][RowCoord[Dim]];
+					}
+					InFunc(Chunk, InRegion.Data + RowOffset - (bContiguous ? 0 : InnerOffsets[0]), bContiguous ? nullptr : InnerOffsets.GetData(), InnerLength);
+					for (int Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+					{
+						if (Dim != InnerAxis)
+						{
+							if (++RowCoord[Dim] < InRegion.AxisOffsets[Dim].Num())
+							{
+								break;
+							}
+							RowCoord[Dim] = 0;
+						}
+					}
+				}
+			}, InNumChunks <= 1);
+		}
+#pragma endregion Histogram
+
+#pragma region WhereSelect
+
+	public:
+		// The per-element boolean condition of Select() / SetWhere(), e.g. made by MakeCondition().
+		using ConditionArrayType = TBasicArrayMultiDim<bool, IndexPolicy, Dims...>;
+
+		// The stream compaction splits the array into chunks of this many elements (a multiple of 64, see Where()).
+		static constexpr int32 COMPACTION_CHUNK_SIZE = 65536;
+
+		/**
+		 * @brief The linear indexes of the elements for which InPredicate(Value) is true, in the storage order, like
+		 * numpy.flatnonzero(). The result feeds GatherByIndex() / ScatterByIndex() directly.
+		 *
+		 * A parallel stream compaction: each chunk evaluates the predicate once into a bitmask and counts its matches,
+		 * a prefix sum of the counts gives the output offset of each chunk, then the chunks write their indexes from the
+		 * bitmask in parallel. The elements are read once, so the filtering stays bound by the memory bandwidth.
+		 * The result uses the allocator of the index policy, like ArgSortIndices(), so it holds more than 2^31 indexes
+		 * of a TArrayMultiDim64.
+		 *
+		 * \code
+		 *		TArray<int32> HotCells = Temperature.Where([](float InValue) { return InValue > 350.f; });
+		 * \endcode
+		 */
+		template <typename PredicateType>
+		TArray<IndexType, typename IndexPolicy::AllocatorType> Where(const PredicateType& InPredicate) const
+		{
+			TArray<IndexType, typename IndexPolicy::AllocatorType> Result;
+			const DataType* Data = GetStorage().GetData();
+			Compact_Internal([Data, &InPredicate](IndexType InIndex) { return static_cast<bool>(InPredicate(Data[InIndex])); },
+							 [&Result](IndexType InCount) { Result.SetNumUninitialized(InCount); },
+							 [&Result](IndexType InOutputIndex, IndexType InIndex) { Result.GetData()[InOutputIndex] = InIndex; });
+			return Result;
+		}
+
+		// Same as Where(), returns the coordinates (the ring origin is applied), still in the storage order.
+		template <typename PredicateType>
+		TArray<CoordinateType> WhereCoordinates(const PredicateType& InPredicate) const
+		{
+			TArray<CoordinateType> Result;
+			const DataType* Data = GetStorage().GetData();
+			Compact_Internal([Data, &InPredicate](IndexType InIndex) { return static_cast<bool>(InPredicate(Data[InIndex])); },
+							 [&Result](IndexType InCount) { Result.SetNumUninitialized(InCount); },
+							 [this, &Result](IndexType InOutputIndex, IndexType InIndex) { Result.GetData()[InOutputIndex] = IndexToCoordinate(InIndex); });
+			return Result;
+		}
+
+		// Evaluates InPredicate(Value) for each element, into a condition of the same shape and storage order.
+		template <typename PredicateType>
+		ConditionArrayType MakeCondition(const PredicateType& InPredicate) const
+		{
+			ConditionArrayType Result;
+			Result.SetDimSize(RuntimeEachDimSize, RuntimeStorageOrder, EResizeDataCopyPolicy::SetToUninitializedValue);
+			bool* Out = Result.GetData();
+			ForEachElementPair_Internal(Result, [&](IndexType InResultIndex, IndexType InIndex)
+			{
+				Out[InResultIndex] = static_cast<bool>(InPredicate(GetStorage()[InIndex]));
+			});
+			return Result;
+		}
+
+		/**
+		 * @brief Picks the element of InA where InCondition is true, of InB elsewhere, like numpy.where(Cond, A, B).
+		 *
+		 * The three arrays have the same size, the result has the storage order of InA. The arrays in the same layout
+		 * (same storage order, no ring origin) are read linearly, the others by coordinate.
+		 */
+		static SelfDynamicSizeType Select(const ConditionArrayType& InCondition, const TBasicArrayMultiDim& InA, const TBasicArrayMultiDim& InB)
+		{
+			check(InA.GetRuntimeEachDimSize() == InB.GetRuntimeEachDimSize());
+			const DataType* BData = InB.GetData();
+			return Select_Internal(InCondition, InA, [&InB, BData](IndexType InIndex, const CoordinateType& InCoordinate)
+			{
+				return BData[InIndex == INVALID_INDEX ? InB.GetLinearIndex(InCoordinate) : InIndex];
+			}, &InB);
+		}
+
+		// Same as above with a constant for the false elements, e.g. Select(Valid, Depth, 0.f).
+		static SelfDynamicSizeType Select(const ConditionArrayType& InCondition, const TBasicArrayMultiDim& InA, const DataType& InB)
+		{
+			return Select_Internal(InCondition, InA, [&InB](IndexType InIndex, const CoordinateType& InCoordinate) -> const DataType&
+			{
+				return InB;
+			}, nullptr);
+		}
+
+		/**
+		 * @brief Sets InValue to the elements where InMask is true (same size as this array). The chunks are written in
+		 * parallel, the dirty blocks of the written elements are marked.
+		 */
+		void SetWhere(const ConditionArrayType& InMask, const DataType& InValue)
+		{
+			check(InMask.GetRuntimeEachDimSize() == RuntimeEachDimSize);
+			const bool* MaskData = InMask.GetData();
+			const bool bSameLayout = IsSameLayout_Internal(InMask);
+			SetWhere_Internal([&, MaskData, bSameLayout](IndexType InIndex, const DataType& InOldValue)
+			{
+				return MaskData[bSameLayout ? InIndex : InMask.GetLinearIndex(IndexToCoordinate(InIndex))];
+			}, InValue);
+		}
+
+		// Sets InValue to the elements for which InPredicate(Value) is true, e.g. SetWhere([](float V) { return V < 0.f; }, 0.f).
+		template <typename PredicateType>
+		void SetWhere(const PredicateType& InPredicate, const DataType& InValue)
+		{
+			SetWhere_Internal([&InPredicate](IndexType InIndex, const DataType& InOldValue)
+			{
+				return static_cast<bool>(InPredicate(InOldValue));
+			}, InValue);
+		}
+
+	protected:
+		// Whether the storage index of a coordinate is the same in both arrays (same size, strides and no ring origin).
+		template <typename OtherArrayType>
+		bool IsSameLayout_Internal(const OtherArrayType& InOther) const
+		{
+			return !bHasRingOrigin && !InOther.HasRingOrigin() && InOther.GetRuntimeEachDimSize() == RuntimeEachDimSize
+				&& InOther.GetRuntimeStride() == RuntimeStride;
+		}
+
+		// Calls InFunc(Begin, End) for each chunk of [0, InNum) in parallel, the chunks are COMPACTION_CHUNK_SIZE elements.
+		template <typename FuncType>
+		static void ParallelForChunks_Internal(IndexType InNum, const FuncType& InFunc)
+		{
+			const int32 NumChunks = static_cast<int32>((InNum + COMPACTION_CHUNK_SIZE - 1) / COMPACTION_CHUNK_SIZE);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				const IndexType Begin = static_cast<IndexType>(Chunk) * COMPACTION_CHUNK_SIZE;
+				InFunc(Begin, FMath::Min<IndexType>(Begin + COMPACTION_CHUNK_SIZE, InNum));
+			}, NumChunks <= 1);
+		}
+
+		/**
+		 * The stream compaction of the storage indexes [0, TotalSize) by InTest(Index): InResize(Count) once the total
+		 * is known, then InWrite(OutputIndex, Index) for each match, from several threads.
+		 */
+		template <typename TestFuncType, typename ResizeFuncType, typename WriteFuncType>
+		void Compact_Internal(const TestFuncType& InTest, const ResizeFuncType& InResize, const WriteFuncType& InWrite) const
+		{
+			static_assert(COMPACTION_CHUNK_SIZE % 64 == 0, "A chunk owns whole words of the bitmask.");
+			const int32 NumChunks = static_cast<int32>((TotalSize + COMPACTION_CHUNK_SIZE - 1) / COMPACTION_CHUNK_SIZE);
+			TArray<uint64> Bits;
+			Bits.SetNumUninitialized(static_cast<int32>((TotalSize + 63) / 64));
+			TArray<IndexType> ChunkOffsets;
+			ChunkOffsets.SetNumZeroed(NumChunks + 1);
+			ParallelForChunks_Internal(TotalSize, [&](IndexType InBegin, IndexType InEnd)
+			{
+				IndexType Count = 0;
+				for (IndexType WordBegin = InBegin; WordBegin < InEnd; WordBegin += 64)
+				{
+					const IndexType WordEnd = FMath::Min<IndexType>(WordBegin + 64, InEnd);
+					uint64 Word = 0;
+					for (IndexType i = WordBegin; i < WordEnd; ++i)
+					{
+						Word |= static_cast<uint64>(InTest(i)) << (i - WordBegin);
+					}
+					Bits[static_cast<int32>(WordBegin / 64)] = Word;
+					Count += FMath::CountBits(Word);
+				}
+				ChunkOffsets[static_cast<int32>(InBegin / COMPACTION_CHUNK_SIZE) + 1] = Count;
+			});
+			for (int32 Chunk = 0; Chunk < NumChunks; ++Chunk)
+			{
+				ChunkOffsets[Chunk + 1] += ChunkOffsets[Chunk];
+			}
+			InResize(ChunkOffsets[NumChunks]);
+
+			ParallelForChunks_Internal(TotalSize, [&](IndexType InBegin, IndexType InEnd)
+			{
+				IndexType OutputIndex = ChunkOffsets[static_cast<int32>(InBegin / COMPACTION_CHUNK_SIZE)];
+				for (IndexType WordBegin = InBegin; WordBegin < InEnd; WordBegin += 64)
+				{
+					uint64 Word = Bits[static_cast<int32>(WordBegin / 64)];
+					while (Word != 0)
+					{
+						InWrite(OutputIndex++, WordBegin + static_cast<IndexType>(FMath::CountTrailingZeros64(Word)));
+						Word &= Word - 1;
+					}
+				}
+			});
+		}
+
+		/**
+		 * Calls InFunc(OtherIndex, Index) for each element, in parallel: Index is the storage index of an element of this
+		 * array, OtherIndex the storage index of the same coordinate in InOther (same size).
+		 */
+		template <typename OtherArrayType, typename FuncType>
+		void ForEachElementPair_Internal(const OtherArrayType& InOther, const FuncType& InFunc) const
+		{
+			check(InOther.GetRuntimeEachDimSize() == RuntimeEachDimSize);
+			const bool bSameLayout = IsSameLayout_Internal(InOther);
+			ParallelForChunks_Internal(TotalSize, [&](IndexType InBegin, IndexType InEnd)
+			{
+				for (IndexType i = InBegin; i < InEnd; ++i)
+				{
+					InFunc(bSameLayout ? i : InOther.GetLinearIndex(IndexToCoordinate(i)), i);
+				}
+			});
+		}
+
+		// Select() into the layout of InA. InGetB(Index, Coordinate) reads B by its storage index, or by coordinate when
+		// the index is INVALID_INDEX (InB isn't in the layout of InA).
+		template <typename GetBFuncType>
+		static SelfDynamicSizeType Select_Internal(const ConditionArrayType& InCondition, const TBasicArrayMultiDim& InA,
+												   const GetBFuncType& InGetB, const TBasicArrayMultiDim* InB)
+		{
+			const ArrayDimType& Size = InA.GetRuntimeEachDimSize();
+			check(InCondition.GetRuntimeEachDimSize() == Size);
+			SelfDynamicSizeType Result;
+			Result.SetDimSize(Size, InA.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToUninitializedValue);
+			const CoordinateType& Stride = Result.GetRuntimeStride();
+			const CoordinateType Order = Result.GetRuntimeStorageOrder();
+			auto IsPlain = [&](const auto& InArray)
+			{
+				return !InArray.HasRingOrigin() && InArray.GetRuntimeStride() == Stride;
+			};
+			const bool bPlainCondition = IsPlain(InCondition);
+			const bool bPlainA = IsPlain(InA);
+			const bool bPlainB = !InB || IsPlain(*InB);
+			const bool* CondData = InCondition.GetData();
+			const DataType* AData = InA.GetData();
+			DataType* Out = Result.GetData();
+			ParallelForChunks_Internal(Result.GetTotalSize(), [&](IndexType InBegin, IndexType InEnd)
+			{
+				if (bPlainCondition && bPlainA && bPlainB)
+				{
+					for (IndexType i = InBegin; i < InEnd; ++i)
+					{
+						Out[i] = CondData[i] ? AData[i] : InGetB(i, CoordinateType());
+					}
+					return;
+				}
+				CoordinateType Coord = IndexToCoordinate(InBegin, Stride, Order);
+				const CoordinateType Zero = GenCompileTimeArray(0);
+				for (IndexType i = InBegin; i < InEnd; ++i)
+				{
+					const bool bCondition = CondData[bPlainCondition ? i : InCondition.GetLinearIndex(Coord)];
+					Out[i] = bCondition ? AData[bPlainA ? i : InA.GetLinearIndex(Coord)] : InGetB(bPlainB ? i : INVALID_INDEX, Coord);
+					AdvanceCoordinateInBox(Coord, Zero, Size, Order);
+				}
+			});
+			return Result;
+		}
+
+		// Writes InValue where InTest(Index, OldValue) is true, in parallel chunks that mark their own dirty blocks.
+		template <typename TestFuncType>
+		void SetWhere_Internal(const TestFuncType& InTest, const DataType& InValue)
+		{
+			DataType* Data = GetMutableStorage().GetData();
+			ParallelForChunks_Internal(TotalSize, [&](IndexType InBegin, IndexType InEnd)
+			{
+				IndexType LastBlockIndex = INVALID_INDEX;
+				for (IndexType i = InBegin; i < InEnd; ++i)
+				{
+					if (InTest(i, Data[i]))
+					{
+						Data[i] = InValue;
+						if (bDirtyTracking)
+						{
+							const IndexType BlockIndex = GetDirtyBlockIndex_Internal(IndexToCoordinate(i));
+							if (BlockIndex != LastBlockIndex)
 							{
-								OriginalCoord[i] = period - OriginalCoord[i];  // 18 - 16 = 2
+								LastBlockIndex = BlockIndex;
+								MarkDirtyBlock_Internal(BlockIndex);
 							}
 						}
 					}
-					break;
-				case EBorderMode::ConstantBorder:  // Not implement yet， Add the constant border value.
-					// Result.Add(ConstantBorderValue);
-					// Result.AddZeroed();
+				}
+			});
+		}
+#pragma endregion WhereSelect
+
+#pragma region ConcurrentWrite
+
+	protected:
+		// The boxes of the live write regions, only tracked in the builds with checks. It's created by the first
+		// AcquireWriteRegion() and never copied with the array.
+		struct FWriteRegionRegistry
+		{
+			FCriticalSection Lock;
+			TArray<TPair<CoordinateType, CoordinateType>> Boxes;
+		};
+
+	public:
+		/**
+		 * @brief A writable box [Min, Max) of the array, handed to one worker thread. See AcquireWriteRegion().
+		 *
+		 * The live handles of an array never overlap, so the workers write through them without any lock. The writes
+		 * mark their dirty blocks like operator() does (thread-safe, each handle keeps its own last block). In the builds
+		 * with checks the coordinates are verified to be inside the box. The handle caches the buffer pointer of the
+		 * array, see AcquireWriteRegion() for what mustn't happen to the array while it's alive. The handle is move-only,
+		 * destroying it or calling Release() gives the box back.
+		 */
+		class FWriteRegion
+		{
+		public:
+			FWriteRegion() = default;
+			FWriteRegion(const FWriteRegion&) = delete;
+			FWriteRegion& operator=(const FWriteRegion&) = delete;
+
+			FWriteRegion(FWriteRegion&& InOther) noexcept
+			{
+				*this = MoveTemp(InOther);
+			}
+
+			FWriteRegion& operator=(FWriteRegion&& InOther) noexcept
+			{
+				if (this != &InOther)
+				{
+					Release();
+					Owner = InOther.Owner;
+					Data = InOther.Data;
+					Min = InOther.Min;
+					Max = InOther.Max;
+					LastDirtyBlockIndex = InOther.LastDirtyBlockIndex;
+#if DO_CHECK
+					Registry = MoveTemp(InOther.Registry);
+#endif
+					InOther.Owner = nullptr;
+					InOther.Data = nullptr;
+				}
+				return *this;
+			}
+
+			~FWriteRegion()
+			{
+				Release();
+			}
+
+			bool IsValid() const { return Owner != nullptr; }
+			const CoordinateType& GetMin() const { return Min; }
+			const CoordinateType& GetMax() const { return Max; }
+
+			bool Contains(const CoordinateType& InCoordinate) const
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					if (InCoordinate[Dim] < Min[Dim] || InCoordinate[Dim] >= Max[Dim])
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// The element of an array coordinate (not relative to Min), which must be inside the box.
+			template <typename... T>
+			FORCEINLINE DataType& operator()(T... InElementCoordinate)
+			{
+				return At(CoordinateType{InElementCoordinate...});
+			}
+
+			FORCEINLINE DataType& At(const CoordinateType& InCoordinate)
+			{
+				checkSlow(IsValid() && Contains(InCoordinate));
+				if (Owner->bDirtyTracking)
+				{
+					const IndexType BlockIndex = Owner->GetDirtyBlockIndex_Internal(InCoordinate);
+					if (BlockIndex != LastDirtyBlockIndex)
+					{
+						LastDirtyBlockIndex = BlockIndex;
+						Owner->MarkDirtyBlock_Internal(BlockIndex);
+					}
+				}
+				return Data[Owner->CoordinateToLinearIndex(InCoordinate)];
+			}
+
+			// Calls InFunc(Coordinate, Element) for each element of the box, in the storage order of the array.
+			template <typename FuncType>
+			void ForEach(const FuncType& InFunc)
+			{
+				check(IsValid());
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					if (Min[Dim] >= Max[Dim])
+					{
+						return;
+					}
+				}
+				const CoordinateType& Order = Owner->GetRuntimeStorageOrder();
+				CoordinateType Coord = Min;
+				IndexType NumElements = 1;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					NumElements *= Max[Dim] - Min[Dim];
+				}
+				for (IndexType i = 0; i < NumElements; ++i)
+				{
+					InFunc(static_cast<const CoordinateType&>(Coord), At(Coord));
+					AdvanceCoordinateInBox(Coord, Min, Max, Order);
+				}
+			}
+
+			// Gives the box back to the array, the handle becomes invalid.
+			void Release()
+			{
+				if (!Owner)
+				{
 					return;
 				}
-			
-				// Add the element to the result
-				IndexType OriginalLinearIdx = CoordinateToLinearIndex(OriginalCoord, RuntimeStride);
-				Result.Add(DataList[OriginalLinearIdx]);
+#if DO_CHECK
+				{
+					FScopeLock Lock(&Registry->Lock);
+					for (int32 i = 0; i < Registry->Boxes.Num(); ++i)
+					{
+						if (Registry->Boxes[i].Key == Min && Registry->Boxes[i].Value == Max)
+						{
+							Registry->Boxes.RemoveAtSwap(i);
+							break;
+						}
+					}
+				}
+				Registry.Reset();
+#endif
+				Owner = nullptr;
+				Data = nullptr;
+			}
+
+		private:
+			friend class TBasicArrayMultiDim;
+
+			TBasicArrayMultiDim* Owner = nullptr;
+			DataType* Data = nullptr;
+			CoordinateType Min{};
+			CoordinateType Max{};
+			IndexType LastDirtyBlockIndex = INVALID_INDEX;
+#if DO_CHECK
+			TSharedPtr<FWriteRegionRegistry, ESPMode::ThreadSafe> Registry;
+#endif
+		};
+
+		/**
+		 * @brief Hands out the box [InMin, InMax) for writing from one worker thread, see FWriteRegion.
+		 *
+		 * The shared buffer is detached here, so the handles write into the exclusive storage of this array. In the
+		 * builds with checks, a box overlapping another live handle of this array fails a check; the overlapping
+		 * writes go through AtomicAdd() and the other atomic operations instead. Without the checks (shipping builds)
+		 * the boxes aren't tracked at all, keeping them disjoint is the caller's job. Acquire the handles on the thread
+		 * that owns the array (they can be released on any thread). The handles cache the buffer pointer: while they are
+		 * alive, don't resize the array, don't switch its shared storage mode and don't copy it in that mode (the
+		 * builds with checks catch the last two).
+		 *
+		 * \code
+		 *		TArray<TArrayMultiDim<float, -1, -1>::FWriteRegion> Regions = Grid.PartitionWriteRegions({64, 64});
+		 *		ParallelFor(Regions.Num(), [&](int32 i)
+		 *		{
+		 *			Regions[i].ForEach([](const auto& InCoord, float& OutValue) { OutValue = InCoord[0] * 0.5f; });
+		 *		});
+		 * \endcode
+		 */
+		FWriteRegion AcquireWriteRegion(const CoordinateType& InMin, const CoordinateType& InMax)
+		{
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				checkf(0 <= InMin[Dim] && InMin[Dim] <= InMax[Dim] && InMax[Dim] <= static_cast<IndexType>(RuntimeEachDimSize[Dim]),
+					   TEXT("The write region is out of the array in the dimension %d."), Dim);
+			}
+			FWriteRegion Region;
+			Region.Owner = this;
+			Region.Data = GetMutableStorage().GetData();
+			Region.Min = InMin;
+			Region.Max = InMax;
+#if DO_CHECK
+			if (!WriteRegionRegistry)
+			{
+				WriteRegionRegistry = MakeShared<FWriteRegionRegistry, ESPMode::ThreadSafe>();
+			}
+			{
+				FScopeLock Lock(&WriteRegionRegistry->Lock);
+				for (const TPair<CoordinateType, CoordinateType>& Box : WriteRegionRegistry->Boxes)
+				{
+					bool bOverlap = true;
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						bOverlap &= InMin[Dim] < Box.Value[Dim] && Box.Key[Dim] < InMax[Dim] && InMin[Dim] < InMax[Dim];
+					}
+					checkf(!bOverlap, TEXT("The write region overlaps a live write region of the array."));
+				}
+				WriteRegionRegistry->Boxes.Add(TPair<CoordinateType, CoordinateType>(InMin, InMax));
+			}
+			Region.Registry = WriteRegionRegistry;
+#endif
+			return Region;
+		}
+
+		// Covers the whole array with the disjoint write regions of InTileSize (smaller at the upper borders), the
+		// first dimension varies fastest.
+		TArray<FWriteRegion> PartitionWriteRegions(const ArrayDimType& InTileSize)
+		{
+			ArrayDimType NumTiles{};
+			int32 NumRegions = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				check(InTileSize[Dim] > 0);
+				NumTiles[Dim] = FMath::DivideAndRoundUp(RuntimeEachDimSize[Dim], InTileSize[Dim]);
+				NumRegions *= NumTiles[Dim];
+			}
+			TArray<FWriteRegion> Regions;
+			Regions.Reserve(NumRegions);
+			for (int32 Region = 0; Region < NumRegions; ++Region)
+			{
+				CoordinateType Min{};
+				CoordinateType Max{};
+				int32 Rest = Region;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Min[Dim] = static_cast<IndexType>(Rest % NumTiles[Dim]) * InTileSize[Dim];
+					Max[Dim] = FMath::Min<IndexType>(Min[Dim] + InTileSize[Dim], RuntimeEachDimSize[Dim]);
+					Rest /= NumTiles[Dim];
+				}
+				Regions.Add(AcquireWriteRegion(Min, Max));
+			}
+			return Regions;
+		}
+
+		/**
+		 * @brief Atomically adds InValue to the element, returns its previous value. For arithmetic DataTypes only.
+		 *
+		 * The atomic operations let several threads update the same elements (deposition, splatting, histograms)
+		 * without a lock, and mark the dirty blocks thread-safely. Like with the write regions, a shared buffer must be
+		 * detached (DetachSharedStorage()) before the concurrent writes. The operations are relaxed: they order nothing
+		 * but the element itself, the end of a ParallelFor publishes the results.
+		 */
+		DataType AtomicAdd(const CoordinateType& InCoordinate, DataType InValue)
+		{
+			static_assert(std::is_arithmetic_v<DataType> && !std::is_same_v<DataType, bool>, "AtomicAdd() requires an arithmetic DataType.");
+			return GetAtomicRef_Internal(InCoordinate).fetch_add(InValue, std::memory_order_relaxed);
+		}
+
+		// Atomically stores the minimum of the element and InValue, returns the previous value.
+		DataType AtomicMin(const CoordinateType& InCoordinate, DataType InValue)
+		{
+			return AtomicUpdate_Internal(InCoordinate, [InValue](DataType InOld) { return InValue < InOld; }, InValue);
+		}
+
+		// Atomically stores the maximum of the element and InValue, returns the previous value.
+		DataType AtomicMax(const CoordinateType& InCoordinate, DataType InValue)
+		{
+			return AtomicUpdate_Internal(InCoordinate, [InValue](DataType InOld) { return InOld < InValue; }, InValue);
+		}
+
+		/**
+		 * @brief Stores InDesired if the element equals InOutExpected, like std::atomic::compare_exchange_strong().
+		 * @return Whether the element was replaced; otherwise InOutExpected receives the current value.
+		 */
+		bool AtomicCompareExchange(const CoordinateType& InCoordinate, DataType& InOutExpected, DataType InDesired)
+		{
+			return GetAtomicRef_Internal(InCoordinate).compare_exchange_strong(InOutExpected, InDesired, std::memory_order_relaxed);
+		}
+
+		// Reads an element that other threads may be updating with the atomic operations.
+		DataType AtomicLoad(const CoordinateType& InCoordinate) const
+		{
+			static_assert(std::is_arithmetic_v<DataType>, "The atomic operations require an arithmetic DataType.");
+			return std::atomic_ref<DataType>(const_cast<DataType&>(GetStorage()[CoordinateToLinearIndex(InCoordinate)])).load(std::memory_order_relaxed);
+		}
+
+	protected:
+#if DO_CHECK
+		TSharedPtr<FWriteRegionRegistry, ESPMode::ThreadSafe> WriteRegionRegistry;
+#endif
+
+		// The write regions cache the buffer pointer, the operations that share or move the buffer check that none is alive.
+		void CheckNoLiveWriteRegion_Internal() const
+		{
+#if DO_CHECK
+			if (WriteRegionRegistry)
+			{
+				FScopeLock Lock(&WriteRegionRegistry->Lock);
+				checkf(WriteRegionRegistry->Boxes.IsEmpty(), TEXT("A write region of the array is alive, its buffer can't be shared or moved."));
+			}
+#endif
+		}
+
+		FORCEINLINE std::atomic_ref<DataType> GetAtomicRef_Internal(const CoordinateType& InCoordinate)
+		{
+			static_assert(std::is_arithmetic_v<DataType>, "The atomic operations require an arithmetic DataType.");
+			// Detaching a shared buffer from several threads at once would race, see AtomicAdd().
+			checkSlow(!SharedDataList || SharedDataList.IsUnique());
+			if (bDirtyTracking)
+			{
+				MarkDirtyBlock_Internal(GetDirtyBlockIndex_Internal(InCoordinate));
+			}
+			return std::atomic_ref<DataType>(GetStorage_Internal().GetData()[CoordinateToLinearIndex(InCoordinate)]);
+		}
+
+		// Stores InValue while InShouldReplace(Current) holds, returns the previous value.
+		template <typename ShouldReplaceFuncType>
+		DataType AtomicUpdate_Internal(const CoordinateType& InCoordinate, const ShouldReplaceFuncType& InShouldReplace, DataType InValue)
+		{
+			std::atomic_ref<DataType> Target = GetAtomicRef_Internal(InCoordinate);
+			DataType Expected = Target.load(std::memory_order_relaxed);
+			while (InShouldReplace(Expected) && !Target.compare_exchange_weak(Expected, InValue, std::memory_order_relaxed))
+			{
+			}
+			return Expected;
+		}
+#pragma endregion ConcurrentWrite
+
+#pragma region AccessProfiler
+
+#if ARRAYMULTIDIM_WITH_ACCESS_PROFILER
+	public:
+		// The access statistics of an array and the layout they suggest, see GetAccessProfile().
+		struct FAccessProfile
+		{
+			// The number of buckets of DistanceHistogram.
+			static constexpr int NUM_DISTANCE_BUCKETS = 40;
+
+			// The recorded accesses (the loops count each of their elements).
+			int64 NumAccesses = 0;
+			// The accesses by their storage distance from the previous access in bytes: bucket 0 is the same element,
+			// bucket k a distance in [2^(k-1), 2^k) bytes.
+			std::array<int64, NUM_DISTANCE_BUCKETS> DistanceHistogram{};
+			// The accesses at least a cache line away from the previous one.
+			int64 NumCacheLineJumps = 0;
+			// The steps along each axis: the accesses that changed this coordinate only.
+			std::array<int64, DIM_SIZE> AxisSteps{};
+
+			// The most stepped axis (INDEX_NONE before any step) and its current stride, in elements.
+			int DominantAxis = INDEX_NONE;
+			IndexType DominantStride = 0;
+			// The axes with at least 10% of the steps whose stride is a cache line or more: each step is a likely miss.
+			std::array<bool, DIM_SIZE> MissProneAxes{};
+			// The storage order that puts the most stepped axes fastest (the current order for the axes not stepped).
+			CoordinateType RecommendedOrder{};
+			// Whether two axes are stepped comparably (the second at least half as often as the first): no storage order
+			// serves both, a bricked layout such as TArrayMultiDimChunked does.
+			bool bRecommendBricked = false;
+		};
+
+		/**
+		 * @brief Enables or disables the access profiling of this array, which clears the recorded statistics.
+		 *
+		 * The profiler records operator() (const and non-const), operator[], the loops and GetElementsByMask(), and
+		 * builds the histograms of GetAccessProfile(). It costs one branch per access when disabled, nothing when
+		 * compiled out (ARRAYMULTIDIM_WITH_ACCESS_PROFILER, off in shipping builds): the profiler API and its member
+		 * don't exist then, guard the calls with the same macro. The statistics of the accesses from several threads
+		 * are approximate, they interleave. The copies of the array aren't profiled.
+		 */
+		void SetAccessProfiling(bool InEnable)
+		{
+			AccessRecorder = InEnable ? MakeShared<FAccessRecorder, ESPMode::ThreadSafe>() : nullptr;
+		}
+
+		bool IsAccessProfiling() const { return AccessRecorder.IsValid(); }
+
+		// The statistics recorded since the profiling was enabled, with the dominant stride, the miss-prone axes and the
+		// recommended storage order for this array.
+		FAccessProfile GetAccessProfile() const
+		{
+			FAccessProfile Profile;
+			Profile.RecommendedOrder = RuntimeStorageOrder;
+			if (!AccessRecorder)
+			{
+				return Profile;
+			}
+			const FAccessRecorder& Recorder = *AccessRecorder;
+			Profile.NumAccesses = Recorder.NumAccesses.load(std::memory_order_relaxed);
+			Profile.NumCacheLineJumps = Recorder.NumCacheLineJumps.load(std::memory_order_relaxed);
+			for (int Bucket = 0; Bucket < FAccessProfile::NUM_DISTANCE_BUCKETS; ++Bucket)
+			{
+				Profile.DistanceHistogram[Bucket] = Recorder.DistanceHistogram[Bucket].load(std::memory_order_relaxed);
+			}
+			int64 TotalSteps = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Profile.AxisSteps[Dim] = Recorder.AxisSteps[Dim].load(std::memory_order_relaxed);
+				TotalSteps += Profile.AxisSteps[Dim];
+			}
+			if (TotalSteps == 0)
+			{
+				return Profile;
+			}
+
+			// The most stepped axis goes first, the ties and the unused axes keep their current rank.
+			std::stable_sort(Profile.RecommendedOrder.begin(), Profile.RecommendedOrder.end(), [&Profile](IndexType InA, IndexType InB)
+			{
+				return Profile.AxisSteps[InA] > Profile.AxisSteps[InB];
 			});
+			Profile.DominantAxis = static_cast<int>(Profile.RecommendedOrder[0]);
+			Profile.DominantStride = RuntimeStride[Profile.DominantAxis];
+			Profile.bRecommendBricked = DIM_SIZE > 1 && Profile.AxisSteps[Profile.RecommendedOrder[DIM_SIZE > 1 ? 1 : 0]] * 2 >= Profile.AxisSteps[Profile.DominantAxis];
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Profile.MissProneAxes[Dim] = Profile.AxisSteps[Dim] * 10 >= TotalSteps
+					&& RuntimeStride[Dim] * static_cast<IndexType>(sizeof(DataType)) >= PLATFORM_CACHE_LINE_SIZE;
+			}
+			return Profile;
+		}
 
-			return Result;
+		/**
+		 * @brief Re-lays the array out in the recommended storage order of GetAccessProfile(), the elements keep their
+		 * coordinates. Call it at a safe point: no reference, view or write region into the array may be alive.
+		 *
+		 * @param InMinSteps Keep the layout until the profile has recorded this many axis steps.
+		 * @return Whether the storage order changed; the recorded statistics are cleared if it did.
+		 */
+		bool ApplyRecommendedLayout(int64 InMinSteps = 1024)
+		{
+			const FAccessProfile Profile = GetAccessProfile();
+			int64 TotalSteps = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				TotalSteps += Profile.AxisSteps[Dim];
+			}
+			if (TotalSteps < InMinSteps || Profile.RecommendedOrder == RuntimeStorageOrder)
+			{
+				return false;
+			}
+#if DO_CHECK
+			checkf(!WriteRegionRegistry || WriteRegionRegistry->Boxes.Num() == 0, TEXT("Re-layout while write regions are alive."));
+#endif
+			SetDimSize(RuntimeEachDimSize, Profile.RecommendedOrder, EResizeDataCopyPolicy::CoordinationCopy);
+			SetAccessProfiling(true);
+			return true;
 		}
-#pragma endregion MaskDataGetter
-	};  // Class TArrayMultiDim END
+
+	protected:
+		struct FAccessRecorder
+		{
+			std::atomic<int64> NumAccesses{0};
+			std::atomic<int64> NumCacheLineJumps{0};
+			std::array<std::atomic<int64>, FAccessProfile::NUM_DISTANCE_BUCKETS> DistanceHistogram{};
+			std::array<std::atomic<int64>, DIM_SIZE> AxisSteps{};
+			std::atomic<IndexType> LastIndex{INVALID_INDEX};
+			std::array<std::atomic<IndexType>, DIM_SIZE> LastCoordinate{};
+		};
+		// Only set while the profiling is enabled, the const accesses record through it too.
+		TSharedPtr<FAccessRecorder, ESPMode::ThreadSafe> AccessRecorder;
+
+		FORCEINLINE void RecordDistance_Internal(FAccessRecorder& InOutRecorder, IndexType InDistance, int64 InCount) const
+		{
+			const uint64 Bytes = static_cast<uint64>(InDistance < 0 ? -InDistance : InDistance) * sizeof(DataType);
+			const int Bucket = Bytes == 0 ? 0 : FMath::Min<int>(static_cast<int>(FMath::FloorLog2_64(Bytes)) + 1, FAccessProfile::NUM_DISTANCE_BUCKETS - 1);
+			InOutRecorder.DistanceHistogram[Bucket].fetch_add(InCount, std::memory_order_relaxed);
+			if (Bytes >= PLATFORM_CACHE_LINE_SIZE)
+			{
+				InOutRecorder.NumCacheLineJumps.fetch_add(InCount, std::memory_order_relaxed);
+			}
+		}
+
+		// Records a single access. The relaxed exchanges keep the concurrent accesses safe, not exact.
+		void RecordAccess_Internal(const CoordinateType& InCoordinate, IndexType InIndex) const
+		{
+			FAccessRecorder& Recorder = *AccessRecorder;
+			Recorder.NumAccesses.fetch_add(1, std::memory_order_relaxed);
+			const IndexType LastIndex = Recorder.LastIndex.exchange(InIndex, std::memory_order_relaxed);
+			if (LastIndex == INVALID_INDEX)
+			{
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Recorder.LastCoordinate[Dim].store(InCoordinate[Dim], std::memory_order_relaxed);
+				}
+				return;
+			}
+			RecordDistance_Internal(Recorder, InIndex - LastIndex, 1);
+			int StepAxis = INDEX_NONE;
+			int NumChangedAxes = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (Recorder.LastCoordinate[Dim].exchange(InCoordinate[Dim], std::memory_order_relaxed) != InCoordinate[Dim])
+				{
+					StepAxis = Dim;
+					++NumChangedAxes;
+				}
+			}
+			if (NumChangedAxes == 1)
+			{
+				Recorder.AxisSteps[StepAxis].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// Records a loop over all the elements whose innermost axis is InAxis.
+		void RecordTraversal_Internal(int InAxis) const
+		{
+			FAccessRecorder& Recorder = *AccessRecorder;
+			Recorder.NumAccesses.fetch_add(TotalSize, std::memory_order_relaxed);
+			Recorder.AxisSteps[InAxis].fetch_add(TotalSize, std::memory_order_relaxed);
+			RecordDistance_Internal(Recorder, RuntimeStride[InAxis], TotalSize);
+			Recorder.LastIndex.store(INVALID_INDEX, std::memory_order_relaxed);
+		}
+#endif
+#pragma endregion AccessProfiler
+	};  // Class TBasicArrayMultiDim END
 }
@@ -0,0 +1,238 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+#include "Tasks/Task.h"
+
+namespace ArrayMultiDim
+{
+	/**
+	 * @brief Runs the heavy operations of an array (resizing with CoordinationCopy, SetData() with an initializer,
+	 * slicing, reductions) on the task graph, so that the calling thread doesn't hitch.
+	 *
+	 * Each async operation returns a UE::Tasks task. The operations on the owned array are ordered automatically: a
+	 * write (SetDimSizeAsync(), SetDataAsync(), WriteAsync()) waits for all the pending operations, a read
+	 * (SliceAsync(), ReduceAsync(), ReadAsync()) waits for the last write only, so the reads run concurrently. None of
+	 * them blocks the caller. The results chain into pipelines with Then() (slice -> filter -> reduce), each stage is
+	 * scheduled as a prerequisite of the next one, without any intermediate wait.
+	 *
+	 * The guard against misuse: the array is only reachable synchronously through Get(), which checks that no async
+	 * operation is pending (call Wait() first). The operations may be scheduled from any thread. The destructor waits
+	 * for the pending operations.
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::TAsyncArray<float, -1, -1> Terrain(MoveTemp(Heights));
+	 *		Terrain.SetDimSizeAsync({4096, 4096});
+	 *		auto Slice = Terrain.SliceAsync({{0, 1024}, {}});
+	 *		auto Peaks = ArrayMultiDim::Then(Slice, [](const auto& InSlice) { return InSlice.Where([](float H) { return H > 100.f; }); });
+	 *		auto NumPeaks = ArrayMultiDim::Then(Peaks, [](const TArray<int32>& InPeaks) { return InPeaks.Num(); });
+	 *		// Later, e.g. on the next frame.
+	 *		if (NumPeaks.IsCompleted())
+	 *		{
+	 *			int32 Count = NumPeaks.GetResult();
+	 *		}
+	 * \endcode
+	 *
+	 * @tparam DataType The element type.
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename DataType, int... Dims>
+	class TAsyncArray
+	{
+	public:
+		using ArrayType = TArrayMultiDim<DataType, Dims...>;
+		using IndexType = typename ArrayType::IndexType;
+		using ArrayDimType = typename ArrayType::ArrayDimType;
+		using CoordinateType = typename ArrayType::CoordinateType;
+		using SliceType = typename ArrayType::SelfDynamicSizeType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+
+		// A reduction splits the array into chunks of this many elements.
+		static constexpr IndexType REDUCE_CHUNK_SIZE = 65536;
+
+		explicit TAsyncArray(ArrayType InArray = ArrayType())
+			: Array(MoveTemp(InArray))
+		{
+		}
+
+		TAsyncArray(const TAsyncArray&) = delete;
+		TAsyncArray& operator=(const TAsyncArray&) = delete;
+
+		~TAsyncArray()
+		{
+			Wait();
+		}
+
+		// SetDimSize() on the task graph, after all the pending operations.
+		UE::Tasks::FTask SetDimSizeAsync(const ArrayDimType& InSize,
+										 EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			return WriteAsync([InSize, InCopyPolicy](ArrayType& OutArray) { OutArray.SetDimSize(InSize, InCopyPolicy); });
+		}
+
+		UE::Tasks::FTask SetDimSizeAsync(const ArrayDimType& InSize, const CoordinateType& InNewOrder,
+										 EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			return WriteAsync([InSize, InNewOrder, InCopyPolicy](ArrayType& OutArray) { OutArray.SetDimSize(InSize, InNewOrder, InCopyPolicy); });
+		}
+
+		// SetData(InFunc) on the task graph, after all the pending operations.
+		UE::Tasks::FTask SetDataAsync(typename ArrayType::DataInitializerFuncType InFunc)
+		{
+			return WriteAsync([Func = MoveTemp(InFunc)](ArrayType& OutArray) { OutArray.SetData(Func); });
+		}
+
+		// Runs InFunc(ArrayType&) on the task graph, after all the pending operations.
+		template <typename FuncType>
+		UE::Tasks::FTask WriteAsync(FuncType&& InFunc)
+		{
+			FScopeLock Lock(&TaskLock);
+			TArray<UE::Tasks::FTask> Prerequisites = MoveTemp(PendingReads);
+			PendingReads.Reset();
+			if (LastWrite.IsValid())
+			{
+				Prerequisites.Add(LastWrite);
+			}
+			LastWrite = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Func = Forward<FuncType>(InFunc)]() mutable
+			{
+				Func(Array);
+			}, Prerequisites);
+			return LastWrite;
+		}
+
+		// Slice() on the task graph, after the pending writes. The slices are copied, so a braced list is fine.
+		UE::Tasks::TTask<SliceType> SliceAsync(std::initializer_list<FSlice> InSlices)
+		{
+			return ReadAsync([Slices = TArray<FSlice>(InSlices)](const ArrayType& InArray)
+			{
+				return InArray.Slice(TConstArrayView<FSlice>(Slices));
+			});
+		}
+
+		/**
+		 * @brief Folds all the elements with InReduce(Accumulated, Element) on the task graph, after the pending writes.
+		 *
+		 * The chunks are reduced in parallel from InIdentity, then the partial results are combined with InReduce, so
+		 * InReduce must be associative and commutative, and InIdentity its identity (0 for a sum, the lowest value for a
+		 * maximum, ...).
+		 */
+		template <typename ReduceFuncType>
+		UE::Tasks::TTask<DataType> ReduceAsync(const DataType& InIdentity, ReduceFuncType InReduce)
+		{
+			return ReadAsync([InIdentity, Reduce = MoveTemp(InReduce)](const ArrayType& InArray)
+			{
+				const IndexType Total = InArray.GetTotalSize();
+				const int32 NumChunks = static_cast<int32>((Total + REDUCE_CHUNK_SIZE - 1) / REDUCE_CHUNK_SIZE);
+				TArray<DataType> Partials;
+				Partials.Init(InIdentity, NumChunks);
+				ParallelFor(NumChunks, [&](int32 Chunk)
+				{
+					const IndexType End = FMath::Min<IndexType>((Chunk + 1) * REDUCE_CHUNK_SIZE, Total);
+					DataType Accumulated = InIdentity;
+					for (IndexType i = Chunk * REDUCE_CHUNK_SIZE; i < End; ++i)
+					{
+						Accumulated = Reduce(Accumulated, InArray[i]);
+					}
+					Partials[Chunk] = Accumulated;
+				});
+				DataType Result = InIdentity;
+				for (const DataType& Partial : Partials)
+				{
+					Result = Reduce(Result, Partial);
+				}
+				return Result;
+			});
+		}
+
+		// Runs InFunc(const ArrayType&) on the task graph after the pending writes, concurrently with the other reads.
+		template <typename FuncType>
+		auto ReadAsync(FuncType&& InFunc) -> UE::Tasks::TTask<decltype(InFunc(std::declval<const ArrayType&>()))>
+		{
+			FScopeLock Lock(&TaskLock);
+			PendingReads.RemoveAll([](const UE::Tasks::FTask& InTask) { return InTask.IsCompleted(); });
+			TArray<UE::Tasks::FTask> Prerequisites;
+			if (LastWrite.IsValid())
+			{
+				Prerequisites.Add(LastWrite);
+			}
+			auto Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Func = Forward<FuncType>(InFunc)]() mutable
+			{
+				return Func(static_cast<const ArrayType&>(Array));
+			}, Prerequisites);
+			PendingReads.Add(Task);
+			return Task;
+		}
+
+		// Whether no async operation of this array is pending.
+		bool IsIdle() const
+		{
+			FScopeLock Lock(&TaskLock);
+			if (LastWrite.IsValid() && !LastWrite.IsCompleted())
+			{
+				return false;
+			}
+			for (const UE::Tasks::FTask& Task : PendingReads)
+			{
+				if (!Task.IsCompleted())
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Blocks until all the pending operations of this array are done.
+		void Wait()
+		{
+			// The reads stay pending while waiting, a write scheduled meanwhile from another thread must still wait for
+			// them. Only the completed ones are dropped afterwards.
+			TArray<UE::Tasks::FTask> Tasks;
+			{
+				FScopeLock Lock(&TaskLock);
+				Tasks = PendingReads;
+				if (LastWrite.IsValid())
+				{
+					Tasks.Add(LastWrite);
+				}
+			}
+			UE::Tasks::Wait(Tasks);
+			FScopeLock Lock(&TaskLock);
+			PendingReads.RemoveAll([](const UE::Tasks::FTask& InTask) { return InTask.IsCompleted(); });
+		}
+
+		// The synchronous access, only while no async operation is pending.
+		ArrayType& Get()
+		{
+			checkf(IsIdle(), TEXT("TAsyncArray::Get() while async operations are pending, call Wait() first."));
+			return Array;
+		}
+
+		const ArrayType& Get() const
+		{
+			checkf(IsIdle(), TEXT("TAsyncArray::Get() while async operations are pending, call Wait() first."));
+			return Array;
+		}
+
+	protected:
+		ArrayType Array;
+
+		// The last scheduled write, and the reads scheduled after it. The next write waits for all of them.
+		mutable FCriticalSection TaskLock;
+		UE::Tasks::FTask LastWrite;
+		TArray<UE::Tasks::FTask> PendingReads;
+	};
+
+	/**
+	 * @brief Chains InFunc(Result) after InTask, e.g. the next stage of a pipeline started by TAsyncArray, without
+	 * waiting: the task is scheduled now and runs once InTask completes.
+	 * @return The task of InFunc's result.
+	 */
+	template <typename ResultType, typename FuncType>
+	auto Then(const UE::Tasks::TTask<ResultType>& InTask, FuncType&& InFunc)
+		-> UE::Tasks::TTask<decltype(InFunc(std::declval<ResultType&>()))>
+	{
+		return UE::Tasks::Launch(UE_SOURCE_LOCATION, [InTask, Func = Forward<FuncType>(InFunc)]() mutable
+		{
+			return Func(InTask.GetResult());
+		}, UE::Tasks::Prerequisites(InTask));
+	}
+}
@@ -0,0 +1,739 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+#include "Async/Async.h"
+#include "Misc/Compression.h"
+
+namespace ArrayMultiDim
+{
+	struct FChunkedStorageSettings
+	{
+		// The chunk edge is 2^ChunkSizeLog2 elements in every dimension, e.g. 5 -> 32x32x32 chunks for a 3D array.
+		int ChunkSizeLog2 = 5;
+
+		// The working set: at most this many chunks are kept uncompressed, the least recently used one is evicted.
+		int32 MaxHotChunks = 64;
+
+		// Compress the evicted chunks on the thread pool. When false the eviction compresses synchronously.
+		bool bBackgroundCompression = true;
+	};
+
+	struct FChunkedStorageStats
+	{
+		// Accesses served by an uncompressed chunk.
+		uint64 NumHits = 0;
+		// Accesses that had to bring a chunk back into the working set.
+		uint64 NumMisses = 0;
+		// Misses that actually decompressed (the others re-took a chunk that was still being compressed).
+		uint64 NumDecompressions = 0;
+
+		int32 NumHotChunks = 0;
+		int32 NumCompressingChunks = 0;
+		int32 NumColdChunks = 0;
+		// Cold chunks whose elements are all equal, stored as a single value.
+		int32 NumUniformChunks = 0;
+
+		// The memory of the cold chunks, before and after the compression.
+		int64 ColdUncompressedBytes = 0;
+		int64 ColdCompressedBytes = 0;
+
+		double GetHitRate() const
+		{
+			const uint64 NumAccesses = NumHits + NumMisses;
+			return NumAccesses > 0 ? static_cast<double>(NumHits) / static_cast<double>(NumAccesses) : 1.0;
+		}
+
+		double GetCompressionRatio() const
+		{
+			return ColdCompressedBytes > 0 ? static_cast<double>(ColdUncompressedBytes) / static_cast<double>(ColdCompressedBytes) : 1.0;
+		}
+	};
+
+	/**
+	 * @brief Multi-dimension array split into cubic chunks, only a working set of recently used chunks is uncompressed.
+	 *
+	 * For the big, mostly idle volumes (voxel worlds, occupancy grids, simulation fields with a moving active region).
+	 * Every chunk is either:
+	 *	- Hot: uncompressed, in the LRU working set. operator() on a hot chunk is a shift/mask plus an array access.
+	 *	- Compressing: evicted from the working set, being compressed on the thread pool. An access re-takes the raw data.
+	 *	- Cold: compressed. A uniform chunk is a single value, otherwise the elements are run-length encoded if the runs
+	 *	  are long enough, otherwise LZ4 compressed, otherwise kept raw. An access decompresses it and makes it hot.
+	 * A new array is all cold uniform chunks of DataType(), it costs almost no memory until it is written.
+	 * An evicted chunk that was only read keeps its compressed form and is not compressed again.
+	 *
+	 * The elements are bitwise compared and copied, so DataType must be trivially copyable.
+	 * The accesses must come from one thread at a time; the background compression is synchronized internally.
+	 * A reference returned by operator() is valid until another chunk is accessed (which can evict this one).
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::FChunkedStorageSettings Settings;
+	 *		Settings.MaxHotChunks = 128;
+	 *		ArrayMultiDim::TArrayMultiDimChunked<uint8, -1, -1, -1> Voxels(Settings);
+	 *		Voxels.SetDimSize({2048, 2048, 256});  // All empty, nothing is allocated for the elements yet.
+	 *		Voxels(10, 20, 30) = 1;                // Decompresses the chunk on the first access.
+	 *		uint8 Value = Voxels.Get(10, 20, 31);  // Hit.
+	 *		ArrayMultiDim::FChunkedStorageStats Stats = Voxels.GetStats();
+	 * \endcode
+	 *
+	 * @tparam DataType The element type, trivially copyable.
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim. The chunks use the default storage order.
+	 */
+	template <typename DataType, int... Dims>
+	class TArrayMultiDimChunked
+	{
+		static_assert(std::is_trivially_copyable_v<DataType>, "The chunked storage compares and copies the elements bitwise.");
+
+	public:
+		using DenseArrayType = TArrayMultiDim<DataType, Dims...>;
+		using IndexType = typename DenseArrayType::IndexType;
+		using ArrayDimType = typename DenseArrayType::ArrayDimType;
+		using CoordinateType = typename DenseArrayType::CoordinateType;
+		using SelfDynamicSizeType = typename DenseArrayType::SelfDynamicSizeType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static constexpr int DYNAMIC_SIZE = -1;
+
+		using ConstCoordCallbackType = std::function<void(const CoordinateType& InCoordinate, const DataType& InValue)>;
+		using CoordCallbackType = std::function<void(const CoordinateType& InCoordinate, DataType& InOutValue)>;
+
+		explicit TArrayMultiDimChunked(const FChunkedStorageSettings& InSettings = FChunkedStorageSettings())
+			: Settings(InSettings)
+		{
+			Settings.ChunkSizeLog2 = FMath::Clamp(Settings.ChunkSizeLog2, 1, 30 / DIM_SIZE);
+			Settings.MaxHotChunks = FMath::Max<int32>(Settings.MaxHotChunks, 1);
+			if constexpr (((Dims != DYNAMIC_SIZE) && ...))
+			{
+				SetDimSize(ArrayDimType{Dims...});
+			}
+		}
+
+		// The background tasks reference the chunks, the array is neither copyable nor movable.
+		TArrayMultiDimChunked(const TArrayMultiDimChunked&) = delete;
+		TArrayMultiDimChunked& operator=(const TArrayMultiDimChunked&) = delete;
+
+		~TArrayMultiDimChunked()
+		{
+			WaitForCompression();
+		}
+
+#pragma region Shape
+
+		// Sets the shape, all the elements are reset to DataType().
+		void SetDimSize(const ArrayDimType& InSize)
+		{
+			constexpr std::array<int, DIM_SIZE> CompileTimeEachDimSize = {Dims...};
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (CompileTimeEachDimSize[Dim] != DYNAMIC_SIZE && InSize[Dim] != CompileTimeEachDimSize[Dim])
+				{
+					UE_LOG(LogTemp, Error, TEXT("%hs: Dimension %d is fixed to %d, cannot be set to %d."),
+						   __FUNCTION__, Dim, CompileTimeEachDimSize[Dim], static_cast<int32>(InSize[Dim]));
+					return;
+				}
+			}
+
+			WaitForCompression();
+			EachDimSize = InSize;
+			ChunkEdgeMask = (static_cast<IndexType>(1) << Settings.ChunkSizeLog2) - 1;
+			ChunkElementCount = static_cast<IndexType>(1) << (Settings.ChunkSizeLog2 * DIM_SIZE);
+			NumChunks = 1;
+			for (int Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+			{
+				ChunkGridSize[Dim] = (FMath::Max<IndexType>(InSize[Dim], 0) + ChunkEdgeMask) >> Settings.ChunkSizeLog2;
+				ChunkGridStride[Dim] = NumChunks;
+				NumChunks *= ChunkGridSize[Dim];
+			}
+
+			Chunks = MakeUnique<FChunk[]>(NumChunks);
+			for (int32 i = 0; i < NumChunks; ++i)
+			{
+				Chunks[i].Packed.Kind = ECompressedKind::Uniform;
+				Chunks[i].Packed.UniformValue = DataType();
+			}
+			LruHead = LruTail = INDEX_NONE;
+			NumHotChunks = 0;
+			ResetStats();
+		}
+
+		const ArrayDimType& GetRuntimeEachDimSize() const { return EachDimSize; }
+
+		IndexType GetTotalSize() const
+		{
+			IndexType TotalSize = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				TotalSize *= EachDimSize[Dim];
+			}
+			return TotalSize;
+		}
+
+		const FChunkedStorageSettings& GetSettings() const { return Settings; }
+		int32 GetChunkCount() const { return NumChunks; }
+		IndexType GetChunkEdge() const { return ChunkEdgeMask + 1; }
+
+#pragma endregion Shape
+
+#pragma region Access
+
+		// Write access, decompresses the chunk if needed and marks it modified.
+		FORCEINLINE DataType& operator()(const CoordinateType& InCoordinate)
+		{
+			IndexType LocalIndex;
+			const int32 ChunkIndex = LocateChunk(InCoordinate, LocalIndex);
+			Chunks[ChunkIndex].bModified = true;
+			return AcquireChunk(ChunkIndex)[LocalIndex];
+		}
+
+		template <typename... T>
+		FORCEINLINE DataType& operator()(T... InElementCoordinate)
+		{
+			return (*this)(CoordinateType{static_cast<IndexType>(InElementCoordinate)...});
+		}
+
+		// Read access, a chunk that is only read is not compressed again when it is evicted.
+		FORCEINLINE DataType Get(const CoordinateType& InCoordinate) const
+		{
+			IndexType LocalIndex;
+			const int32 ChunkIndex = LocateChunk(InCoordinate, LocalIndex);
+			return AcquireChunk(ChunkIndex)[LocalIndex];
+		}
+
+		template <typename... T>
+		FORCEINLINE DataType Get(T... InElementCoordinate) const
+		{
+			return Get(CoordinateType{static_cast<IndexType>(InElementCoordinate)...});
+		}
+
+		FORCEINLINE void Set(const CoordinateType& InCoordinate, const DataType& InValue)
+		{
+			(*this)(InCoordinate) = InValue;
+		}
+
+		// Sets all the elements to one value: every chunk becomes a cold uniform chunk, the working set is dropped.
+		void Fill(const DataType& InValue)
+		{
+			WaitForCompression();
+			FScopeLock Lock(&StateLock);
+			for (int32 i = 0; i < NumChunks; ++i)
+			{
+				FChunk& Chunk = Chunks[i];
+				Chunk.Hot.Empty();
+				Chunk.PendingRaw.Reset();
+				Chunk.Packed.Reset();
+				Chunk.Packed.Kind = ECompressedKind::Uniform;
+				Chunk.Packed.UniformValue = InValue;
+				Chunk.bModified = false;
+				Chunk.LruPrev = Chunk.LruNext = INDEX_NONE;
+				++Chunk.Generation;
+				Chunk.State.store(EChunkState::Cold, std::memory_order_relaxed);
+			}
+			LruHead = LruTail = INDEX_NONE;
+			NumHotChunks = 0;
+		}
+
+		/**
+		 * Visits every element, chunk by chunk. Each chunk is decompressed once, so this is the fast way to read
+		 * the whole array. The elements are visited in the chunk order, not in the storage order of a dense array.
+		 */
+		void ConstLoopByCoord(const ConstCoordCallbackType& InFunc) const
+		{
+			ForEachChunkElement([&](const CoordinateType& InCoordinate, DataType* InChunkData, IndexType InLocalIndex)
+			{
+				InFunc(InCoordinate, InChunkData[InLocalIndex]);
+			}, false);
+		}
+
+		// Same as ConstLoopByCoord(), the chunks are marked modified.
+		void LoopByCoord(const CoordCallbackType& InFunc)
+		{
+			ForEachChunkElement([&](const CoordinateType& InCoordinate, DataType* InChunkData, IndexType InLocalIndex)
+			{
+				InFunc(InCoordinate, InChunkData[InLocalIndex]);
+			}, true);
+		}
+
+		// Copies a dense array of the same shape in, chunk by chunk.
+		void FromDense(const DenseArrayType& InSource)
+		{
+			SetDimSize(InSource.GetRuntimeEachDimSize());
+			LoopByCoord([&](const CoordinateType& InCoordinate, DataType& OutValue)
+			{
+				OutValue = InSource[InSource.GetLinearIndex(InCoordinate)];
+			});
+		}
+
+		DenseArrayType ToDense() const
+		{
+			DenseArrayType Result;
+			Result.SetDimSize(EachDimSize, EResizeDataCopyPolicy::SetToUninitializedValue);
+			ConstLoopByCoord([&](const CoordinateType& InCoordinate, const DataType& InValue)
+			{
+				Result[Result.GetLinearIndex(InCoordinate)] = InValue;
+			});
+			return Result;
+		}
+
+		// Slices into a dense array, same semantics as TArrayMultiDim::Slice(). Only the touched chunks are decompressed.
+		SelfDynamicSizeType Slice(std::initializer_list<FSlice> InSlices) const
+		{
+			check(static_cast<int>(InSlices.size()) == DIM_SIZE);
+			ArrayDimType NewDimensions;
+			CoordinateType SliceStart;
+			int Dim = 0;
+			for (const FSlice& SliceObj : InSlices)
+			{
+				if (SliceObj.IsSingle())
+				{
+					SliceStart[Dim] = SliceObj.GetSingle();
+					NewDimensions[Dim] = 1;
+				}
+				else if (SliceObj.IsRanged())
+				{
+					SliceStart[Dim] = SliceObj.GetRangeStart();
+					NewDimensions[Dim] = SliceObj.GetRangeEnd() - SliceObj.GetRangeStart();
+				}
+				else
+				{
+					SliceStart[Dim] = 0;
+					NewDimensions[Dim] = EachDimSize[Dim];
+				}
+				++Dim;
+			}
+
+			SelfDynamicSizeType Result;
+			Result.SetDimSize(NewDimensions, EResizeDataCopyPolicy::SetToUninitializedValue);
+			DenseArrayType::DoNestedLoops(NewDimensions, [&](const CoordinateType& InLocalCoord, const IndexType& InLoopCounter)
+			{
+				CoordinateType SourceCoord;
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					SourceCoord[i] = SliceStart[i] + InLocalCoord[i];
+				}
+				Result[InLoopCounter] = Get(SourceCoord);
+			});
+			return Result;
+		}
+
+#pragma endregion Access
+
+#pragma region Compression
+
+		// Waits for all the background compression tasks. Called by the destructor and before a reshape.
+		void WaitForCompression() const
+		{
+			while (true)
+			{
+				TArray<TFuture<void>> Tasks;
+				{
+					FScopeLock Lock(&StateLock);
+					Tasks = MoveTemp(InFlightTasks);
+					InFlightTasks.Reset();
+				}
+				if (Tasks.Num() == 0)
+				{
+					return;
+				}
+				for (const TFuture<void>& Task : Tasks)
+				{
+					Task.Wait();
+				}
+			}
+		}
+
+		// Evicts the whole working set, e.g. before the array goes idle. Pass true to wait until it is compressed.
+		void Flush(bool bInWait = false)
+		{
+			{
+				FScopeLock Lock(&StateLock);
+				while (LruTail != INDEX_NONE)
+				{
+					EvictChunk_Locked(LruTail);
+				}
+			}
+			if (bInWait)
+			{
+				WaitForCompression();
+			}
+		}
+
+		FChunkedStorageStats GetStats() const
+		{
+			FScopeLock Lock(&StateLock);
+			FChunkedStorageStats Stats;
+			Stats.NumHits = NumHits.load(std::memory_order_relaxed);
+			Stats.NumMisses = NumMisses.load(std::memory_order_relaxed);
+			Stats.NumDecompressions = NumDecompressions.load(std::memory_order_relaxed);
+			for (int32 i = 0; i < NumChunks; ++i)
+			{
+				const FChunk& Chunk = Chunks[i];
+				switch (Chunk.State.load(std::memory_order_relaxed))
+				{
+				case EChunkState::Hot:
+					++Stats.NumHotChunks;
+					break;
+				case EChunkState::Compressing:
+					++Stats.NumCompressingChunks;
+					break;
+				default:
+					++Stats.NumColdChunks;
+					Stats.NumUniformChunks += Chunk.Packed.Kind == ECompressedKind::Uniform ? 1 : 0;
+					Stats.ColdUncompressedBytes += static_cast<int64>(ChunkElementCount) * sizeof(DataType);
+					Stats.ColdCompressedBytes += Chunk.Packed.GetSize();
+					break;
+				}
+			}
+			return Stats;
+		}
+
+		void ResetStats()
+		{
+			NumHits.store(0, std::memory_order_relaxed);
+			NumMisses.store(0, std::memory_order_relaxed);
+			NumDecompressions.store(0, std::memory_order_relaxed);
+		}
+
+#pragma endregion Compression
+
+	private:
+		enum class EChunkState : uint8
+		{
+			Hot,
+			Compressing,
+			Cold,
+		};
+
+		enum class ECompressedKind : uint8
+		{
+			Uniform,
+			RunLength,
+			LZ4,
+			Raw,
+		};
+
+		struct FCompressedChunk
+		{
+			ECompressedKind Kind = ECompressedKind::Uniform;
+			DataType UniformValue{};
+			TArray<uint8> Bytes;
+
+			int64 GetSize() const { return Kind == ECompressedKind::Uniform ? sizeof(DataType) : Bytes.Num(); }
+
+			void Reset()
+			{
+				Kind = ECompressedKind::Uniform;
+				Bytes.Empty();
+			}
+		};
+
+		struct FChunk
+		{
+			// Valid when hot.
+			TArray<DataType> Hot;
+			// Valid when cold, and kept while hot until the chunk is modified.
+			FCompressedChunk Packed;
+			// Valid when compressing, shared with the compression task.
+			TSharedPtr<TArray<DataType>, ESPMode::ThreadSafe> PendingRaw;
+			// Bumped whenever a pending compression result becomes stale.
+			uint32 Generation = 0;
+			int32 LruPrev = INDEX_NONE;
+			int32 LruNext = INDEX_NONE;
+			bool bModified = false;
+			std::atomic<EChunkState> State{EChunkState::Cold};
+		};
+
+		FORCEINLINE int32 LocateChunk(const CoordinateType& InCoordinate, IndexType& OutLocalIndex) const
+		{
+			int32 ChunkIndex = 0;
+			OutLocalIndex = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				checkSlow(InCoordinate[Dim] >= 0 && InCoordinate[Dim] < EachDimSize[Dim]);
+				ChunkIndex += static_cast<int32>(InCoordinate[Dim] >> Settings.ChunkSizeLog2) * ChunkGridStride[Dim];
+				OutLocalIndex = (OutLocalIndex << Settings.ChunkSizeLog2) | (InCoordinate[Dim] & ChunkEdgeMask);
+			}
+			return ChunkIndex;
+		}
+
+		// The storage has a single writer thread, a plain load and store is enough and avoids the locked read-modify-write of fetch_add.
+		static FORCEINLINE void BumpCounter(std::atomic<uint64>& InCounter)
+		{
+			InCounter.store(InCounter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		// Returns the uncompressed elements of a chunk, the fast path does not lock.
+		FORCEINLINE DataType* AcquireChunk(int32 InChunkIndex) const
+		{
+			FChunk& Chunk = Chunks[InChunkIndex];
+			if (InChunkIndex == LruHead)
+			{
+				BumpCounter(NumHits);
+				return Chunk.Hot.GetData();
+			}
+			if (Chunk.State.load(std::memory_order_relaxed) == EChunkState::Hot)
+			{
+				BumpCounter(NumHits);
+				LruRemove(InChunkIndex);
+				LruPushFront(InChunkIndex);
+				return Chunk.Hot.GetData();
+			}
+			return AcquireColdChunk(InChunkIndex);
+		}
+
+		DataType* AcquireColdChunk(int32 InChunkIndex) const
+		{
+			FScopeLock Lock(&StateLock);
+			FChunk& Chunk = Chunks[InChunkIndex];
+			BumpCounter(NumMisses);
+			if (Chunk.State.load(std::memory_order_relaxed) == EChunkState::Compressing)
+			{
+				// The task may still read the raw data, take a copy and let the task result be discarded.
+				// There is no valid compressed form, the chunk has to be compressed again on the next eviction.
+				Chunk.Hot = *Chunk.PendingRaw;
+				Chunk.PendingRaw.Reset();
+				++Chunk.Generation;
+				Chunk.bModified = true;
+			}
+			else
+			{
+				BumpCounter(NumDecompressions);
+				Chunk.Hot.SetNumUninitialized(ChunkElementCount);
+				Decompress(Chunk.Packed, Chunk.Hot.GetData(), ChunkElementCount);
+			}
+			Chunk.State.store(EChunkState::Hot, std::memory_order_relaxed);
+			LruPushFront(InChunkIndex);
+			++NumHotChunks;
+			while (NumHotChunks > Settings.MaxHotChunks)
+			{
+				EvictChunk_Locked(LruTail);
+			}
+			return Chunk.Hot.GetData();
+		}
+
+		void EvictChunk_Locked(int32 InChunkIndex) const
+		{
+			FChunk& Chunk = Chunks[InChunkIndex];
+			LruRemove(InChunkIndex);
+			--NumHotChunks;
+			if (!Chunk.bModified)
+			{
+				// Only read since it was decompressed, the compressed form is still valid.
+				Chunk.Hot.Empty();
+				Chunk.State.store(EChunkState::Cold, std::memory_order_relaxed);
+				return;
+			}
+
+			Chunk.bModified = false;
+			Chunk.Packed.Reset();
+			if (!Settings.bBackgroundCompression)
+			{
+				Compress(Chunk.Hot.GetData(), ChunkElementCount, Chunk.Packed);
+				Chunk.Hot.Empty();
+				Chunk.State.store(EChunkState::Cold, std::memory_order_relaxed);
+				return;
+			}
+
+			Chunk.PendingRaw = MakeShared<TArray<DataType>, ESPMode::ThreadSafe>(MoveTemp(Chunk.Hot));
+			Chunk.Hot.Empty();
+			Chunk.State.store(EChunkState::Compressing, std::memory_order_relaxed);
+
+			// Drop the finished tasks once in a while so the list stays small.
+			if (InFlightTasks.Num() >= Settings.MaxHotChunks)
+			{
+				InFlightTasks.RemoveAll([](const TFuture<void>& InTask) { return InTask.IsReady(); });
+			}
+
+			TSharedPtr<TArray<DataType>, ESPMode::ThreadSafe> Raw = Chunk.PendingRaw;
+			const uint32 Generation = Chunk.Generation;
+			const IndexType ElementCount = ChunkElementCount;
+			InFlightTasks.Add(Async(EAsyncExecution::ThreadPool, [this, InChunkIndex, Raw, Generation, ElementCount]()
+			{
+				FCompressedChunk Result;
+				Compress(Raw->GetData(), ElementCount, Result);
+
+				FScopeLock Lock(&StateLock);
+				FChunk& TargetChunk = Chunks[InChunkIndex];
+				if (TargetChunk.Generation == Generation && TargetChunk.State.load(std::memory_order_relaxed) == EChunkState::Compressing)
+				{
+					TargetChunk.Packed = MoveTemp(Result);
+					TargetChunk.PendingRaw.Reset();
+					TargetChunk.State.store(EChunkState::Cold, std::memory_order_relaxed);
+				}
+			}));
+		}
+
+		static void Compress(const DataType* InData, IndexType InCount, FCompressedChunk& OutPacked)
+		{
+			// Count the runs of bitwise equal elements, one run means a uniform chunk.
+			int32 NumRuns = 1;
+			for (IndexType i = 1; i < InCount; ++i)
+			{
+				NumRuns += FMemory::Memcmp(&InData[i], &InData[i - 1], sizeof(DataType)) != 0 ? 1 : 0;
+			}
+			if (NumRuns == 1)
+			{
+				OutPacked.Kind = ECompressedKind::Uniform;
+				FMemory::Memcpy(&OutPacked.UniformValue, InData, sizeof(DataType));
+				OutPacked.Bytes.Empty();
+				return;
+			}
+
+			constexpr int32 RunSize = sizeof(int32) + sizeof(DataType);
+			const int32 RawSize = static_cast<int32>(InCount * sizeof(DataType));
+			if (static_cast<int64>(NumRuns) * RunSize <= RawSize / 2)
+			{
+				OutPacked.Kind = ECompressedKind::RunLength;
+				OutPacked.Bytes.SetNumUninitialized(NumRuns * RunSize);
+				uint8* Write = OutPacked.Bytes.GetData();
+				int32 RunStart = 0;
+				for (IndexType i = 1; i <= InCount; ++i)
+				{
+					if (i == InCount || FMemory::Memcmp(&InData[i], &InData[RunStart], sizeof(DataType)) != 0)
+					{
+						const int32 RunLength = static_cast<int32>(i) - RunStart;
+						FMemory::Memcpy(Write, &RunLength, sizeof(int32));
+						FMemory::Memcpy(Write + sizeof(int32), &InData[RunStart], sizeof(DataType));
+						Write += RunSize;
+						RunStart = static_cast<int32>(i);
+					}
+				}
+				return;
+			}
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_LZ4, RawSize);
+			OutPacked.Bytes.SetNumUninitialized(CompressedSize);
+			if (FCompression::CompressMemory(NAME_LZ4, OutPacked.Bytes.GetData(), CompressedSize, InData, RawSize) && CompressedSize < RawSize)
+			{
+				OutPacked.Kind = ECompressedKind::LZ4;
+				OutPacked.Bytes.SetNum(CompressedSize);
+				OutPacked.Bytes.Shrink();
+				return;
+			}
+
+			// Incompressible, keep the raw bytes.
+			OutPacked.Kind = ECompressedKind::Raw;
+			OutPacked.Bytes.SetNumUninitialized(RawSize);
+			OutPacked.Bytes.Shrink();
+			FMemory::Memcpy(OutPacked.Bytes.GetData(), InData, RawSize);
+		}
+
+		static void Decompress(const FCompressedChunk& InPacked, DataType* OutData, IndexType InCount)
+		{
+			switch (InPacked.Kind)
+			{
+			case ECompressedKind::Uniform:
+				for (IndexType i = 0; i < InCount; ++i)
+				{
+					OutData[i] = InPacked.UniformValue;
+				}
+				break;
+			case ECompressedKind::RunLength:
+				{
+					constexpr int32 RunSize = sizeof(int32) + sizeof(DataType);
+					const uint8* Read = InPacked.Bytes.GetData();
+					const uint8* ReadEnd = Read + InPacked.Bytes.Num();
+					DataType* Write = OutData;
+					for (; Read < ReadEnd; Read += RunSize)
+					{
+						int32 RunLength;
+						DataType Value;
+						FMemory::Memcpy(&RunLength, Read, sizeof(int32));
+						FMemory::Memcpy(&Value, Read + sizeof(int32), sizeof(DataType));
+						for (int32 i = 0; i < RunLength; ++i)
+						{
+							*Write++ = Value;
+						}
+					}
+					check(Write == OutData + InCount);
+				}
+				break;
+			case ECompressedKind::LZ4:
+				{
+					const bool bSucceeded = FCompression::UncompressMemory(NAME_LZ4, OutData, static_cast<int32>(InCount * sizeof(DataType)),
+																		   InPacked.Bytes.GetData(), InPacked.Bytes.Num());
+					checkf(bSucceeded, TEXT("Failed to decompress a chunk."));
+				}
+				break;
+			default:
+				FMemory::Memcpy(OutData, InPacked.Bytes.GetData(), InPacked.Bytes.Num());
+				break;
+			}
+		}
+
+		// Calls InFunc(Coordinate, ChunkData, LocalIndex) for every element inside the array, chunk by chunk.
+		template <typename FuncType>
+		void ForEachChunkElement(const FuncType& InFunc, bool bInModify) const
+		{
+			CoordinateType ChunkExtent;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				ChunkExtent[Dim] = ChunkEdgeMask + 1;
+			}
+			DenseArrayType::DoNestedLoops(ChunkGridSize, [&](const CoordinateType& InChunkCoord, const IndexType& InChunkCounter)
+			{
+				CoordinateType ChunkMin;
+				CoordinateType Limits;
+				int32 ChunkIndex = 0;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					ChunkMin[Dim] = InChunkCoord[Dim] << Settings.ChunkSizeLog2;
+					Limits[Dim] = FMath::Min<IndexType>(ChunkExtent[Dim], EachDimSize[Dim] - ChunkMin[Dim]);
+					ChunkIndex += static_cast<int32>(InChunkCoord[Dim]) * ChunkGridStride[Dim];
+				}
+				if (bInModify)
+				{
+					Chunks[ChunkIndex].bModified = true;
+				}
+				DataType* ChunkData = AcquireChunk(ChunkIndex);
+				DenseArrayType::DoNestedLoops(Limits, [&](const CoordinateType& InLocalCoord, const IndexType& InLoopCounter)
+				{
+					CoordinateType Coordinate;
+					IndexType LocalIndex = 0;
+					for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+					{
+						Coordinate[Dim] = ChunkMin[Dim] + InLocalCoord[Dim];
+						LocalIndex = (LocalIndex << Settings.ChunkSizeLog2) | InLocalCoord[Dim];
+					}
+					InFunc(Coordinate, ChunkData, LocalIndex);
+				});
+			});
+		}
+
+		// The LRU list of the hot chunks, linked through the chunk indexes, most recently used first.
+		void LruRemove(int32 InChunkIndex) const
+		{
+			FChunk& Chunk = Chunks[InChunkIndex];
+			(Chunk.LruPrev != INDEX_NONE ? Chunks[Chunk.LruPrev].LruNext : LruHead) = Chunk.LruNext;
+			(Chunk.LruNext != INDEX_NONE ? Chunks[Chunk.LruNext].LruPrev : LruTail) = Chunk.LruPrev;
+			Chunk.LruPrev = Chunk.LruNext = INDEX_NONE;
+		}
+
+		void LruPushFront(int32 InChunkIndex) const
+		{
+			FChunk& Chunk = Chunks[InChunkIndex];
+			Chunk.LruPrev = INDEX_NONE;
+			Chunk.LruNext = LruHead;
+			(LruHead != INDEX_NONE ? Chunks[LruHead].LruPrev : LruTail) = InChunkIndex;
+			LruHead = InChunkIndex;
+		}
+
+		FChunkedStorageSettings Settings;
+		ArrayDimType EachDimSize{};
+		CoordinateType ChunkGridSize{};
+		std::array<int32, DIM_SIZE> ChunkGridStride{};
+		IndexType ChunkEdgeMask = 0;
+		IndexType ChunkElementCount = 0;
+		int32 NumChunks = 0;
+
+		// The reads decompress too, the chunk states are mutable.
+		mutable TUniquePtr<FChunk[]> Chunks;
+		mutable int32 LruHead = INDEX_NONE;
+		mutable int32 LruTail = INDEX_NONE;
+		mutable int32 NumHotChunks = 0;
+		mutable TArray<TFuture<void>> InFlightTasks;
+		mutable FCriticalSection StateLock;
+
+		// Counted on the lock-free fast path too, by the single writer thread. Relaxed atomics so that GetStats() may read them from any thread.
+		mutable std::atomic<uint64> NumHits{0};
+		mutable std::atomic<uint64> NumMisses{0};
+		mutable std::atomic<uint64> NumDecompressions{0};
+	};
+}
@@ -0,0 +1,509 @@
+#pragma once
+#include "ArrayMultiDim.h"
+
+namespace ArrayMultiDim
+{
+	/**
+	 * Quantization codecs, the storage policies of TArrayMultiDimQuantized. A codec converts a float value to the
+	 * stored type and back, and provides the bulk versions used by the loops and the reductions.
+	 */
+
+	// Half-float storage, 2 bytes per element. About 3 significant decimal digits, the values are clamped to +-65504.
+	struct FHalfFloatCodec
+	{
+		using StoredType = FFloat16;
+
+		FORCEINLINE StoredType Encode(float InValue) const
+		{
+			StoredType Result;
+			Result.SetClamped(InValue);
+			return Result;
+		}
+
+		FORCEINLINE float Decode(const StoredType& InValue) const { return InValue.GetFloat(); }
+
+		void DecodeRange(const StoredType* InStored, float* OutValues, int32 InCount) const
+		{
+			for (int32 i = 0; i < InCount; ++i)
+			{
+				OutValues[i] = InStored[i].GetFloat();
+			}
+		}
+
+		void EncodeRange(const float* InValues, StoredType* OutStored, int32 InCount) const
+		{
+			for (int32 i = 0; i < InCount; ++i)
+			{
+				OutStored[i].SetClamped(InValues[i]);
+			}
+		}
+	};
+
+	/**
+	 * @brief Scaled and offset integer storage: Value = Stored * Scale + Offset.
+	 *
+	 * The values out of the representable range are clamped, the error of the representable values is at most Scale / 2.
+	 * Use FromRange() to map a known value range to the full range of the integer type.
+	 */
+	template <typename InStoredType>
+	struct TScaledIntCodec
+	{
+		static_assert(std::is_integral_v<InStoredType>, "The stored type must be an integer type.");
+		using StoredType = InStoredType;
+
+		float Scale = 1.f;
+		float Offset = 0.f;
+
+		TScaledIntCodec()
+		{
+		}
+
+		TScaledIntCodec(float InScale, float InOffset)
+			: Scale(InScale), Offset(InOffset)
+		{
+			check(Scale != 0.f);
+		}
+
+		// The codec that maps [InMin, InMax] to the full range of the stored type.
+		static TScaledIntCodec FromRange(float InMin, float InMax)
+		{
+			constexpr float StoredMin = static_cast<float>(TNumericLimits<StoredType>::Min());
+			constexpr float StoredMax = static_cast<float>(TNumericLimits<StoredType>::Max());
+			const float RangeScale = InMax > InMin ? (InMax - InMin) / (StoredMax - StoredMin) : 1.f;
+			return TScaledIntCodec(RangeScale, InMin - StoredMin * RangeScale);
+		}
+
+		FORCEINLINE StoredType Encode(float InValue) const
+		{
+			// Clamped in float before the rounding, an out of range value (or a NaN) can't overflow the conversion.
+			constexpr float StoredMin = static_cast<float>(TNumericLimits<StoredType>::Min());
+			constexpr float StoredMax = static_cast<float>(TNumericLimits<StoredType>::Max());
+			const float Scaled = (InValue - Offset) / Scale;
+			if (!(Scaled > StoredMin))
+			{
+				return TNumericLimits<StoredType>::Min();
+			}
+			if (Scaled >= StoredMax)
+			{
+				return TNumericLimits<StoredType>::Max();
+			}
+			return static_cast<StoredType>(FMath::RoundToFloat(Scaled));
+		}
+
+		FORCEINLINE float Decode(StoredType InValue) const { return static_cast<float>(InValue) * Scale + Offset; }
+
+		// A plain multiply-add loop, the compiler vectorizes it.
+		void DecodeRange(const StoredType* InStored, float* OutValues, int32 InCount) const
+		{
+			const float LocalScale = Scale;
+			const float LocalOffset = Offset;
+			for (int32 i = 0; i < InCount; ++i)
+			{
+				OutValues[i] = static_cast<float>(InStored[i]) * LocalScale + LocalOffset;
+			}
+		}
+
+		void EncodeRange(const float* InValues, StoredType* OutStored, int32 InCount) const
+		{
+			for (int32 i = 0; i < InCount; ++i)
+			{
+				OutStored[i] = Encode(InValues[i]);
+			}
+		}
+
+		// The maximum error of a value inside the representable range.
+		float GetMaxError() const { return FMath::Abs(Scale) * 0.5f; }
+	};
+
+	using FInt8Codec = TScaledIntCodec<int8>;
+	using FUInt8Codec = TScaledIntCodec<uint8>;
+	using FInt16Codec = TScaledIntCodec<int16>;
+	using FUInt16Codec = TScaledIntCodec<uint16>;
+
+	/**
+	 * @brief Multi-dimension float array stored with reduced precision.
+	 *
+	 * The elements are stored as [CodecType::StoredType] in a TArrayMultiDim (same shape, storage order, slicing and
+	 * ring-buffer semantics), and encoded / decoded transparently on access. The memory and the bandwidth are cut by
+	 * 2x (half-float, int16) or 4x (int8). The bulk paths decode contiguous chunks into a small float buffer, and the
+	 * reductions of the integer codecs run on the integers directly.
+	 *
+	 * Usage:
+	 * \code
+	 *		using FProbabilityMap = ArrayMultiDim::TArrayMultiDimQuantized<ArrayMultiDim::FUInt8Codec, -1, -1>;
+	 *		FProbabilityMap Map(ArrayMultiDim::FUInt8Codec::FromRange(0.f, 1.f));
+	 *		Map.SetDimSize({1024, 1024}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+	 *		Map(3, 4) = 0.25f;           // Encoded.
+	 *		float Probability = Map(3, 4);  // Decoded, 0.25 +- 1/510.
+	 *		double Mean = Map.Mean();     // Integer reduction.
+	 * \endcode
+	 *
+	 * @tparam CodecType FHalfFloatCodec or a TScaledIntCodec.
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename CodecType, int... Dims>
+	class TArrayMultiDimQuantized
+	{
+	public:
+		using StoredType = typename CodecType::StoredType;
+		using EncodedArrayType = TArrayMultiDim<StoredType, Dims...>;
+		using DecodedArrayType = TArrayMultiDim<float, Dims...>;
+		using IndexType = typename EncodedArrayType::IndexType;
+		using ArrayDimType = typename EncodedArrayType::ArrayDimType;
+		using CoordinateType = typename EncodedArrayType::CoordinateType;
+		using MaskType = typename EncodedArrayType::MaskType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static constexpr int DYNAMIC_SIZE = -1;
+		using SelfDynamicSizeType = TArrayMultiDimQuantized<CodecType, (static_cast<void>(Dims), DYNAMIC_SIZE)...>;
+
+		// The bulk paths decode this many elements at a time into a buffer on the stack.
+		static constexpr int32 DECODE_CHUNK_SIZE = 1024;
+
+		TArrayMultiDimQuantized()
+		{
+		}
+
+		explicit TArrayMultiDimQuantized(const CodecType& InCodec)
+			: Codec(InCodec)
+		{
+		}
+
+		template <int... OrderList>
+		TArrayMultiDimQuantized(const CodecType& InCodec, Odr<OrderList...> InOrder)
+			: Codec(InCodec), Encoded(InOrder)
+		{
+		}
+
+		// Encodes a float array, the shape and the storage order are kept.
+		TArrayMultiDimQuantized(const DecodedArrayType& InSource, const CodecType& InCodec)
+			: Codec(InCodec)
+		{
+			Encode(InSource);
+		}
+
+#pragma region Shape
+		void SetDimSize(const ArrayDimType& InSize,
+						const CoordinateType& InNewOrder,
+						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			Encoded.SetDimSize(InSize, InNewOrder, InCopyPolicy);
+		}
+
+		void SetDimSize(const ArrayDimType& InSize,
+						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			Encoded.SetDimSize(InSize, InCopyPolicy);
+		}
+
+		template <int... OrderList>
+		void SetDimSize(const ArrayDimType& InSize, Odr<OrderList...> InOrder,
+						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			Encoded.SetDimSize(InSize, InOrder, InCopyPolicy);
+		}
+
+		IndexType GetTotalSize() const { return Encoded.GetTotalSize(); }
+		const ArrayDimType& GetRuntimeEachDimSize() const { return Encoded.GetRuntimeEachDimSize(); }
+		CoordinateType GetRuntimeStorageOrder() const { return Encoded.GetRuntimeStorageOrder(); }
+		IndexType GetLinearIndex(const CoordinateType& InCoordinate) const { return Encoded.GetLinearIndex(InCoordinate); }
+
+		const CodecType& GetCodec() const { return Codec; }
+
+		// Re-encodes all the elements with another codec, e.g. after the value range changed.
+		void Recode(const CodecType& InNewCodec)
+		{
+			const DecodedArrayType Decoded = Decode();
+			Codec = InNewCodec;
+			Encode(Decoded);
+		}
+
+		// The underlying array of the stored type, e.g. for the serialization.
+		const EncodedArrayType& GetEncoded() const { return Encoded; }
+		EncodedArrayType& GetEncoded() { return Encoded; }
+#pragma endregion Shape
+
+#pragma region GetElements
+		float Get(IndexType InLinearIndex) const { return Codec.Decode(Encoded[InLinearIndex]); }
+
+		void Set(IndexType InLinearIndex, float InValue) { Encoded[InLinearIndex] = Codec.Encode(InValue); }
+
+		// Proxy of an element returned by the non-const operator(), reads decode and writes encode.
+		class TElementRef
+		{
+		public:
+			TElementRef(TArrayMultiDimQuantized& InOwner, IndexType InLinearIndex)
+				: Owner(InOwner), LinearIndex(InLinearIndex)
+			{
+			}
+
+			operator float() const { return Owner.Get(LinearIndex); }
+
+			TElementRef& operator=(float InValue)
+			{
+				Owner.Set(LinearIndex, InValue);
+				return *this;
+			}
+
+			TElementRef& operator=(const TElementRef& InOther)
+			{
+				return *this = static_cast<float>(InOther);
+			}
+
+			TElementRef& operator+=(float InValue)
+			{
+				return *this = static_cast<float>(*this) + InValue;
+			}
+
+		private:
+			TArrayMultiDimQuantized& Owner;
+			IndexType LinearIndex;
+		};
+
+		template <typename... T>
+		TElementRef operator()(T... InElementCoordinate)
+		{
+			return TElementRef(*this, Encoded.GetLinearIndex(CoordinateType{InElementCoordinate...}));
+		}
+
+		template <typename... T>
+		float operator()(T... InElementCoordinate) const
+		{
+			return Get(Encoded.GetLinearIndex(CoordinateType{InElementCoordinate...}));
+		}
+
+		using DataInitializerFuncType = std::function<float(
+			const CoordinateType& /* InCoordinate */,
+			IndexType /* InLinearIdx */,
+			float /* InOldData */)>;
+
+		// Same as TArrayMultiDim::SetData(), with the decoded old value.
+		void SetData(const DataInitializerFuncType& InFunc)
+		{
+			Encoded.SetData([&](const CoordinateType& InCoordinate, IndexType InLinearIdx, StoredType& InOldData) -> StoredType
+			{
+				return Codec.Encode(InFunc(InCoordinate, InLinearIdx, Codec.Decode(InOldData)));
+			});
+		}
+
+		using ConstLoopCallbackType = std::function<void(
+			const CoordinateType& /* InCoordinate */,
+			IndexType /* InLinearIdx */,
+			IndexType /* InLoopCount */,
+			float /* InData */)>;
+
+		// Same as TArrayMultiDim::ConstLoopByCoord(), with the decoded values.
+		void ConstLoopByCoord(const ConstLoopCallbackType& InFunc) const
+		{
+			Encoded.ConstLoopByCoord([&](const CoordinateType& InCoordinate, IndexType InLinearIdx, IndexType InLoopCount, const StoredType& InData)
+			{
+				InFunc(InCoordinate, InLinearIdx, InLoopCount, Codec.Decode(InData));
+			});
+		}
+
+		/**
+		 * \brief Type definition for the callback of ForEachDecodedChunk().
+		 *
+		 * \param InStartIndex The linear storage index of the first value.
+		 * \param InValues The decoded values, only valid in the callback.
+		 * \param InCount The count of the values, at most DECODE_CHUNK_SIZE.
+		 */
+		using DecodedChunkFuncType = std::function<void(IndexType /* InStartIndex */, const float* /* InValues */, int32 /* InCount */)>;
+
+		/**
+		 * @brief Decodes the elements chunk by chunk in the linear storage order, the bulk read path for the kernels.
+		 *
+		 * Each chunk is decoded by the vectorizable DecodeRange() of the codec into a buffer on the stack.
+		 *
+		 * @param InFunc Called for each chunk.
+		 * @param bInParallel Whether the chunks are processed in parallel, [InFunc] must be thread-safe then.
+		 */
+		void ForEachDecodedChunk(const DecodedChunkFuncType& InFunc, bool bInParallel = false) const
+		{
+			const IndexType TotalSize = FMath::Max<IndexType>(Encoded.GetTotalSize(), 0);
+			const StoredType* Stored = Encoded.GetData();
+			const IndexType NumChunks = (TotalSize + DECODE_CHUNK_SIZE - 1) / DECODE_CHUNK_SIZE;
+			ParallelForIndex(NumChunks, [&](IndexType ChunkIndex)
+			{
+				float Buffer[DECODE_CHUNK_SIZE];
+				const IndexType Start = ChunkIndex * DECODE_CHUNK_SIZE;
+				const int32 Count = static_cast<int32>(FMath::Min<IndexType>(DECODE_CHUNK_SIZE, TotalSize - Start));
+				Codec.DecodeRange(Stored + Start, Buffer, Count);
+				InFunc(Start, Buffer, Count);
+			}, !bInParallel);
+		}
+#pragma endregion GetElements
+
+#pragma region Conversion
+		// Replaces the shape, the storage order and the data with a float array.
+		void Encode(const DecodedArrayType& InSource)
+		{
+			Encoded.SetDimSize(InSource.GetRuntimeEachDimSize(), InSource.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToInitialValue);
+			if (InSource.HasRingOrigin())
+			{
+				InSource.ConstLoopByCoord([&](const CoordinateType& InCoordinate, IndexType InLinearIdx, IndexType InLoopCount, const float& InData)
+				{
+					Encoded[Encoded.GetLinearIndex(InCoordinate)] = Codec.Encode(InData);
+				});
+				return;
+			}
+			Codec.EncodeRange(InSource.GetData(), Encoded.GetData(), static_cast<int32>(Encoded.GetTotalSize()));
+		}
+
+		// Decodes to a float array with the same shape and storage order.
+		DecodedArrayType Decode() const
+		{
+			DecodedArrayType Result;
+			Result.SetDimSize(GetRuntimeEachDimSize(), GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToUninitializedValue);
+			float* ResultData = Result.GetData();
+			if (Encoded.HasRingOrigin())
+			{
+				Encoded.ConstLoopByCoord([&](const CoordinateType& InCoordinate, IndexType InLinearIdx, IndexType InLoopCount, const StoredType& InData)
+				{
+					ResultData[Result.GetLinearIndex(InCoordinate)] = Codec.Decode(InData);
+				});
+				return Result;
+			}
+			ForEachDecodedChunk([ResultData](IndexType InStartIndex, const float* InValues, int32 InCount)
+			{
+				FMemory::Memcpy(ResultData + InStartIndex, InValues, InCount * sizeof(float));
+			}, true);
+			return Result;
+		}
+
+		// Slices the stored array, see TArrayMultiDim::Slice(). The result uses the same codec.
+		SelfDynamicSizeType Slice(std::initializer_list<FSlice> InSlices) const
+		{
+			SelfDynamicSizeType Result(Codec);
+			Result.GetEncoded() = Encoded.Slice(InSlices);
+			return Result;
+		}
+
+		// Decoded version of TArrayMultiDim::GetElementsByMask(), e.g. for the convolution kernels.
+		TArray<float> GetElementsByMask(const MaskType& InMask,
+										const CoordinateType& InApplyCoord,
+										const CoordinateType& InMaskCenter = CoordinateType{},
+										EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			const TArray<StoredType> StoredElements = Encoded.GetElementsByMask(InMask, InApplyCoord, InMaskCenter, InBorderMode);
+			TArray<float> Result;
+			Result.SetNumUninitialized(StoredElements.Num());
+			Codec.DecodeRange(StoredElements.GetData(), Result.GetData(), StoredElements.Num());
+			return Result;
+		}
+#pragma endregion Conversion
+
+#pragma region Reductions
+		/**
+		 * @brief Sum of the decoded values.
+		 *
+		 * The integer codecs sum the stored integers (exactly, in int64) and decode the sum once:
+		 * Sum = Scale * SumOfStored + Offset * Count. The half-float codec sums the decoded chunks in double.
+		 */
+		double Sum() const
+		{
+			const IndexType TotalSize = FMath::Max<IndexType>(Encoded.GetTotalSize(), 0);
+			if constexpr (std::is_integral_v<StoredType>)
+			{
+				const StoredType* Stored = Encoded.GetData();
+				const IndexType NumChunks = (TotalSize + REDUCE_CHUNK_SIZE - 1) / REDUCE_CHUNK_SIZE;
+				TArray<int64> PartialSums;
+				PartialSums.SetNumZeroed(static_cast<int32>(NumChunks));
+				ParallelForIndex(NumChunks, [&](IndexType ChunkIndex)
+				{
+					const IndexType Start = ChunkIndex * REDUCE_CHUNK_SIZE;
+					const IndexType End = FMath::Min<IndexType>(Start + REDUCE_CHUNK_SIZE, TotalSize);
+					int64 PartialSum = 0;
+					for (IndexType i = Start; i < End; ++i)
+					{
+						PartialSum += Stored[i];
+					}
+					PartialSums[ChunkIndex] = PartialSum;
+				});
+				int64 StoredSum = 0;
+				for (const int64 PartialSum : PartialSums)
+				{
+					StoredSum += PartialSum;
+				}
+				return static_cast<double>(Codec.Scale) * static_cast<double>(StoredSum) + static_cast<double>(Codec.Offset) * TotalSize;
+			}
+			else
+			{
+				const IndexType NumChunks = (TotalSize + DECODE_CHUNK_SIZE - 1) / DECODE_CHUNK_SIZE;
+				TArray<double> PartialSums;
+				PartialSums.SetNumZeroed(static_cast<int32>(NumChunks));
+				ForEachDecodedChunk([&](IndexType InStartIndex, const float* InValues, int32 InCount)
+				{
+					double PartialSum = 0.0;
+					for (int32 i = 0; i < InCount; ++i)
+					{
+						PartialSum += InValues[i];
+					}
+					PartialSums[static_cast<int32>(InStartIndex / DECODE_CHUNK_SIZE)] = PartialSum;
+				}, true);
+				double Total = 0.0;
+				for (const double PartialSum : PartialSums)
+				{
+					Total += PartialSum;
+				}
+				return Total;
+			}
+		}
+
+		// Mean of the decoded values, 0 for an empty array.
+		double Mean() const
+		{
+			const IndexType TotalSize = Encoded.GetTotalSize();
+			return TotalSize > 0 ? Sum() / static_cast<double>(TotalSize) : 0.0;
+		}
+
+		// Minimum of the decoded values. The integer codecs compare the stored integers (the decoding is monotonic).
+		float Min() const
+		{
+			return MinMax_Internal(true);
+		}
+
+		// Maximum of the decoded values.
+		float Max() const
+		{
+			return MinMax_Internal(false);
+		}
+#pragma endregion Reductions
+
+	protected:
+		// The element count of a chunk of the parallel integer reductions.
+		static constexpr IndexType REDUCE_CHUNK_SIZE = 16 * 1024;
+
+		float MinMax_Internal(bool bInMin) const
+		{
+			const IndexType TotalSize = FMath::Max<IndexType>(Encoded.GetTotalSize(), 0);
+			check(TotalSize > 0);
+			if constexpr (std::is_integral_v<StoredType>)
+			{
+				// A negative scale reverses the order of the stored values.
+				const bool bStoredMin = bInMin == (Codec.Scale > 0.f);
+				const StoredType* Stored = Encoded.GetData();
+				StoredType Extreme = Stored[0];
+				for (IndexType i = 1; i < TotalSize; ++i)
+				{
+					Extreme = bStoredMin ? FMath::Min(Extreme, Stored[i]) : FMath::Max(Extreme, Stored[i]);
+				}
+				return Codec.Decode(Extreme);
+			}
+			else
+			{
+				float Extreme = Get(0);
+				ForEachDecodedChunk([&](IndexType InStartIndex, const float* InValues, int32 InCount)
+				{
+					for (int32 i = 0; i < InCount; ++i)
+					{
+						Extreme = bInMin ? FMath::Min(Extreme, InValues[i]) : FMath::Max(Extreme, InValues[i]);
+					}
+				});
+				return Extreme;
+			}
+		}
+
+		CodecType Codec;
+		EncodedArrayType Encoded;
+	};
+}
@@ -0,0 +1,360 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+#include <atomic>
+
+namespace ArrayMultiDim
+{
+	/**
+	 * @brief Publishes immutable snapshots of an array written by one thread to any number of reader threads, without
+	 * locks: a simulation writes the array, the render and AI threads read the last published state.
+	 *
+	 * The writer owns a working array (GetWriteArray()) with the dirty tracking enabled. Publish() brings one of the
+	 * 2 or 3 snapshot buffers up to date and swaps the published index atomically (RCU-style). Only the blocks written
+	 * since the buffer was last published are copied forward, so a frame that touches a small region copies a small
+	 * region. A buffer is reused only when no reader holds it; with 3 buffers the writer always finds one unless two
+	 * readers pin two different old snapshots, with 2 buffers a reader holding the previous snapshot makes Publish()
+	 * fail. A failed publication keeps its dirty blocks for the next one.
+	 *
+	 * Readers call Acquire(): a counter increment and a re-check of the published index, no lock and no copy. The
+	 * snapshot stays immutable and alive as long as the handle does.
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Initial;
+	 *		Initial.SetDimSize({1024, 1024}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+	 *		ArrayMultiDim::TSnapshotPublisher<float, -1, -1> Heights(Initial);
+	 *		// Simulation thread.
+	 *		Heights.GetWriteArray()(10, 20) = 5.f;
+	 *		Heights.Publish();
+	 *		// Render thread.
+	 *		if (auto Snapshot = Heights.Acquire())
+	 *		{
+	 *			float Height = (*Snapshot)(10, 20);
+	 *		}
+	 * \endcode
+	 *
+	 * @tparam DataType The element type.
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename DataType, int... Dims>
+	class TSnapshotPublisher
+	{
+	public:
+		using ArrayType = TArrayMultiDim<DataType, Dims...>;
+		using IndexType = typename ArrayType::IndexType;
+		using ArrayDimType = typename ArrayType::ArrayDimType;
+		using CoordinateType = typename ArrayType::CoordinateType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static constexpr int32 MAX_BUFFERS = 3;
+
+		// A reader's reference to a published snapshot. Move-only, the snapshot is released with the handle.
+		class FReadHandle
+		{
+		public:
+			FReadHandle()
+			{
+			}
+
+			FReadHandle(FReadHandle&& InOther) noexcept
+				: Snapshot(InOther.Snapshot), Readers(InOther.Readers), Version(InOther.Version)
+			{
+				InOther.Snapshot = nullptr;
+				InOther.Readers = nullptr;
+			}
+
+			FReadHandle& operator=(FReadHandle&& InOther) noexcept
+			{
+				if (this != &InOther)
+				{
+					Release();
+					Snapshot = InOther.Snapshot;
+					Readers = InOther.Readers;
+					Version = InOther.Version;
+					InOther.Snapshot = nullptr;
+					InOther.Readers = nullptr;
+				}
+				return *this;
+			}
+
+			FReadHandle(const FReadHandle&) = delete;
+			FReadHandle& operator=(const FReadHandle&) = delete;
+
+			~FReadHandle()
+			{
+				Release();
+			}
+
+			bool IsValid() const { return Snapshot != nullptr; }
+			explicit operator bool() const { return IsValid(); }
+
+			const ArrayType& operator*() const { check(Snapshot); return *Snapshot; }
+			const ArrayType* operator->() const { check(Snapshot); return Snapshot; }
+
+			// The publication number of the snapshot, increasing from 1.
+			int64 GetVersion() const { return Version; }
+
+			// Releases the snapshot early.
+			void Release()
+			{
+				if (Readers)
+				{
+					Readers->fetch_sub(1);
+				}
+				Snapshot = nullptr;
+				Readers = nullptr;
+			}
+
+		private:
+			friend class TSnapshotPublisher;
+
+			const ArrayType* Snapshot = nullptr;
+			std::atomic<int32>* Readers = nullptr;
+			int64 Version = 0;
+		};
+
+		/**
+		 * @param InInitial The initial content of the working array, published by the first Publish().
+		 * @param InNumBuffers 2 (double buffering) or 3 (triple buffering) snapshot buffers.
+		 * @param InBlockSizeLog2 The dirty block size of the working array, see TArrayMultiDim::SetDirtyTracking().
+		 */
+		explicit TSnapshotPublisher(const ArrayType& InInitial, int32 InNumBuffers = 3, int InBlockSizeLog2 = 4)
+			: NumBuffers(InNumBuffers)
+		{
+			checkf(InNumBuffers >= 2 && InNumBuffers <= MAX_BUFFERS, TEXT("%d snapshot buffers, 2 or 3 are supported."), InNumBuffers);
+			WriteArray = InInitial;
+			WriteArray.SetDirtyTracking(true, InBlockSizeLog2);
+		}
+
+		TSnapshotPublisher(const TSnapshotPublisher&) = delete;
+		TSnapshotPublisher& operator=(const TSnapshotPublisher&) = delete;
+
+		/**
+		 * @brief The working array, for the writer thread only. Its dirty tracking must stay enabled: the writes through
+		 * a raw pointer call MarkDirtyRegion(), resizing it copies the whole array at the next publication.
+		 */
+		ArrayType& GetWriteArray() { return WriteArray; }
+
+		/**
+		 * @brief Copies the changes of the working array forward into a free snapshot buffer and publishes it.
+		 * Writer thread only.
+		 *
+		 * @return False if every other buffer is still held by a reader, the changes are then published next time.
+		 */
+		bool Publish()
+		{
+			CollectDirtyBlocks_Internal();
+
+			const int32 Published = PublishedBuffer.load();
+			int32 Target = INDEX_NONE;
+			for (int32 i = 1; i <= NumBuffers && Target == INDEX_NONE; ++i)
+			{
+				const int32 Candidate = (Published + i + NumBuffers) % NumBuffers;
+				if (Candidate != Published && Buffers[Candidate].Readers.load() == 0)
+				{
+					Target = Candidate;
+				}
+			}
+			if (Target == INDEX_NONE)
+			{
+				return false;
+			}
+
+			FSnapshotBuffer& Buffer = Buffers[Target];
+			if (Buffer.bNeedsFullCopy)
+			{
+				CopyFull_Internal(Buffer.Array);
+				Buffer.bNeedsFullCopy = false;
+			}
+			else
+			{
+				CopyBlocks_Internal(Buffer);
+			}
+			FMemory::Memzero(Buffer.PendingBlocks.GetData(), Buffer.PendingBlocks.Num() * sizeof(uint64));
+			Buffer.Version = PublishedVersion.load() + 1;
+			PublishedVersion.store(Buffer.Version);
+			PublishedBuffer.store(Target);
+			return true;
+		}
+
+		/**
+		 * @brief The last published snapshot, from any thread, lock-free. The handle is invalid before the first Publish().
+		 */
+		FReadHandle Acquire() const
+		{
+			FReadHandle Handle;
+			while (true)
+			{
+				const int32 Published = PublishedBuffer.load();
+				if (Published == INDEX_NONE)
+				{
+					return Handle;
+				}
+				FSnapshotBuffer& Buffer = Buffers[Published];
+				Buffer.Readers.fetch_add(1);
+				// The writer may have moved on and claimed the buffer before the increment was visible, only a buffer
+				// still published after the increment is safe to read.
+				if (PublishedBuffer.load() == Published)
+				{
+					Handle.Snapshot = &Buffer.Array;
+					Handle.Readers = &Buffer.Readers;
+					Handle.Version = Buffer.Version;
+					return Handle;
+				}
+				Buffer.Readers.fetch_sub(1);
+			}
+		}
+
+		// The number of the last publication, 0 before the first one.
+		int64 GetPublishedVersion() const { return PublishedVersion.load(); }
+
+	protected:
+		struct FSnapshotBuffer
+		{
+			ArrayType Array;
+			mutable std::atomic<int32> Readers{0};
+			// The dirty blocks published since this buffer was last brought up to date.
+			TArray<uint64> PendingBlocks;
+			bool bNeedsFullCopy = true;
+			int64 Version = 0;
+		};
+
+		// Moves the dirty blocks of the working array into the pending blocks of every buffer.
+		void CollectDirtyBlocks_Internal()
+		{
+			const ArrayDimType& Size = WriteArray.GetRuntimeEachDimSize();
+			const CoordinateType Order = WriteArray.GetRuntimeStorageOrder();
+			const int BlockSize = WriteArray.GetDirtyBlockSize();
+			IndexType NumBlocks = 1;
+			ArrayDimType GridSize;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				GridSize[Dim] = (Size[Dim] + BlockSize - 1) / BlockSize;
+				NumBlocks *= GridSize[Dim];
+			}
+			// A new shape or layout invalidates the snapshots, they are copied whole.
+			if (GridSize != BlockGridSize || Size != LayoutSize || Order != LayoutOrder)
+			{
+				BlockGridSize = GridSize;
+				LayoutSize = Size;
+				LayoutOrder = Order;
+				for (int32 i = 0; i < NumBuffers; ++i)
+				{
+					Buffers[i].bNeedsFullCopy = true;
+					Buffers[i].PendingBlocks.Reset();
+					Buffers[i].PendingBlocks.SetNumZeroed(static_cast<int32>((NumBlocks + 63) / 64));
+				}
+			}
+
+			WriteArray.ForEachDirtyBlock([&](const CoordinateType& InBlockMin, const CoordinateType& InBlockMax)
+			{
+				IndexType BlockIndex = 0;
+				for (int Dim = DIM_SIZE - 1, Stride = 1; Dim >= 0; Stride *= BlockGridSize[Dim], --Dim)
+				{
+					BlockIndex += InBlockMin[Dim] / BlockSize * Stride;
+				}
+				for (int32 i = 0; i < NumBuffers; ++i)
+				{
+					Buffers[i].PendingBlocks[static_cast<int32>(BlockIndex >> 6)] |= uint64(1) << (BlockIndex & 63);
+				}
+			});
+			WriteArray.ClearDirty();
+		}
+
+		void CopyFull_Internal(ArrayType& OutArray) const
+		{
+			OutArray.SetDimSize(LayoutSize, LayoutOrder, EResizeDataCopyPolicy::SetToUninitializedValue);
+			CoordinateType Min;
+			Min.fill(0);
+			CopyBox_Internal(OutArray, OutArray.GetData(), Min, LayoutSize);
+		}
+
+		// Copies the pending blocks of a buffer from the working array, the blocks in parallel.
+		void CopyBlocks_Internal(FSnapshotBuffer& InOutBuffer) const
+		{
+			TArray<IndexType> Blocks;
+			for (int32 WordIndex = 0; WordIndex < InOutBuffer.PendingBlocks.Num(); ++WordIndex)
+			{
+				for (uint64 Word = InOutBuffer.PendingBlocks[WordIndex]; Word != 0; Word &= Word - 1)
+				{
+					Blocks.Add(static_cast<IndexType>(WordIndex) * 64 + static_cast<IndexType>(FMath::CountTrailingZeros64(Word)));
+				}
+			}
+			const int BlockSize = WriteArray.GetDirtyBlockSize();
+			DataType* Target = InOutBuffer.Array.GetData();
+			ParallelFor(Blocks.Num(), [&](int32 i)
+			{
+				CoordinateType BlockMin;
+				CoordinateType BlockMax;
+				IndexType Rest = Blocks[i];
+				for (int Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+				{
+					BlockMin[Dim] = Rest % BlockGridSize[Dim] * BlockSize;
+					BlockMax[Dim] = FMath::Min<IndexType>(BlockMin[Dim] + BlockSize, LayoutSize[Dim]);
+					Rest /= BlockGridSize[Dim];
+				}
+				CopyBox_Internal(InOutBuffer.Array, Target, BlockMin, BlockMax);
+			}, Blocks.Num() < 4);
+		}
+
+		// Copies the box [InMin, InMax) of the working array into OutTarget, the buffer of InArray, row by row along the
+		// fastest storage dimension.
+		void CopyBox_Internal(const ArrayType& InArray, DataType* OutTarget, const CoordinateType& InMin, const CoordinateType& InMax) const
+		{
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (InMax[Dim] <= InMin[Dim])
+				{
+					return;
+				}
+			}
+			const int RowDim = LayoutOrder[0];
+			const IndexType RowLength = InMax[RowDim] - InMin[RowDim];
+			const bool bContiguousSource = !WriteArray.HasRingOrigin();
+			const DataType* Source = WriteArray.GetData();
+			CoordinateType Coord = InMin;
+			while (true)
+			{
+				DataType* TargetRow = OutTarget + InArray.GetLinearIndex(Coord);
+				if (bContiguousSource)
+				{
+					const DataType* SourceRow = Source + WriteArray.GetLinearIndex(Coord);
+					for (IndexType i = 0; i < RowLength; ++i)
+					{
+						TargetRow[i] = SourceRow[i];
+					}
+				}
+				else
+				{
+					CoordinateType ElementCoord = Coord;
+					for (IndexType i = 0; i < RowLength; ++i, ++ElementCoord[RowDim])
+					{
+						TargetRow[i] = Source[WriteArray.GetLinearIndex(ElementCoord)];
+					}
+				}
+				int i = 1;
+				for (; i < DIM_SIZE; ++i)
+				{
+					const int Dim = LayoutOrder[i];
+					if (++Coord[Dim] < InMax[Dim])
+					{
+						break;
+					}
+					Coord[Dim] = InMin[Dim];
+				}
+				if (i == DIM_SIZE)
+				{
+					return;
+				}
+			}
+		}
+
+		ArrayType WriteArray;
+		mutable FSnapshotBuffer Buffers[MAX_BUFFERS];
+		int32 NumBuffers = MAX_BUFFERS;
+		std::atomic<int32> PublishedBuffer{INDEX_NONE};
+		std::atomic<int64> PublishedVersion{0};
+		ArrayDimType BlockGridSize{};
+		ArrayDimType LayoutSize{};
+		CoordinateType LayoutOrder{};
+	};
+}
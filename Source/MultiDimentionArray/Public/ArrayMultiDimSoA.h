@@ -0,0 +1,374 @@
+#pragma once
+#include "ArrayMultiDim.h"
+#include <tuple>
+#include <utility>
+
+namespace ArrayMultiDim
+{
+	// Splits a pointer to data member into its class type and member type.
+	template <typename MemberPtrType>
+	struct TMemberPointerTraits;
+
+	template <typename InClassType, typename InMemberType>
+	struct TMemberPointerTraits<InMemberType InClassType::*>
+	{
+		using ClassType = InClassType;
+		using MemberType = InMemberType;
+	};
+
+	/**
+	 * @brief The member list of an aggregate element type stored by TArrayMultiDimSoA, one plane per member.
+	 *
+	 * \code
+	 *		struct FCell { float Density; float Temperature; FVector Velocity; };
+	 *		using FCellFields = ArrayMultiDim::TSoAFields<&FCell::Density, &FCell::Temperature, &FCell::Velocity>;
+	 * \endcode
+	 */
+	template <auto... MemberPtrs>
+	struct TSoAFields
+	{
+		static constexpr int NUM_FIELDS = sizeof...(MemberPtrs);
+		static_assert(NUM_FIELDS > 0, "At least one member is required.");
+
+		template <size_t Index>
+		static constexpr auto GetMemberPtr()
+		{
+			return std::get<Index>(std::make_tuple(MemberPtrs...));
+		}
+
+		// The index of the member in the list, -1 if it's not in the list.
+		template <auto MemberPtr>
+		static constexpr int IndexOf()
+		{
+			int Index = 0;
+			int Result = -1;
+			((Result = (Result < 0 && IsSameMember<MemberPtr, MemberPtrs>()) ? Index : Result, ++Index), ...);
+			return Result;
+		}
+
+	private:
+		template <auto A, auto B>
+		static constexpr bool IsSameMember()
+		{
+			if constexpr (std::is_same_v<decltype(A), decltype(B)>)
+			{
+				return A == B;
+			}
+			else
+			{
+				return false;
+			}
+		}
+	};
+
+	template <typename DataType, typename FieldList, int... Dims>
+	class TArrayMultiDimSoA;
+
+	/**
+	 * @brief Multi-dimension array of an aggregate type in the structure-of-arrays layout.
+	 *
+	 * Each member listed in [TSoAFields] is stored in its own TArrayMultiDim plane. All the planes share the shape
+	 * and the storage order, so a coordinate has the same linear index in every plane. A kernel that only reads one
+	 * member works on the contiguous plane of this member (GetField() / GetFieldView()) and doesn't drag the other
+	 * members through the cache.
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::TArrayMultiDimSoA<FCell, FCellFields, 64, 64, 64> Grid {ArrayMultiDim::Odr<0, 1, 2>()};
+	 *		Grid.SetDimSize({64, 64, 64}, ArrayMultiDim::EResizeDataCopyPolicy::SetToInitialValue);
+	 *		Grid(1, 2, 3) = FCell{1.f, 300.f, FVector::ZeroVector};  // Scattered to the 3 planes.
+	 *		FCell Cell = Grid(1, 2, 3);                              // Gathered from the 3 planes.
+	 *
+	 *		// Single member kernel, vectorizable.
+	 *		TArrayView<float> Density = Grid.GetFieldView<&FCell::Density>();
+	 *		for (float& Value : Density) { Value *= 0.5f; }
+	 * \endcode
+	 *
+	 * @tparam DataType The aggregate element type, it must be default constructible.
+	 * @tparam FieldList TSoAFields that lists the stored members of [DataType].
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename DataType, auto... MemberPtrs, int... Dims>
+	class TArrayMultiDimSoA<DataType, TSoAFields<MemberPtrs...>, Dims...>
+	{
+	public:
+		using FieldListType = TSoAFields<MemberPtrs...>;
+		static constexpr int NUM_FIELDS = FieldListType::NUM_FIELDS;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static constexpr int DYNAMIC_SIZE = -1;
+
+		template <auto MemberPtr>
+		using FieldType = typename TMemberPointerTraits<decltype(MemberPtr)>::MemberType;
+		template <auto MemberPtr>
+		using FieldArrayType = TArrayMultiDim<FieldType<MemberPtr>, Dims...>;
+		using PlaneTupleType = std::tuple<FieldArrayType<MemberPtrs>...>;
+		using FirstPlaneType = std::tuple_element_t<0, PlaneTupleType>;
+
+		using IndexType = typename FirstPlaneType::IndexType;
+		using ArrayDimType = typename FirstPlaneType::ArrayDimType;
+		using CoordinateType = typename FirstPlaneType::CoordinateType;
+		using AoSType = TArrayMultiDim<DataType, Dims...>;
+		using SelfDynamicSizeType = TArrayMultiDimSoA<DataType, FieldListType, (static_cast<void>(Dims), DYNAMIC_SIZE)...>;
+
+		static_assert((std::is_same_v<typename TMemberPointerTraits<decltype(MemberPtrs)>::ClassType, DataType> && ...),
+					  "All the members must belong to the element type.");
+
+		TArrayMultiDimSoA()
+		{
+		}
+
+		template <int... OrderList>
+		explicit TArrayMultiDimSoA(Odr<OrderList...> InOrder)
+			: Planes(FieldArrayType<MemberPtrs>(InOrder)...)
+		{
+		}
+
+		// Converts an array of structs.
+		explicit TArrayMultiDimSoA(const AoSType& InSource)
+		{
+			FromAoS(InSource);
+		}
+
+#pragma region Shape
+		void SetDimSize(const ArrayDimType& InSize,
+						const CoordinateType& InNewOrder,
+						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			ForEachPlane([&](auto& InPlane, auto InMemberPtr)
+			{
+				InPlane.SetDimSize(InSize, InNewOrder, InCopyPolicy);
+			});
+		}
+
+		void SetDimSize(const ArrayDimType& InSize,
+						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			SetDimSize(InSize, GetRuntimeStorageOrder(), InCopyPolicy);
+		}
+
+		template <int... OrderList>
+		void SetDimSize(const ArrayDimType& InSize, Odr<OrderList...>,
+						EResizeDataCopyPolicy InCopyPolicy = EResizeDataCopyPolicy::CoordinationCopy)
+		{
+			SetDimSize(InSize, {OrderList...}, InCopyPolicy);
+		}
+
+		IndexType GetTotalSize() const { return std::get<0>(Planes).GetTotalSize(); }
+		const ArrayDimType& GetRuntimeEachDimSize() const { return std::get<0>(Planes).GetRuntimeEachDimSize(); }
+		CoordinateType GetRuntimeStorageOrder() const { return std::get<0>(Planes).GetRuntimeStorageOrder(); }
+		const CoordinateType& GetRuntimeStride() const { return std::get<0>(Planes).GetRuntimeStride(); }
+		IndexType GetLinearIndex(const CoordinateType& InCoordinate) const { return std::get<0>(Planes).GetLinearIndex(InCoordinate); }
+#pragma endregion Shape
+
+#pragma region FieldViews
+		/**
+		 * @brief The plane of a member, a normal TArrayMultiDim with the shape and the storage order of this array.
+		 *
+		 * All the TArrayMultiDim APIs (loops, slicing, scans, ...) work on the plane. Don't resize a plane alone, use
+		 * SetDimSize() of this array to keep the planes consistent.
+		 */
+		template <auto MemberPtr>
+		FieldArrayType<MemberPtr>& GetField()
+		{
+			return std::get<GetFieldIndex<MemberPtr>()>(Planes);
+		}
+
+		template <auto MemberPtr>
+		const FieldArrayType<MemberPtr>& GetField() const
+		{
+			return std::get<GetFieldIndex<MemberPtr>()>(Planes);
+		}
+
+		// The contiguous storage of a member plane, in the linear storage order of this array.
+		template <auto MemberPtr>
+		TArrayView<FieldType<MemberPtr>> GetFieldView()
+		{
+			FieldArrayType<MemberPtr>& Plane = GetField<MemberPtr>();
+			return TArrayView<FieldType<MemberPtr>>(Plane.GetData(), Plane.GetTotalSize());
+		}
+
+		template <auto MemberPtr>
+		TArrayView<const FieldType<MemberPtr>> GetFieldView() const
+		{
+			const FieldArrayType<MemberPtr>& Plane = GetField<MemberPtr>();
+			return TArrayView<const FieldType<MemberPtr>>(Plane.GetData(), Plane.GetTotalSize());
+		}
+#pragma endregion FieldViews
+
+#pragma region GetElements
+		// Gathers the element at a linear storage index from all the planes.
+		DataType GetElementAt(IndexType InLinearIndex) const
+		{
+			DataType Result{};
+			ForEachPlane([&](const auto& InPlane, auto InMemberPtr)
+			{
+				Result.*InMemberPtr() = InPlane[InLinearIndex];
+			});
+			return Result;
+		}
+
+		// Scatters the element to all the planes at a linear storage index.
+		void SetElementAt(IndexType InLinearIndex, const DataType& InValue)
+		{
+			ForEachPlane([&](auto& InPlane, auto InMemberPtr)
+			{
+				InPlane[InLinearIndex] = InValue.*InMemberPtr();
+			});
+		}
+
+		// Proxy of an element returned by the non-const operator(), reads gather and writes scatter.
+		class TElementRef
+		{
+		public:
+			TElementRef(TArrayMultiDimSoA& InOwner, IndexType InLinearIndex)
+				: Owner(InOwner), LinearIndex(InLinearIndex)
+			{
+			}
+
+			operator DataType() const { return Owner.GetElementAt(LinearIndex); }
+
+			TElementRef& operator=(const DataType& InValue)
+			{
+				Owner.SetElementAt(LinearIndex, InValue);
+				return *this;
+			}
+
+			TElementRef& operator=(const TElementRef& InOther)
+			{
+				return *this = static_cast<DataType>(InOther);
+			}
+
+		private:
+			TArrayMultiDimSoA& Owner;
+			IndexType LinearIndex;
+		};
+
+		template <typename... T>
+		TElementRef operator()(T... InElementCoordinate)
+		{
+			return TElementRef(*this, GetLinearIndex(CoordinateType{InElementCoordinate...}));
+		}
+
+		template <typename... T>
+		DataType operator()(T... InElementCoordinate) const
+		{
+			return GetElementAt(GetLinearIndex(CoordinateType{InElementCoordinate...}));
+		}
+
+		using DataInitializerFuncType = std::function<DataType(
+			const CoordinateType& /* InCoordinate */,
+			IndexType /* InLinearIdx */,
+			DataType& /* InOldData */)>;
+
+		// Same as TArrayMultiDim::SetData(), the elements are gathered, passed to [InFunc] and scattered back.
+		void SetData(const DataInitializerFuncType& InFunc)
+		{
+			const IndexType TotalSize = GetTotalSize();
+			const FirstPlaneType& FirstPlane = std::get<0>(Planes);
+			for (IndexType i = 0; i < TotalSize; ++i)
+			{
+				DataType OldData = GetElementAt(i);
+				SetElementAt(i, InFunc(FirstPlane.GetCoordinate(i), i, OldData));
+			}
+		}
+
+		using ConstLoopCallbackType = std::function<void(
+			const CoordinateType& /* InCoordinate */,
+			IndexType /* InLinearIdx */,
+			IndexType /* InLoopCount */,
+			const DataType& /* InData */)>;
+
+		// Same as TArrayMultiDim::ConstLoopByCoord(), each element is gathered from all the planes.
+		void ConstLoopByCoord(const ConstLoopCallbackType& InFunc) const
+		{
+			FirstPlaneType::DoNestedLoops(GetRuntimeEachDimSize(), [&](const CoordinateType& InLoopIndex, const IndexType& InLoopCounter)
+			{
+				const IndexType LinearIndex = GetLinearIndex(InLoopIndex);
+				InFunc(InLoopIndex, LinearIndex, InLoopCounter, GetElementAt(LinearIndex));
+			});
+		}
+#pragma endregion GetElements
+
+#pragma region Conversion
+		// Slices every plane, see TArrayMultiDim::Slice().
+		SelfDynamicSizeType Slice(std::initializer_list<FSlice> InSlices) const
+		{
+			SelfDynamicSizeType Result;
+			ForEachPlane([&](const auto& InPlane, auto InMemberPtr)
+			{
+				Result.template GetField<decltype(InMemberPtr)::value>() = InPlane.Slice(InSlices);
+			});
+			return Result;
+		}
+
+		// Converts to an array of structs with the same shape and storage order.
+		AoSType ToAoS() const
+		{
+			AoSType Result;
+			Result.SetDimSize(GetRuntimeEachDimSize(), GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToInitialValue);
+			const IndexType TotalSize = GetTotalSize();
+			for (IndexType i = 0; i < TotalSize; ++i)
+			{
+				Result[i] = GetElementAt(i);
+			}
+			return Result;
+		}
+
+		// Replaces the shape, the storage order and the data with an array of structs.
+		void FromAoS(const AoSType& InSource)
+		{
+			SetDimSize(InSource.GetRuntimeEachDimSize(), InSource.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToInitialValue);
+			ForEachPlane([&](auto& InPlane, auto InMemberPtr)
+			{
+				// One plane at a time, so each pass writes a single contiguous plane.
+				auto* PlaneData = InPlane.GetData();
+				if (InSource.HasRingOrigin())
+				{
+					// The scrolled source doesn't store its elements in the linear order of the plane, copy by coordinate.
+					InSource.ConstLoopByCoord([&](const CoordinateType& InCoordinate, IndexType InLinearIdx, IndexType InLoopCount, const DataType& InData)
+					{
+						PlaneData[InPlane.GetLinearIndex(InCoordinate)] = InData.*InMemberPtr();
+					});
+					return;
+				}
+				const IndexType TotalSize = InSource.GetTotalSize();
+				for (IndexType i = 0; i < TotalSize; ++i)
+				{
+					PlaneData[i] = InSource[i].*InMemberPtr();
+				}
+			});
+		}
+#pragma endregion Conversion
+
+	private:
+		template <auto MemberPtr>
+		static constexpr size_t GetFieldIndex()
+		{
+			constexpr int Index = FieldListType::template IndexOf<MemberPtr>();
+			static_assert(Index >= 0, "The member is not in the field list.");
+			return static_cast<size_t>(Index);
+		}
+
+		// Calls [InFunc](Plane, std::integral_constant<MemberPtr>) for each member, InMemberPtr() is the member pointer.
+		template <typename FuncType>
+		void ForEachPlane(FuncType&& InFunc)
+		{
+			ForEachPlane_Internal(Planes, InFunc, std::make_index_sequence<NUM_FIELDS>());
+		}
+
+		template <typename FuncType>
+		void ForEachPlane(FuncType&& InFunc) const
+		{
+			ForEachPlane_Internal(Planes, InFunc, std::make_index_sequence<NUM_FIELDS>());
+		}
+
+		template <typename TupleType, typename FuncType, size_t... Indexes>
+		static void ForEachPlane_Internal(TupleType& InPlanes, FuncType& InFunc, std::index_sequence<Indexes...>)
+		{
+			(InFunc(std::get<Indexes>(InPlanes), std::integral_constant<decltype(FieldListType::template GetMemberPtr<Indexes>()),
+																	   FieldListType::template GetMemberPtr<Indexes>()>()), ...);
+		}
+
+		PlaneTupleType Planes;
+	};
+}
@@ -0,0 +1,605 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+
+namespace ArrayMultiDim
+{
+	/**
+	 * @brief Sparse multi-dimension array: a hashed map of small dense bricks, everything else is the background value.
+	 *
+	 * For the grids that are mostly one value (occupancy, SDF narrow bands, sparse simulation fields). The array is
+	 * split into bricks of 2^BRICK_SIZE_LOG2 elements per edge; only the bricks that hold at least one active element
+	 * are allocated, so the memory is proportional to the active content, not to GetTotalSize().
+	 * Each brick keeps its values (the inactive ones hold the background value) and a bit mask of the active elements.
+	 *
+	 * The interface follows TArrayMultiDim: operator() / Get() / Set(), Slice(), GetElementsByMask(), plus the
+	 * iteration over the active elements only and the dense <-> sparse conversions.
+	 * The const accesses never allocate; a non-const operator() activates the element (and allocates its brick).
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::TArrayMultiDimSparse<float, -1, -1, -1> Sdf(1.f);  // Background: far outside.
+	 *		Sdf.SetDimSize({4096, 4096, 512});
+	 *		Sdf(10, 20, 30) = -0.5f;                 // Activates the element.
+	 *		float Far = Sdf.Get(0, 0, 0);            // 1.f, nothing allocated.
+	 *		Sdf.ConstForEachActive([](const auto& InCoord, const float& InValue) { ... });
+	 * \endcode
+	 *
+	 * @tparam DataType The element type, needs operator== for FromDense() and Prune().
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename DataType, int... Dims>
+	class TArrayMultiDimSparse
+	{
+	public:
+		using DenseArrayType = TArrayMultiDim<DataType, Dims...>;
+		using IndexType = typename DenseArrayType::IndexType;
+		using ArrayDimType = typename DenseArrayType::ArrayDimType;
+		using CoordinateType = typename DenseArrayType::CoordinateType;
+		using MaskType = typename DenseArrayType::MaskType;
+		using SelfDynamicSizeType = typename DenseArrayType::SelfDynamicSizeType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static constexpr int DYNAMIC_SIZE = -1;
+
+		// 8^3 = 512 elements per brick in 3D, smaller edges for the higher dimensions.
+		static constexpr int BRICK_SIZE_LOG2 = DIM_SIZE <= 3 ? 3 : (DIM_SIZE <= 5 ? 2 : 1);
+		static constexpr int32 BRICK_ELEMENT_COUNT = 1 << (BRICK_SIZE_LOG2 * DIM_SIZE);
+		static constexpr int32 BRICK_MASK_WORD_COUNT = (BRICK_ELEMENT_COUNT + 63) / 64;
+
+		using ActiveCallbackType = std::function<void(const CoordinateType& InCoordinate, DataType& InOutValue)>;
+		using ConstActiveCallbackType = std::function<void(const CoordinateType& InCoordinate, const DataType& InValue)>;
+
+		explicit TArrayMultiDimSparse(const DataType& InBackgroundValue = DataType())
+			: BackgroundValue(InBackgroundValue)
+		{
+			if constexpr (((Dims != DYNAMIC_SIZE) && ...))
+			{
+				SetDimSize(ArrayDimType{Dims...});
+			}
+		}
+
+#pragma region Shape
+
+		// Sets the shape, all the elements become inactive.
+		void SetDimSize(const ArrayDimType& InSize)
+		{
+			constexpr std::array<int, DIM_SIZE> CompileTimeEachDimSize = {Dims...};
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (CompileTimeEachDimSize[Dim] != DYNAMIC_SIZE && InSize[Dim] != CompileTimeEachDimSize[Dim])
+				{
+					UE_LOG(LogTemp, Error, TEXT("%hs: Dimension %d is fixed to %d, cannot be set to %d."),
+						   __FUNCTION__, Dim, CompileTimeEachDimSize[Dim], static_cast<int32>(InSize[Dim]));
+					return;
+				}
+			}
+
+			EachDimSize = InSize;
+			int64 Stride = 1;
+			for (int Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+			{
+				BrickGridSize[Dim] = (FMath::Max<IndexType>(InSize[Dim], 0) + BRICK_EDGE_MASK) >> BRICK_SIZE_LOG2;
+				BrickGridStride[Dim] = Stride;
+				Stride *= BrickGridSize[Dim];
+			}
+			Empty();
+		}
+
+		const ArrayDimType& GetRuntimeEachDimSize() const { return EachDimSize; }
+
+		int64 GetTotalSize() const
+		{
+			int64 TotalSize = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				TotalSize *= EachDimSize[Dim];
+			}
+			return TotalSize;
+		}
+
+		const DataType& GetBackgroundValue() const { return BackgroundValue; }
+
+		// Deactivates all the elements and frees the bricks, the shape is kept.
+		void Empty()
+		{
+			Bricks.Empty();
+			BrickMap.Empty();
+			NumActive = 0;
+			WriteCursor = FBrickCursor();
+		}
+
+		int64 GetActiveCount() const { return NumActive; }
+		int32 GetBrickCount() const { return Bricks.Num(); }
+
+		// The memory held by the bricks and the brick map, in bytes.
+		int64 GetAllocatedSize() const
+		{
+			return static_cast<int64>(Bricks.Num()) * sizeof(FBrick) + static_cast<int64>(BrickMap.Num()) * (sizeof(int64) + sizeof(int32));
+		}
+
+#pragma endregion Shape
+
+#pragma region Access
+
+		// Write access, activates the element. The reference is valid until another brick is allocated.
+		DataType& operator()(const CoordinateType& InCoordinate)
+		{
+			int32 LocalIndex;
+			FBrick& Brick = FindOrAddBrick(InCoordinate, LocalIndex);
+			uint64& Word = Brick.ActiveBits[LocalIndex >> 6];
+			const uint64 Bit = uint64(1) << (LocalIndex & 63);
+			if (!(Word & Bit))
+			{
+				Word |= Bit;
+				++Brick.NumActive;
+				++NumActive;
+			}
+			return Brick.Values[LocalIndex];
+		}
+
+		template <typename... T>
+		DataType& operator()(T... InElementCoordinate)
+		{
+			return (*this)(CoordinateType{static_cast<IndexType>(InElementCoordinate)...});
+		}
+
+		// Read access, the background value for the inactive elements. Never allocates, safe to call from many threads.
+		const DataType& Get(const CoordinateType& InCoordinate) const
+		{
+			FBrickCursor Cursor;
+			return Get_Internal(InCoordinate, Cursor);
+		}
+
+		template <typename... T>
+		const DataType& Get(T... InElementCoordinate) const
+		{
+			return Get(CoordinateType{static_cast<IndexType>(InElementCoordinate)...});
+		}
+
+		template <typename... T>
+		const DataType& operator()(T... InElementCoordinate) const
+		{
+			return Get(CoordinateType{static_cast<IndexType>(InElementCoordinate)...});
+		}
+
+		void Set(const CoordinateType& InCoordinate, const DataType& InValue)
+		{
+			(*this)(InCoordinate) = InValue;
+		}
+
+		bool IsActive(const CoordinateType& InCoordinate) const
+		{
+			int32 LocalIndex;
+			FBrickCursor Cursor;
+			const int32 BrickIndex = FindBrick(InCoordinate, LocalIndex, Cursor);
+			return BrickIndex != INDEX_NONE && (Bricks[BrickIndex].ActiveBits[LocalIndex >> 6] & (uint64(1) << (LocalIndex & 63))) != 0;
+		}
+
+		// Resets the element to the background value. The empty bricks are kept until Prune().
+		void Deactivate(const CoordinateType& InCoordinate)
+		{
+			int32 LocalIndex;
+			const int32 BrickIndex = FindBrick(InCoordinate, LocalIndex, WriteCursor);
+			if (BrickIndex == INDEX_NONE)
+			{
+				return;
+			}
+			FBrick& Brick = Bricks[BrickIndex];
+			uint64& Word = Brick.ActiveBits[LocalIndex >> 6];
+			const uint64 Bit = uint64(1) << (LocalIndex & 63);
+			if (Word & Bit)
+			{
+				Word &= ~Bit;
+				--Brick.NumActive;
+				--NumActive;
+			}
+			Brick.Values[LocalIndex] = BackgroundValue;
+		}
+
+		/**
+		 * Deactivates the active elements equal to the background value and frees the empty bricks.
+		 * \return The number of freed bricks.
+		 */
+		int32 Prune()
+		{
+			int32 NumFreed = 0;
+			for (int32 BrickIndex = Bricks.Num() - 1; BrickIndex >= 0; --BrickIndex)
+			{
+				FBrick& Brick = Bricks[BrickIndex];
+				ForEachActiveBit(Brick, [&](int32 InLocalIndex)
+				{
+					if (Brick.Values[InLocalIndex] == BackgroundValue)
+					{
+						Brick.ActiveBits[InLocalIndex >> 6] &= ~(uint64(1) << (InLocalIndex & 63));
+						--Brick.NumActive;
+						--NumActive;
+					}
+				});
+				if (Brick.NumActive == 0)
+				{
+					RemoveBrick(BrickIndex);
+					++NumFreed;
+				}
+			}
+			return NumFreed;
+		}
+
+#pragma endregion Access
+
+#pragma region ActiveIteration
+
+		/**
+		 * Visits the active elements only, brick by brick. The cost is proportional to the number of allocated bricks,
+		 * not to the total size. The bricks are visited in parallel when bInParallel is true.
+		 */
+		void ConstForEachActive(const ConstActiveCallbackType& InFunc, bool bInParallel = false) const
+		{
+			ParallelFor(Bricks.Num(), [&](int32 BrickIndex)
+			{
+				const FBrick& Brick = Bricks[BrickIndex];
+				ForEachActiveBit(Brick, [&](int32 InLocalIndex)
+				{
+					InFunc(LocalIndexToCoordinate(Brick.Origin, InLocalIndex), Brick.Values[InLocalIndex]);
+				});
+			}, !bInParallel);
+		}
+
+		void ForEachActive(const ActiveCallbackType& InFunc, bool bInParallel = false)
+		{
+			ParallelFor(Bricks.Num(), [&](int32 BrickIndex)
+			{
+				FBrick& Brick = Bricks[BrickIndex];
+				ForEachActiveBit(Brick, [&](int32 InLocalIndex)
+				{
+					InFunc(LocalIndexToCoordinate(Brick.Origin, InLocalIndex), Brick.Values[InLocalIndex]);
+				});
+			}, !bInParallel);
+		}
+
+#pragma endregion ActiveIteration
+
+#pragma region DenseConversion
+
+		/**
+		 * Rebuilds the sparse array from a dense one, the elements not equal to the background value become active.
+		 * Two parallel passes over the bricks: count the active elements, then fill the allocated bricks.
+		 */
+		void FromDense(const DenseArrayType& InSource)
+		{
+			SetDimSize(InSource.GetRuntimeEachDimSize());
+			const int64 NumGridBricks = GetGridBrickCount();
+			checkf(NumGridBricks <= TNumericLimits<int32>::Max(), TEXT("Too many bricks for a dense conversion."));
+
+			// 1. Find the bricks with active elements.
+			TArray<uint8> GridBrickActive;
+			GridBrickActive.SetNumZeroed(static_cast<int32>(NumGridBricks));
+			ParallelFor(static_cast<int32>(NumGridBricks), [&](int32 GridBrickIndex)
+			{
+				bool bAnyActive = false;
+				ForEachBrickElement(GridIndexToOrigin(GridBrickIndex), [&](const CoordinateType& InCoordinate, int32 InLocalIndex)
+				{
+					bAnyActive = bAnyActive || !(InSource[InSource.GetLinearIndex(InCoordinate)] == BackgroundValue);
+				});
+				GridBrickActive[GridBrickIndex] = bAnyActive;
+			});
+
+			// 2. Allocate them.
+			for (int32 GridBrickIndex = 0; GridBrickIndex < NumGridBricks; ++GridBrickIndex)
+			{
+				if (GridBrickActive[GridBrickIndex])
+				{
+					AddBrick(GridIndexToOrigin(GridBrickIndex), GridBrickIndex);
+				}
+			}
+
+			// 3. Fill them.
+			TArray<int32> BrickActiveCounts;
+			BrickActiveCounts.SetNumZeroed(Bricks.Num());
+			ParallelFor(Bricks.Num(), [&](int32 BrickIndex)
+			{
+				FBrick& Brick = Bricks[BrickIndex];
+				ForEachBrickElement(Brick.Origin, [&](const CoordinateType& InCoordinate, int32 InLocalIndex)
+				{
+					const DataType& Value = InSource[InSource.GetLinearIndex(InCoordinate)];
+					if (!(Value == BackgroundValue))
+					{
+						Brick.Values[InLocalIndex] = Value;
+						Brick.ActiveBits[InLocalIndex >> 6] |= uint64(1) << (InLocalIndex & 63);
+						++Brick.NumActive;
+					}
+				});
+				BrickActiveCounts[BrickIndex] = Brick.NumActive;
+			});
+			for (int32 Count : BrickActiveCounts)
+			{
+				NumActive += Count;
+			}
+		}
+
+		// A dense array of the same shape, filled with the background value and the active elements.
+		DenseArrayType ToDense() const
+		{
+			DenseArrayType Result;
+			Result.SetDimSize(EachDimSize, EResizeDataCopyPolicy::SetToUninitializedValue);
+			DataType* ResultData = Result.GetData();
+			ParallelForIndex(Result.GetTotalSize(), [&](IndexType i)
+			{
+				ResultData[i] = BackgroundValue;
+			});
+			ParallelFor(Bricks.Num(), [&](int32 BrickIndex)
+			{
+				const FBrick& Brick = Bricks[BrickIndex];
+				ForEachActiveBit(Brick, [&](int32 InLocalIndex)
+				{
+					ResultData[Result.GetLinearIndex(LocalIndexToCoordinate(Brick.Origin, InLocalIndex))] = Brick.Values[InLocalIndex];
+				});
+			});
+			return Result;
+		}
+
+		// Slices into a dense array, same semantics as TArrayMultiDim::Slice().
+		SelfDynamicSizeType Slice(std::initializer_list<FSlice> InSlices) const
+		{
+			check(static_cast<int>(InSlices.size()) == DIM_SIZE);
+			ArrayDimType NewDimensions;
+			CoordinateType SliceStart;
+			int Dim = 0;
+			for (const FSlice& SliceObj : InSlices)
+			{
+				if (SliceObj.IsSingle())
+				{
+					SliceStart[Dim] = SliceObj.GetSingle();
+					NewDimensions[Dim] = 1;
+				}
+				else if (SliceObj.IsRanged())
+				{
+					SliceStart[Dim] = SliceObj.GetRangeStart();
+					NewDimensions[Dim] = SliceObj.GetRangeEnd() - SliceObj.GetRangeStart();
+				}
+				else
+				{
+					SliceStart[Dim] = 0;
+					NewDimensions[Dim] = EachDimSize[Dim];
+				}
+				++Dim;
+			}
+
+			SelfDynamicSizeType Result;
+			Result.SetDimSize(NewDimensions, EResizeDataCopyPolicy::SetToUninitializedValue);
+			FBrickCursor Cursor;
+			DenseArrayType::DoNestedLoops(NewDimensions, [&](const CoordinateType& InLocalCoord, const IndexType& InLoopCounter)
+			{
+				CoordinateType SourceCoord;
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					SourceCoord[i] = SliceStart[i] + InLocalCoord[i];
+				}
+				Result[InLoopCounter] = Get_Internal(SourceCoord, Cursor);
+			});
+			return Result;
+		}
+
+#pragma endregion DenseConversion
+
+#pragma region MaskDataGetter
+
+		/**
+		 * Same as TArrayMultiDim::GetElementsByMask(). The inactive elements return the background value, and so do
+		 * the out of range elements with EBorderMode::ConstantBorder.
+		 */
+		TArray<DataType> GetElementsByMask(const MaskType& InMask,
+										   const CoordinateType& InApplyCoord,
+										   const CoordinateType& InMaskCenter = CoordinateType{},
+										   EBorderMode InBorderMode = EBorderMode::NoPadding) const
+		{
+			TArray<DataType> Result;
+			Result.Reserve(InMask.GetTotalSize());
+			FBrickCursor Cursor;
+			InMask.ConstLoopByCoord([&](const typename MaskType::CoordinateType& MaskCoord,
+										typename MaskType::IndexType MaskLinearIdx,
+										typename MaskType::IndexType MaskLoopCount,
+										const std::variant<bool, int>& MaskValue)
+			{
+				const bool bEnabledData = std::visit([](auto InMaskValue) -> bool { return static_cast<bool>(InMaskValue); }, MaskValue);
+				if (!bEnabledData)
+				{
+					return;
+				}
+
+				CoordinateType OriginalCoord;
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					OriginalCoord[i] = InApplyCoord[i] + MaskCoord[i] - InMaskCenter[i];
+				}
+				if (DenseArrayType::ResolveBorderCoordinate(OriginalCoord, EachDimSize, InBorderMode))
+				{
+					Result.Add(Get_Internal(OriginalCoord, Cursor));
+				}
+				else if (InBorderMode == EBorderMode::ConstantBorder)
+				{
+					Result.Add(BackgroundValue);
+				}
+			});
+			return Result;
+		}
+
+#pragma endregion MaskDataGetter
+
+	private:
+		static constexpr IndexType BRICK_EDGE_MASK = (1 << BRICK_SIZE_LOG2) - 1;
+
+		struct FBrick
+		{
+			// The coordinate of the first element of the brick.
+			CoordinateType Origin;
+			int32 NumActive = 0;
+			uint64 ActiveBits[BRICK_MASK_WORD_COUNT] = {};
+			DataType Values[BRICK_ELEMENT_COUNT];
+		};
+
+		FORCEINLINE int64 GetBrickKey(const CoordinateType& InCoordinate, int32& OutLocalIndex) const
+		{
+			int64 Key = 0;
+			OutLocalIndex = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				checkSlow(InCoordinate[Dim] >= 0 && InCoordinate[Dim] < EachDimSize[Dim]);
+				Key += static_cast<int64>(InCoordinate[Dim] >> BRICK_SIZE_LOG2) * BrickGridStride[Dim];
+				OutLocalIndex = (OutLocalIndex << BRICK_SIZE_LOG2) | static_cast<int32>(InCoordinate[Dim] & BRICK_EDGE_MASK);
+			}
+			return Key;
+		}
+
+		// The last found brick, the neighbouring accesses skip the hash lookup. The bulk reads keep one on the stack.
+		struct FBrickCursor
+		{
+			int64 Key = INDEX_NONE;
+			int32 Index = INDEX_NONE;
+		};
+
+		FORCEINLINE int32 FindBrick(const CoordinateType& InCoordinate, int32& OutLocalIndex, FBrickCursor& InOutCursor) const
+		{
+			const int64 Key = GetBrickKey(InCoordinate, OutLocalIndex);
+			if (Key != InOutCursor.Key)
+			{
+				const int32* BrickIndex = BrickMap.Find(Key);
+				if (!BrickIndex)
+				{
+					return INDEX_NONE;
+				}
+				InOutCursor.Key = Key;
+				InOutCursor.Index = *BrickIndex;
+			}
+			return InOutCursor.Index;
+		}
+
+		FORCEINLINE const DataType& Get_Internal(const CoordinateType& InCoordinate, FBrickCursor& InOutCursor) const
+		{
+			int32 LocalIndex;
+			const int32 BrickIndex = FindBrick(InCoordinate, LocalIndex, InOutCursor);
+			return BrickIndex != INDEX_NONE ? Bricks[BrickIndex].Values[LocalIndex] : BackgroundValue;
+		}
+
+		FBrick& FindOrAddBrick(const CoordinateType& InCoordinate, int32& OutLocalIndex)
+		{
+			const int32 BrickIndex = FindBrick(InCoordinate, OutLocalIndex, WriteCursor);
+			if (BrickIndex != INDEX_NONE)
+			{
+				return Bricks[BrickIndex];
+			}
+			CoordinateType Origin;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Origin[Dim] = InCoordinate[Dim] & ~BRICK_EDGE_MASK;
+			}
+			int32 Unused;
+			return Bricks[AddBrick(Origin, GetBrickKey(Origin, Unused))];
+		}
+
+		int32 AddBrick(const CoordinateType& InOrigin, int64 InKey)
+		{
+			const int32 BrickIndex = Bricks.AddDefaulted();
+			FBrick& Brick = Bricks[BrickIndex];
+			Brick.Origin = InOrigin;
+			for (DataType& Value : Brick.Values)
+			{
+				Value = BackgroundValue;
+			}
+			BrickMap.Add(InKey, BrickIndex);
+			WriteCursor.Key = InKey;
+			WriteCursor.Index = BrickIndex;
+			return BrickIndex;
+		}
+
+		// Swaps the last brick into the hole.
+		void RemoveBrick(int32 InBrickIndex)
+		{
+			int32 Unused;
+			BrickMap.Remove(GetBrickKey(Bricks[InBrickIndex].Origin, Unused));
+			const int32 LastIndex = Bricks.Num() - 1;
+			if (InBrickIndex != LastIndex)
+			{
+				BrickMap.Add(GetBrickKey(Bricks[LastIndex].Origin, Unused), InBrickIndex);
+			}
+			Bricks.RemoveAtSwap(InBrickIndex);
+			WriteCursor = FBrickCursor();
+		}
+
+		int64 GetGridBrickCount() const
+		{
+			int64 Count = 1;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Count *= BrickGridSize[Dim];
+			}
+			return Count;
+		}
+
+		CoordinateType GridIndexToOrigin(int64 InGridBrickIndex) const
+		{
+			CoordinateType Origin;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Origin[Dim] = static_cast<IndexType>((InGridBrickIndex / BrickGridStride[Dim]) % BrickGridSize[Dim]) << BRICK_SIZE_LOG2;
+			}
+			return Origin;
+		}
+
+		static CoordinateType LocalIndexToCoordinate(const CoordinateType& InOrigin, int32 InLocalIndex)
+		{
+			CoordinateType Coordinate;
+			for (int Dim = DIM_SIZE - 1; Dim >= 0; --Dim)
+			{
+				Coordinate[Dim] = InOrigin[Dim] + (InLocalIndex & BRICK_EDGE_MASK);
+				InLocalIndex >>= BRICK_SIZE_LOG2;
+			}
+			return Coordinate;
+		}
+
+		// Calls InFunc(LocalIndex) for every set bit of the active mask.
+		template <typename FuncType>
+		static void ForEachActiveBit(const FBrick& InBrick, const FuncType& InFunc)
+		{
+			for (int32 WordIndex = 0; WordIndex < BRICK_MASK_WORD_COUNT; ++WordIndex)
+			{
+				uint64 Word = InBrick.ActiveBits[WordIndex];
+				while (Word)
+				{
+					InFunc(WordIndex * 64 + static_cast<int32>(FMath::CountTrailingZeros64(Word)));
+					Word &= Word - 1;
+				}
+			}
+		}
+
+		// Calls InFunc(Coordinate, LocalIndex) for the elements of a brick inside the array.
+		template <typename FuncType>
+		void ForEachBrickElement(const CoordinateType& InOrigin, const FuncType& InFunc) const
+		{
+			CoordinateType Limits;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Limits[Dim] = FMath::Min<IndexType>(BRICK_EDGE_MASK + 1, EachDimSize[Dim] - InOrigin[Dim]);
+			}
+			DenseArrayType::DoNestedLoops(Limits, [&](const CoordinateType& InLocalCoord, const IndexType& InLoopCounter)
+			{
+				CoordinateType Coordinate;
+				int32 LocalIndex = 0;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Coordinate[Dim] = InOrigin[Dim] + InLocalCoord[Dim];
+					LocalIndex = (LocalIndex << BRICK_SIZE_LOG2) | static_cast<int32>(InLocalCoord[Dim]);
+				}
+				InFunc(Coordinate, LocalIndex);
+			});
+		}
+
+		ArrayDimType EachDimSize{};
+		DataType BackgroundValue;
+		CoordinateType BrickGridSize{};
+		std::array<int64, DIM_SIZE> BrickGridStride{};
+
+		TArray<FBrick> Bricks;
+		TMap<int64, int32> BrickMap;
+		int64 NumActive = 0;
+		FBrickCursor WriteCursor;
+	};
+}
@@ -0,0 +1,184 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include <atomic>
+
+// Compiles the operation counters and the trace scopes of the arrays in, see FArrayMultiDimStats. Off in shipping
+// builds by default, define it to 1 to keep it in a shipping-test build. Compiled out, the scopes are empty statements.
+#ifndef ARRAYMULTIDIM_WITH_STATS
+#define ARRAYMULTIDIM_WITH_STATS !UE_BUILD_SHIPPING
+#endif
+
+namespace ArrayMultiDim
+{
+	// The instrumented operations of the arrays.
+	enum class EArrayOperation : uint8
+	{
+		DeepCopy,  // A copy construction / assignment that duplicated the buffer (not in the shared storage mode).
+		Detach,  // A copy-on-write detach of a shared buffer.
+		Resize,  // SetDimSize().
+		Slice,  // Slice(), which allocates its result.
+		MaskGather,  // GetElementsByMask().
+		SetData,  // SetData() with an initializer function.
+		Traversal,  // LoopByIndex(), LoopByCoord() and their const versions.
+		Num
+	};
+
+	// The totals of one operation.
+	struct FArrayOperationStats
+	{
+		uint64 NumCalls = 0;
+		uint64 BytesAllocated = 0;
+		uint64 BytesCopied = 0;
+		double Seconds = 0.0;
+	};
+
+	// A copy of all the counters at one moment, see FArrayMultiDimStats::GetSnapshot().
+	struct FArrayMultiDimStatsSnapshot
+	{
+		FArrayOperationStats Operations[static_cast<int>(EArrayOperation::Num)];
+
+		const FArrayOperationStats& operator[](EArrayOperation InOperation) const
+		{
+			return Operations[static_cast<int>(InOperation)];
+		}
+
+		// The sum of all the operations. The nested operations (e.g. the resize of the result of a Slice()) count in both.
+		FArrayOperationStats GetTotal() const
+		{
+			FArrayOperationStats Total;
+			for (const FArrayOperationStats& Operation : Operations)
+			{
+				Total.NumCalls += Operation.NumCalls;
+				Total.BytesAllocated += Operation.BytesAllocated;
+				Total.BytesCopied += Operation.BytesCopied;
+				Total.Seconds += Operation.Seconds;
+			}
+			return Total;
+		}
+
+		// The counts since an earlier snapshot, e.g. the cost of one frame or of one test.
+		FArrayMultiDimStatsSnapshot operator-(const FArrayMultiDimStatsSnapshot& InEarlier) const
+		{
+			FArrayMultiDimStatsSnapshot Delta;
+			for (int i = 0; i < static_cast<int>(EArrayOperation::Num); ++i)
+			{
+				Delta.Operations[i].NumCalls = Operations[i].NumCalls - InEarlier.Operations[i].NumCalls;
+				Delta.Operations[i].BytesAllocated = Operations[i].BytesAllocated - InEarlier.Operations[i].BytesAllocated;
+				Delta.Operations[i].BytesCopied = Operations[i].BytesCopied - InEarlier.Operations[i].BytesCopied;
+				Delta.Operations[i].Seconds = Operations[i].Seconds - InEarlier.Operations[i].Seconds;
+			}
+			return Delta;
+		}
+	};
+
+	/**
+	 * @brief The counters of the heavy array operations: calls, bytes allocated, bytes copied and time.
+	 *
+	 * Each instrumented operation also opens an Insights CPU trace scope (ArrayMultiDim_<Operation>) and a
+	 * "stat quick" cycle counter. The counters are relaxed atomics, shared by all the arrays and threads. They are
+	 * defined once in MultiDimentionArray.cpp and exported, so every module of a modular build counts into the same set. With
+	 * ARRAYMULTIDIM_WITH_STATS set to 0 nothing is recorded and the snapshots stay empty.
+	 *
+	 * \code
+	 *		const ArrayMultiDim::FArrayMultiDimStatsSnapshot Before = ArrayMultiDim::FArrayMultiDimStats::GetSnapshot();
+	 *		TickSimulation();
+	 *		const auto Frame = ArrayMultiDim::FArrayMultiDimStats::GetSnapshot() - Before;
+	 *		UE_LOG(LogTemp, Log, TEXT("%llu deep copies, %llu bytes copied"),
+	 *			   Frame[ArrayMultiDim::EArrayOperation::DeepCopy].NumCalls, Frame.GetTotal().BytesCopied);
+	 * \endcode
+	 */
+	class FArrayMultiDimStats
+	{
+	public:
+		static FArrayMultiDimStatsSnapshot GetSnapshot()
+		{
+			FArrayMultiDimStatsSnapshot Snapshot;
+			const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+			for (int i = 0; i < static_cast<int>(EArrayOperation::Num); ++i)
+			{
+				Snapshot.Operations[i].NumCalls = Counters[i].NumCalls.load(std::memory_order_relaxed);
+				Snapshot.Operations[i].BytesAllocated = Counters[i].BytesAllocated.load(std::memory_order_relaxed);
+				Snapshot.Operations[i].BytesCopied = Counters[i].BytesCopied.load(std::memory_order_relaxed);
+				Snapshot.Operations[i].Seconds = Counters[i].Cycles.load(std::memory_order_relaxed) * SecondsPerCycle;
+			}
+			return Snapshot;
+		}
+
+		static void Reset()
+		{
+			for (FCounters& Counter : Counters)
+			{
+				Counter.NumCalls.store(0, std::memory_order_relaxed);
+				Counter.BytesAllocated.store(0, std::memory_order_relaxed);
+				Counter.BytesCopied.store(0, std::memory_order_relaxed);
+				Counter.Cycles.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		static void Record(EArrayOperation InOperation, uint64 InBytesAllocated, uint64 InBytesCopied, uint64 InCycles)
+		{
+			FCounters& Counter = Counters[static_cast<int>(InOperation)];
+			Counter.NumCalls.fetch_add(1, std::memory_order_relaxed);
+			Counter.BytesAllocated.fetch_add(InBytesAllocated, std::memory_order_relaxed);
+			Counter.BytesCopied.fetch_add(InBytesCopied, std::memory_order_relaxed);
+			Counter.Cycles.fetch_add(InCycles, std::memory_order_relaxed);
+		}
+
+	private:
+		struct FCounters
+		{
+			std::atomic<uint64> NumCalls{0};
+			std::atomic<uint64> BytesAllocated{0};
+			std::atomic<uint64> BytesCopied{0};
+			std::atomic<uint64> Cycles{0};
+		};
+		static MULTIDIMENTIONARRAY_API FCounters Counters[static_cast<int>(EArrayOperation::Num)];
+	};
+
+	// Records one operation when it goes out of scope: its time, and the bytes reported by AddBytes().
+	class FArrayOperationScope
+	{
+	public:
+		explicit FArrayOperationScope(EArrayOperation InOperation)
+			: Operation(InOperation), StartCycles(FPlatformTime::Cycles64())
+		{
+		}
+
+		FArrayOperationScope(const FArrayOperationScope&) = delete;
+		FArrayOperationScope& operator=(const FArrayOperationScope&) = delete;
+
+		~FArrayOperationScope()
+		{
+			FArrayMultiDimStats::Record(Operation, BytesAllocated, BytesCopied, FPlatformTime::Cycles64() - StartCycles);
+		}
+
+		void AddBytes(uint64 InBytesAllocated, uint64 InBytesCopied)
+		{
+			BytesAllocated += InBytesAllocated;
+			BytesCopied += InBytesCopied;
+		}
+
+	private:
+		EArrayOperation Operation;
+		uint64 StartCycles;
+		uint64 BytesAllocated = 0;
+		uint64 BytesCopied = 0;
+	};
+}
+
+// Instruments the rest of the enclosing scope as one [Operation] (an EArrayOperation name), the scope variable
+// [ScopeName] receives the byte counts through ARRAYMULTIDIM_OPERATION_BYTES. Compiled out, the byte expressions aren't
+// evaluated either.
+#if ARRAYMULTIDIM_WITH_STATS
+#define ARRAYMULTIDIM_OPERATION_SCOPE(Operation, ScopeName) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(ArrayMultiDim_##Operation); \
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ArrayMultiDim_##Operation); \
+	ArrayMultiDim::FArrayOperationScope ScopeName(ArrayMultiDim::EArrayOperation::Operation)
+#define ARRAYMULTIDIM_OPERATION_BYTES(ScopeName, BytesAllocated, BytesCopied) \
+	ScopeName.AddBytes(static_cast<uint64>(BytesAllocated), static_cast<uint64>(BytesCopied))
+#else
+#define ARRAYMULTIDIM_OPERATION_SCOPE(Operation, ScopeName)
+#define ARRAYMULTIDIM_OPERATION_BYTES(ScopeName, BytesAllocated, BytesCopied)
+#endif
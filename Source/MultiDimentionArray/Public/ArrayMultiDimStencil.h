@@ -0,0 +1,552 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+
+namespace ArrayMultiDim
+{
+	/**
+	 * @brief Runs many time steps of the same stencil over an array: cellular automata, heat diffusion, Jacobi
+	 * relaxation, ... Each step computes every element from the neighborhood of the element in the previous step.
+	 *
+	 * The runner owns two buffers and swaps them after each step (ping-pong), and keeps the scratch buffers of its
+	 * workers from one run to the next, so no step allocates once they have grown. The domain is split into tiles
+	 * updated in parallel, each worker takes the next tile left. With temporal blocking (SetStepsPerTile()), a tile is loaded into a
+	 * scratch buffer with a halo of StepsPerTile * Radius elements and advanced several steps while it stays in the
+	 * cache: the halo shrinks by the radius at each step, and the overlapping halos of the neighbor tiles are computed
+	 * redundantly instead of exchanged. The result is the same as running the steps one by one.
+	 *
+	 * The elements out of the array follow the border mode at each step: ConstantBorder reads the border value,
+	 * NoPadding reads DataType() (so a weighted stencil skips them), the reflecting modes read the reflected element.
+	 * RepeatBorder wraps to the other side of the array, out of the tile, so it runs one step per tile.
+	 *
+	 * Usage:
+	 * \code
+	 *		// 100 steps of heat diffusion, the weights are scaled by 1/8.
+	 *		using FHeatRunner = ArrayMultiDim::TStencilRunner<float, -1, -1>;
+	 *		FHeatRunner Heat(Temperature, ArrayMultiDim::EBorderMode::ReflectBorder);
+	 *		Heat.Run(100, FHeatRunner::MaskType{{0, 1, 0}, {1, 4, 1}, {0, 1, 0}}, 1. / 8.);
+	 *
+	 *		// Game of life, the stencil reads the neighbors at offsets up to 1.
+	 *		ArrayMultiDim::TStencilRunner<uint8, -1, -1> Life(Cells, ArrayMultiDim::EBorderMode::RepeatBorder);
+	 *		Life.Run(10, {1, 1}, [](const auto& InCells)
+	 *		{
+	 *			const int32 Alive = InCells(-1, -1) + InCells(-1, 0) + InCells(-1, 1) + InCells(0, -1) + InCells(0, 1)
+	 *				+ InCells(1, -1) + InCells(1, 0) + InCells(1, 1);
+	 *			return static_cast<uint8>(Alive == 3 || (Alive == 2 && InCells.GetCenter()));
+	 *		});
+	 *		const auto& Result = Life.GetCurrent();
+	 * \endcode
+	 *
+	 * @tparam DataType The element type.
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename DataType, int... Dims>
+	class TStencilRunner
+	{
+	public:
+		using ArrayType = TArrayMultiDim<DataType, Dims...>;
+		using IndexType = typename ArrayType::IndexType;
+		using ArrayDimType = typename ArrayType::ArrayDimType;
+		using CoordinateType = typename ArrayType::CoordinateType;
+		using MaskType = typename ArrayType::MaskType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+
+		// The default tiles hold about this many elements (the scratch buffers add the halos).
+		static constexpr IndexType DEFAULT_TILE_ELEMENTS = 16384;
+		// The default tile length along the fastest storage dimension.
+		static constexpr IndexType DEFAULT_TILE_ROW_LENGTH = 256;
+		static constexpr int32 DEFAULT_STEPS_PER_TILE = 4;
+
+		/**
+		 * @brief The neighborhood of the updated element, given to the stencil callables.
+		 *
+		 * Neighborhood(Offset0, Offset1, ...) reads the previous step at the offset from the updated element, the
+		 * offsets are bounded by the radius given to Run(). The reads don't check the borders, the halo of the scratch
+		 * buffer already holds the border values.
+		 */
+		class FNeighborhood
+		{
+		public:
+			template <typename... T>
+			FORCEINLINE const DataType& operator()(T... InOffset) const
+			{
+				static_assert(sizeof...(T) == DIM_SIZE, "One offset per dimension.");
+				return At(CoordinateType{static_cast<IndexType>(InOffset)...});
+			}
+
+			FORCEINLINE const DataType& At(const CoordinateType& InOffset) const
+			{
+				IndexType Offset = 0;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Offset += InOffset[Dim] * (*Strides)[Dim];
+				}
+				return Center[Offset];
+			}
+
+			FORCEINLINE const DataType& GetCenter() const { return *Center; }
+
+			// The coordinate of the updated element in the array, e.g. for the sources of a diffusion.
+			FORCEINLINE const CoordinateType& GetCoordinate() const { return Coordinate; }
+
+			// The raw center and the element strides around it, for the hand-unrolled stencils.
+			FORCEINLINE const DataType* GetCenterPointer() const { return Center; }
+			FORCEINLINE const CoordinateType& GetStrides() const { return *Strides; }
+
+		private:
+			friend class TStencilRunner;
+
+			const DataType* Center = nullptr;
+			const CoordinateType* Strides = nullptr;
+			CoordinateType Coordinate{};
+		};
+
+		TStencilRunner()
+		{
+		}
+
+		explicit TStencilRunner(const ArrayType& InInitial, EBorderMode InBorderMode = EBorderMode::NoPadding,
+								const DataType& InBorderValue = DataType())
+		{
+			Reset(InInitial, InBorderMode, InBorderValue);
+		}
+
+		// Restarts from a new initial state, the tile size and the steps per tile are kept.
+		void Reset(const ArrayType& InInitial, EBorderMode InBorderMode = EBorderMode::NoPadding,
+				   const DataType& InBorderValue = DataType())
+		{
+			Buffers[0] = InInitial;
+			if (Buffers[0].HasRingOrigin())
+			{
+				Buffers[0].NormalizeRingOrigin();
+			}
+			Buffers[1].SetDimSize(Buffers[0].GetRuntimeEachDimSize(), Buffers[0].GetRuntimeStorageOrder(),
+								  EResizeDataCopyPolicy::SetToUninitializedValue);
+			CurrentBuffer = 0;
+			StepCount = 0;
+			BorderMode = InBorderMode;
+			BorderValue = InBorderMode == EBorderMode::ConstantBorder ? InBorderValue : DataType();
+		}
+
+		/**
+		 * @brief The tile edge lengths, clamped to the array size. A zero length (the default) picks DEFAULT_TILE_ROW_LENGTH
+		 * along the fastest storage dimension and splits DEFAULT_TILE_ELEMENTS evenly over the other ones.
+		 */
+		void SetTileSize(const ArrayDimType& InTileSize) { TileSize = InTileSize; }
+
+		/**
+		 * @brief How many steps a tile runs before the buffers are swapped (temporal blocking), 1 disables it.
+		 *
+		 * More steps per tile mean fewer sweeps over the whole array, but wider halos computed redundantly: each tile
+		 * computes (Tile + 2 * Steps * Radius)^N elements per Steps * Tile^N useful ones at most.
+		 */
+		void SetStepsPerTile(int32 InStepsPerTile)
+		{
+			check(InStepsPerTile > 0);
+			StepsPerTile = InStepsPerTile;
+		}
+
+		// The state after the steps run so far.
+		const ArrayType& GetCurrent() const { return Buffers[CurrentBuffer]; }
+
+		// The number of steps run since the last Reset().
+		int64 GetStepCount() const { return StepCount; }
+
+		/**
+		 * @brief Runs [InNumSteps] steps of a weighted stencil: each element becomes
+		 * InScale * Sum(Weight * Neighbor) over the non-zero weights of the mask (a bool weight counts as 1). The arithmetic
+		 * types sum in double and convert once, so a uint8 sum doesn't wrap.
+		 *
+		 * @param InWeights The weights, centered on InCenter, or on the middle of the mask by default (same as Erode()).
+		 */
+		void Run(int32 InNumSteps, const MaskType& InWeights, double InScale = 1.,
+				 const CoordinateType& InCenter = MakeFilledCoordinate(INDEX_NONE))
+		{
+			TArray<CoordinateType> TapOffsets;
+			TArray<int32> TapWeights;
+			ArrayDimType Radius = MakeFilledCoordinate(0);
+			InWeights.ConstLoopByCoord([&](const typename MaskType::CoordinateType& InMaskCoord,
+										   typename MaskType::IndexType InMaskLinearIdx,
+										   typename MaskType::IndexType InMaskLoopCount,
+										   const std::variant<bool, int>& InMaskValue)
+			{
+				const int32 Weight = std::visit([](const auto InValue) { return static_cast<int32>(InValue); }, InMaskValue);
+				if (Weight == 0)
+				{
+					return;
+				}
+				CoordinateType& Offset = TapOffsets.AddDefaulted_GetRef();
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					const IndexType Anchor = InCenter[Dim] == INDEX_NONE ? InWeights.GetRuntimeEachDimSize()[Dim] / 2 : InCenter[Dim];
+					Offset[Dim] = InMaskCoord[Dim] - Anchor;
+					Radius[Dim] = FMath::Max<IndexType>(Radius[Dim], FMath::Abs(Offset[Dim]));
+				}
+				TapWeights.Add(Weight);
+			});
+			checkf(TapWeights.Num() > 0, TEXT("The stencil has no non-zero weight."));
+
+			RunTiled_Internal(InNumSteps, Radius, [&](const CoordinateType& InScratchStrides)
+			{
+				// The taps as linear offsets in the scratch buffers.
+				TArray<IndexType> TapIndices;
+				for (const CoordinateType& Offset : TapOffsets)
+				{
+					TapIndices.Add(LinearIndexOf(Offset, InScratchStrides));
+				}
+				return [TapIndices = MoveTemp(TapIndices), &TapWeights, InScale](const FNeighborhood& InNeighborhood)
+				{
+					const DataType* Center = InNeighborhood.GetCenterPointer();
+					if constexpr (std::is_arithmetic_v<DataType>)
+					{
+						double Sum = 0.;
+						for (int32 Tap = 0; Tap < TapIndices.Num(); ++Tap)
+						{
+							Sum += static_cast<double>(Center[TapIndices[Tap]]) * TapWeights[Tap];
+						}
+						return static_cast<DataType>(Sum * InScale);
+					}
+					else
+					{
+						DataType Sum = static_cast<DataType>(Center[TapIndices[0]] * TapWeights[0]);
+						for (int32 Tap = 1; Tap < TapIndices.Num(); ++Tap)
+						{
+							Sum += Center[TapIndices[Tap]] * TapWeights[Tap];
+						}
+						return static_cast<DataType>(Sum * InScale);
+					}
+				};
+			});
+		}
+
+		/**
+		 * @brief Runs [InNumSteps] steps of a stencil callable: each element becomes InStencil(Neighborhood), see
+		 * FNeighborhood. The callable is called from several threads.
+		 *
+		 * @param InRadius The largest offset read by the stencil in each dimension, it sizes the halos.
+		 */
+		template <typename StencilFuncType>
+		void Run(int32 InNumSteps, const ArrayDimType& InRadius, const StencilFuncType& InStencil)
+		{
+			RunTiled_Internal(InNumSteps, InRadius, [&InStencil](const CoordinateType& InScratchStrides) -> const StencilFuncType&
+			{
+				return InStencil;
+			});
+		}
+
+	protected:
+		/**
+		 * Runs the steps block by block, a block advances every tile by up to StepsPerTile steps then swaps the buffers.
+		 * InMakeKernel(ScratchStrides) returns the stencil of a block, the scratch layout is the same for all its tiles.
+		 */
+		template <typename MakeKernelFuncType>
+		void RunTiled_Internal(int32 InNumSteps, const ArrayDimType& InRadius, const MakeKernelFuncType& InMakeKernel)
+		{
+			const ArrayDimType Size = Buffers[CurrentBuffer].GetRuntimeEachDimSize();
+			const CoordinateType Order = Buffers[CurrentBuffer].GetRuntimeStorageOrder();
+			const ArrayDimType Tile = MakeTileSize_Internal(Size, Order);
+			int32 NumTiles = 1;
+			ArrayDimType TileCount;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (Size[Dim] <= 0)
+				{
+					return;
+				}
+				TileCount[Dim] = (Size[Dim] + Tile[Dim] - 1) / Tile[Dim];
+				NumTiles *= TileCount[Dim];
+			}
+
+			// A border element reflects an element at most Steps * Radius deep, still in the halo of the tile as long as
+			// that depth fits in the array. The wrapped elements are on the other side of the array.
+			int32 MaxStepsPerBlock = BorderMode == EBorderMode::RepeatBorder ? 1 : StepsPerTile;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				check(InRadius[Dim] >= 0);
+				if (InRadius[Dim] > 0)
+				{
+					MaxStepsPerBlock = FMath::Max<int32>(FMath::Min<int32>(MaxStepsPerBlock, Size[Dim] / InRadius[Dim]), 1);
+				}
+			}
+
+			for (int32 StepsLeft = InNumSteps; StepsLeft > 0;)
+			{
+				const int32 BlockSteps = FMath::Min(MaxStepsPerBlock, StepsLeft);
+				CoordinateType Halo;
+				ArrayDimType ScratchSize;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					Halo[Dim] = BlockSteps * InRadius[Dim];
+					ScratchSize[Dim] = Tile[Dim] + 2 * Halo[Dim];
+				}
+				CoordinateType ScratchStrides;
+				IndexType ScratchTotal = 1;
+				for (int i = 0; i < DIM_SIZE; ++i)
+				{
+					ScratchStrides[Order[i]] = ScratchTotal;
+					ScratchTotal *= ScratchSize[Order[i]];
+				}
+				const auto& Kernel = InMakeKernel(ScratchStrides);
+
+				const ArrayType& Source = Buffers[CurrentBuffer];
+				ArrayType& Target = Buffers[1 - CurrentBuffer];
+				const DataType* SourceData = Source.GetData();
+				DataType* TargetData = Target.GetData();
+				const CoordinateType& SourceStride = Source.GetRuntimeStride();
+				const CoordinateType& TargetStride = Target.GetRuntimeStride();
+
+				// Two scratch buffers per worker, they only grow.
+				const int32 NumWorkers = FMath::Min(NumTiles, FPlatformMisc::NumberOfWorkerThreadsToSpawn() + 1);
+				if (ScratchBuffers.Num() < 2 * NumWorkers)
+				{
+					ScratchBuffers.SetNum(2 * NumWorkers);
+				}
+				for (int32 i = 0; i < 2 * NumWorkers; ++i)
+				{
+					if (ScratchBuffers[i].Num() < ScratchTotal)
+					{
+						ScratchBuffers[i].SetNumUninitialized(ScratchTotal);
+					}
+				}
+
+				std::atomic<int32> NextTile{0};
+				ParallelFor(NumWorkers, [&](int32 Worker)
+				{
+					DataType* Scratch[2] = {ScratchBuffers[2 * Worker].GetData(), ScratchBuffers[2 * Worker + 1].GetData()};
+					for (int32 TileIndex = NextTile.fetch_add(1, std::memory_order_relaxed); TileIndex < NumTiles;
+						 TileIndex = NextTile.fetch_add(1, std::memory_order_relaxed))
+					{
+						CoordinateType TileMin;
+						CoordinateType TileMax;
+						for (int Dim = 0, Rest = TileIndex; Dim < DIM_SIZE; ++Dim)
+						{
+							TileMin[Dim] = Rest % TileCount[Dim] * Tile[Dim];
+							TileMax[Dim] = FMath::Min<IndexType>(TileMin[Dim] + Tile[Dim], Size[Dim]);
+							Rest /= TileCount[Dim];
+						}
+						CoordinateType ScratchOrigin;
+						for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+						{
+							ScratchOrigin[Dim] = TileMin[Dim] - Halo[Dim];
+						}
+						const IndexType ScratchOriginIndex = LinearIndexOf(ScratchOrigin, ScratchStrides);
+						auto ScratchIndexOf = [&](const CoordinateType& InCoordinate)
+						{
+							return LinearIndexOf(InCoordinate, ScratchStrides) - ScratchOriginIndex;
+						};
+
+						// Load the tile and its halo, the elements out of the array follow the border mode.
+						CoordinateType BoxMin;
+						CoordinateType BoxMax;
+						ExpandBox_Internal(TileMin, TileMax, Halo, BoxMin, BoxMax);
+						ForEachBoxRow_Internal(BoxMin, BoxMax, Order, [&](const CoordinateType& InRowStart, IndexType InLength)
+						{
+							DataType* Row = Scratch[0] + ScratchIndexOf(InRowStart);
+							// The part of the row inside the array is copied, the rest follows the border mode.
+							IndexType InsideBegin = FMath::Clamp<IndexType>(-InRowStart[Order[0]], 0, InLength);
+							IndexType InsideEnd = FMath::Clamp<IndexType>(Size[Order[0]] - InRowStart[Order[0]], InsideBegin, InLength);
+							for (int i = 1; i < DIM_SIZE; ++i)
+							{
+								if (InRowStart[Order[i]] < 0 || InRowStart[Order[i]] >= Size[Order[i]])
+								{
+									InsideBegin = InsideEnd = InLength;
+								}
+							}
+							if (InsideBegin < InsideEnd)
+							{
+								CoordinateType InsideStart = InRowStart;
+								InsideStart[Order[0]] += InsideBegin;
+								const DataType* SourceRow = SourceData + LinearIndexOf(InsideStart, SourceStride);
+								for (IndexType i = InsideBegin; i < InsideEnd; ++i)
+								{
+									Row[i] = SourceRow[i - InsideBegin];
+								}
+							}
+							CoordinateType Coord = InRowStart;
+							for (IndexType i = 0; i < InLength; ++i, ++Coord[Order[0]])
+							{
+								if (i == InsideBegin)
+								{
+									i = InsideEnd;
+									Coord[Order[0]] = InRowStart[Order[0]] + i;
+									if (i == InLength)
+									{
+										break;
+									}
+								}
+								CoordinateType Resolved = Coord;
+								Row[i] = ArrayType::ResolveBorderCoordinate(Resolved, Size, BorderMode)
+									? SourceData[LinearIndexOf(Resolved, SourceStride)] : BorderValue;
+							}
+						});
+
+						for (int32 Step = 0; Step < BlockSteps; ++Step)
+						{
+							const DataType* In = Scratch[Step & 1];
+							DataType* Out = Scratch[(Step + 1) & 1];
+							// The elements still needed by the next steps of this tile.
+							CoordinateType Grow;
+							for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+							{
+								Grow[Dim] = (BlockSteps - Step - 1) * InRadius[Dim];
+							}
+							ExpandBox_Internal(TileMin, TileMax, Grow, BoxMin, BoxMax);
+							CoordinateType ComputeMin;
+							CoordinateType ComputeMax;
+							for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+							{
+								ComputeMin[Dim] = FMath::Max<IndexType>(BoxMin[Dim], 0);
+								ComputeMax[Dim] = FMath::Min<IndexType>(BoxMax[Dim], Size[Dim]);
+							}
+							ForEachBoxRow_Internal(ComputeMin, ComputeMax, Order, [&](const CoordinateType& InRowStart, IndexType InLength)
+							{
+								const IndexType RowIndex = ScratchIndexOf(InRowStart);
+								FNeighborhood Neighborhood;
+								Neighborhood.Strides = &ScratchStrides;
+								Neighborhood.Coordinate = InRowStart;
+								for (IndexType i = 0; i < InLength; ++i, ++Neighborhood.Coordinate[Order[0]])
+								{
+									Neighborhood.Center = In + RowIndex + i;
+									Out[RowIndex + i] = Kernel(Neighborhood);
+								}
+							});
+							if (Step + 1 < BlockSteps)
+							{
+								FillBorder_Internal(BoxMin, BoxMax, Size, Order, Out, ScratchIndexOf);
+							}
+						}
+
+						// Store the tile.
+						const DataType* Result = Scratch[BlockSteps & 1];
+						ForEachBoxRow_Internal(TileMin, TileMax, Order, [&](const CoordinateType& InRowStart, IndexType InLength)
+						{
+							const DataType* Row = Result + ScratchIndexOf(InRowStart);
+							DataType* TargetRow = TargetData + LinearIndexOf(InRowStart, TargetStride);
+							for (IndexType i = 0; i < InLength; ++i)
+							{
+								TargetRow[i] = Row[i];
+							}
+						});
+					}
+				}, NumWorkers <= 1);
+
+				CurrentBuffer = 1 - CurrentBuffer;
+				StepCount += BlockSteps;
+				StepsLeft -= BlockSteps;
+			}
+		}
+
+		// The box of a tile grown by InGrow elements on each side.
+		static void ExpandBox_Internal(const CoordinateType& InTileMin, const CoordinateType& InTileMax, const CoordinateType& InGrow,
+									   CoordinateType& OutMin, CoordinateType& OutMax)
+		{
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				OutMin[Dim] = InTileMin[Dim] - InGrow[Dim];
+				OutMax[Dim] = InTileMax[Dim] + InGrow[Dim];
+			}
+		}
+
+		// Sets the elements of the box out of the array from the elements they reflect, or to the border value.
+		template <typename ScratchIndexFuncType>
+		void FillBorder_Internal(const CoordinateType& InBoxMin, const CoordinateType& InBoxMax, const ArrayDimType& InSize,
+								 const CoordinateType& InOrder, DataType* InOutScratch, const ScratchIndexFuncType& InScratchIndexOf) const
+		{
+			const int RowDim = InOrder[0];
+			ForEachBoxRow_Internal(InBoxMin, InBoxMax, InOrder, [&](const CoordinateType& InRowStart, IndexType InLength)
+			{
+				bool bRowInside = true;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					bRowInside &= Dim == RowDim || (InRowStart[Dim] >= 0 && InRowStart[Dim] < InSize[Dim]);
+				}
+				CoordinateType Coord = InRowStart;
+				for (IndexType i = 0; i < InLength; ++i, ++Coord[RowDim])
+				{
+					if (bRowInside && Coord[RowDim] >= 0 && Coord[RowDim] < InSize[RowDim])
+					{
+						continue;
+					}
+					CoordinateType Resolved = Coord;
+					InOutScratch[InScratchIndexOf(Coord)] = ArrayType::ResolveBorderCoordinate(Resolved, InSize, BorderMode)
+						? InOutScratch[InScratchIndexOf(Resolved)] : BorderValue;
+				}
+			});
+		}
+
+		// Calls InFunc(RowStart, Length) for each row of the box [InMin, InMax) along the fastest storage dimension.
+		template <typename FuncType>
+		static void ForEachBoxRow_Internal(const CoordinateType& InMin, const CoordinateType& InMax, const CoordinateType& InOrder,
+										   const FuncType& InFunc)
+		{
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (InMax[Dim] <= InMin[Dim])
+				{
+					return;
+				}
+			}
+			CoordinateType Coord = InMin;
+			while (true)
+			{
+				InFunc(Coord, InMax[InOrder[0]] - InMin[InOrder[0]]);
+				int i = 1;
+				for (; i < DIM_SIZE; ++i)
+				{
+					const int Dim = InOrder[i];
+					if (++Coord[Dim] < InMax[Dim])
+					{
+						break;
+					}
+					Coord[Dim] = InMin[Dim];
+				}
+				if (i == DIM_SIZE)
+				{
+					return;
+				}
+			}
+		}
+
+		static CoordinateType MakeFilledCoordinate(IndexType InValue)
+		{
+			CoordinateType Result;
+			Result.fill(InValue);
+			return Result;
+		}
+
+		static FORCEINLINE IndexType LinearIndexOf(const CoordinateType& InCoordinate, const CoordinateType& InStride)
+		{
+			IndexType Index = 0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Index += InCoordinate[Dim] * InStride[Dim];
+			}
+			return Index;
+		}
+
+		ArrayDimType MakeTileSize_Internal(const ArrayDimType& InSize, const CoordinateType& InOrder) const
+		{
+			ArrayDimType Result = TileSize;
+			const IndexType RowLength = Result[InOrder[0]] > 0 ? Result[InOrder[0]] : FMath::Min(DEFAULT_TILE_ROW_LENGTH, InSize[InOrder[0]]);
+			const double OtherEdge = DIM_SIZE > 1 ? FMath::Pow(static_cast<double>(FMath::Max<IndexType>(DEFAULT_TILE_ELEMENTS / FMath::Max<IndexType>(RowLength, 1), 1)), 1. / (DIM_SIZE - 1)) : 1.;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				if (Result[Dim] <= 0)
+				{
+					Result[Dim] = Dim == InOrder[0] ? RowLength : static_cast<IndexType>(FMath::RoundToInt(OtherEdge));
+				}
+				Result[Dim] = FMath::Clamp<IndexType>(Result[Dim], 1, FMath::Max<IndexType>(InSize[Dim], 1));
+			}
+			return Result;
+		}
+
+		ArrayType Buffers[2];
+		// The ping-pong scratch buffers of the tiles, two per worker.
+		TArray<TArray<DataType>> ScratchBuffers;
+		int32 CurrentBuffer = 0;
+		int64 StepCount = 0;
+		EBorderMode BorderMode = EBorderMode::NoPadding;
+		DataType BorderValue = DataType();
+		ArrayDimType TileSize{};
+		int32 StepsPerTile = DEFAULT_STEPS_PER_TILE;
+	};
+}
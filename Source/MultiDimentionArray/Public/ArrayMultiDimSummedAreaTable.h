@@ -0,0 +1,231 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+
+namespace ArrayMultiDim
+{
+	/**
+	 * @brief N-dimensional summed-area table (integral image) built on TArrayMultiDim.
+	 *
+	 * Each element of the table holds the sum of all the source elements whose coordinates are less than or equal to
+	 * its coordinate in every dimension. After the table is built, the sum of any axis-aligned box is answered with
+	 * 2^N table lookups, independent of the box volume.
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::TArrayMultiDim<float, 128, 128> InfluenceMap;
+	 *		ArrayMultiDim::TSummedAreaTable<double, 128, 128> Table(InfluenceMap);
+	 *		double Sum = Table.BoxSum({10, 20}, {30, 40});  // Like NumPy InfluenceMap[10:30, 20:40].sum()
+	 * \endcode
+	 *
+	 * @tparam SumType The accumulation type of the table, e.g. int64 for an int source or double for a float source.
+	 * @tparam Dims The dimension sizes, same as the source array.
+	 */
+	template <typename SumType, int... Dims>
+	class TSummedAreaTable
+	{
+	public:
+		using TableType = TArrayMultiDim<SumType, Dims...>;
+		using CoordinateType = typename TableType::CoordinateType;
+		using ArrayDimType = typename TableType::ArrayDimType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+
+		TSummedAreaTable()
+		{
+		}
+
+		template <typename SourceDataType>
+		explicit TSummedAreaTable(const TArrayMultiDim<SourceDataType, Dims...>& InSource)
+		{
+			Build(InSource);
+		}
+
+		/**
+		 * @brief (Re)builds the whole table from the source array.
+		 *
+		 * The table uses the same size and storage order as the source, then it's filled by one parallel prefix scan per axis.
+		 */
+		template <typename SourceDataType>
+		void Build(const TArrayMultiDim<SourceDataType, Dims...>& InSource)
+		{
+			Table.SetDimSize(InSource.GetRuntimeEachDimSize(), InSource.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToUninitializedValue);
+
+			if (InSource.HasRingOrigin())
+			{
+				InSource.ConstLoopByCoord([this](const CoordinateType& InCoord, int InLinearIdx, int InLoopCount, const SourceDataType& InData)
+				{
+					Table[Table.GetLinearIndex(InCoord)] = static_cast<SumType>(InData);
+				});
+			}
+			else
+			{
+				// Same size and storage order, so the linear indexes of the table and the source are the same.
+				const int TotalSize = Table.GetTotalSize();
+				for (int i = 0; i < TotalSize; ++i)
+				{
+					Table[i] = static_cast<SumType>(InSource[i]);
+				}
+			}
+			for (int Axis = 0; Axis < DIM_SIZE; ++Axis)
+			{
+				Table.InclusiveScan(Axis);
+			}
+		}
+
+		/**
+		 * @brief Sum of the source elements in the box [InMin, InMax) (2^N lookups).
+		 *
+		 * Like NumPy Source[Min0:Max0, Min1:Max1, ...].sum(). The box must be inside the array, an empty box gets SumType().
+		 *
+		 * @param InMin The first coordinate of the box (inclusive).
+		 * @param InMax The last coordinate of the box (exclusive).
+		 */
+		SumType BoxSum(const CoordinateType& InMin, const CoordinateType& InMax) const
+		{
+			const ArrayDimType& EachDimSize = Table.GetRuntimeEachDimSize();
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				check(InMin[Dim] >= 0 && InMax[Dim] <= EachDimSize[Dim]);
+				if (InMax[Dim] <= InMin[Dim])
+				{
+					return SumType();
+				}
+			}
+
+			// Inclusion-exclusion over the 2^N corners, the corners before the array start (-1) contribute zero.
+			SumType Sum = SumType();
+			for (uint32 Corner = 0; Corner < (1u << DIM_SIZE); ++Corner)
+			{
+				CoordinateType CornerCoord;
+				int NumLowerCorner = 0;
+				bool bOutside = false;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					if (Corner & (1u << Dim))
+					{
+						CornerCoord[Dim] = InMax[Dim] - 1;
+					}
+					else
+					{
+						CornerCoord[Dim] = InMin[Dim] - 1;
+						bOutside |= CornerCoord[Dim] < 0;
+						++NumLowerCorner;
+					}
+				}
+				if (bOutside)
+				{
+					continue;
+				}
+				const SumType& CornerValue = Table[Table.GetLinearIndex(CornerCoord)];
+				if (NumLowerCorner % 2 == 0)
+				{
+					Sum += CornerValue;
+				}
+				else
+				{
+					Sum -= CornerValue;
+				}
+			}
+			return Sum;
+		}
+
+		// Mean of the source elements in the box [InMin, InMax), 0 for an empty box.
+		double BoxMean(const CoordinateType& InMin, const CoordinateType& InMax) const
+		{
+			double Volume = 1.0;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Volume *= FMath::Max(InMax[Dim] - InMin[Dim], 0);
+			}
+			return Volume > 0.0 ? static_cast<double>(BoxSum(InMin, InMax)) / Volume : 0.0;
+		}
+
+		// Sum of the whole source array.
+		SumType GetTotalSum() const
+		{
+			return Table.GetTotalSize() > 0 ? Table[Table.GetLinearIndex(GetLastCoordinate())] : SumType();
+		}
+
+		/**
+		 * @brief Updates the table after the source elements in the box [InMin, InMax) changed, e.g. a row or a plane.
+		 *
+		 * The old source values are recovered from the table itself, the differences are prefix-scanned in a temporary
+		 * array that covers [InMin, array end) and added back to the table. The cost is proportional to the part of
+		 * the table after InMin instead of the whole table.
+		 *
+		 * @param InSource The source array that already holds the new values. Its size must match the table.
+		 * @param InMin The first coordinate of the changed box (inclusive).
+		 * @param InMax The last coordinate of the changed box (exclusive).
+		 */
+		template <typename SourceDataType>
+		void UpdateRegion(const TArrayMultiDim<SourceDataType, Dims...>& InSource,
+						  const CoordinateType& InMin,
+						  const CoordinateType& InMax)
+		{
+			const ArrayDimType& EachDimSize = Table.GetRuntimeEachDimSize();
+			check(InSource.GetRuntimeEachDimSize() == EachDimSize);
+
+			ArrayDimType ChangedSize;
+			ArrayDimType AffectedSize;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				check(InMin[Dim] >= 0 && InMax[Dim] <= EachDimSize[Dim]);
+				if (InMax[Dim] <= InMin[Dim])
+				{
+					return;
+				}
+				ChangedSize[Dim] = InMax[Dim] - InMin[Dim];
+				AffectedSize[Dim] = EachDimSize[Dim] - InMin[Dim];
+			}
+
+			// 1. Differences between the new and the old source values, the rest of the affected part stays zero.
+			typename TableType::SelfDynamicSizeType Delta;
+			Delta.SetDimSize(AffectedSize, Table.GetRuntimeStorageOrder(), EResizeDataCopyPolicy::SetToInitialValue);
+			TableType::DoNestedLoops(ChangedSize, [&](const CoordinateType& InLocalCoord, const int& InLoopCounter)
+			{
+				CoordinateType SourceCoord;
+				CoordinateType NextCoord;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					SourceCoord[Dim] = InMin[Dim] + InLocalCoord[Dim];
+					NextCoord[Dim] = SourceCoord[Dim] + 1;
+				}
+				const SumType OldValue = BoxSum(SourceCoord, NextCoord);
+				const SumType NewValue = static_cast<SumType>(InSource[InSource.GetLinearIndex(SourceCoord)]);
+				Delta[Delta.GetLinearIndex(InLocalCoord)] = NewValue - OldValue;
+			});
+
+			// 2. Summed-area table of the differences.
+			for (int Axis = 0; Axis < DIM_SIZE; ++Axis)
+			{
+				Delta.InclusiveScan(Axis);
+			}
+
+			// 3. Add it to the affected part of the table.
+			Delta.ConstLoopByCoord([&](const CoordinateType& InLocalCoord, int InLinearIdx, int InLoopCount, const SumType& InDelta)
+			{
+				CoordinateType TableCoord;
+				for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+				{
+					TableCoord[Dim] = InMin[Dim] + InLocalCoord[Dim];
+				}
+				Table[Table.GetLinearIndex(TableCoord)] += InDelta;
+			});
+		}
+
+		// The underlying table, each element is the inclusive prefix sum of the source in all dimensions.
+		const TableType& GetTable() const { return Table; }
+
+	private:
+		CoordinateType GetLastCoordinate() const
+		{
+			CoordinateType LastCoord;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				LastCoord[Dim] = Table.GetRuntimeEachDimSize()[Dim] - 1;
+			}
+			return LastCoord;
+		}
+
+		TableType Table;
+	};
+}
@@ -0,0 +1,404 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+#include <utility>
+
+namespace ArrayMultiDim
+{
+	// The multi-dimension array with [NumDims] dynamic dimensions, e.g. the result of a contraction.
+	template <typename DataType, typename IndexPolicy, typename Sequence>
+	struct TDynamicArrayMultiDimImpl;
+
+	template <typename DataType, typename IndexPolicy, size_t... DimIndexes>
+	struct TDynamicArrayMultiDimImpl<DataType, IndexPolicy, std::index_sequence<DimIndexes...>>
+	{
+		using Type = TBasicArrayMultiDim<DataType, IndexPolicy, (static_cast<void>(DimIndexes), -1)...>;
+	};
+
+	template <typename DataType, typename IndexPolicy, int NumDims>
+	using TDynamicArrayMultiDim = typename TDynamicArrayMultiDimImpl<DataType, IndexPolicy, std::make_index_sequence<NumDims>>::Type;
+
+	/**
+	 * @brief The GEMM kernel behind Contract() and MatMul(): C[M x N] += A[M x K] * B[K x N].
+	 *
+	 * The operands are addressed by offset tables (A(m, k) = A[RowOffsets[m] + KOffsets[k]], likewise for B), so any
+	 * storage order, ring origin, or group of axes folded into one matrix dimension is read without a transposed copy.
+	 * The layout is the usual GotoBLAS / BLIS one: for each KC slice of K, A is packed into MR-row panels and B into
+	 * NR-column panels (the pack loops follow the unit stride of the operand, whichever it is), then the MR x NR
+	 * micro-kernel keeps its accumulators in registers while it streams the two panels. The tiles of C are computed in
+	 * parallel when the product is large enough. C is row-major and dense.
+	 */
+	template <typename DataType, typename IndexType>
+	class TGemmKernel
+	{
+		static_assert(std::is_arithmetic_v<DataType>, "The tensor products need an arithmetic element type.");
+
+	public:
+		// The micro-kernel tile: MR rows of A times NR columns of B, 12 vector accumulators for float.
+		static constexpr int32 MR = 6;
+		static constexpr int32 NR = 8;
+		// The K slice of a pack, and the column count of a B pack. MC x KC of A stays in L2, KC x NR of B in L1.
+		static constexpr int32 KC = 256;
+		static constexpr int32 NC = 2048;
+		// The tile of C computed by one task.
+		static constexpr int32 MC = 96;
+		static constexpr int32 TILE_COLUMNS = 256;
+		// The products under this many multiply-adds run on the calling thread.
+		static constexpr int64 PARALLEL_MIN_WORK = 1 << 18;
+
+		static void Run(IndexType InM, IndexType InN, IndexType InK,
+						const DataType* InA, const IndexType* InARowOffsets, const IndexType* InAKOffsets,
+						const DataType* InB, const IndexType* InBKOffsets, const IndexType* InBColumnOffsets,
+						DataType* OutC, bool bInAllowParallel = true)
+		{
+			if (InM == 0 || InN == 0 || InK == 0)
+			{
+				return;
+			}
+			const bool bParallel = bInAllowParallel && static_cast<int64>(InM) * InN * InK >= PARALLEL_MIN_WORK;
+			const IndexType NumRowPanels = (InM + MR - 1) / MR;
+			TArray<DataType> PackedA, PackedB;
+			PackedA.SetNumUninitialized(static_cast<int32>(NumRowPanels * MR * KC));
+			PackedB.SetNumUninitialized(static_cast<int32>(FMath::Min<IndexType>(NC, (InN + NR - 1) / NR * NR) * KC));
+
+			for (IndexType KBegin = 0; KBegin < InK; KBegin += KC)
+			{
+				const int32 KSize = static_cast<int32>(FMath::Min<IndexType>(KC, InK - KBegin));
+				PackA(InA, InARowOffsets, InAKOffsets + KBegin, InM, KSize, PackedA.GetData(), bParallel);
+
+				for (IndexType ColumnBegin = 0; ColumnBegin < InN; ColumnBegin += NC)
+				{
+					const IndexType ColumnSize = FMath::Min<IndexType>(NC, InN - ColumnBegin);
+					PackB(InB, InBKOffsets + KBegin, InBColumnOffsets + ColumnBegin, ColumnSize, KSize, PackedB.GetData(), bParallel);
+
+					// The tiles of C write disjoint elements, so they run in parallel without synchronization.
+					const IndexType NumTileRows = (InM + MC - 1) / MC;
+					const IndexType NumTileColumns = (ColumnSize + TILE_COLUMNS - 1) / TILE_COLUMNS;
+					ParallelForIndex(NumTileRows * NumTileColumns, [&](IndexType Tile)
+					{
+						const IndexType RowBegin = Tile / NumTileColumns * MC;
+						const IndexType RowEnd = FMath::Min<IndexType>(RowBegin + MC, InM);
+						const IndexType TileColumnBegin = Tile % NumTileColumns * TILE_COLUMNS;
+						const IndexType TileColumnEnd = FMath::Min<IndexType>(TileColumnBegin + TILE_COLUMNS, ColumnSize);
+						for (IndexType Column = TileColumnBegin; Column < TileColumnEnd; Column += NR)
+						{
+							const DataType* PanelB = PackedB.GetData() + Column * KSize;
+							for (IndexType Row = RowBegin; Row < RowEnd; Row += MR)
+							{
+								MicroKernel(KSize, PackedA.GetData() + Row * KSize, PanelB,
+											OutC + Row * InN + ColumnBegin + Column, InN,
+											static_cast<int32>(FMath::Min<IndexType>(MR, InM - Row)),
+											static_cast<int32>(FMath::Min<IndexType>(NR, ColumnSize - Column)));
+							}
+						}
+					}, !bParallel);
+				}
+			}
+		}
+
+	private:
+		// Packs the rows of A into MR-row panels, K-major inside a panel. The missing rows of the last panel are zero.
+		static void PackA(const DataType* InA, const IndexType* InRowOffsets, const IndexType* InKOffsets,
+						  IndexType InM, int32 InKSize, DataType* OutPacked, bool bInParallel)
+		{
+			// Row-major A (unit stride along K) is read row by row, the other layouts column by column.
+			const bool bKContiguous = InKSize < 2 || InKOffsets[1] - InKOffsets[0] == 1;
+			const IndexType NumPanels = (InM + MR - 1) / MR;
+			ParallelForIndex(NumPanels, [&](IndexType Panel)
+			{
+				DataType* Out = OutPacked + Panel * MR * InKSize;
+				const IndexType RowBegin = Panel * MR;
+				const int32 NumRows = static_cast<int32>(FMath::Min<IndexType>(MR, InM - RowBegin));
+				if (bKContiguous)
+				{
+					for (int32 i = 0; i < MR; ++i)
+					{
+						const DataType* Row = i < NumRows ? InA + InRowOffsets[RowBegin + i] : nullptr;
+						for (int32 p = 0; p < InKSize; ++p)
+						{
+							Out[p * MR + i] = Row ? Row[InKOffsets[p]] : DataType(0);
+						}
+					}
+				}
+				else
+				{
+					for (int32 p = 0; p < InKSize; ++p)
+					{
+						for (int32 i = 0; i < MR; ++i)
+						{
+							Out[p * MR + i] = i < NumRows ? InA[InRowOffsets[RowBegin + i] + InKOffsets[p]] : DataType(0);
+						}
+					}
+				}
+			}, !bInParallel || NumPanels <= 1);
+		}
+
+		// Packs the columns of B into NR-column panels, K-major inside a panel. The missing columns are zero.
+		static void PackB(const DataType* InB, const IndexType* InKOffsets, const IndexType* InColumnOffsets,
+						  IndexType InN, int32 InKSize, DataType* OutPacked, bool bInParallel)
+		{
+			// Column-major B (unit stride along K) is read column by column, the other layouts row by row.
+			const bool bKContiguous = InKSize >= 2 && InKOffsets[1] - InKOffsets[0] == 1;
+			const IndexType NumPanels = (InN + NR - 1) / NR;
+			ParallelForIndex(NumPanels, [&](IndexType Panel)
+			{
+				DataType* Out = OutPacked + Panel * NR * InKSize;
+				const IndexType ColumnBegin = Panel * NR;
+				const int32 NumColumns = static_cast<int32>(FMath::Min<IndexType>(NR, InN - ColumnBegin));
+				if (bKContiguous)
+				{
+					for (int32 j = 0; j < NR; ++j)
+					{
+						const DataType* Column = j < NumColumns ? InB + InColumnOffsets[ColumnBegin + j] : nullptr;
+						for (int32 p = 0; p < InKSize; ++p)
+						{
+							Out[p * NR + j] = Column ? Column[InKOffsets[p]] : DataType(0);
+						}
+					}
+				}
+				else
+				{
+					for (int32 p = 0; p < InKSize; ++p)
+					{
+						const DataType* Row = InB + InKOffsets[p];
+						for (int32 j = 0; j < NR; ++j)
+						{
+							Out[p * NR + j] = j < NumColumns ? Row[InColumnOffsets[ColumnBegin + j]] : DataType(0);
+						}
+					}
+				}
+			}, !bInParallel || NumPanels <= 1);
+		}
+
+		// C[0:InRows, 0:InColumns] += PanelA * PanelB, the MR x NR accumulators are fixed-size so they stay in registers.
+		FORCEINLINE static void MicroKernel(int32 InKSize, const DataType* RESTRICT InPanelA, const DataType* RESTRICT InPanelB,
+											DataType* OutC, IndexType InRowStride, int32 InRows, int32 InColumns)
+		{
+			DataType Accumulators[MR][NR];
+			if constexpr (std::is_same_v<DataType, float>)
+			{
+				// The float kernel is written with the engine vector registers, 2 per row, so its register allocation
+				// doesn't depend on how the compiler vectorizes the generic loops.
+				static_assert(NR == 8, "The float micro-kernel holds a row in 2 vector registers.");
+				VectorRegister4Float Rows[MR][2];
+				for (int32 i = 0; i < MR; ++i)
+				{
+					Rows[i][0] = VectorZeroFloat();
+					Rows[i][1] = VectorZeroFloat();
+				}
+				for (int32 p = 0; p < InKSize; ++p)
+				{
+					const VectorRegister4Float B0 = VectorLoad(InPanelB + p * NR);
+					const VectorRegister4Float B1 = VectorLoad(InPanelB + p * NR + 4);
+					for (int32 i = 0; i < MR; ++i)
+					{
+						const VectorRegister4Float A = VectorLoadFloat1(InPanelA + p * MR + i);
+						Rows[i][0] = VectorMultiplyAdd(A, B0, Rows[i][0]);
+						Rows[i][1] = VectorMultiplyAdd(A, B1, Rows[i][1]);
+					}
+				}
+				for (int32 i = 0; i < MR; ++i)
+				{
+					VectorStore(Rows[i][0], Accumulators[i]);
+					VectorStore(Rows[i][1], Accumulators[i] + 4);
+				}
+			}
+			else
+			{
+				for (int32 i = 0; i < MR; ++i)
+				{
+					for (int32 j = 0; j < NR; ++j)
+					{
+						Accumulators[i][j] = DataType(0);
+					}
+				}
+				for (int32 p = 0; p < InKSize; ++p)
+				{
+					const DataType* RESTRICT A = InPanelA + p * MR;
+					const DataType* RESTRICT B = InPanelB + p * NR;
+					for (int32 i = 0; i < MR; ++i)
+					{
+						for (int32 j = 0; j < NR; ++j)
+						{
+							Accumulators[i][j] += A[i] * B[j];
+						}
+					}
+				}
+			}
+			for (int32 i = 0; i < InRows; ++i)
+			{
+				DataType* Row = OutC + i * InRowStride;
+				for (int32 j = 0; j < InColumns; ++j)
+				{
+					Row[j] += Accumulators[i][j];
+				}
+			}
+		}
+	};
+
+	// The offset of each coordinate along each axis, Offsets[Dim][Coord]. The sum over the axes plus the offset of the
+	// origin is the storage index, which also holds with a ring origin (the wrap is per axis).
+	template <typename ArrayType>
+	TArray<TArray<typename ArrayType::IndexType>> MakeAxisOffsets_Internal(const ArrayType& InArray)
+	{
+		using IndexType = typename ArrayType::IndexType;
+		const typename ArrayType::CoordinateType Origin{};
+		const IndexType OriginOffset = InArray.GetLinearIndex(Origin);
+		TArray<TArray<IndexType>> Offsets;
+		for (int Dim = 0; Dim < ArrayType::DIM_SIZE; ++Dim)
+		{
+			TArray<IndexType>& AxisOffsets = Offsets.AddDefaulted_GetRef();
+			AxisOffsets.SetNumUninitialized(InArray.GetRuntimeEachDimSize()[Dim]);
+			typename ArrayType::CoordinateType Coord{};
+			for (IndexType i = 0; i < InArray.GetRuntimeEachDimSize()[Dim]; ++i)
+			{
+				Coord[Dim] = i;
+				AxisOffsets[i] = InArray.GetLinearIndex(Coord) - OriginOffset;
+			}
+		}
+		return Offsets;
+	}
+
+	// Folds a group of axes into one matrix dimension: the combined offset of each index, the last axis fastest.
+	template <typename IndexType>
+	TArray<IndexType> FoldAxisOffsets_Internal(const TArray<TArray<IndexType>>& InAxisOffsets, const TArray<int>& InAxes, IndexType InBaseOffset = 0)
+	{
+		TArray<IndexType> Folded = {InBaseOffset};
+		for (const int Axis : InAxes)
+		{
+			TArray<IndexType> Next;
+			Next.Reserve(Folded.Num() * InAxisOffsets[Axis].Num());
+			for (const IndexType Outer : Folded)
+			{
+				for (const IndexType Inner : InAxisOffsets[Axis])
+				{
+					Next.Add(Outer + Inner);
+				}
+			}
+			Folded = MoveTemp(Next);
+		}
+		return Folded;
+	}
+
+	/**
+	 * @brief Tensor contraction, like numpy.tensordot(A, B, axes=(InAxesA, InAxesB)).
+	 *
+	 * Sums the products over the paired axes InAxesA[i] / InAxesB[i], which must have the same size. The result has the
+	 * free axes of A (in order), then the free axes of B (in order), all dynamic, in the default storage order.
+	 * The free axes of each operand are folded into the rows / columns of one GEMM, and the contracted axes into K,
+	 * whatever the storage orders are. See TGemmKernel.
+	 *
+	 * Usage:
+	 * \code
+	 *		ArrayMultiDim::TArrayMultiDim<float, -1, -1, -1> Features;  // [Batch, Time, In]
+	 *		ArrayMultiDim::TArrayMultiDim<float, -1, -1> Weights;  // [In, Out]
+	 *		auto Outputs = ArrayMultiDim::Contract(Features, {2}, Weights, {0});  // [Batch, Time, Out]
+	 * \endcode
+	 */
+	template <typename DataType, typename IndexPolicy, int... DimsA, int... DimsB, int NumAxes>
+	TDynamicArrayMultiDim<DataType, IndexPolicy, static_cast<int>(sizeof...(DimsA) + sizeof...(DimsB)) - 2 * NumAxes>
+	Contract(const TBasicArrayMultiDim<DataType, IndexPolicy, DimsA...>& InA, const int (&InAxesA)[NumAxes],
+			 const TBasicArrayMultiDim<DataType, IndexPolicy, DimsB...>& InB, const int (&InAxesB)[NumAxes])
+	{
+		using IndexType = typename IndexPolicy::IndexType;
+		constexpr int RESULT_DIM_SIZE = static_cast<int>(sizeof...(DimsA) + sizeof...(DimsB)) - 2 * NumAxes;
+		static_assert(RESULT_DIM_SIZE > 0, "The contraction must keep at least one axis.");
+		using ResultType = TDynamicArrayMultiDim<DataType, IndexPolicy, RESULT_DIM_SIZE>;
+
+		const auto& SizeA = InA.GetRuntimeEachDimSize();
+		const auto& SizeB = InB.GetRuntimeEachDimSize();
+		TArray<int> ContractedA, ContractedB, FreeA, FreeB;
+		for (int i = 0; i < NumAxes; ++i)
+		{
+			checkf(InAxesA[i] >= 0 && InAxesA[i] < static_cast<int>(sizeof...(DimsA)) && !ContractedA.Contains(InAxesA[i]),
+				   TEXT("Invalid or repeated axis %d of A."), InAxesA[i]);
+			checkf(InAxesB[i] >= 0 && InAxesB[i] < static_cast<int>(sizeof...(DimsB)) && !ContractedB.Contains(InAxesB[i]),
+				   TEXT("Invalid or repeated axis %d of B."), InAxesB[i]);
+			checkf(SizeA[InAxesA[i]] == SizeB[InAxesB[i]], TEXT("Contracted axes of size %d and %d."),
+				   static_cast<int32>(SizeA[InAxesA[i]]), static_cast<int32>(SizeB[InAxesB[i]]));
+			ContractedA.Add(InAxesA[i]);
+			ContractedB.Add(InAxesB[i]);
+		}
+
+		typename ResultType::ArrayDimType ResultSize;
+		int ResultDim = 0;
+		for (int Dim = 0; Dim < static_cast<int>(sizeof...(DimsA)); ++Dim)
+		{
+			if (!ContractedA.Contains(Dim))
+			{
+				FreeA.Add(Dim);
+				ResultSize[ResultDim++] = SizeA[Dim];
+			}
+		}
+		for (int Dim = 0; Dim < static_cast<int>(sizeof...(DimsB)); ++Dim)
+		{
+			if (!ContractedB.Contains(Dim))
+			{
+				FreeB.Add(Dim);
+				ResultSize[ResultDim++] = SizeB[Dim];
+			}
+		}
+
+		ResultType Result;
+		Result.SetDimSize(ResultSize, EResizeDataCopyPolicy::SetToInitialValue);
+		const TArray<TArray<IndexType>> AxisOffsetsA = MakeAxisOffsets_Internal(InA);
+		const TArray<TArray<IndexType>> AxisOffsetsB = MakeAxisOffsets_Internal(InB);
+		const TArray<IndexType> RowOffsets = FoldAxisOffsets_Internal(AxisOffsetsA, FreeA, InA.GetLinearIndex({}));
+		const TArray<IndexType> ColumnOffsets = FoldAxisOffsets_Internal(AxisOffsetsB, FreeB, InB.GetLinearIndex({}));
+		const TArray<IndexType> KOffsetsA = FoldAxisOffsets_Internal(AxisOffsetsA, ContractedA);
+		const TArray<IndexType> KOffsetsB = FoldAxisOffsets_Internal(AxisOffsetsB, ContractedB);
+		TGemmKernel<DataType, IndexType>::Run(RowOffsets.Num(), ColumnOffsets.Num(), KOffsetsA.Num(),
+											  InA.GetData(), RowOffsets.GetData(), KOffsetsA.GetData(),
+											  InB.GetData(), KOffsetsB.GetData(), ColumnOffsets.GetData(),
+											  Result.GetData());
+		return Result;
+	}
+
+	/**
+	 * @brief Matrix product of 2 matrices, [M, K] x [K, N] -> [M, N], like numpy.matmul(). Any storage order.
+	 */
+	template <typename DataType, typename IndexPolicy, int M, int K1, int K2, int N>
+	TDynamicArrayMultiDim<DataType, IndexPolicy, 2> MatMul(const TBasicArrayMultiDim<DataType, IndexPolicy, M, K1>& InA,
+														  const TBasicArrayMultiDim<DataType, IndexPolicy, K2, N>& InB)
+	{
+		return Contract(InA, {1}, InB, {0});
+	}
+
+	/**
+	 * @brief Batched matrix product, [Batch, M, K] x [Batch, K, N] -> [Batch, M, N], like numpy.matmul() on 3D arrays.
+	 *
+	 * Many small matrices (e.g. one layer of a tiny model evaluated for every agent) run one product per task, the
+	 * large ones run one after the other, each one parallel inside.
+	 */
+	template <typename DataType, typename IndexPolicy, int Batch1, int M, int K1, int Batch2, int K2, int N>
+	TDynamicArrayMultiDim<DataType, IndexPolicy, 3> MatMul(const TBasicArrayMultiDim<DataType, IndexPolicy, Batch1, M, K1>& InA,
+														  const TBasicArrayMultiDim<DataType, IndexPolicy, Batch2, K2, N>& InB)
+	{
+		using IndexType = typename IndexPolicy::IndexType;
+		using KernelType = TGemmKernel<DataType, IndexType>;
+		const auto& SizeA = InA.GetRuntimeEachDimSize();
+		const auto& SizeB = InB.GetRuntimeEachDimSize();
+		checkf(SizeA[0] == SizeB[0] && SizeA[2] == SizeB[1], TEXT("MatMul of [%d, %d, %d] and [%d, %d, %d]."),
+			   static_cast<int32>(SizeA[0]), static_cast<int32>(SizeA[1]), static_cast<int32>(SizeA[2]),
+			   static_cast<int32>(SizeB[0]), static_cast<int32>(SizeB[1]), static_cast<int32>(SizeB[2]));
+
+		TDynamicArrayMultiDim<DataType, IndexPolicy, 3> Result;
+		Result.SetDimSize({SizeA[0], SizeA[1], SizeB[2]}, EResizeDataCopyPolicy::SetToInitialValue);
+		const TArray<TArray<IndexType>> AxisOffsetsA = MakeAxisOffsets_Internal(InA);
+		const TArray<TArray<IndexType>> AxisOffsetsB = MakeAxisOffsets_Internal(InB);
+		const IndexType OriginA = InA.GetLinearIndex({});
+		const IndexType OriginB = InB.GetLinearIndex({});
+		const IndexType MatrixSize = SizeA[1] * SizeB[2];
+		const bool bParallelBatches = static_cast<int64>(MatrixSize) * SizeA[2] < KernelType::PARALLEL_MIN_WORK;
+		DataType* Out = Result.GetData();
+		ParallelForIndex(SizeA[0], [&](IndexType BatchIndex)
+		{
+			const TArray<IndexType> RowOffsets = FoldAxisOffsets_Internal(AxisOffsetsA, {1}, OriginA + AxisOffsetsA[0][BatchIndex]);
+			const TArray<IndexType> ColumnOffsets = FoldAxisOffsets_Internal(AxisOffsetsB, {2}, OriginB + AxisOffsetsB[0][BatchIndex]);
+			KernelType::Run(SizeA[1], SizeB[2], SizeA[2],
+							InA.GetData(), RowOffsets.GetData(), AxisOffsetsA[2].GetData(),
+							InB.GetData(), AxisOffsetsB[1].GetData(), ColumnOffsets.GetData(),
+							Out + BatchIndex * MatrixSize, !bParallelBatches);
+		}, !bParallelBatches || SizeA[0] <= 1);
+		return Result;
+	}
+}
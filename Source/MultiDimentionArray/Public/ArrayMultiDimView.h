@@ -0,0 +1,386 @@
+﻿#pragma once
+#include "ArrayMultiDim.h"
+
+namespace ArrayMultiDim
+{
+	// The owner of adopted memory, shared by a view, its copies and its slices, calls the release function once.
+	template <typename DataType>
+	struct TArrayMultiDimViewOwner
+	{
+		using ReleaseFuncType = std::function<void(DataType* /* InData */)>;
+
+		DataType* Data;
+		ReleaseFuncType ReleaseFunc;
+
+		TArrayMultiDimViewOwner(DataType* InData, ReleaseFuncType&& InReleaseFunc)
+			: Data(InData), ReleaseFunc(MoveTemp(InReleaseFunc))
+		{
+		}
+
+		~TArrayMultiDimViewOwner()
+		{
+			if (ReleaseFunc)
+			{
+				ReleaseFunc(Data);
+			}
+		}
+	};
+
+	/**
+	 * @brief Multi-dimension view over memory that TArrayMultiDim doesn't own: texture readbacks, solver output,
+	 * decoded network blobs, ... No element is copied.
+	 *
+	 * The ownership is explicit in the factory used to create the view:
+	 *	- Borrow(): the caller keeps the memory alive for the lifetime of the view (and of its copies / slices).
+	 *	- Adopt(): the view owns the memory, the release function is called once the last copy of the view is gone.
+	 *	- TArrayMultiDimView(Array): borrows the buffer of a TArrayMultiDim (its ring origin is normalized first).
+	 * To move a TArray into a TArrayMultiDim without copying, use TArrayMultiDim::AdoptData() instead.
+	 *
+	 * The layout is given by a storage order (same as Odr<...> of TArrayMultiDim) or by custom element strides,
+	 * e.g. the row pitch of a texture. Use a const DataType for the read-only views.
+	 *
+	 * Usage:
+	 * \code
+	 *		// A 256x256 readback with a 272-texel row pitch, borrowed.
+	 *		auto Texels = ArrayMultiDim::TArrayMultiDimView<const FColor, -1, -1>::BorrowStrided(Mapped, {256, 256}, {272, 1});
+	 *		FColor Texel = Texels(10, 20);
+	 *		auto Packed = Texels.ToArray();  // An explicit copy.
+	 *
+	 *		// A buffer allocated by another system, released by the view.
+	 *		float* SolverOutput = static_cast<float*>(FMemory::Malloc(64 * 64 * 64 * sizeof(float)));
+	 *		auto Field = ArrayMultiDim::TArrayMultiDimView<float, -1, -1, -1>::Adopt(SolverOutput, {64, 64, 64},
+	 *			[](float* InData) { FMemory::Free(InData); });
+	 * \endcode
+	 *
+	 * @tparam DataType The element type, const for the read-only views.
+	 * @tparam Dims The dimension sizes, same as TArrayMultiDim.
+	 */
+	template <typename DataType, int... Dims>
+	class TArrayMultiDimView
+	{
+	public:
+		using ValueType = std::remove_const_t<DataType>;
+		using DenseArrayType = TArrayMultiDim<ValueType, Dims...>;
+		using IndexType = typename DenseArrayType::IndexType;
+		using ArrayDimType = typename DenseArrayType::ArrayDimType;
+		using CoordinateType = typename DenseArrayType::CoordinateType;
+		using SelfDynamicSizeType = typename DenseArrayType::SelfDynamicSizeType;
+		static constexpr int DIM_SIZE = sizeof...(Dims);
+		static constexpr int DYNAMIC_SIZE = -1;
+		// The view type of the slices, all the dimensions are dynamic since a slice may shrink the fixed ones.
+		using SelfDynamicSizeViewType = TArrayMultiDimView<DataType, (static_cast<void>(Dims), DYNAMIC_SIZE)...>;
+
+		// The element strides, 64-bit so that a view can span more than 2^31 elements of foreign memory.
+		using StrideType = std::array<int64, DIM_SIZE>;
+		using ReleaseFuncType = typename TArrayMultiDimViewOwner<DataType>::ReleaseFuncType;
+
+		using ConstLoopCallbackType = std::function<void(const CoordinateType& InCoordinate, const ValueType& InValue)>;
+		using LoopCallbackType = std::function<void(const CoordinateType& InCoordinate, DataType& InOutValue)>;
+
+		// An empty view.
+		TArrayMultiDimView()
+		{
+		}
+
+		// Borrows the buffer of an array. The view is invalidated by anything that reallocates the array.
+		explicit TArrayMultiDimView(DenseArrayType& InArray) requires (!std::is_const_v<DataType>)
+		{
+			if (InArray.HasRingOrigin())
+			{
+				InArray.NormalizeRingOrigin();
+			}
+			InitFromArray(InArray.GetData(), InArray);
+		}
+
+		explicit TArrayMultiDimView(const DenseArrayType& InArray) requires std::is_const_v<DataType>
+		{
+			checkf(!InArray.HasRingOrigin(), TEXT("Call NormalizeRingOrigin() before viewing an array with a ring origin."));
+			InitFromArray(InArray.GetData(), InArray);
+		}
+
+#pragma region Factories
+
+		// Borrows a buffer in the default storage order (the last dimension is contiguous).
+		static TArrayMultiDimView Borrow(DataType* InData, const ArrayDimType& InSize)
+		{
+			return BorrowStrided(InData, InSize, MakeStrides(InSize, DefaultStorageOrder()));
+		}
+
+		static TArrayMultiDimView Borrow(DataType* InData, const ArrayDimType& InSize, const CoordinateType& InStorageOrder)
+		{
+			return BorrowStrided(InData, InSize, MakeStrides(InSize, InStorageOrder));
+		}
+
+		template <int... OrderList>
+		static TArrayMultiDimView Borrow(DataType* InData, const ArrayDimType& InSize, Odr<OrderList...>)
+		{
+			return BorrowStrided(InData, InSize, MakeStrides(InSize, CoordinateType{OrderList...}));
+		}
+
+		// Borrows a TArrayView, its size must match the shape.
+		static TArrayMultiDimView Borrow(TArrayView<DataType> InView, const ArrayDimType& InSize,
+										 const CoordinateType& InStorageOrder = DefaultStorageOrder())
+		{
+			checkf(InView.Num() == GetElementCount(InSize), TEXT("The view has %lld elements, the shape needs %lld."),
+				   static_cast<int64>(InView.Num()), GetElementCount(InSize));
+			return BorrowStrided(InView.GetData(), InSize, MakeStrides(InSize, InStorageOrder));
+		}
+
+		// Borrows a buffer with custom element strides, e.g. padded rows.
+		static TArrayMultiDimView BorrowStrided(DataType* InData, const ArrayDimType& InSize, const StrideType& InStrides)
+		{
+			TArrayMultiDimView Result;
+			Result.Init(InData, InSize, InStrides);
+			return Result;
+		}
+
+		// Takes the ownership of a buffer, InReleaseFunc frees it when the last copy of the view is destroyed.
+		static TArrayMultiDimView Adopt(DataType* InData, const ArrayDimType& InSize, ReleaseFuncType InReleaseFunc,
+										const CoordinateType& InStorageOrder = DefaultStorageOrder())
+		{
+			return AdoptStrided(InData, InSize, MakeStrides(InSize, InStorageOrder), MoveTemp(InReleaseFunc));
+		}
+
+		static TArrayMultiDimView AdoptStrided(DataType* InData, const ArrayDimType& InSize, const StrideType& InStrides,
+											   ReleaseFuncType InReleaseFunc)
+		{
+			TArrayMultiDimView Result;
+			Result.Init(InData, InSize, InStrides);
+			Result.Owner = MakeShared<FOwner, ESPMode::ThreadSafe>(InData, MoveTemp(InReleaseFunc));
+			return Result;
+		}
+
+#pragma endregion Factories
+
+#pragma region Access
+
+		FORCEINLINE DataType& operator()(const CoordinateType& InCoordinate) const
+		{
+			return Data[GetOffset(InCoordinate)];
+		}
+
+		template <typename... T>
+		FORCEINLINE DataType& operator()(T... InElementCoordinate) const
+		{
+			return Data[GetOffset(CoordinateType{static_cast<IndexType>(InElementCoordinate)...})];
+		}
+
+		FORCEINLINE int64 GetOffset(const CoordinateType& InCoordinate) const
+		{
+			int64 Offset = 0;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				checkSlow(InCoordinate[i] >= 0 && InCoordinate[i] < EachDimSize[i]);
+				Offset += InCoordinate[i] * Strides[i];
+			}
+			return Offset;
+		}
+
+		DataType* GetData() const { return Data; }
+		const ArrayDimType& GetRuntimeEachDimSize() const { return EachDimSize; }
+		const StrideType& GetStrides() const { return Strides; }
+		int64 GetTotalSize() const { return GetElementCount(EachDimSize); }
+		bool IsValid() const { return Data != nullptr; }
+
+		// True if the view owns its memory (Adopt()), false if it is borrowed.
+		bool IsOwning() const { return Owner.IsValid(); }
+
+		// True if the elements are densely packed (in any storage order), so GetData() spans GetTotalSize() elements.
+		bool IsContiguous() const
+		{
+			std::array<int, DIM_SIZE> DimsBySize;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				DimsBySize[i] = i;
+			}
+			std::sort(DimsBySize.begin(), DimsBySize.end(), [&](int A, int B) { return Strides[A] < Strides[B]; });
+			int64 ExpectedStride = 1;
+			for (const int Dim : DimsBySize)
+			{
+				if (EachDimSize[Dim] != 1 && Strides[Dim] != ExpectedStride)
+				{
+					return false;
+				}
+				ExpectedStride *= EachDimSize[Dim];
+			}
+			return true;
+		}
+
+		/**
+		 * A sub-view, no element is copied, the ownership is shared. Same semantics as TArrayMultiDim::Slice():
+		 * a single index keeps the dimension with size 1. The sub-view has dynamic sizes, like the result of
+		 * TArrayMultiDim::Slice().
+		 */
+		SelfDynamicSizeViewType Slice(std::initializer_list<FSlice> InSlices) const
+		{
+			check(static_cast<int>(InSlices.size()) == DIM_SIZE);
+			SelfDynamicSizeViewType Result;
+			Result.EachDimSize = EachDimSize;
+			Result.Strides = Strides;
+			Result.Owner = Owner;
+			CoordinateType SliceStart;
+			int Dim = 0;
+			for (const FSlice& SliceObj : InSlices)
+			{
+				if (SliceObj.IsSingle())
+				{
+					SliceStart[Dim] = SliceObj.GetSingle();
+					Result.EachDimSize[Dim] = 1;
+				}
+				else if (SliceObj.IsRanged())
+				{
+					SliceStart[Dim] = SliceObj.GetRangeStart();
+					Result.EachDimSize[Dim] = SliceObj.GetRangeEnd() - SliceObj.GetRangeStart();
+				}
+				else
+				{
+					SliceStart[Dim] = 0;
+				}
+				++Dim;
+			}
+			Result.Data = Data + GetOffset(SliceStart);
+			return Result;
+		}
+
+		void ConstLoopByCoord(const ConstLoopCallbackType& InFunc) const
+		{
+			DenseArrayType::DoNestedLoops(EachDimSize, [&](const CoordinateType& InCoordinate, const IndexType& InLoopCounter)
+			{
+				InFunc(InCoordinate, Data[GetOffset(InCoordinate)]);
+			});
+		}
+
+		void LoopByCoord(const LoopCallbackType& InFunc) const requires (!std::is_const_v<DataType>)
+		{
+			DenseArrayType::DoNestedLoops(EachDimSize, [&](const CoordinateType& InCoordinate, const IndexType& InLoopCounter)
+			{
+				InFunc(InCoordinate, Data[GetOffset(InCoordinate)]);
+			});
+		}
+
+		// Copies the viewed elements into a new array in the default storage order.
+		SelfDynamicSizeType ToArray() const
+		{
+			SelfDynamicSizeType Result;
+			Result.SetDimSize(EachDimSize, EResizeDataCopyPolicy::SetToUninitializedValue);
+			ValueType* ResultData = Result.GetData();
+			if (IsContiguous() && Strides == MakeStrides(EachDimSize, DefaultStorageOrder()))
+			{
+				FMemory::Memcpy(ResultData, Data, sizeof(ValueType) * GetTotalSize());
+				return Result;
+			}
+			ConstLoopByCoord([&, Index = int64(0)](const CoordinateType& InCoordinate, const ValueType& InValue) mutable
+			{
+				ResultData[Index++] = InValue;
+			});
+			return Result;
+		}
+
+#pragma endregion Access
+
+#pragma region Histogram
+
+		// Same as TArrayMultiDim::Histogram(), counts the viewed elements in place.
+		TArray<int64> Histogram(int32 InNumBins, ValueType InMin, ValueType InMax) const
+		{
+			return DenseArrayType::HistogramRegion(MakeStridedRegion(), InNumBins, InMin, InMax);
+		}
+
+		TArray<int64> Histogram(TConstArrayView<ValueType> InBinEdges) const
+		{
+			return DenseArrayType::HistogramRegion(MakeStridedRegion(), InBinEdges);
+		}
+
+		// Same as TArrayMultiDim::CountUnique().
+		TArray<TPair<ValueType, int64>> CountUnique() const
+		{
+			return DenseArrayType::CountUniqueRegion(MakeStridedRegion());
+		}
+
+		typename DenseArrayType::FStridedRegion MakeStridedRegion() const
+		{
+			typename DenseArrayType::FStridedRegion Region;
+			Region.Data = Data;
+			for (int Dim = 0; Dim < DIM_SIZE; ++Dim)
+			{
+				Region.AxisOffsets[Dim].SetNumUninitialized(EachDimSize[Dim]);
+				for (int32 i = 0; i < EachDimSize[Dim]; ++i)
+				{
+					Region.AxisOffsets[Dim][i] = i * Strides[Dim];
+				}
+			}
+			return Region;
+		}
+
+#pragma endregion Histogram
+
+		static CoordinateType DefaultStorageOrder()
+		{
+			CoordinateType Order;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				Order[i] = DIM_SIZE - 1 - i;
+			}
+			return Order;
+		}
+
+		// The packed strides of a storage order, InStorageOrder[0] is the contiguous dimension (same as TArrayMultiDim).
+		static StrideType MakeStrides(const ArrayDimType& InSize, const CoordinateType& InStorageOrder)
+		{
+			StrideType Result;
+			int64 CurrentStride = 1;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				Result[InStorageOrder[i]] = CurrentStride;
+				CurrentStride *= InSize[InStorageOrder[i]];
+			}
+			return Result;
+		}
+
+	private:
+		template <typename, int...>
+		friend class TArrayMultiDimView;
+
+		using FOwner = TArrayMultiDimViewOwner<DataType>;
+
+		static int64 GetElementCount(const ArrayDimType& InSize)
+		{
+			int64 Count = 1;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				Count *= InSize[i];
+			}
+			return Count;
+		}
+
+		void Init(DataType* InData, const ArrayDimType& InSize, const StrideType& InStrides)
+		{
+			constexpr std::array<int, DIM_SIZE> CompileTimeEachDimSize = {Dims...};
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				checkf(CompileTimeEachDimSize[i] == DYNAMIC_SIZE || CompileTimeEachDimSize[i] == InSize[i],
+					   TEXT("Dimension %d is fixed to %d, cannot view a buffer of size %d."), i, CompileTimeEachDimSize[i], static_cast<int32>(InSize[i]));
+				checkf(InSize[i] >= 0, TEXT("Negative size of dimension %d."), i);
+			}
+			Data = InData;
+			EachDimSize = InSize;
+			Strides = InStrides;
+		}
+
+		template <typename PointerType>
+		void InitFromArray(PointerType InData, const DenseArrayType& InArray)
+		{
+			StrideType ArrayStrides;
+			for (int i = 0; i < DIM_SIZE; ++i)
+			{
+				ArrayStrides[i] = InArray.GetRuntimeStride()[i];
+			}
+			Init(InData, InArray.GetRuntimeEachDimSize(), ArrayStrides);
+		}
+
+		DataType* Data = nullptr;
+		ArrayDimType EachDimSize{};
+		StrideType Strides{};
+		TSharedPtr<FOwner, ESPMode::ThreadSafe> Owner;
+	};
+}